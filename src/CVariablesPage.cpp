@@ -208,10 +208,10 @@ CVariablesPage::OnDeviceComboBoxSelectionChange()
         lvGroup.iGroupId = iGroupId;
         ListView_InsertGroup(m_hList, iGroupId, &lvGroup);
 
-        for (const auto& Symbol : Block.Symbols)
+        for (const auto& Symbol : Block.GetSymbols())
         {
             std::wstring wstrName = StrToWstr(Symbol.strName);
-            std::wstring wstrCode = StrToWstr(Symbol.strCode);
+            std::wstring wstrCode = StrToWstr(Block.GetCode(Symbol));
             std::wstring wstrDatatype = StrToWstr(Symbol.strDatatype);
             std::wstring wstrComment = StrToWstr(Symbol.strComment);
 
@@ -0,0 +1,355 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+// Usage: S7PBench [--corpus FOLDER] [--project S7PFILE] [--filter NAME] [--min-time SECONDS]
+//                 [--output CSVFILE] [--baseline CSVFILE] [--tolerance PERCENT]
+//
+// Runs all benchmarks whose name contains the filter and writes their metrics as "BENCHMARK;CASE;METRIC;VALUE;BETTER" lines
+// to the output file (or stdout). Benchmarks marked as needing a project are skipped without --project.
+// With --baseline, every metric is compared against the same metric of a previous output file.
+// The exit code is 0 on success, 1 on errors, and 2 if any metric is worse than its baseline by more than the tolerance.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <new>
+#include <windows.h>
+#include <EnlyzeWinStringLib.h>
+
+#include "s7p_bench.h"
+
+struct BenchInfo
+{
+    const char* szName;
+    S7PBenchFunction pFunction;
+    bool bNeedsProject;
+};
+
+static const BenchInfo _Benchmarks[] = {
+    {"mc5code", BenchMc5codeParser, false},
+    {"mc5code_scanner", BenchMc5codeScanner, false},
+    {"read_planner", BenchReadPlanner, false},
+    {"decode_plan", BenchDecodePlan, false},
+    {"snapshot_delta", BenchSnapshotDelta, false},
+    {"query_server", BenchQueryServer, false},
+    {"statistics", BenchStatistics, false},
+    {"name_table", BenchNameTable, false},
+    {"reparse", BenchReparse, true},
+};
+
+static std::atomic<size_t> _AllocationCount;
+
+
+// Count all heap allocations, so that benchmarks can report allocations per symbol.
+// The array and nothrow forms of operator new forward to this one.
+void*
+operator new(size_t Size)
+{
+    _AllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    void* p = malloc(Size ? Size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void
+operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void
+operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+
+static std::string
+_FormatMetric(const S7PBenchMetric& Metric)
+{
+    char szValue[32];
+    snprintf(szValue, sizeof(szValue), "%.6g", Metric.Value);
+
+    return Metric.strBenchmark + ";" + Metric.strCase + ";" + Metric.strName + ";" + szValue + ";" + (Metric.bHigherIsBetter ? "higher" : "lower") + "\n";
+}
+
+static std::variant<std::vector<S7PBenchMetric>, CS7PError>
+_LoadBaseline(const std::wstring& wstrFilePath)
+{
+    auto ReadResult = ReadBenchFile(wstrFilePath);
+    if (const auto pError = std::get_if<CS7PError>(&ReadResult))
+    {
+        return *pError;
+    }
+
+    const std::string& strContent = std::get<std::string>(ReadResult);
+    std::vector<S7PBenchMetric> Metrics;
+    size_t LineStart = 0;
+
+    while (LineStart < strContent.size())
+    {
+        size_t LineEnd = strContent.find('\n', LineStart);
+        if (LineEnd == std::string::npos)
+        {
+            LineEnd = strContent.size();
+        }
+
+        std::string strLine = strContent.substr(LineStart, LineEnd - LineStart);
+        LineStart = LineEnd + 1;
+
+        if (!strLine.empty() && strLine.back() == '\r')
+        {
+            strLine.pop_back();
+        }
+
+        if (strLine.empty() || strLine.starts_with("BENCHMARK;"))
+        {
+            continue;
+        }
+
+        std::vector<std::string> Fields;
+        size_t FieldStart = 0;
+        for (;;)
+        {
+            const size_t FieldEnd = strLine.find(';', FieldStart);
+            Fields.push_back(strLine.substr(FieldStart, FieldEnd - FieldStart));
+            if (FieldEnd == std::string::npos)
+            {
+                break;
+            }
+
+            FieldStart = FieldEnd + 1;
+        }
+
+        if (Fields.size() != 5)
+        {
+            return CS7PError(wstrFilePath + L": Invalid line \"" + StrToWstr(strLine) + L"\"");
+        }
+
+        S7PBenchMetric& Metric = Metrics.emplace_back();
+        Metric.strBenchmark = Fields[0];
+        Metric.strCase = Fields[1];
+        Metric.strName = Fields[2];
+        Metric.Value = strtod(Fields[3].c_str(), nullptr);
+        Metric.bHigherIsBetter = (Fields[4] == "higher");
+    }
+
+    return Metrics;
+}
+
+static bool
+_CompareWithBaseline(const std::vector<S7PBenchMetric>& Metrics, const std::vector<S7PBenchMetric>& BaselineMetrics, double TolerancePercent)
+{
+    bool bRegression = false;
+
+    for (const S7PBenchMetric& Metric : Metrics)
+    {
+        const auto it = std::find_if(BaselineMetrics.begin(), BaselineMetrics.end(), [&](const S7PBenchMetric& BaselineMetric)
+        {
+            return BaselineMetric.strBenchmark == Metric.strBenchmark && BaselineMetric.strCase == Metric.strCase && BaselineMetric.strName == Metric.strName;
+        });
+
+        const std::wstring wstrMetricName = StrToWstr(Metric.strBenchmark + "/" + Metric.strCase + "/" + Metric.strName);
+        if (it == BaselineMetrics.end() || it->Value == 0.0)
+        {
+            fwprintf(stderr, L"%-60ls %12.6g  (not in baseline)\n", wstrMetricName.c_str(), Metric.Value);
+            continue;
+        }
+
+        const double ChangePercent = (Metric.Value - it->Value) * 100.0 / it->Value;
+        const bool bWorse = Metric.bHigherIsBetter ? (ChangePercent < -TolerancePercent) : (ChangePercent > TolerancePercent);
+        if (bWorse)
+        {
+            bRegression = true;
+        }
+
+        fwprintf(stderr, L"%-60ls %12.6g -> %12.6g  %+7.1f%%%ls\n", wstrMetricName.c_str(), it->Value, Metric.Value, ChangePercent, bWorse ? L"  REGRESSION" : L"");
+    }
+
+    return bRegression;
+}
+
+static std::variant<std::monostate, CS7PError>
+_WriteOutput(const std::wstring& wstrFilePath, const std::string& strOutput)
+{
+    if (wstrFilePath.empty())
+    {
+        fputs(strOutput.c_str(), stdout);
+        return std::monostate();
+    }
+
+    HANDLE hFile = CreateFileW(wstrFilePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not create " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    DWORD BytesWritten;
+    const BOOL bWritten = WriteFile(hFile, strOutput.data(), static_cast<DWORD>(strOutput.size()), &BytesWritten, nullptr);
+    const DWORD dwWriteError = GetLastError();
+    CloseHandle(hFile);
+    if (!bWritten || BytesWritten != strOutput.size())
+    {
+        return CS7PError(L"Could not write " + wstrFilePath + L", error " + std::to_wstring(dwWriteError));
+    }
+
+    return std::monostate();
+}
+
+static int
+_Fail(const std::wstring& wstrMessage)
+{
+    fwprintf(stderr, L"%ls\n", wstrMessage.c_str());
+    return 1;
+}
+
+
+size_t
+GetBenchAllocationCount()
+{
+    return _AllocationCount.load(std::memory_order_relaxed);
+}
+
+double
+MeasureMedianNanoseconds(const S7PBenchOptions& Options, const std::function<void()>& Function)
+{
+    const auto MinDuration = std::chrono::duration<double>(Options.MinSeconds);
+    const auto StartTime = std::chrono::steady_clock::now();
+    std::vector<double> Nanoseconds;
+
+    do
+    {
+        const auto CallStartTime = std::chrono::steady_clock::now();
+        Function();
+        const auto CallEndTime = std::chrono::steady_clock::now();
+
+        Nanoseconds.push_back(std::chrono::duration<double, std::nano>(CallEndTime - CallStartTime).count());
+    }
+    while (Nanoseconds.size() < 3 || std::chrono::steady_clock::now() - StartTime < MinDuration);
+
+    std::nth_element(Nanoseconds.begin(), Nanoseconds.begin() + Nanoseconds.size() / 2, Nanoseconds.end());
+    return std::max(Nanoseconds[Nanoseconds.size() / 2], 1.0);
+}
+
+int
+wmain(int argc, wchar_t* argv[])
+{
+    S7PBenchOptions Options;
+    std::wstring wstrOutputFilePath;
+    std::wstring wstrBaselineFilePath;
+    double TolerancePercent = 10.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::wstring wstrArgument = argv[i];
+        if (i + 1 == argc)
+        {
+            return _Fail(L"Missing value for " + wstrArgument);
+        }
+
+        const wchar_t* pwszValue = argv[++i];
+
+        if (wstrArgument == L"--corpus")
+        {
+            Options.wstrCorpusFolderPath = pwszValue;
+        }
+        else if (wstrArgument == L"--project")
+        {
+            Options.wstrProjectFilePath = pwszValue;
+        }
+        else if (wstrArgument == L"--filter")
+        {
+            Options.wstrFilter = pwszValue;
+        }
+        else if (wstrArgument == L"--min-time")
+        {
+            Options.MinSeconds = wcstod(pwszValue, nullptr);
+        }
+        else if (wstrArgument == L"--output")
+        {
+            wstrOutputFilePath = pwszValue;
+        }
+        else if (wstrArgument == L"--baseline")
+        {
+            wstrBaselineFilePath = pwszValue;
+        }
+        else if (wstrArgument == L"--tolerance")
+        {
+            TolerancePercent = wcstod(pwszValue, nullptr);
+        }
+        else
+        {
+            return _Fail(L"Unknown argument " + wstrArgument);
+        }
+    }
+
+    auto LoadResult = LoadBenchCorpus(Options.Corpus, Options.wstrCorpusFolderPath);
+    if (const auto pError = std::get_if<CS7PError>(&LoadResult))
+    {
+        return _Fail(pError->Message());
+    }
+
+    std::vector<S7PBenchMetric> Metrics;
+
+    for (const BenchInfo& Benchmark : _Benchmarks)
+    {
+        const std::wstring wstrName = StrToWstr(Benchmark.szName);
+        if (wstrName.find(Options.wstrFilter) == std::wstring::npos)
+        {
+            continue;
+        }
+
+        if (Benchmark.bNeedsProject && Options.wstrProjectFilePath.empty())
+        {
+            fwprintf(stderr, L"Skipping %ls, because it needs --project\n", wstrName.c_str());
+            continue;
+        }
+
+        fwprintf(stderr, L"Running %ls\n", wstrName.c_str());
+
+        auto BenchResult = Benchmark.pFunction(Options, Metrics);
+        if (const auto pError = std::get_if<CS7PError>(&BenchResult))
+        {
+            return _Fail(wstrName + L": " + pError->Message());
+        }
+    }
+
+    std::string strOutput = "BENCHMARK;CASE;METRIC;VALUE;BETTER\n";
+    for (const S7PBenchMetric& Metric : Metrics)
+    {
+        strOutput += _FormatMetric(Metric);
+    }
+
+    auto WriteResult = _WriteOutput(wstrOutputFilePath, strOutput);
+    if (const auto pError = std::get_if<CS7PError>(&WriteResult))
+    {
+        return _Fail(pError->Message());
+    }
+
+    if (!wstrBaselineFilePath.empty())
+    {
+        auto BaselineResult = _LoadBaseline(wstrBaselineFilePath);
+        if (const auto pError = std::get_if<CS7PError>(&BaselineResult))
+        {
+            return _Fail(pError->Message());
+        }
+
+        if (_CompareWithBaseline(Metrics, std::get<std::vector<S7PBenchMetric>>(BaselineResult), TolerancePercent))
+        {
+            return 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_parser.h"
+
+// A single block of a corpus file, e.g. {"UDT", 5, "STRUCT\r\n..."}.
+struct S7PBenchCorpusBlock
+{
+    std::string strType;
+    size_t Number = 0;
+    std::string strMc5code;
+};
+
+// A corpus file from the corpus folder.
+// Every case is named after its file, e.g. "deep_struct" for "deep_struct.mc5".
+struct S7PBenchCorpusCase
+{
+    std::string strName;
+    std::vector<S7PBenchCorpusBlock> Blocks;
+
+    // The MC5 Code of all blocks by block type and block number, as ParseMc5code expects it.
+    std::map<std::string, std::map<size_t, std::string>> Mc5code;
+
+    // Number of variable declarations in all blocks, i.e. lines with a colon outside a comment.
+    size_t DeclarationCount = 0;
+
+    // Number of symbols the case must parse into, if given by a "#SYMBOLS <count>" line.
+    std::optional<size_t> ExpectedSymbolCount;
+    size_t ByteSize = 0;
+};
+
+// Parse result of a corpus case or of the project given via --project, as input for benchmarks working on symbols.
+struct S7PBenchLayout
+{
+    std::string strName;
+    std::vector<S7DeviceSymbolInfo> DeviceSymbolInfos;
+};
+
+struct S7PBenchOptions
+{
+    std::wstring wstrCorpusFolderPath = L"corpus";
+    std::wstring wstrProjectFilePath;
+    std::wstring wstrFilter;
+    double MinSeconds = 1.0;
+    std::vector<S7PBenchCorpusCase> Corpus;
+};
+
+struct S7PBenchMetric
+{
+    std::string strBenchmark;
+    std::string strCase;
+    std::string strName;
+    double Value = 0.0;
+    bool bHigherIsBetter = false;
+};
+
+using S7PBenchFunction = std::variant<std::monostate, CS7PError> (*)(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// S7PBench.cpp
+// Number of heap allocations made via operator new since the start of the program.
+size_t GetBenchAllocationCount();
+
+// Calls Function repeatedly for at least Options.MinSeconds and 3 times, and returns the median duration of a call in nanoseconds.
+double MeasureMedianNanoseconds(const S7PBenchOptions& Options, const std::function<void()>& Function);
+
+// s7p_bench_corpus.cpp
+std::variant<std::string, CS7PError> ReadBenchFile(const std::wstring& wstrFilePath);
+std::variant<std::monostate, CS7PError> LoadBenchCorpus(std::vector<S7PBenchCorpusCase>& Corpus, const std::wstring& wstrCorpusFolderPath);
+std::variant<std::vector<S7PBenchLayout>, CS7PError> ParseBenchLayouts(const S7PBenchOptions& Options, const S7ParseOptions& ParseOptions);
+
+// s7p_bench_decode_plan.cpp
+std::variant<std::monostate, CS7PError> BenchDecodePlan(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// s7p_bench_mc5code.cpp
+std::variant<std::monostate, CS7PError> BenchMc5codeParser(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// s7p_bench_mc5code_scanner.cpp
+std::variant<std::monostate, CS7PError> BenchMc5codeScanner(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// s7p_bench_name_table.cpp
+std::variant<std::monostate, CS7PError> BenchNameTable(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// s7p_bench_query_server.cpp
+std::variant<std::monostate, CS7PError> BenchQueryServer(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// s7p_bench_read_planner.cpp
+std::variant<std::monostate, CS7PError> BenchReadPlanner(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// s7p_bench_reparse.cpp
+std::variant<std::monostate, CS7PError> BenchReparse(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// s7p_bench_snapshot_delta.cpp
+std::variant<std::monostate, CS7PError> BenchSnapshotDelta(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
+
+// s7p_bench_statistics.cpp
+std::variant<std::monostate, CS7PError> BenchStatistics(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics);
@@ -0,0 +1,231 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <windows.h>
+#include <EnlyzeWinStringLib.h>
+
+#include "s7p_bench.h"
+#include "s7p_db_parser.h"
+
+
+static std::variant<std::monostate, CS7PError>
+_ParseCorpusFile(S7PBenchCorpusCase& Case, const std::string& strContent, const std::wstring& wstrFilePath)
+{
+    // Every block starts with a "#BLOCK <type> <number>" line, followed by its MC5 Code.
+    // Anything before the first block describes the case, except for an optional "#SYMBOLS <count>" line.
+    // MC5 Code in a Subblock List always has CRLF line endings, so the lines are joined that way regardless of how the file was checked out.
+    S7PBenchCorpusBlock* pBlock = nullptr;
+    size_t LineStart = 0;
+    size_t LineNumber = 0;
+
+    while (LineStart < strContent.size())
+    {
+        size_t LineEnd = strContent.find('\n', LineStart);
+        if (LineEnd == std::string::npos)
+        {
+            LineEnd = strContent.size();
+        }
+
+        std::string strLine = strContent.substr(LineStart, LineEnd - LineStart);
+        if (!strLine.empty() && strLine.back() == '\r')
+        {
+            strLine.pop_back();
+        }
+
+        LineStart = LineEnd + 1;
+        LineNumber++;
+
+        if (strLine.starts_with("#BLOCK "))
+        {
+            const size_t SpacePosition = strLine.find(' ', 7);
+            if (SpacePosition == std::string::npos)
+            {
+                return CS7PError(wstrFilePath + L": Invalid block header in line " + std::to_wstring(LineNumber));
+            }
+
+            auto NumberOption = StrToSizeT(strLine.substr(SpacePosition + 1));
+            if (!NumberOption.has_value())
+            {
+                return CS7PError(wstrFilePath + L": Invalid block number in line " + std::to_wstring(LineNumber));
+            }
+
+            pBlock = &Case.Blocks.emplace_back();
+            pBlock->strType = strLine.substr(7, SpacePosition - 7);
+            pBlock->Number = NumberOption.value();
+            continue;
+        }
+
+        if (!pBlock)
+        {
+            if (strLine.starts_with("#SYMBOLS "))
+            {
+                Case.ExpectedSymbolCount = StrToSizeT(strLine.substr(9));
+                if (!Case.ExpectedSymbolCount.has_value())
+                {
+                    return CS7PError(wstrFilePath + L": Invalid symbol count in line " + std::to_wstring(LineNumber));
+                }
+            }
+
+            continue;
+        }
+
+        const size_t CommentPosition = strLine.find("//");
+        if (strLine.find(':') < CommentPosition)
+        {
+            Case.DeclarationCount++;
+        }
+
+        pBlock->strMc5code += strLine;
+        pBlock->strMc5code += "\r\n";
+    }
+
+    if (Case.Blocks.empty())
+    {
+        return CS7PError(wstrFilePath + L" contains no blocks");
+    }
+
+    for (const S7PBenchCorpusBlock& Block : Case.Blocks)
+    {
+        if (!Case.Mc5code[Block.strType].emplace(Block.Number, Block.strMc5code).second)
+        {
+            return CS7PError(wstrFilePath + L" contains " + StrToWstr(Block.strType) + std::to_wstring(Block.Number) + L" twice");
+        }
+
+        Case.ByteSize += Block.strMc5code.size();
+    }
+
+    return std::monostate();
+}
+
+
+std::variant<std::string, CS7PError>
+ReadBenchFile(const std::wstring& wstrFilePath)
+{
+    HANDLE hFile = CreateFileW(wstrFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not open " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(hFile, &FileSize))
+    {
+        CloseHandle(hFile);
+        return CS7PError(L"Could not get the size of " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    if (FileSize.QuadPart > UINT32_MAX / 2)
+    {
+        CloseHandle(hFile);
+        return CS7PError(wstrFilePath + L" is too large");
+    }
+
+    std::string strContent(static_cast<size_t>(FileSize.QuadPart), '\0');
+    DWORD BytesRead;
+    const BOOL bRead = ReadFile(hFile, strContent.data(), static_cast<DWORD>(strContent.size()), &BytesRead, nullptr);
+    const DWORD dwReadError = GetLastError();
+    CloseHandle(hFile);
+    if (!bRead || BytesRead != strContent.size())
+    {
+        return CS7PError(L"Could not read " + wstrFilePath + L", error " + std::to_wstring(dwReadError));
+    }
+
+    return strContent;
+}
+
+std::variant<std::monostate, CS7PError>
+LoadBenchCorpus(std::vector<S7PBenchCorpusCase>& Corpus, const std::wstring& wstrCorpusFolderPath)
+{
+    std::vector<std::wstring> FileNames;
+
+    WIN32_FIND_DATAW FindData;
+    HANDLE hFind = FindFirstFileW((wstrCorpusFolderPath + L"\\*").c_str(), &FindData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not open the corpus folder " + wstrCorpusFolderPath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    do
+    {
+        const std::wstring wstrFileName = FindData.cFileName;
+        if (!(FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && wstrFileName.size() > 4 &&
+            _wcsicmp(wstrFileName.c_str() + wstrFileName.size() - 4, L".mc5") == 0)
+        {
+            FileNames.push_back(wstrFileName);
+        }
+    }
+    while (FindNextFileW(hFind, &FindData));
+
+    FindClose(hFind);
+
+    if (FileNames.empty())
+    {
+        return CS7PError(L"The corpus folder " + wstrCorpusFolderPath + L" contains no .mc5 files");
+    }
+
+    // Keep the order of the results stable.
+    std::sort(FileNames.begin(), FileNames.end());
+
+    for (const std::wstring& wstrFileName : FileNames)
+    {
+        const std::wstring wstrFilePath = wstrCorpusFolderPath + L"\\" + wstrFileName;
+        auto ReadResult = ReadBenchFile(wstrFilePath);
+        if (const auto pError = std::get_if<CS7PError>(&ReadResult))
+        {
+            return *pError;
+        }
+
+        S7PBenchCorpusCase& Case = Corpus.emplace_back();
+        Case.strName = WstrToStr(wstrFileName.substr(0, wstrFileName.size() - 4));
+
+        auto ParseResult = _ParseCorpusFile(Case, std::get<std::string>(ReadResult), wstrFilePath);
+        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        {
+            return *pError;
+        }
+    }
+
+    return std::monostate();
+}
+
+std::variant<std::vector<S7PBenchLayout>, CS7PError>
+ParseBenchLayouts(const S7PBenchOptions& Options, const S7ParseOptions& ParseOptions)
+{
+    std::vector<S7PBenchLayout> Layouts;
+
+    for (const S7PBenchCorpusCase& Case : Options.Corpus)
+    {
+        S7PBenchLayout& Layout = Layouts.emplace_back();
+        Layout.strName = Case.strName;
+
+        S7DeviceSymbolInfo& DeviceSymbolInfo = Layout.DeviceSymbolInfos.emplace_back();
+        DeviceSymbolInfo.strName = Case.strName;
+
+        size_t ProjectSymbolCount = 0;
+        auto ParseResult = ParseMc5code(DeviceSymbolInfo, Case.Mc5code, ParseOptions, ProjectSymbolCount);
+        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        {
+            return *pError;
+        }
+    }
+
+    if (!Options.wstrProjectFilePath.empty())
+    {
+        auto ParseResult = ParseS7P(Options.wstrProjectFilePath, ParseOptions);
+        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        {
+            return *pError;
+        }
+
+        S7PBenchLayout& Layout = Layouts.emplace_back();
+        Layout.strName = "project";
+        Layout.DeviceSymbolInfos = std::get<std::vector<S7DeviceSymbolInfo>>(std::move(ParseResult));
+    }
+
+    return Layouts;
+}
@@ -0,0 +1,322 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include <EnlyzeWinStringLib.h>
+
+#include "CS7DecodePlan.h"
+#include "s7p_bench.h"
+
+struct ReferenceType
+{
+    const char* szName;
+    uint32_t Size;
+    bool bSigned;
+    bool bReal;
+};
+
+// Big-endian datatypes decoded by the vector kernels of CS7DecodePlan.
+static const ReferenceType _ReferenceTypes[] = {
+    {"INT", 2, true, false},
+    {"WORD", 2, false, false},
+    {"DATE", 2, false, false},
+    {"S5TIME", 2, false, false},
+    {"DINT", 4, true, false},
+    {"DWORD", 4, false, false},
+    {"TIME", 4, true, false},
+    {"TIME_OF_DAY", 4, false, false},
+    {"REAL", 4, false, true},
+};
+
+// Element counts of the arrays in the synthetic DB, covering every remainder of the 4 and 8 values decoded per vector iteration.
+static const uint32_t _SyntheticElementCounts[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33 };
+
+static const uint32_t _LongArrayElementCount = 4096;
+
+
+static const ReferenceType*
+_FindReferenceType(const std::string& strDatatype)
+{
+    std::string_view ElementType = strDatatype;
+    const size_t OfPosition = ElementType.find(" OF ");
+    if (OfPosition != std::string_view::npos)
+    {
+        ElementType = ElementType.substr(OfPosition + 4);
+    }
+
+    for (const ReferenceType& Type : _ReferenceTypes)
+    {
+        if (ElementType == Type.szName)
+        {
+            return &Type;
+        }
+    }
+
+    return nullptr;
+}
+
+static std::variant<std::monostate, CS7PError>
+_CheckAgainstScalarDecode(const S7Block& Block, const std::vector<uint8_t>& Snapshot, const std::string& strCase)
+{
+    // Decode every value of the supported datatypes byte by byte and compare it with the result of the plan.
+    CS7DecodePlan Plan(Block, S7Area::DB);
+    S7DecodedValues Values;
+    auto DecodeResult = Plan.Decode(Values, Snapshot.data(), Snapshot.size());
+    if (const auto pError = std::get_if<CS7PError>(&DecodeResult))
+    {
+        return *pError;
+    }
+
+    const std::vector<S7Symbol>& Symbols = Block.GetSymbols();
+    for (size_t i = 0; i < Symbols.size(); i++)
+    {
+        const S7Symbol& Symbol = Symbols[i];
+        const ReferenceType* pType = _FindReferenceType(Symbol.strDatatype);
+        if (!pType || Symbol.Address.Area != S7Area::DB || !Symbol.strRawCode.empty())
+        {
+            continue;
+        }
+
+        const S7DecodedSymbol& DecodedSymbol = Plan.GetSymbols()[i];
+        const uint32_t ElementCount = std::max<uint32_t>(Symbol.Address.ElementCount, 1);
+        const uint8_t* p = Snapshot.data() + Symbol.Address.BitOffset / 8;
+
+        for (uint32_t j = 0; j < ElementCount; j++, p += pType->Size)
+        {
+            uint32_t Bits = 0;
+            for (uint32_t k = 0; k < pType->Size; k++)
+            {
+                Bits = (Bits << 8) | p[k];
+            }
+
+            bool bEqual;
+            if (pType->bReal)
+            {
+                float Real;
+                memcpy(&Real, &Bits, sizeof(float));
+                bEqual = DecodedSymbol.Kind == S7ValueKind::Real && memcmp(&Values.Reals[DecodedSymbol.FirstValueIndex + j], &Real, sizeof(float)) == 0;
+            }
+            else
+            {
+                int64_t Integer = Bits;
+                if (pType->bSigned)
+                {
+                    Integer = (pType->Size == 2) ? static_cast<int16_t>(Bits) : static_cast<int32_t>(Bits);
+                }
+
+                bEqual = DecodedSymbol.Kind == S7ValueKind::Integer && Values.Integers[DecodedSymbol.FirstValueIndex + j] == Integer;
+            }
+
+            if (!bEqual)
+            {
+                return CS7PError(L"Case " + StrToWstr(strCase) + L": Element " + std::to_wstring(j) + L" of " + StrToWstr(Symbol.strName) + L" differs from the scalar decode");
+            }
+        }
+    }
+
+    return std::monostate();
+}
+
+static void
+_AddArraySymbol(S7Block& Block, const ReferenceType& Type, uint32_t ElementCount, uint32_t& BitOffset)
+{
+    S7Symbol& Symbol = Block.Symbols.emplace_back();
+    Symbol.strName = std::string(Type.szName) + "_Array" + std::to_string(ElementCount);
+    Symbol.strDatatype = "ARRAY [1.." + std::to_string(ElementCount) + "] OF " + Type.szName;
+    Symbol.Address.BitOffset = BitOffset;
+    Symbol.Address.BitSize = ElementCount * Type.Size * 8;
+    Symbol.Address.ElementCount = ElementCount;
+    BitOffset += Symbol.Address.BitSize;
+}
+
+static std::vector<uint8_t>
+_MakeRandomSnapshot(uint32_t BitSize)
+{
+    // Random bytes give both signs, NaNs, and denormals.
+    std::vector<uint8_t> Snapshot(BitSize / 8);
+    std::mt19937 Random(42);
+    for (uint8_t& Byte : Snapshot)
+    {
+        Byte = static_cast<uint8_t>(Random());
+    }
+
+    return Snapshot;
+}
+
+static std::variant<std::monostate, CS7PError>
+_CheckSyntheticDb()
+{
+    // A DB with arrays of every supported datatype, followed by the same number of single variables, which the plan merges into one op.
+    S7Block Block;
+    uint32_t BitOffset = 0;
+
+    for (const ReferenceType& Type : _ReferenceTypes)
+    {
+        for (uint32_t ElementCount : _SyntheticElementCounts)
+        {
+            _AddArraySymbol(Block, Type, ElementCount, BitOffset);
+
+            for (uint32_t j = 0; j < ElementCount; j++)
+            {
+                S7Symbol& Symbol = Block.Symbols.emplace_back();
+                Symbol.strName = std::string(Type.szName) + "_Variable" + std::to_string(ElementCount) + "_" + std::to_string(j);
+                Symbol.strDatatype = Type.szName;
+                Symbol.Address.BitOffset = BitOffset;
+                Symbol.Address.BitSize = Type.Size * 8;
+                BitOffset += Symbol.Address.BitSize;
+            }
+
+            // Leave a 2-byte gap before the next run, so that 4-byte values do not always start 4-byte aligned.
+            BitOffset += 16;
+        }
+    }
+
+    return _CheckAgainstScalarDecode(Block, _MakeRandomSnapshot(BitOffset), "synthetic");
+}
+
+static std::variant<std::monostate, CS7PError>
+_BenchLongArrays(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    // Long arrays (e.g. of recorded measurement values) are where the vector kernels of CS7DecodePlan pay off.
+    S7Block Block;
+    uint32_t BitOffset = 0;
+    uint32_t ValueCount = 0;
+
+    for (const ReferenceType& Type : _ReferenceTypes)
+    {
+        _AddArraySymbol(Block, Type, _LongArrayElementCount, BitOffset);
+        ValueCount += _LongArrayElementCount;
+    }
+
+    const std::vector<uint8_t> Snapshot = _MakeRandomSnapshot(BitOffset);
+    auto CheckResult = _CheckAgainstScalarDecode(Block, Snapshot, "long_arrays");
+    if (const auto pError = std::get_if<CS7PError>(&CheckResult))
+    {
+        return *pError;
+    }
+
+    const CS7DecodePlan Plan(Block, S7Area::DB);
+    S7DecodedValues Values;
+    Plan.Decode(Values, Snapshot.data(), Snapshot.size());
+
+    const double Nanoseconds = MeasureMedianNanoseconds(Options, [&]()
+    {
+        Plan.Decode(Values, Snapshot.data(), Snapshot.size());
+    });
+
+    Metrics.push_back({"decode_plan", "long_arrays", "ns_per_value", Nanoseconds / static_cast<double>(ValueCount), false});
+    Metrics.push_back({"decode_plan", "long_arrays", "us_per_64kb", Nanoseconds * 65536.0 / static_cast<double>(Snapshot.size()) / 1000.0, false});
+
+    return std::monostate();
+}
+
+
+std::variant<std::monostate, CS7PError>
+BenchDecodePlan(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    auto ParseResult = ParseBenchLayouts(Options, S7ParseOptions());
+    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    {
+        return *pError;
+    }
+
+    auto CheckResult = _CheckSyntheticDb();
+    if (const auto pError = std::get_if<CS7PError>(&CheckResult))
+    {
+        return *pError;
+    }
+
+    CheckResult = _BenchLongArrays(Options, Metrics);
+    if (const auto pError = std::get_if<CS7PError>(&CheckResult))
+    {
+        return *pError;
+    }
+
+    struct DecodeInfo
+    {
+        std::unique_ptr<CS7DecodePlan> pPlan;
+        std::vector<uint8_t> Snapshot;
+        S7DecodedValues Values;
+    };
+
+    for (const S7PBenchLayout& Layout : std::get<std::vector<S7PBenchLayout>>(ParseResult))
+    {
+        // Compile a plan for every DB and give it a snapshot with some bits set.
+        std::vector<DecodeInfo> Decodes;
+        size_t SnapshotBytes = 0;
+        size_t SymbolCount = 0;
+
+        for (const S7DeviceSymbolInfo& DeviceSymbolInfo : Layout.DeviceSymbolInfos)
+        {
+            for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+            {
+                auto pPlan = std::make_unique<CS7DecodePlan>(Block, S7Area::DB);
+                if (pPlan->GetRequiredBufferSize() == 0)
+                {
+                    continue;
+                }
+
+                DecodeInfo& Decode = Decodes.emplace_back();
+                Decode.Snapshot.resize(pPlan->GetRequiredBufferSize());
+                for (size_t i = 0; i < Decode.Snapshot.size(); i++)
+                {
+                    Decode.Snapshot[i] = static_cast<uint8_t>(i * 37);
+                }
+
+                CheckResult = _CheckAgainstScalarDecode(Block, Decode.Snapshot, Layout.strName);
+                if (const auto pError = std::get_if<CS7PError>(&CheckResult))
+                {
+                    return *pError;
+                }
+
+                SnapshotBytes += Decode.Snapshot.size();
+                SymbolCount += pPlan->GetSymbols().size();
+                Decode.pPlan = std::move(pPlan);
+            }
+        }
+
+        if (Decodes.empty())
+        {
+            continue;
+        }
+
+        // Decode every snapshot once to size all values, so that the measured runs show the steady state of a polling loop.
+        auto DecodeAll = [&]()
+        {
+            for (DecodeInfo& Decode : Decodes)
+            {
+                auto DecodeResult = Decode.pPlan->Decode(Decode.Values, Decode.Snapshot.data(), Decode.Snapshot.size());
+                if (const auto pError = std::get_if<CS7PError>(&DecodeResult))
+                {
+                    return std::variant<std::monostate, CS7PError>(*pError);
+                }
+            }
+
+            return std::variant<std::monostate, CS7PError>();
+        };
+
+        auto DecodeResult = DecodeAll();
+        if (const auto pError = std::get_if<CS7PError>(&DecodeResult))
+        {
+            return *pError;
+        }
+
+        const size_t FirstAllocationCount = GetBenchAllocationCount();
+        DecodeAll();
+        const size_t AllocationCount = GetBenchAllocationCount() - FirstAllocationCount;
+
+        const double Nanoseconds = MeasureMedianNanoseconds(Options, [&]() { DecodeAll(); });
+
+        Metrics.push_back({"decode_plan", Layout.strName, "ns_per_symbol", Nanoseconds / static_cast<double>(SymbolCount), false});
+        Metrics.push_back({"decode_plan", Layout.strName, "us_per_64kb", Nanoseconds * 65536.0 / static_cast<double>(SnapshotBytes) / 1000.0, false});
+        Metrics.push_back({"decode_plan", Layout.strName, "allocations_per_decode", static_cast<double>(AllocationCount) / static_cast<double>(Decodes.size()), false});
+    }
+
+    return std::monostate();
+}
@@ -0,0 +1,72 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <EnlyzeWinStringLib.h>
+
+#include "s7p_bench.h"
+#include "s7p_db_parser.h"
+
+
+std::variant<std::monostate, CS7PError>
+BenchMc5codeParser(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    const S7ParseOptions ParseOptions;
+
+    for (const S7PBenchCorpusCase& Case : Options.Corpus)
+    {
+        // Parse once to count the symbols and allocations, and to make sure the corpus parses without warnings.
+        S7DeviceSymbolInfo DeviceSymbolInfo;
+        DeviceSymbolInfo.strName = Case.strName;
+        size_t ProjectSymbolCount = 0;
+
+        const size_t FirstAllocationCount = GetBenchAllocationCount();
+        auto ParseResult = ParseMc5code(DeviceSymbolInfo, Case.Mc5code, ParseOptions, ProjectSymbolCount);
+        const size_t AllocationCount = GetBenchAllocationCount() - FirstAllocationCount;
+
+        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        {
+            return *pError;
+        }
+
+        if (!DeviceSymbolInfo.Warnings.empty())
+        {
+            return CS7PError(L"Corpus case " + StrToWstr(Case.strName) + L": " + DeviceSymbolInfo.Warnings.front().Message());
+        }
+
+        size_t SymbolCount = 0;
+        for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+        {
+            SymbolCount += Block.GetSymbols().size();
+        }
+
+        if (SymbolCount == 0)
+        {
+            return CS7PError(L"Corpus case " + StrToWstr(Case.strName) + L" has no symbols");
+        }
+
+        if (Case.ExpectedSymbolCount.has_value() && SymbolCount != Case.ExpectedSymbolCount.value())
+        {
+            return CS7PError(
+                L"Corpus case " + StrToWstr(Case.strName) + L" has " + std::to_wstring(SymbolCount) +
+                L" symbols instead of " + std::to_wstring(Case.ExpectedSymbolCount.value())
+            );
+        }
+
+        // The parse includes destroying its result, because every real parse eventually does that too.
+        const double Nanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            S7DeviceSymbolInfo MeasuredDeviceSymbolInfo;
+            size_t MeasuredProjectSymbolCount = 0;
+            ParseMc5code(MeasuredDeviceSymbolInfo, Case.Mc5code, ParseOptions, MeasuredProjectSymbolCount);
+        });
+
+        Metrics.push_back({"mc5code", Case.strName, "ns_per_declaration", Nanoseconds / static_cast<double>(Case.DeclarationCount), false});
+        Metrics.push_back({"mc5code", Case.strName, "symbols_per_s", static_cast<double>(SymbolCount) * 1e9 / Nanoseconds, true});
+        Metrics.push_back({"mc5code", Case.strName, "allocations_per_symbol", static_cast<double>(AllocationCount) / static_cast<double>(SymbolCount), false});
+    }
+
+    return std::monostate();
+}
@@ -0,0 +1,53 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <memory_resource>
+
+#include "CMc5codeTokenStream.h"
+#include "s7p_bench.h"
+
+
+std::variant<std::monostate, CS7PError>
+BenchMc5codeScanner(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    for (const S7PBenchCorpusCase& Case : Options.Corpus)
+    {
+        // Tokenize the MC5 Code of all blocks, like _ParseDBs does for every DB and referenced block.
+        std::vector<std::pmr::string> Mc5codes;
+        size_t ByteCount = 0;
+
+        for (const S7PBenchCorpusBlock& Block : Case.Blocks)
+        {
+            Mc5codes.emplace_back(Block.strMc5code);
+            ByteCount += Block.strMc5code.size();
+        }
+
+        if (ByteCount == 0)
+        {
+            continue;
+        }
+
+        size_t TokenCount = 0;
+
+        const double Nanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            std::pmr::monotonic_buffer_resource Resource;
+            TokenCount = 0;
+
+            for (const std::pmr::string& strMc5code : Mc5codes)
+            {
+                CMc5codeTokenStream TokenStream(strMc5code, &Resource);
+                TokenCount += TokenStream.GetTokenCount();
+            }
+        });
+
+        // Bytes per nanosecond are gigabytes per second.
+        Metrics.push_back({"mc5code_scanner", Case.strName, "gb_per_s", static_cast<double>(ByteCount) / Nanoseconds, true});
+        Metrics.push_back({"mc5code_scanner", Case.strName, "ns_per_token", Nanoseconds / static_cast<double>(TokenCount), false});
+    }
+
+    return std::monostate();
+}
@@ -0,0 +1,119 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+
+#include <EnlyzeWinStringLib.h>
+
+#include "CS7SymbolNameTable.h"
+#include "s7p_bench.h"
+
+struct NameTableKey
+{
+    std::string_view svDeviceName;
+    std::string_view svBlockName;
+    std::string_view svSymbolName;
+};
+
+
+std::variant<std::monostate, CS7PError>
+BenchNameTable(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    auto ParseResult = ParseBenchLayouts(Options, S7ParseOptions());
+    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    {
+        return *pError;
+    }
+
+    for (const S7PBenchLayout& Layout : std::get<std::vector<S7PBenchLayout>>(ParseResult))
+    {
+        std::vector<NameTableKey> Keys;
+        for (const S7DeviceSymbolInfo& DeviceSymbolInfo : Layout.DeviceSymbolInfos)
+        {
+            for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+            {
+                for (const S7Symbol& Symbol : Block.GetSymbols())
+                {
+                    Keys.push_back({ DeviceSymbolInfo.strName, Block.strName, Symbol.strName });
+                }
+            }
+        }
+
+        if (Keys.empty())
+        {
+            continue;
+        }
+
+        // Clients don't look up symbols in parse order, so neither do we.
+        // Otherwise, the hash map below would profit from having allocated its nodes in lookup order.
+        std::shuffle(Keys.begin(), Keys.end(), std::mt19937(42));
+
+        auto BuildResult = CS7SymbolNameTable::Build(Layout.DeviceSymbolInfos);
+        if (const auto pError = std::get_if<CS7PError>(&BuildResult))
+        {
+            return *pError;
+        }
+
+        const CS7SymbolNameTable& Table = *std::get<std::unique_ptr<CS7SymbolNameTable>>(BuildResult);
+
+        // Every key must be found, which also makes sure the lookups below cannot be optimized away.
+        for (const NameTableKey& Key : Keys)
+        {
+            if (!Table.Find(Key.svDeviceName, Key.svBlockName, Key.svSymbolName).has_value())
+            {
+                return CS7PError(L"Case " + StrToWstr(Layout.strName) + L": Symbol " + StrToWstr(std::string(Key.svSymbolName)) + L" not found");
+            }
+        }
+
+        const double BuildNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            CS7SymbolNameTable::Build(Layout.DeviceSymbolInfos);
+        });
+
+        size_t FoundCount = 0;
+        const double FindNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            for (const NameTableKey& Key : Keys)
+            {
+                FoundCount += Table.Find(Key.svDeviceName, Key.svBlockName, Key.svSymbolName).has_value();
+            }
+        });
+
+        // For comparison, the obvious alternative of a hash map from the concatenated key to the location.
+        std::unordered_map<std::string, size_t> Map;
+        Map.reserve(Keys.size());
+        std::string strKey;
+        for (size_t i = 0; i < Keys.size(); i++)
+        {
+            strKey.assign(Keys[i].svDeviceName).append(1, '\0').append(Keys[i].svBlockName).append(1, '\0').append(Keys[i].svSymbolName);
+            Map.emplace(strKey, i);
+        }
+
+        const double MapFindNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            for (const NameTableKey& Key : Keys)
+            {
+                strKey.assign(Key.svDeviceName).append(1, '\0').append(Key.svBlockName).append(1, '\0').append(Key.svSymbolName);
+                FoundCount += Map.count(strKey);
+            }
+        });
+
+        if (FoundCount == 0)
+        {
+            return CS7PError(L"Case " + StrToWstr(Layout.strName) + L": No symbol found");
+        }
+
+        const double KeyCount = static_cast<double>(Keys.size());
+        Metrics.push_back({"name_table", Layout.strName, "build_ns_per_symbol", BuildNanoseconds / KeyCount, false});
+        Metrics.push_back({"name_table", Layout.strName, "find_ns", FindNanoseconds / KeyCount, false});
+        Metrics.push_back({"name_table", Layout.strName, "unordered_map_find_ns", MapFindNanoseconds / KeyCount, false});
+    }
+
+    return std::monostate();
+}
@@ -0,0 +1,189 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <windows.h>
+
+#include "CS7PQueryServer.h"
+#include "CS7PThreadGroup.h"
+#include "s7p_bench.h"
+
+// Number of clients querying the server concurrently, and pipe instances serving them.
+static const size_t _ClientCount = 4;
+
+
+static HANDLE
+_ConnectToPipe(const std::wstring& wstrPipeName)
+{
+    for (;;)
+    {
+        HANDLE hPipe = CreateFileW(wstrPipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (hPipe != INVALID_HANDLE_VALUE || GetLastError() != ERROR_PIPE_BUSY)
+        {
+            return hPipe;
+        }
+
+        // All instances are busy, so wait until one becomes free.
+        if (!WaitNamedPipeW(wstrPipeName.c_str(), 5000))
+        {
+            return INVALID_HANDLE_VALUE;
+        }
+    }
+}
+
+static bool
+_Query(HANDLE hPipe, const std::string& strRequest, std::string& strResponse)
+{
+    DWORD cbWritten;
+    if (!WriteFile(hPipe, strRequest.data(), static_cast<DWORD>(strRequest.size()), &cbWritten, nullptr) || cbWritten != strRequest.size())
+    {
+        return false;
+    }
+
+    // Every response ends with an "END" or "ERR" line.
+    strResponse.clear();
+    for (;;)
+    {
+        char Buffer[4096];
+        DWORD cbRead;
+        if (!ReadFile(hPipe, Buffer, sizeof(Buffer), &cbRead, nullptr) || cbRead == 0)
+        {
+            return false;
+        }
+
+        strResponse.append(Buffer, cbRead);
+
+        const size_t LastLineStart = strResponse.rfind('\n', strResponse.size() - 2) + 1;
+        if (strResponse.back() == '\n' && (strResponse.compare(LastLineStart, 4, "END\n") == 0 || strResponse.compare(LastLineStart, 4, "ERR\t") == 0))
+        {
+            return true;
+        }
+    }
+}
+
+static double
+_GetPercentile(std::vector<double>& Values, double Percentile)
+{
+    const size_t Index = std::min(Values.size() - 1, static_cast<size_t>(Percentile / 100.0 * static_cast<double>(Values.size())));
+    std::nth_element(Values.begin(), Values.begin() + Index, Values.end());
+    return Values[Index];
+}
+
+
+std::variant<std::monostate, CS7PError>
+BenchQueryServer(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    auto ParseResult = ParseBenchLayouts(Options, S7ParseOptions());
+    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    {
+        return *pError;
+    }
+
+    // A unique pipe name, so that benchmarks can run in parallel.
+    const std::wstring wstrPipeName = L"\\\\.\\pipe\\S7PBench-" + std::to_wstring(GetCurrentProcessId());
+
+    auto StartResult = CS7PQueryServer::Start(wstrPipeName, _ClientCount);
+    if (const auto pError = std::get_if<CS7PError>(&StartResult))
+    {
+        return *pError;
+    }
+
+    CS7PQueryServer& Server = *std::get<std::unique_ptr<CS7PQueryServer>>(StartResult);
+
+    for (S7PBenchLayout& Layout : std::get<std::vector<S7PBenchLayout>>(ParseResult))
+    {
+        // Look up every symbol by its name, as a client resolving the variables of a dashboard would do.
+        std::vector<std::string> Requests;
+        for (const S7DeviceSymbolInfo& DeviceSymbolInfo : Layout.DeviceSymbolInfos)
+        {
+            for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+            {
+                const std::string strPrefix = (Block.DbNumber == 0) ? std::string() : "DB" + std::to_string(Block.DbNumber) + ".";
+
+                for (const S7Symbol& Symbol : Block.GetSymbols())
+                {
+                    Requests.push_back("NAME\t" + Layout.strName + "\t" + DeviceSymbolInfo.strName + "\t" + strPrefix + Symbol.strName + "\n");
+                }
+            }
+        }
+
+        if (Requests.empty())
+        {
+            continue;
+        }
+
+        Server.SetProject(Layout.strName, std::move(Layout.DeviceSymbolInfos));
+
+        // Every client sends one request at a time and waits for its response, so each latency covers a full round trip.
+        // Together, the clients look up every symbol at least once.
+        std::mutex LatencyMutex;
+        std::vector<double> Latencies;
+        std::optional<CS7PError> Error;
+
+        auto Client = [&](size_t ClientIndex)
+        {
+            HANDLE hPipe = _ConnectToPipe(wstrPipeName);
+            if (hPipe == INVALID_HANDLE_VALUE)
+            {
+                std::lock_guard<std::mutex> Lock(LatencyMutex);
+                Error = CS7PError(L"Could not connect to " + wstrPipeName + L", error " + std::to_wstring(GetLastError()));
+                return;
+            }
+
+            std::vector<double> ClientLatencies;
+            std::string strResponse;
+            const auto MinDuration = std::chrono::duration<double>(Options.MinSeconds);
+            const auto StartTime = std::chrono::steady_clock::now();
+
+            for (size_t i = ClientIndex; ClientLatencies.size() * _ClientCount < Requests.size() || std::chrono::steady_clock::now() - StartTime < MinDuration; i += _ClientCount)
+            {
+                const auto RequestStartTime = std::chrono::steady_clock::now();
+                if (!_Query(hPipe, Requests[i % Requests.size()], strResponse))
+                {
+                    std::lock_guard<std::mutex> Lock(LatencyMutex);
+                    Error = CS7PError(L"Query failed, error " + std::to_wstring(GetLastError()));
+                    break;
+                }
+
+                const auto RequestEndTime = std::chrono::steady_clock::now();
+                ClientLatencies.push_back(std::chrono::duration<double, std::micro>(RequestEndTime - RequestStartTime).count());
+            }
+
+            CloseHandle(hPipe);
+
+            std::lock_guard<std::mutex> Lock(LatencyMutex);
+            Latencies.insert(Latencies.end(), ClientLatencies.begin(), ClientLatencies.end());
+        };
+
+        const auto StartTime = std::chrono::steady_clock::now();
+
+        {
+            CS7PThreadGroup Clients;
+            for (size_t i = 0; i < _ClientCount; i++)
+            {
+                Clients.Start(Client, i);
+            }
+        }
+
+        const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+        if (Error.has_value())
+        {
+            return *Error;
+        }
+
+        Metrics.push_back({"query_server", Layout.strName, "requests_per_s", static_cast<double>(Latencies.size()) / Seconds, true});
+        Metrics.push_back({"query_server", Layout.strName, "p50_us", _GetPercentile(Latencies, 50.0), false});
+        Metrics.push_back({"query_server", Layout.strName, "p99_us", _GetPercentile(Latencies, 99.0), false});
+
+        Server.UnloadProject(Layout.strName);
+    }
+
+    return std::monostate();
+}
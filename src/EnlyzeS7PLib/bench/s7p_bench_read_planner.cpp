@@ -0,0 +1,149 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <EnlyzeWinStringLib.h>
+
+#include "s7p_bench.h"
+#include "s7p_read_planner.h"
+
+// Negotiated PDU size of most S7-300 CPUs and the gap we would bridge in practice.
+static const size_t PduSize = 240;
+static const size_t MaxGapBytes = 32;
+
+
+static std::variant<std::monostate, CS7PError>
+_CheckEmptyAddressesSkipped(const std::vector<S7Address>& Addresses, const std::string& strCase)
+{
+    // Symbol List entries only available as strRawCode come with an empty address.
+    // Interleaving such addresses must give them an empty mapping and leave the plan of all others unchanged.
+    std::vector<S7Address> MixedAddresses;
+    for (const S7Address& Address : Addresses)
+    {
+        MixedAddresses.push_back(S7Address());
+        MixedAddresses.push_back(Address);
+    }
+
+    auto PlanResult = PlanS7Reads(Addresses, PduSize, MaxGapBytes);
+    auto MixedPlanResult = PlanS7Reads(MixedAddresses, PduSize, MaxGapBytes);
+    if (const auto pError = std::get_if<CS7PError>(&PlanResult))
+    {
+        return *pError;
+    }
+
+    if (const auto pError = std::get_if<CS7PError>(&MixedPlanResult))
+    {
+        return *pError;
+    }
+
+    const S7ReadPlan& Plan = std::get<S7ReadPlan>(PlanResult);
+    const S7ReadPlan& MixedPlan = std::get<S7ReadPlan>(MixedPlanResult);
+    const std::wstring wstrError = L"Case " + StrToWstr(strCase) + L": Addresses with a BitSize of 0 have changed the plan";
+
+    if (MixedPlan.Ranges.size() != Plan.Ranges.size())
+    {
+        return CS7PError(wstrError);
+    }
+
+    for (size_t i = 0; i < Plan.Ranges.size(); i++)
+    {
+        const S7ReadRange& Range = Plan.Ranges[i];
+        const S7ReadRange& MixedRange = MixedPlan.Ranges[i];
+        if (Range.Area != MixedRange.Area || Range.DbNumber != MixedRange.DbNumber || Range.ByteOffset != MixedRange.ByteOffset || Range.ByteSize != MixedRange.ByteSize)
+        {
+            return CS7PError(wstrError);
+        }
+    }
+
+    for (size_t i = 0; i < Plan.Mappings.size(); i++)
+    {
+        const S7ReadMapping& Mapping = Plan.Mappings[i];
+        const S7ReadMapping& MixedMapping = MixedPlan.Mappings[2 * i + 1];
+        if (MixedPlan.Mappings[2 * i].RangeCount != 0 ||
+            Mapping.RangeIndex != MixedMapping.RangeIndex ||
+            Mapping.ByteOffset != MixedMapping.ByteOffset ||
+            Mapping.RangeCount != MixedMapping.RangeCount)
+        {
+            return CS7PError(wstrError);
+        }
+    }
+
+    return std::monostate();
+}
+
+
+std::variant<std::monostate, CS7PError>
+BenchReadPlanner(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    auto ParseResult = ParseBenchLayouts(Options, S7ParseOptions());
+    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    {
+        return *pError;
+    }
+
+    for (const S7PBenchLayout& Layout : std::get<std::vector<S7PBenchLayout>>(ParseResult))
+    {
+        // Select all symbols with an address, and every 8th of them to model a sparse selection of tags.
+        for (const size_t Stride : { 1, 8 })
+        {
+            std::vector<S7Address> Addresses;
+            size_t SymbolIndex = 0;
+
+            for (const S7DeviceSymbolInfo& DeviceSymbolInfo : Layout.DeviceSymbolInfos)
+            {
+                for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+                {
+                    for (const S7Symbol& Symbol : Block.GetSymbols())
+                    {
+                        if (Symbol.Address.BitSize > 0 && SymbolIndex++ % Stride == 0)
+                        {
+                            Addresses.push_back(Block.GetAddress(Symbol));
+                        }
+                    }
+                }
+            }
+
+            if (Addresses.empty())
+            {
+                continue;
+            }
+
+            const std::string strCase = Layout.strName + (Stride == 1 ? "" : "_sparse");
+            auto CheckResult = _CheckEmptyAddressesSkipped(Addresses, strCase);
+            if (const auto pError = std::get_if<CS7PError>(&CheckResult))
+            {
+                return *pError;
+            }
+
+            size_t RangeCount = 0;
+            std::variant<std::monostate, CS7PError> PlanError;
+
+            const double Nanoseconds = MeasureMedianNanoseconds(Options, [&]()
+            {
+                auto PlanResult = PlanS7Reads(Addresses, PduSize, MaxGapBytes);
+                if (const auto pError = std::get_if<CS7PError>(&PlanResult))
+                {
+                    PlanError = *pError;
+                    return;
+                }
+
+                RangeCount = std::get<S7ReadPlan>(PlanResult).Ranges.size();
+            });
+
+            if (const auto pError = std::get_if<CS7PError>(&PlanError))
+            {
+                return *pError;
+            }
+
+            // Without planning, every symbol is read by a request item of its own.
+            const double SymbolCount = static_cast<double>(Addresses.size());
+            Metrics.push_back({"read_planner", strCase, "ns_per_symbol", Nanoseconds / SymbolCount, false});
+            Metrics.push_back({"read_planner", strCase, "ranges", static_cast<double>(RangeCount), false});
+            Metrics.push_back({"read_planner", strCase, "requests_saved_percent", (SymbolCount - static_cast<double>(RangeCount)) * 100.0 / SymbolCount, true});
+        }
+    }
+
+    return std::monostate();
+}
@@ -0,0 +1,141 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <EnlyzeWinStringLib.h>
+
+#include "s7p_archive.h"
+#include "s7p_bench.h"
+#include "s7p_db_parser.h"
+
+
+static std::vector<size_t>
+_GetBlockDbNumbers(const S7DeviceSymbolInfo& DeviceSymbolInfo)
+{
+    std::vector<size_t> DbNumbers;
+    for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+    {
+        DbNumbers.push_back(Block.DbNumber);
+    }
+
+    return DbNumbers;
+}
+
+
+std::variant<std::monostate, CS7PError>
+BenchReparse(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    // Reparsing works on the project files themselves, which an archive would first have to be extracted to.
+    if (IsS7PArchivePath(Options.wstrProjectFilePath))
+    {
+        return CS7PError(L"The reparse benchmark needs a .s7p file and not a project archive");
+    }
+
+    std::wstring wstrS7PFolderPath;
+    auto FolderResult = GetS7PFolderPath(wstrS7PFolderPath, Options.wstrProjectFilePath);
+    if (const auto pError = std::get_if<CS7PError>(&FolderResult))
+    {
+        return *pError;
+    }
+
+    const S7ParseOptions ParseOptions;
+    auto ParseResult = ParseS7P(Options.wstrProjectFilePath, ParseOptions);
+    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    {
+        return *pError;
+    }
+
+    auto& DeviceSymbolInfos = std::get<std::vector<S7DeviceSymbolInfo>>(ParseResult);
+
+    double FullNanoseconds = 0;
+    double ReparseNanoseconds = 0;
+    size_t SubblockListCount = 0;
+
+    for (S7DeviceSymbolInfo& DeviceSymbolInfo : DeviceSymbolInfos)
+    {
+        std::vector<size_t> SubblockListIds;
+        for (const auto& [SubblockListId, SubblockListInfo] : DeviceSymbolInfo.SubblockListInfos)
+        {
+            SubblockListIds.push_back(SubblockListId);
+        }
+
+        for (size_t SubblockListId : SubblockListIds)
+        {
+            const std::wstring wstrCase = L"Device " + StrToWstr(DeviceSymbolInfo.strName) + L", Subblock List " + std::to_wstring(SubblockListId);
+
+            // A full parse of this Subblock List into an otherwise empty device, as the reference for the reparse.
+            auto ParseFullSubblockList = [&](size_t& ProjectSymbolCount)
+            {
+                S7DeviceSymbolInfo FullDeviceSymbolInfo;
+                FullDeviceSymbolInfo.strName = DeviceSymbolInfo.strName;
+                FullDeviceSymbolInfo.DbNamesMap = DeviceSymbolInfo.DbNamesMap;
+                return ParseOmbstxSubblockList(FullDeviceSymbolInfo, SubblockListId, wstrS7PFolderPath, ParseOptions, ProjectSymbolCount);
+            };
+
+            size_t FullSymbolCount = 0;
+            auto SubblockListResult = ParseFullSubblockList(FullSymbolCount);
+            if (const auto pError = std::get_if<CS7PError>(&SubblockListResult))
+            {
+                return *pError;
+            }
+
+            // Nothing has changed on disk, so the reparse must reuse every DB, keep all blocks in place, and count the same symbols.
+            const std::vector<size_t> BlockDbNumbers = _GetBlockDbNumbers(DeviceSymbolInfo);
+            const size_t WarningCount = DeviceSymbolInfo.Warnings.size();
+
+            std::vector<size_t> ReparsedDbNumbers;
+            size_t ReparseSymbolCount = 0;
+            SubblockListResult = ReparseOmbstxSubblockList(DeviceSymbolInfo, ReparsedDbNumbers, SubblockListId, wstrS7PFolderPath, ParseOptions, ReparseSymbolCount);
+            if (const auto pError = std::get_if<CS7PError>(&SubblockListResult))
+            {
+                return *pError;
+            }
+
+            if (!ReparsedDbNumbers.empty())
+            {
+                return CS7PError(wstrCase + L": " + std::to_wstring(ReparsedDbNumbers.size()) + L" unchanged DBs have been parsed again");
+            }
+
+            if (ReparseSymbolCount != FullSymbolCount)
+            {
+                return CS7PError(
+                    wstrCase + L": The reparse counts " + std::to_wstring(ReparseSymbolCount) +
+                    L" symbols, but the full parse " + std::to_wstring(FullSymbolCount)
+                );
+            }
+
+            if (_GetBlockDbNumbers(DeviceSymbolInfo) != BlockDbNumbers || DeviceSymbolInfo.Warnings.size() != WarningCount)
+            {
+                return CS7PError(wstrCase + L": The reparse has moved blocks or warnings");
+            }
+
+            FullNanoseconds += MeasureMedianNanoseconds(Options, [&]()
+            {
+                size_t MeasuredProjectSymbolCount = 0;
+                ParseFullSubblockList(MeasuredProjectSymbolCount);
+            });
+
+            // The result stays the same, so every call takes the same path as the one checked above.
+            ReparseNanoseconds += MeasureMedianNanoseconds(Options, [&]()
+            {
+                size_t MeasuredProjectSymbolCount = 0;
+                ReparseOmbstxSubblockList(DeviceSymbolInfo, ReparsedDbNumbers, SubblockListId, wstrS7PFolderPath, ParseOptions, MeasuredProjectSymbolCount);
+            });
+
+            SubblockListCount++;
+        }
+    }
+
+    if (SubblockListCount == 0)
+    {
+        return CS7PError(L"The project has no Subblock List to reparse");
+    }
+
+    Metrics.push_back({"reparse", "project", "full_parse_ms", FullNanoseconds / 1e6, false});
+    Metrics.push_back({"reparse", "project", "reparse_ms", ReparseNanoseconds / 1e6, false});
+    Metrics.push_back({"reparse", "project", "speedup", FullNanoseconds / ReparseNanoseconds, true});
+
+    return std::monostate();
+}
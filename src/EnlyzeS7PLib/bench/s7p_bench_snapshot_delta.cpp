@@ -0,0 +1,216 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include <EnlyzeWinStringLib.h>
+
+#include "CS7SnapshotDelta.h"
+#include "s7p_bench.h"
+
+// Percentage of symbols changed between two snapshots in the "sparse" cases, as in a typical polling loop.
+static const size_t _ChangedSymbolPercent = 1;
+
+
+static bool
+_IsBitSet(const uint8_t* pBuffer, size_t BitOffset)
+{
+    return (pBuffer[BitOffset / 8] >> (BitOffset % 8)) & 1;
+}
+
+static std::vector<size_t>
+_GetChangedSymbolsBitwise(const S7Block& Block, const uint8_t* pPreviousBuffer, const uint8_t* pCurrentBuffer)
+{
+    // Obviously correct, but slow reference, comparing each symbol bit by bit.
+    std::vector<size_t> ChangedSymbolIndexes;
+    const std::vector<S7Symbol>& Symbols = Block.GetSymbols();
+
+    for (size_t i = 0; i < Symbols.size(); i++)
+    {
+        const S7Address& Address = Symbols[i].Address;
+        if (Address.Area != S7Area::DB || !Symbols[i].strRawCode.empty())
+        {
+            continue;
+        }
+
+        const size_t EndBitOffset = static_cast<size_t>(Address.BitOffset) + std::max<uint32_t>(Address.BitSize, 1);
+        for (size_t BitOffset = Address.BitOffset; BitOffset < EndBitOffset; BitOffset++)
+        {
+            if (_IsBitSet(pPreviousBuffer, BitOffset) != _IsBitSet(pCurrentBuffer, BitOffset))
+            {
+                ChangedSymbolIndexes.push_back(i);
+                break;
+            }
+        }
+    }
+
+    return ChangedSymbolIndexes;
+}
+
+static size_t
+_GetChangedSymbolCountPerSymbol(const S7Block& Block, const uint8_t* pPreviousBuffer, const uint8_t* pCurrentBuffer)
+{
+    // What a client would do without CS7SnapshotDelta: Compare the bytes of every symbol.
+    size_t ChangedSymbolCount = 0;
+
+    for (const S7Symbol& Symbol : Block.GetSymbols())
+    {
+        const S7Address& Address = Symbol.Address;
+        if (Address.Area != S7Area::DB || !Symbol.strRawCode.empty())
+        {
+            continue;
+        }
+
+        const size_t FirstByte = Address.BitOffset / 8;
+        const size_t EndByte = (static_cast<size_t>(Address.BitOffset) + std::max<uint32_t>(Address.BitSize, 1) + 7) / 8;
+        ChangedSymbolCount += memcmp(pPreviousBuffer + FirstByte, pCurrentBuffer + FirstByte, EndByte - FirstByte) != 0;
+    }
+
+    return ChangedSymbolCount;
+}
+
+
+std::variant<std::monostate, CS7PError>
+BenchSnapshotDelta(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    auto ParseResult = ParseBenchLayouts(Options, S7ParseOptions());
+    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    {
+        return *pError;
+    }
+
+    struct DeltaInfo
+    {
+        const S7Block* pBlock;
+        std::unique_ptr<CS7SnapshotDelta> pDelta;
+        std::vector<uint8_t> PreviousSnapshot;
+        std::vector<uint8_t> CurrentSnapshot;
+    };
+
+    for (const S7PBenchLayout& Layout : std::get<std::vector<S7PBenchLayout>>(ParseResult))
+    {
+        std::vector<DeltaInfo> Deltas;
+        size_t SnapshotBytes = 0;
+        size_t SymbolCount = 0;
+
+        for (const S7DeviceSymbolInfo& DeviceSymbolInfo : Layout.DeviceSymbolInfos)
+        {
+            for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+            {
+                auto pDelta = std::make_unique<CS7SnapshotDelta>(Block, S7Area::DB);
+                if (pDelta->GetRequiredBufferSize() == 0)
+                {
+                    continue;
+                }
+
+                DeltaInfo& Delta = Deltas.emplace_back();
+                Delta.pBlock = &Block;
+                Delta.PreviousSnapshot.resize(pDelta->GetRequiredBufferSize());
+                for (size_t i = 0; i < Delta.PreviousSnapshot.size(); i++)
+                {
+                    Delta.PreviousSnapshot[i] = static_cast<uint8_t>(i * 37);
+                }
+
+                Delta.CurrentSnapshot = Delta.PreviousSnapshot;
+                SnapshotBytes += Delta.PreviousSnapshot.size();
+                SymbolCount += Block.GetSymbols().size();
+                Delta.pDelta = std::move(pDelta);
+            }
+        }
+
+        if (Deltas.empty())
+        {
+            continue;
+        }
+
+        std::vector<size_t> ChangedSymbolIndexes;
+
+        auto MeasureCase = [&](const std::string& strCase)
+        {
+            // Every reported symbol must have a changed bit, and no symbol with a changed bit must be missed.
+            for (const DeltaInfo& Delta : Deltas)
+            {
+                auto DeltaResult = Delta.pDelta->GetChangedSymbols(ChangedSymbolIndexes, Delta.PreviousSnapshot.data(), Delta.CurrentSnapshot.data(), Delta.CurrentSnapshot.size());
+                if (const auto pError = std::get_if<CS7PError>(&DeltaResult))
+                {
+                    return std::variant<std::monostate, CS7PError>(*pError);
+                }
+
+                if (ChangedSymbolIndexes != _GetChangedSymbolsBitwise(*Delta.pBlock, Delta.PreviousSnapshot.data(), Delta.CurrentSnapshot.data()))
+                {
+                    return std::variant<std::monostate, CS7PError>(CS7PError(L"Case " + StrToWstr(strCase) + L": Changed symbols differ from the bitwise comparison"));
+                }
+            }
+
+            const size_t FirstAllocationCount = GetBenchAllocationCount();
+            for (const DeltaInfo& Delta : Deltas)
+            {
+                Delta.pDelta->GetChangedSymbols(ChangedSymbolIndexes, Delta.PreviousSnapshot.data(), Delta.CurrentSnapshot.data(), Delta.CurrentSnapshot.size());
+            }
+
+            const size_t AllocationCount = GetBenchAllocationCount() - FirstAllocationCount;
+
+            const double DeltaNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+            {
+                for (const DeltaInfo& Delta : Deltas)
+                {
+                    Delta.pDelta->GetChangedSymbols(ChangedSymbolIndexes, Delta.PreviousSnapshot.data(), Delta.CurrentSnapshot.data(), Delta.CurrentSnapshot.size());
+                }
+            });
+
+            size_t ChangedSymbolCount = 0;
+            const double PerSymbolNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+            {
+                for (const DeltaInfo& Delta : Deltas)
+                {
+                    ChangedSymbolCount += _GetChangedSymbolCountPerSymbol(*Delta.pBlock, Delta.PreviousSnapshot.data(), Delta.CurrentSnapshot.data());
+                }
+            });
+
+            Metrics.push_back({"snapshot_delta", strCase, "us_per_64kb", DeltaNanoseconds * 65536.0 / static_cast<double>(SnapshotBytes) / 1000.0, false});
+            Metrics.push_back({"snapshot_delta", strCase, "ns_per_symbol", DeltaNanoseconds / static_cast<double>(SymbolCount), false});
+            Metrics.push_back({"snapshot_delta", strCase, "speedup_vs_per_symbol", PerSymbolNanoseconds / DeltaNanoseconds, true});
+            Metrics.push_back({"snapshot_delta", strCase, "allocations_per_call", static_cast<double>(AllocationCount) / static_cast<double>(Deltas.size()), false});
+
+            return std::variant<std::monostate, CS7PError>();
+        };
+
+        // The steady state of a polling loop over a mostly static DB.
+        auto CaseResult = MeasureCase(Layout.strName + "_unchanged");
+        if (const auto pError = std::get_if<CS7PError>(&CaseResult))
+        {
+            return *pError;
+        }
+
+        // Change a few randomly chosen symbols by flipping the first bit of each.
+        std::mt19937 Random(42);
+        for (DeltaInfo& Delta : Deltas)
+        {
+            const std::vector<S7Symbol>& Symbols = Delta.pBlock->GetSymbols();
+            const size_t ChangeCount = std::max<size_t>(Symbols.size() * _ChangedSymbolPercent / 100, 1);
+
+            for (size_t i = 0; i < ChangeCount; i++)
+            {
+                const S7Address& Address = Symbols[Random() % Symbols.size()].Address;
+                if (Address.Area == S7Area::DB)
+                {
+                    Delta.CurrentSnapshot[Address.BitOffset / 8] ^= static_cast<uint8_t>(1 << (Address.BitOffset % 8));
+                }
+            }
+        }
+
+        CaseResult = MeasureCase(Layout.strName + "_sparse");
+        if (const auto pError = std::get_if<CS7PError>(&CaseResult))
+        {
+            return *pError;
+        }
+    }
+
+    return std::monostate();
+}
@@ -0,0 +1,102 @@
+//
+// S7PBench - Benchmarks for EnlyzeS7PLib
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <EnlyzeWinStringLib.h>
+
+#include "s7p_bench.h"
+#include "s7p_db_parser.h"
+
+
+static void
+_AddMetrics(std::vector<S7PBenchMetric>& Metrics, const std::string& strCase, double FullNanoseconds, double StatisticsNanoseconds)
+{
+    Metrics.push_back({"statistics", strCase, "full_parse_ms", FullNanoseconds / 1e6, false});
+    Metrics.push_back({"statistics", strCase, "statistics_ms", StatisticsNanoseconds / 1e6, false});
+    Metrics.push_back({"statistics", strCase, "speedup", FullNanoseconds / StatisticsNanoseconds, true});
+}
+
+
+std::variant<std::monostate, CS7PError>
+BenchStatistics(const S7PBenchOptions& Options, std::vector<S7PBenchMetric>& Metrics)
+{
+    const S7ParseOptions ParseOptions;
+
+    for (const S7PBenchCorpusCase& Case : Options.Corpus)
+    {
+        // Collect the statistics once to make sure they count exactly the symbols of a full parse.
+        S7DeviceSymbolInfo DeviceSymbolInfo;
+        size_t ProjectSymbolCount = 0;
+        auto ParseResult = ParseMc5code(DeviceSymbolInfo, Case.Mc5code, ParseOptions, ProjectSymbolCount);
+        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        {
+            return *pError;
+        }
+
+        S7DeviceSymbolInfo StatisticsDeviceSymbolInfo;
+        S7DeviceStatistics DeviceStatistics;
+        size_t StatisticsProjectSymbolCount = 0;
+        ParseResult = ParseMc5code(StatisticsDeviceSymbolInfo, Case.Mc5code, ParseOptions, StatisticsProjectSymbolCount, &DeviceStatistics);
+        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        {
+            return *pError;
+        }
+
+        size_t SymbolCount = 0;
+        for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+        {
+            SymbolCount += Block.GetSymbols().size();
+        }
+
+        size_t StatisticsSymbolCount = 0;
+        for (const S7DbStatistics& DbStatistics : DeviceStatistics.Dbs)
+        {
+            StatisticsSymbolCount += DbStatistics.SymbolCount;
+        }
+
+        if (StatisticsSymbolCount != SymbolCount)
+        {
+            return CS7PError(
+                L"Corpus case " + StrToWstr(Case.strName) + L": Statistics count " + std::to_wstring(StatisticsSymbolCount) +
+                L" symbols, but the full parse has " + std::to_wstring(SymbolCount)
+            );
+        }
+
+        const double FullNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            S7DeviceSymbolInfo MeasuredDeviceSymbolInfo;
+            size_t MeasuredProjectSymbolCount = 0;
+            ParseMc5code(MeasuredDeviceSymbolInfo, Case.Mc5code, ParseOptions, MeasuredProjectSymbolCount);
+        });
+
+        const double StatisticsNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            S7DeviceSymbolInfo MeasuredDeviceSymbolInfo;
+            S7DeviceStatistics MeasuredDeviceStatistics;
+            size_t MeasuredProjectSymbolCount = 0;
+            ParseMc5code(MeasuredDeviceSymbolInfo, Case.Mc5code, ParseOptions, MeasuredProjectSymbolCount, &MeasuredDeviceStatistics);
+        });
+
+        _AddMetrics(Metrics, Case.strName, FullNanoseconds, StatisticsNanoseconds);
+    }
+
+    if (!Options.wstrProjectFilePath.empty())
+    {
+        // Both include reading the project files, so this is the speedup a caller of ParseS7PStatistics actually sees.
+        const double FullNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            ParseS7P(Options.wstrProjectFilePath, ParseOptions);
+        });
+
+        const double StatisticsNanoseconds = MeasureMedianNanoseconds(Options, [&]()
+        {
+            ParseS7PStatistics(Options.wstrProjectFilePath, ParseOptions);
+        });
+
+        _AddMetrics(Metrics, "project", FullNanoseconds, StatisticsNanoseconds);
+    }
+
+    return std::monostate();
+}
@@ -93,6 +93,32 @@ public:
         return InvalidIterator();
     }
 
+    size_t GetElementCount() const
+    {
+        size_t ElementCount = 1;
+        for (const auto& Dimension : m_Dimensions)
+        {
+            ElementCount *= static_cast<size_t>(Dimension.EndIndex - Dimension.StartIndex + 1);
+        }
+
+        return ElementCount;
+    }
+
+    // Returns the indexes of the element at the given position in enumeration order.
+    // This allows splitting an enumeration into independent chunks.
+    void GetIndexes(std::vector<short>& Indexes, size_t LinearIndex) const
+    {
+        Indexes.resize(m_Dimensions.size());
+
+        // The last dimension changes fastest, so it has a stride of 1.
+        for (size_t i = m_Dimensions.size(); i-- > 0;)
+        {
+            const size_t DimensionElementCount = static_cast<size_t>(m_Dimensions[i].EndIndex - m_Dimensions[i].StartIndex + 1);
+            Indexes[i] = static_cast<short>(m_Dimensions[i].StartIndex + static_cast<short>(LinearIndex % DimensionElementCount));
+            LinearIndex /= DimensionElementCount;
+        }
+    }
+
 private:
     const std::vector<CMc5ArrayDimension>& m_Dimensions;
 };
@@ -4,11 +4,16 @@
 // SPDX-License-Identifier: MIT
 //
 
-#include <numeric>
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <thread>
 #include <EnlyzeWinStringLib.h>
 
 #include "CMc5ArrayEnumerator.h"
 #include "CMc5codeParser.h"
+#include "CS7PThreadGroup.h"
+#include "s7p_cp1252.h"
 
 struct ByteSizedVariableInfo
 {
@@ -16,13 +21,104 @@ struct ByteSizedVariableInfo
     unsigned char ByteAlignment;
     unsigned char ByteSize;
 
-    bool operator==(const std::string& other) const
+    bool operator==(std::string_view other) const
     {
         return szName == other;
     }
 };
 
 
+template<typename T> static std::optional<T>
+_ParseNumber(std::string_view svToken)
+{
+    T Value;
+    const auto [pEnd, Error] = std::from_chars(svToken.data(), svToken.data() + svToken.size(), Value);
+    if (Error != std::errc() || pEnd != svToken.data() + svToken.size())
+    {
+        return std::nullopt;
+    }
+
+    return Value;
+}
+
+static void
+_AppendArrayDatatype(std::string& strDatatype, const std::vector<CMc5ArrayDimension>& ArrayDimensions)
+{
+    // Build the array part of the datatype, e.g. "ARRAY [1..3, 0..7] OF ".
+    strDatatype += "ARRAY [";
+
+    for (size_t i = 0; i < ArrayDimensions.size(); i++)
+    {
+        if (i > 0)
+        {
+            strDatatype += ", ";
+        }
+
+        strDatatype += ArrayDimensions[i].AsString();
+    }
+
+    strDatatype += "] OF ";
+}
+
+static bool
+_AppendTreeString(S7SymbolTree& Tree, const std::string& str, uint32_t& Offset, uint32_t& Length)
+{
+    // Offsets and lengths are 32-bit, so the string pool must not grow beyond that.
+    if (str.size() > UINT32_MAX - Tree.strStrings.size())
+    {
+        return false;
+    }
+
+    Offset = static_cast<uint32_t>(Tree.strStrings.size());
+    Length = static_cast<uint32_t>(str.size());
+    Tree.strStrings += str;
+    return true;
+}
+
+// Returns nullptr if the strings of the node don't fit into the string pool anymore.
+static S7SymbolNode*
+_AddTreeNode(S7SymbolTree& Tree, S7SymbolNodeKind Kind, uint32_t ParentIndex, const std::string& strName, const std::string& strDatatype, const std::string& strComment)
+{
+    S7SymbolNode& Node = Tree.Nodes.emplace_back();
+    Node.Kind = Kind;
+    Node.ParentIndex = ParentIndex;
+    Node.EndIndex = static_cast<uint32_t>(Tree.Nodes.size());
+    Node.ElementCount = 1;
+
+    if (!_AppendTreeString(Tree, strName, Node.NameOffset, Node.NameLength) ||
+        !_AppendTreeString(Tree, strDatatype, Node.DatatypeOffset, Node.DatatypeLength) ||
+        !_AppendTreeString(Tree, strComment, Node.CommentOffset, Node.CommentLength))
+    {
+        Tree.Nodes.pop_back();
+        return nullptr;
+    }
+
+    return &Node;
+}
+
+static void
+_FormatArrayElementName(std::string& strElementName, const std::string& strVariableName, const std::vector<short>& Indexes)
+{
+    // Build the element name from the indexes, e.g. "Recipe[3,1]".
+    strElementName = strVariableName;
+    strElementName += '[';
+
+    for (size_t i = 0; i < Indexes.size(); i++)
+    {
+        if (i > 0)
+        {
+            strElementName += ',';
+        }
+
+        char szIndex[8];
+        auto [pEnd, Error] = std::to_chars(szIndex, szIndex + sizeof(szIndex), Indexes[i]);
+        strElementName.append(szIndex, pEnd);
+    }
+
+    strElementName += ']';
+}
+
+
 std::variant<std::monostate, CS7PError>
 CMc5codeParser::_AddArrayVariable(const std::string& strStructureType, const std::string& strVariableName)
 {
@@ -33,7 +129,7 @@ CMc5codeParser::_AddArrayVariable(const std::string& strStructureType, const std
     _AlignUp(2 * 8);
 
     // The next non-comment token must be the opening bracket.
-    auto TokenResult = _GetNextToken("[");
+    auto TokenResult = _GetNextToken();
     if (std::holds_alternative<std::monostate>(TokenResult))
     {
         return CS7PError(
@@ -42,16 +138,18 @@ CMc5codeParser::_AddArrayVariable(const std::string& strStructureType, const std
         );
     }
 
-    std::string strToken = std::get<std::string>(std::move(TokenResult));
-    if (strToken != "[")
+    std::string_view svToken = std::get<std::string_view>(TokenResult);
+    if (svToken != "[")
     {
         return CS7PError(
-            L"Expected opening bracket but found \"" + StrToWstr(strToken) +
+            L"Expected opening bracket but found \"" + Cp1252ToWstr(svToken) +
             L"\" while parsing array variable definition for " + StrToWstr(strVariableName)
         );
     }
 
     std::vector<CMc5ArrayDimension> ArrayDimensions;
+    size_t ElementCount = 1;
+    uint64_t TotalElementCount = m_Context.EnclosingArrayElementCount;
     for (;;)
     {
         if (ArrayDimensions.size() == MaxArrayDimensions)
@@ -68,8 +166,23 @@ CMc5codeParser::_AddArrayVariable(const std::string& strStructureType, const std
         CMc5ArrayDimension Dimension = std::get<CMc5ArrayDimension>(std::move(ArrayDimensionInfoResult));
         ArrayDimensions.push_back(Dimension);
 
+        // Check the total number of elements including all enclosing arrays after each dimension, so that the product can never overflow.
+        // A single dimension has at most 65536 elements, and MaxArrayElements is checked before multiplying the next one.
+        // ElementCount is a factor of TotalElementCount and therefore also within MaxArrayElements.
+        const size_t DimensionElementCount = static_cast<size_t>(Dimension.EndIndex - Dimension.StartIndex + 1);
+        TotalElementCount *= DimensionElementCount;
+        if (TotalElementCount > m_Context.Options.MaxArrayElements)
+        {
+            return CS7PError(
+                L"Array variable " + StrToWstr(strVariableName) + L" of " + _GetBlockName() +
+                L" exceeds the maximum of " + std::to_wstring(m_Context.Options.MaxArrayElements) + L" array elements"
+            );
+        }
+
+        ElementCount *= DimensionElementCount;
+
         // The next non-comment token must be a comma to indicate the next dimension or a closing bracket.
-        TokenResult = _GetNextToken(",]");
+        TokenResult = _GetNextToken();
         if (std::holds_alternative<std::monostate>(TokenResult))
         {
             return CS7PError(
@@ -78,15 +191,15 @@ CMc5codeParser::_AddArrayVariable(const std::string& strStructureType, const std
             );
         }
 
-        strToken = std::get<std::string>(std::move(TokenResult));
-        if (strToken == "]")
+        svToken = std::get<std::string_view>(TokenResult);
+        if (svToken == "]")
         {
             break;
         }
-        else if (strToken != ",")
+        else if (svToken != ",")
         {
             return CS7PError(
-                L"Expected comma or closing bracket but found \"" + StrToWstr(strToken) +
+                L"Expected comma or closing bracket but found \"" + Cp1252ToWstr(svToken) +
                 L"\" while parsing array variable definition for " + StrToWstr(strVariableName)
             );
         }
@@ -101,17 +214,17 @@ CMc5codeParser::_AddArrayVariable(const std::string& strStructureType, const std
         );
     }
 
-    strToken = std::get<std::string>(std::move(TokenResult));
-    if (strToken != "OF")
+    svToken = std::get<std::string_view>(TokenResult);
+    if (svToken != "OF")
     {
         return CS7PError(
-            L"Expected \"OF\" but found \"" + StrToWstr(strToken) + L"\" while parsing array variable definition for " +
+            L"Expected \"OF\" but found \"" + Cp1252ToWstr(svToken) + L"\" while parsing array variable definition for " +
             StrToWstr(strVariableName)
         );
     }
 
     // The next non-comment token must be the element type.
-    TokenResult = _GetNextToken(";[:");
+    TokenResult = _GetNextToken();
     if (std::holds_alternative<std::monostate>(TokenResult))
     {
         return CS7PError(
@@ -119,56 +232,124 @@ CMc5codeParser::_AddArrayVariable(const std::string& strStructureType, const std
         );
     }
 
-    std::string strElementType = std::get<std::string>(std::move(TokenResult));
+    std::string_view svElementType = std::get<std::string_view>(TokenResult);
+
+    if (m_Context.pStatistics)
+    {
+        m_Context.pStatistics->ArrayElementCount += ElementCount;
+    }
 
     // Is this a complex array type?
     // Then unpack the array into its elements.
-    if (strElementType == "STRUCT" || m_Mc5codeMap.find(strElementType) != m_Mc5codeMap.end())
+    if (svElementType == "STRUCT" || m_Mc5codeMap.find(svElementType) != m_Mc5codeMap.end())
     {
-        const char* pszSavedPosition = m_pszMc5codePosition;
-
-        // Iterate over all elements.
-        for (const auto& Indexes : CMc5ArrayEnumerator(ArrayDimensions))
+        const CMc5ArrayEnumerator Enumerator(ArrayDimensions);
+        const size_t SavedTokenIndex = m_TokenIndex;
+        const size_t FirstSymbolIndex = _GetSymbolCount();
+        const size_t FirstElementBitAddress = m_BitAddressCounter;
+        const size_t FirstArrayElementCount = m_Context.pStatistics ? m_Context.pStatistics->ArrayElementCount : 0;
+
+        std::vector<short> Indexes;
+        std::string strElementName;
+
+        // In a tree, the array is a node of its own, and its element nodes are only named by their indexes (e.g. "[3,1]").
+        uint32_t ArrayNodeIndex = 0;
+        if (m_Context.pTree)
         {
-            // Rewind back to the start position before reading the complex type again.
-            m_pszMc5codePosition = pszSavedPosition;
+            auto BeginResult = _BeginTreeNode(S7SymbolNodeKind::Array, strVariableName, std::string(), ElementCount);
+            if (const auto pError = std::get_if<CS7PError>(&BeginResult))
+            {
+                return *pError;
+            }
 
-            // Build the element name from the indexes.
-            std::string strElementName = strVariableName + "[";
+            ArrayNodeIndex = std::get<uint32_t>(BeginResult);
+        }
 
-            strElementName += std::accumulate(
-                std::next(Indexes.begin()),
-                Indexes.end(),
-                std::to_string(Indexes.front()),
-                [](std::string a, const short& b)
+        // Arrays nested in the elements count against MaxArrayElements together with this one.
+        const uint64_t SavedEnclosingArrayElementCount = m_Context.EnclosingArrayElementCount;
+        m_Context.EnclosingArrayElementCount = TotalElementCount;
+
+        // Iterate over all elements.
+        std::variant<std::monostate, CS7PError> Result;
+        for (size_t LinearIndex = 0; LinearIndex < ElementCount; LinearIndex++)
+        {
+            if (LinearIndex == 1 && _CloneArrayElements(Enumerator, strVariableName, strElementName, FirstSymbolIndex, FirstElementBitAddress))
+            {
+                if (m_Context.pStatistics)
                 {
-                    return std::move(a) + "," + std::to_string(b);
+                    // Account for the arrays nested in all further elements.
+                    m_Context.pStatistics->ArrayElementCount += (ElementCount - 1) * (m_Context.pStatistics->ArrayElementCount - FirstArrayElementCount);
                 }
-            );
 
-            strElementName += "]";
+                break;
+            }
+
+            // Rewind back to the start position before reading the complex type again.
+            m_TokenIndex = SavedTokenIndex;
+
+            if (m_Context.pStatistics)
+            {
+                // Element names are only needed for error messages when collecting statistics.
+                strElementName = strVariableName;
+            }
+            else
+            {
+                Enumerator.GetIndexes(Indexes, LinearIndex);
+                _FormatArrayElementName(strElementName, m_Context.pTree ? std::string() : strVariableName, Indexes);
+            }
 
             // Add the variable.
-            std::variant<std::monostate, CS7PError> Result;
-            if (strElementType == "STRUCT")
+            if (svElementType == "STRUCT")
             {
                 Result = _AddStructVariable(strElementName);
             }
             else
             {
-                Result = _AddBlockVariable(strElementName, strElementType);
+                Result = _AddBlockVariable(strElementName, svElementType);
             }
 
-            if (const auto pError = std::get_if<CS7PError>(&Result))
+            if (std::holds_alternative<CS7PError>(Result))
             {
-                return *pError;
+                break;
             }
         }
+
+        m_Context.EnclosingArrayElementCount = SavedEnclosingArrayElementCount;
+
+        if (m_Context.pTree)
+        {
+            _EndTreeNode(ArrayNodeIndex);
+
+            // The block number of a UDT/FB element type is only known from the first element (e.g. "ARRAY [1..3] OF UDT5").
+            S7SymbolTree& Tree = *m_Context.pTree;
+            std::string strArrayDatatype;
+            _AppendArrayDatatype(strArrayDatatype, ArrayDimensions);
+
+            if (ArrayNodeIndex + 1 < Tree.Nodes.size())
+            {
+                strArrayDatatype += Tree.GetDatatype(Tree.Nodes[ArrayNodeIndex + 1]);
+            }
+            else
+            {
+                strArrayDatatype += svElementType;
+            }
+
+            S7SymbolNode& ArrayNode = Tree.Nodes[ArrayNodeIndex];
+            if (!_AppendTreeString(Tree, strArrayDatatype, ArrayNode.DatatypeOffset, ArrayNode.DatatypeLength) && !std::holds_alternative<CS7PError>(Result))
+            {
+                Result = _GetTreeTooLargeError();
+            }
+        }
+
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return *pError;
+        }
     }
     else
     {
         // No complex type, then add the primitive variable with the array type.
-        auto Result = _AddPrimitiveVariable(strStructureType, strVariableName, strElementType, &ArrayDimensions);
+        auto Result = _AddPrimitiveVariable(strStructureType, strVariableName, svElementType, &ArrayDimensions);
         if (const auto pError = std::get_if<CS7PError>(&Result))
         {
             return *pError;
@@ -181,71 +362,288 @@ CMc5codeParser::_AddArrayVariable(const std::string& strStructureType, const std
     return std::monostate();
 }
 
+bool
+CMc5codeParser::_CloneArrayElements(const CMc5ArrayEnumerator& Enumerator, const std::string& strVariableName, const std::string& strFirstElementName, size_t FirstSymbolIndex, size_t FirstElementBitAddress)
+{
+    // Arrays with at least this many symbols to clone are split among multiple threads.
+    const size_t MinSymbolsPerThread = 50000;
+
+    // The first element has just been parsed.
+    // All alignments within a STRUCT or UDT are at most 2 bytes, so if its size is a multiple of 2 bytes,
+    // all further elements have the exact same layout, just shifted by that size.
+    // Otherwise, they need to be parsed one by one.
+    const size_t ElementBitSize = m_BitAddressCounter - FirstElementBitAddress;
+    if (ElementBitSize % (2 * 8) != 0)
+    {
+        return false;
+    }
+
+    const size_t ElementCount = Enumerator.GetElementCount();
+    const size_t SymbolsPerElement = _GetSymbolCount() - FirstSymbolIndex;
+    const size_t AdditionalSymbolCount = (ElementCount - 1) * SymbolsPerElement;
+
+    // Let the regular parsing report the exact element exceeding a symbol limit.
+    if (_GetSymbolCount() + AdditionalSymbolCount > m_Context.Options.MaxSymbolsPerDb ||
+        m_Context.ProjectSymbolCount + AdditionalSymbolCount > m_Context.Options.MaxSymbolsPerProject)
+    {
+        return false;
+    }
+
+    if (m_Context.pStatistics)
+    {
+        // There are no symbols to clone, only the counts matter.
+        m_Context.pStatistics->SymbolCount += AdditionalSymbolCount;
+        m_Context.ProjectSymbolCount += AdditionalSymbolCount;
+        m_BitAddressCounter = FirstElementBitAddress + ElementCount * ElementBitSize;
+        return true;
+    }
+
+    if (m_Context.pTree)
+    {
+        // The first element's node directly follows the array node, which is the current parent.
+        // All further elements copy its nodes with shifted indexes and addresses, reusing their strings.
+        // Only the element node itself gets a new name.
+        S7SymbolTree& Tree = *m_Context.pTree;
+        const size_t FirstNodeIndex = m_Context.TreeParentIndex + 1;
+        const size_t NodesPerElement = Tree.Nodes.size() - FirstNodeIndex;
+
+        if (Tree.Nodes.size() + (ElementCount - 1) * NodesPerElement >= S7SymbolTree::NoParent)
+        {
+            return false;
+        }
+
+        Tree.Nodes.reserve(Tree.Nodes.size() + (ElementCount - 1) * NodesPerElement);
+
+        // If the element names don't fit into the string pool, undo the cloning and let the regular parsing report the exact element.
+        const size_t FirstCloneNodeIndex = Tree.Nodes.size();
+        const size_t FirstCloneStringOffset = Tree.strStrings.size();
+
+        std::vector<short> Indexes;
+        std::string strElementName;
+
+        for (size_t ElementIndex = 1; ElementIndex < ElementCount; ElementIndex++)
+        {
+            Enumerator.GetIndexes(Indexes, ElementIndex);
+            _FormatArrayElementName(strElementName, std::string(), Indexes);
+
+            const uint32_t NodeShift = static_cast<uint32_t>(ElementIndex * NodesPerElement);
+            const uint32_t BitOffset = static_cast<uint32_t>(ElementIndex * ElementBitSize);
+
+            for (size_t i = 0; i < NodesPerElement; i++)
+            {
+                S7SymbolNode Node = Tree.Nodes[FirstNodeIndex + i];
+
+                if (i == 0)
+                {
+                    if (!_AppendTreeString(Tree, strElementName, Node.NameOffset, Node.NameLength))
+                    {
+                        Tree.Nodes.resize(FirstCloneNodeIndex);
+                        Tree.strStrings.resize(FirstCloneStringOffset);
+                        return false;
+                    }
+                }
+                else
+                {
+                    Node.ParentIndex += NodeShift;
+                }
+
+                Node.EndIndex += NodeShift;
+                Node.BitOffset += BitOffset;
+                Tree.Nodes.push_back(Node);
+            }
+        }
+
+        Tree.SymbolCount += AdditionalSymbolCount;
+        m_Context.ProjectSymbolCount += AdditionalSymbolCount;
+        m_BitAddressCounter = FirstElementBitAddress + ElementCount * ElementBitSize;
+        return true;
+    }
+
+    // Preallocate the symbols of all elements, so that each element has a fixed slot and the order stays the same.
+    m_Symbols.resize(m_Symbols.size() + AdditionalSymbolCount);
+
+    auto CloneElements = [&](size_t FirstElement, size_t EndElement)
+    {
+        std::vector<short> Indexes;
+        std::string strElementName;
+
+        for (size_t ElementIndex = FirstElement; ElementIndex < EndElement; ElementIndex++)
+        {
+            Enumerator.GetIndexes(Indexes, ElementIndex);
+            _FormatArrayElementName(strElementName, strVariableName, Indexes);
+
+            const uint32_t BitOffset = static_cast<uint32_t>(ElementIndex * ElementBitSize);
+
+            for (size_t i = 0; i < SymbolsPerElement; i++)
+            {
+                const S7Symbol& TemplateSymbol = m_Symbols[FirstSymbolIndex + i];
+                S7Symbol& Symbol = m_Symbols[FirstSymbolIndex + ElementIndex * SymbolsPerElement + i];
+
+                // Replace the first element's name (e.g. "Recipe[1,1]") by this element's name.
+                Symbol.strName.reserve(strElementName.size() + TemplateSymbol.strName.size() - strFirstElementName.size());
+                Symbol.strName = strElementName;
+                Symbol.strName.append(TemplateSymbol.strName, strFirstElementName.size());
+
+                Symbol.strDatatype = TemplateSymbol.strDatatype;
+                Symbol.strComment = TemplateSymbol.strComment;
+                Symbol.Address = TemplateSymbol.Address;
+                Symbol.Address.BitOffset += BitOffset;
+            }
+        }
+    };
+
+    size_t ThreadCount = std::min<size_t>(std::thread::hardware_concurrency(), AdditionalSymbolCount / MinSymbolsPerThread);
+    if (ThreadCount <= 1)
+    {
+        CloneElements(1, ElementCount);
+    }
+    else
+    {
+        // Each thread writes a contiguous range of elements into its preallocated slots.
+        CS7PThreadGroup Threads;
+        const size_t ElementsPerThread = (ElementCount - 1 + ThreadCount - 1) / ThreadCount;
+
+        for (size_t FirstElement = 1; FirstElement < ElementCount; FirstElement += ElementsPerThread)
+        {
+            const size_t EndElement = std::min(FirstElement + ElementsPerThread, ElementCount);
+            Threads.Start(CloneElements, FirstElement, EndElement);
+        }
+
+        Threads.Join();
+    }
+
+    m_Context.ProjectSymbolCount += AdditionalSymbolCount;
+    m_BitAddressCounter = FirstElementBitAddress + ElementCount * ElementBitSize;
+    return true;
+}
+
 std::variant<std::monostate, CS7PError>
-CMc5codeParser::_AddBlockVariable(const std::string& strVariableName, const std::string& strVariableType)
+CMc5codeParser::_AddBlockVariable(const std::string& strVariableName, std::string_view svVariableType)
 {
     // Block variables need to be aligned to a 2-byte boundary.
     _AlignUp(2 * 8);
 
     // The next non-comment token must be the block number.
-    auto TokenResult = _GetNextToken(";");
+    auto TokenResult = _GetNextToken();
     if (std::holds_alternative<std::monostate>(TokenResult))
     {
         return CS7PError(
-            L"Expected block number but found EOF while parsing " + StrToWstr(strVariableType) +
+            L"Expected block number but found EOF while parsing " + Cp1252ToWstr(svVariableType) +
             L" variable definition for " + StrToWstr(strVariableName)
         );
     }
 
-    std::string strToken = std::get<std::string>(std::move(TokenResult));
-    auto Option = StrToSizeT(strToken);
+    std::string_view svToken = std::get<std::string_view>(TokenResult);
+    auto Option = _ParseNumber<size_t>(svToken);
     if (!Option.has_value())
     {
         return CS7PError(
-            L"Expected block number but found \"" + StrToWstr(strToken) + L"\" while parsing " +
-            StrToWstr(strVariableType) + L" variable definition for " + StrToWstr(strVariableName)
+            L"Expected block number but found \"" + Cp1252ToWstr(svToken) + L"\" while parsing " +
+            Cp1252ToWstr(svVariableType) + L" variable definition for " + StrToWstr(strVariableName)
         );
     }
 
     size_t BlockNumber = Option.value();
 
+    if (m_Context.pDependencies)
+    {
+        const auto& InstantiationStack = m_Context.InstantiationStack;
+        const S7BlockKey ReferencingKey = InstantiationStack.empty() ? S7BlockKey("DB", m_DbNumber) : InstantiationStack.back();
+        (*m_Context.pDependencies)[ReferencingKey].emplace(svVariableType, BlockNumber);
+    }
+
     // Continue parsing up to EOF or the final semicolon.
     for (;;)
     {
-        TokenResult = _GetNextToken(";");
+        TokenResult = _GetNextToken();
         if (std::holds_alternative<std::monostate>(TokenResult))
         {
             break;
         }
 
-        strToken = std::get<std::string>(std::move(TokenResult));
-        if (strToken == ";")
+        svToken = std::get<std::string_view>(TokenResult);
+        if (svToken == ";")
         {
             break;
         }
     }
 
     // Find the block in its MC5 Code Map.
-    const std::map<size_t, std::string>& BlockMc5codeMap = m_Mc5codeMap.at(strVariableType);
+    // The caller has already checked that this is a block type.
+    const Mc5codeBlockMap& BlockMc5codeMap = m_Mc5codeMap.find(svVariableType)->second;
     const auto it = BlockMc5codeMap.find(BlockNumber);
     if (it == BlockMc5codeMap.end())
     {
         return CS7PError(
-            L"Variable " + StrToWstr(strVariableName) + L" of DB" + std::to_wstring(m_DbNumber) + L" references " +
-            StrToWstr(strVariableType) + std::to_wstring(BlockNumber) + L", which could not be found"
+            L"Variable " + StrToWstr(strVariableName) + L" of " + _GetBlockName() + L" references " +
+            Cp1252ToWstr(svVariableType) + std::to_wstring(BlockNumber) + L", which could not be found"
+        );
+    }
+
+    // A block that (directly or indirectly) contains itself would be expanded forever.
+    auto& InstantiationStack = m_Context.InstantiationStack;
+    const auto BlockKey = std::make_pair(std::string(svVariableType), BlockNumber);
+    if (std::find(InstantiationStack.begin(), InstantiationStack.end(), BlockKey) != InstantiationStack.end())
+    {
+        std::wstring wstrChain;
+        for (const auto& [strType, Number] : InstantiationStack)
+        {
+            wstrChain += StrToWstr(strType) + std::to_wstring(Number) + L" -> ";
+        }
+
+        wstrChain += Cp1252ToWstr(svVariableType) + std::to_wstring(BlockNumber);
+
+        return CS7PError(
+            L"Variable " + StrToWstr(strVariableName) + L" of " + _GetBlockName() +
+            L" recursively instantiates " + wstrChain
+        );
+    }
+
+    if (m_Context.NestingDepth >= m_Context.Options.MaxNestingDepth)
+    {
+        return CS7PError(
+            L"Variable " + StrToWstr(strVariableName) + L" of " + _GetBlockName() +
+            L" exceeds the maximum nesting depth of " + std::to_wstring(m_Context.Options.MaxNestingDepth)
         );
     }
 
     // Parse the MC5 Code for this block.
-    const std::string& strMc5code = it->second;
-    CMc5codeParser Parser(m_Symbols, m_BitAddressCounter, m_DbNumber, strMc5code, m_Mc5codeMap);
+    // Its tokens are cached, so that every further instance of this block in any DB just walks the same token stream.
+    const auto StreamIt = m_Context.TokenStreamCache.try_emplace(BlockKey, it->second, m_Context.pTemporaryResource).first;
+    CMc5codeParser Parser(m_Symbols, m_BitAddressCounter, m_DbNumber, StreamIt->second, m_Mc5codeMap, m_Context);
+
+    InstantiationStack.push_back(BlockKey);
+    m_Context.NestingDepth++;
 
-    std::string strPrefix = strVariableName + ".";
-    return Parser.Parse(strPrefix);
+    std::variant<std::monostate, CS7PError> Result;
+    if (m_Context.pTree)
+    {
+        auto BeginResult = _BeginTreeNode(S7SymbolNodeKind::Struct, strVariableName, BlockKey.first + std::to_string(BlockNumber));
+        if (const auto pError = std::get_if<CS7PError>(&BeginResult))
+        {
+            Result = *pError;
+        }
+        else
+        {
+            const uint32_t NodeIndex = std::get<uint32_t>(BeginResult);
+            Result = Parser.Parse();
+            _EndTreeNode(NodeIndex);
+        }
+    }
+    else
+    {
+        std::string strPrefix = strVariableName + ".";
+        Result = Parser.Parse(strPrefix);
+    }
+
+    m_Context.NestingDepth--;
+    InstantiationStack.pop_back();
+
+    return Result;
 }
 
 std::variant<std::monostate, CS7PError>
-CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const std::string& strVariableName, const std::string& strVariableType, const std::vector<CMc5ArrayDimension>* pArrayDimensions)
+CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const std::string& strVariableName, std::string_view svVariableType, const std::vector<CMc5ArrayDimension>* pArrayDimensions)
 {
     static constexpr std::array<ByteSizedVariableInfo, 20> ByteSizedVariables = {{
         {"BYTE", 1, 1},
@@ -275,20 +673,21 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
 
     // Assume a single variable, but check if the caller passed array dimensions.
     size_t ArrayDimensionCount = 1;
-    long ElementCount = 1;
+    size_t ElementCount = 1;
     if (pArrayDimensions)
     {
         ArrayDimensionCount = pArrayDimensions->size();
 
         // Count the total number of elements over all dimensions.
         // Array elements over multiple dimensions are ordered linearly without any padding. (except for BOOL!)
+        // _AddArrayVariable has already checked this product against MaxArrayElements.
         for (const auto& Info : *pArrayDimensions)
         {
-            ElementCount *= Info.EndIndex - Info.StartIndex + 1;
+            ElementCount *= static_cast<size_t>(Info.EndIndex - Info.StartIndex + 1);
         }
     }
 
-    if (strVariableType == "BOOL")
+    if (svVariableType == "BOOL")
     {
         // A BOOL variable always works on the current address with no extra alignment.
         BitAddress = m_BitAddressCounter;
@@ -315,10 +714,10 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
             //    8,1 - 8,2
 
             const auto& LastDimensionInfo = pArrayDimensions->back();
-            long LastDimensionElementCount = LastDimensionInfo.EndIndex - LastDimensionInfo.StartIndex + 1;
-            long OtherDimensionsElementCount = ElementCount / LastDimensionElementCount;
+            size_t LastDimensionElementCount = static_cast<size_t>(LastDimensionInfo.EndIndex - LastDimensionInfo.StartIndex + 1);
+            size_t OtherDimensionsElementCount = ElementCount / LastDimensionElementCount;
 
-            for (long i = 0; i < OtherDimensionsElementCount; i++)
+            for (size_t i = 0; i < OtherDimensionsElementCount; i++)
             {
                 _AlignUp(8);
                 m_BitAddressCounter += LastDimensionElementCount;
@@ -330,10 +729,10 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
             m_BitAddressCounter += ElementCount;
         }
     }
-    else if (strVariableType == "STRING")
+    else if (svVariableType == "STRING")
     {
         // The next non-comment token must be the opening bracket.
-        auto TokenResult = _GetNextToken("[");
+        auto TokenResult = _GetNextToken();
         if (std::holds_alternative<std::monostate>(TokenResult))
         {
             return CS7PError(
@@ -341,17 +740,17 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
             );
         }
 
-        std::string strToken = std::get<std::string>(std::move(TokenResult));
-        if (strToken != "[")
+        std::string_view svToken = std::get<std::string_view>(TokenResult);
+        if (svToken != "[")
         {
             return CS7PError(
-                L"Expected opening bracket but found \"" + StrToWstr(strToken) +
+                L"Expected opening bracket but found \"" + Cp1252ToWstr(svToken) +
                 L"\" while parsing string variable definition for " + StrToWstr(strVariableName)
             );
         }
 
         // The next non-comment token must be the character count.
-        TokenResult = _GetNextToken("]");
+        TokenResult = _GetNextToken();
         if (std::holds_alternative<std::monostate>(TokenResult))
         {
             return CS7PError(
@@ -359,12 +758,12 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
             );
         }
 
-        strToken = std::get<std::string>(std::move(TokenResult));
-        auto Option = StrToSizeT(strToken);
+        svToken = std::get<std::string_view>(TokenResult);
+        auto Option = _ParseNumber<size_t>(svToken);
         if (!Option.has_value())
         {
             return CS7PError(
-                L"Expected character count but found \"" + StrToWstr(strToken) +
+                L"Expected character count but found \"" + Cp1252ToWstr(svToken) +
                 L"\" while parsing string variable definition for " + StrToWstr(strVariableName)
             );
         }
@@ -382,7 +781,7 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
         _AlignUp(2 * 8);
         BitAddress = m_BitAddressCounter;
 
-        for (long i = 0; i < ElementCount; i++)
+        for (size_t i = 0; i < ElementCount; i++)
         {
             // Each STRING variable within an ARRAY of STRINGs also needs to be aligned to a 2-byte boundary (note that StringByteCount can be odd, e.g. for a "STRING[3]").
             _AlignUp(2 * 8);
@@ -394,7 +793,7 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
     else
     {
         // Is it one of the trivial types without any special handling?
-        const auto& it = std::find(ByteSizedVariables.begin(), ByteSizedVariables.end(), strVariableType);
+        const auto& it = std::find(ByteSizedVariables.begin(), ByteSizedVariables.end(), svVariableType);
         if (it != ByteSizedVariables.end())
         {
             _AlignUp(it->ByteAlignment * 8);
@@ -405,75 +804,83 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
         else
         {
             return CS7PError(
-                L"Variable " + StrToWstr(strVariableName) + L" of DB" + std::to_wstring(m_DbNumber) +
-                L" has unknown primitive variable type " + StrToWstr(strVariableType)
+                L"Variable " + StrToWstr(strVariableName) + L" of " + _GetBlockName() +
+                L" has unknown primitive variable type " + Cp1252ToWstr(svVariableType)
             );
         }
     }
 
     // Continue parsing up to EOF or the final semicolon.
+    std::string strVariableComment;
     for (;;)
     {
-        auto TokenResult = _GetNextToken(";");
+        auto TokenResult = _GetNextToken();
         if (std::holds_alternative<std::monostate>(TokenResult))
         {
             break;
         }
 
-        std::string strToken = std::get<std::string>(std::move(TokenResult));
-        if (strToken == ";")
+        std::string_view svToken = std::get<std::string_view>(TokenResult);
+        if (svToken == ";")
         {
+            // The last comment following the semicolon is the comment for this symbol.
+            // Statistics don't need it.
+            uint32_t CommentIndex = m_TokenStream.GetTrailingCommentIndex(m_TokenIndex - 1);
+            if (CommentIndex != CMc5codeTokenStream::NoComment && !m_Context.pStatistics)
+            {
+                const std::string_view svComment = m_TokenStream.GetComment(CommentIndex);
+                if (m_Context.Options.bTranscodeStrings)
+                {
+                    AppendCp1252AsUtf8(strVariableComment, svComment);
+                }
+                else
+                {
+                    strVariableComment = svComment;
+                }
+            }
+
             break;
         }
     }
 
-    // Find the last comment for this symbol.
-    std::string strVariableComment;
-    for (;;)
+    // Enforce the symbol limits before adding this symbol.
+    if (_GetSymbolCount() >= m_Context.Options.MaxSymbolsPerDb)
     {
-        auto TokenResult = _GetNextToken(":{", true);
-        if (std::holds_alternative<std::monostate>(TokenResult))
-        {
-            break;
-        }
+        return CS7PError(
+            _GetBlockName() + L" exceeds the maximum of " +
+            std::to_wstring(m_Context.Options.MaxSymbolsPerDb) + L" symbols per DB"
+        );
+    }
 
-        std::string strToken = std::get<std::string>(std::move(TokenResult));
-        if (strToken.starts_with("//"))
-        {
-            strVariableComment = Str1252ToStr(strToken.substr(2));
-        }
-        else
-        {
-            // This is not a comment, but the next token, and we are not interested in that token here.
-            // Rewind the reader position, so that it is found again by the next _GetNextToken call.
-            m_pszMc5codePosition -= strToken.size();
-            break;
-        }
+    if (m_Context.ProjectSymbolCount >= m_Context.Options.MaxSymbolsPerProject)
+    {
+        return CS7PError(
+            _GetBlockName() + L" exceeds the maximum of " +
+            std::to_wstring(m_Context.Options.MaxSymbolsPerProject) + L" symbols per project"
+        );
+    }
+
+    m_Context.ProjectSymbolCount++;
+
+    if (m_Context.pStatistics)
+    {
+        m_Context.pStatistics->SymbolCount++;
+        m_Context.pStatistics->MaxNestingDepth = std::max(m_Context.pStatistics->MaxNestingDepth, m_Context.NestingDepth);
+        return std::monostate();
     }
 
     // Add this symbol.
     S7Symbol Symbol;
     Symbol.strName = strVariableName;
-
-    size_t AddressMajor = BitAddress / 8;
-    size_t AddressMinor = BitAddress % 8;
-    Symbol.strCode = "DB" + std::to_string(m_DbNumber) + ":" + std::to_string(AddressMajor) + "." + std::to_string(AddressMinor);
+    Symbol.Address.Area = S7Area::DB;
+    Symbol.Address.DbNumber = static_cast<uint16_t>(m_DbNumber);
+    Symbol.Address.BitOffset = static_cast<uint32_t>(BitAddress);
+    Symbol.Address.BitSize = static_cast<uint32_t>(m_BitAddressCounter - BitAddress);
+    Symbol.Address.ElementCount = static_cast<uint32_t>(ElementCount);
 
     if (ElementCount > 1)
     {
-        Symbol.strDatatype = "ARRAY [";
-
-        Symbol.strDatatype += std::accumulate(
-            std::next(pArrayDimensions->begin()),
-            pArrayDimensions->end(),
-            pArrayDimensions->front().AsString(),
-            [](std::string a, const CMc5ArrayDimension& b)
-            {
-                return std::move(a) + ", " + b.AsString();
-            }
-        );
-
-        Symbol.strDatatype += "] OF ";
+        _AppendArrayDatatype(Symbol.strDatatype, *pArrayDimensions);
     }
 
     if (!strFullVariableType.empty())
@@ -482,7 +889,7 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
     }
     else
     {
-        Symbol.strDatatype += strVariableType;
+        Symbol.strDatatype += svVariableType;
     }
 
     Symbol.strComment = strStructureType;
@@ -491,34 +898,81 @@ CMc5codeParser::_AddPrimitiveVariable(const std::string& strStructureType, const
         Symbol.strComment += "; " + strVariableComment;
     }
 
-    m_Symbols.push_back(Symbol);
+    if (m_Context.pTree)
+    {
+        S7SymbolNode* pNode = _AddTreeNode(*m_Context.pTree, S7SymbolNodeKind::Leaf, m_Context.TreeParentIndex, Symbol.strName, Symbol.strDatatype, Symbol.strComment);
+        if (!pNode)
+        {
+            return _GetTreeTooLargeError();
+        }
+
+        pNode->BitOffset = Symbol.Address.BitOffset;
+        pNode->BitSize = Symbol.Address.BitSize;
+        pNode->ElementCount = Symbol.Address.ElementCount;
+        m_Context.pTree->SymbolCount++;
+    }
+    else
+    {
+        m_Symbols.push_back(std::move(Symbol));
+    }
 
     // Return success!
     return std::monostate();
 }
 
 std::variant<std::monostate, CS7PError>
-CMc5codeParser::_AddSingleVariable(const std::string& strStructureType, const std::string& strVariableName, const std::string& strVariableType)
+CMc5codeParser::_AddSingleVariable(const std::string& strStructureType, const std::string& strVariableName, std::string_view svVariableType)
 {
-    if (strVariableType == "STRUCT")
+    if (svVariableType == "STRUCT")
     {
         return _AddStructVariable(strVariableName);
     }
-    else if (m_Mc5codeMap.find(strVariableType) != m_Mc5codeMap.end())
+    else if (m_Mc5codeMap.find(svVariableType) != m_Mc5codeMap.end())
     {
-        return _AddBlockVariable(strVariableName, strVariableType);
+        return _AddBlockVariable(strVariableName, svVariableType);
     }
     else
     {
-        return _AddPrimitiveVariable(strStructureType, strVariableName, strVariableType);
+        return _AddPrimitiveVariable(strStructureType, strVariableName, svVariableType);
     }
 }
 
 std::variant<std::monostate, CS7PError>
 CMc5codeParser::_AddStructVariable(const std::string& strVariableName)
 {
-    std::string strPrefix = strVariableName + ".";
-    auto Result = _ParseInnerStructure("Struct", strPrefix);
+    if (m_Context.NestingDepth >= m_Context.Options.MaxNestingDepth)
+    {
+        return CS7PError(
+            L"Variable " + StrToWstr(strVariableName) + L" of " + _GetBlockName() +
+            L" exceeds the maximum nesting depth of " + std::to_wstring(m_Context.Options.MaxNestingDepth)
+        );
+    }
+
+    m_Context.NestingDepth++;
+
+    std::variant<bool, CS7PError> Result;
+    if (m_Context.pTree)
+    {
+        auto BeginResult = _BeginTreeNode(S7SymbolNodeKind::Struct, strVariableName, "STRUCT");
+        if (const auto pError = std::get_if<CS7PError>(&BeginResult))
+        {
+            Result = *pError;
+        }
+        else
+        {
+            const uint32_t NodeIndex = std::get<uint32_t>(BeginResult);
+            Result = _ParseInnerStructure("Struct", std::string());
+            _EndTreeNode(NodeIndex);
+        }
+    }
+    else
+    {
+        std::string strPrefix = strVariableName + ".";
+        Result = _ParseInnerStructure("Struct", strPrefix);
+    }
+
+    m_Context.NestingDepth--;
+
     if (const auto pError = std::get_if<CS7PError>(&Result))
     {
         return *pError;
@@ -531,7 +985,7 @@ std::variant<std::monostate, CS7PError>
 CMc5codeParser::_AddVariable(const std::string& strStructureType, const std::string& strVariableName)
 {
     // The next non-comment token can be the delimiter between variable name and type, or the beginning of an attribute list.
-    auto TokenResult = _GetNextToken(":{");
+    auto TokenResult = _GetNextToken();
     if (std::holds_alternative<std::monostate>(TokenResult))
     {
         return CS7PError(
@@ -540,14 +994,14 @@ CMc5codeParser::_AddVariable(const std::string& strStructureType, const std::str
         );
     }
 
-    std::string strToken = std::get<std::string>(std::move(TokenResult));
-    if (strToken == "{")
+    std::string_view svToken = std::get<std::string_view>(TokenResult);
+    if (svToken == "{")
     {
         // This is the beginning of a variable attribute list.
         // We don't care about variable attributes, so just look for the closing brace.
         for (;;)
         {
-            TokenResult = _GetNextToken("}");
+            TokenResult = _GetNextToken();
             if (std::holds_alternative<std::monostate>(TokenResult))
             {
                 return CS7PError(
@@ -556,15 +1010,15 @@ CMc5codeParser::_AddVariable(const std::string& strStructureType, const std::str
                 );
             }
 
-            strToken = std::get<std::string>(std::move(TokenResult));
-            if (strToken == "}")
+            svToken = std::get<std::string_view>(TokenResult);
+            if (svToken == "}")
             {
                 break;
             }
         }
 
         // Now we should finally be at the delimiter.
-        TokenResult = _GetNextToken(":");
+        TokenResult = _GetNextToken();
         if (std::holds_alternative<std::monostate>(TokenResult))
         {
             return CS7PError(
@@ -572,19 +1026,19 @@ CMc5codeParser::_AddVariable(const std::string& strStructureType, const std::str
             );
         }
 
-        strToken = std::get<std::string>(std::move(TokenResult));
+        svToken = std::get<std::string_view>(TokenResult);
     }
 
-    if (strToken != ":")
+    if (svToken != ":")
     {
         return CS7PError(
-            L"Expected colon but found \"" + StrToWstr(strToken) +
+            L"Expected colon but found \"" + Cp1252ToWstr(svToken) +
             L"\" while parsing variable definition for " + StrToWstr(strVariableName)
         );
     }
 
     // The next non-comment token must be the variable type.
-    TokenResult = _GetNextToken(";[:");
+    TokenResult = _GetNextToken();
     if (std::holds_alternative<std::monostate>(TokenResult))
     {
         return CS7PError(
@@ -592,16 +1046,16 @@ CMc5codeParser::_AddVariable(const std::string& strStructureType, const std::str
         );
     }
 
-    std::string strVariableType = std::get<std::string>(std::move(TokenResult));
+    std::string_view svVariableType = std::get<std::string_view>(TokenResult);
 
     // Is this an array or a single variable?
-    if (strVariableType == "ARRAY")
+    if (svVariableType == "ARRAY")
     {
         return _AddArrayVariable(strStructureType, strVariableName);
     }
     else
     {
-        return _AddSingleVariable(strStructureType, strVariableName, strVariableType);
+        return _AddSingleVariable(strStructureType, strVariableName, svVariableType);
     }
 }
 
@@ -612,11 +1066,62 @@ CMc5codeParser::_AlignUp(const size_t BitAlignment)
     m_BitAddressCounter = (m_BitAddressCounter + BitMask) & ~BitMask;
 }
 
+std::variant<uint32_t, CS7PError>
+CMc5codeParser::_BeginTreeNode(S7SymbolNodeKind Kind, const std::string& strName, const std::string& strDatatype, size_t ElementCount)
+{
+    // The node starts at the current address and becomes the parent of all nodes added until _EndTreeNode.
+    S7SymbolTree& Tree = *m_Context.pTree;
+    const uint32_t NodeIndex = static_cast<uint32_t>(Tree.Nodes.size());
+
+    S7SymbolNode* pNode = _AddTreeNode(Tree, Kind, m_Context.TreeParentIndex, strName, strDatatype, std::string());
+    if (!pNode)
+    {
+        return _GetTreeTooLargeError();
+    }
+
+    pNode->BitOffset = static_cast<uint32_t>(m_BitAddressCounter);
+    pNode->ElementCount = static_cast<uint32_t>(ElementCount);
+
+    m_Context.TreeParentIndex = NodeIndex;
+    return NodeIndex;
+}
+
+void
+CMc5codeParser::_EndTreeNode(uint32_t NodeIndex)
+{
+    S7SymbolTree& Tree = *m_Context.pTree;
+    S7SymbolNode& Node = Tree.Nodes[NodeIndex];
+    Node.EndIndex = static_cast<uint32_t>(Tree.Nodes.size());
+    Node.BitSize = static_cast<uint32_t>(m_BitAddressCounter - Node.BitOffset);
+
+    m_Context.TreeParentIndex = Node.ParentIndex;
+}
+
+std::wstring
+CMc5codeParser::_GetBlockName() const
+{
+    // A layout shared by multiple instance DBs is parsed without a DB number, so its errors name the FB instead.
+    // The caller prefixes them with the respective instance DB.
+    if (m_DbNumber == 0 && !m_Context.InstantiationStack.empty())
+    {
+        const auto& [strType, BlockNumber] = m_Context.InstantiationStack.front();
+        return StrToWstr(strType) + std::to_wstring(BlockNumber);
+    }
+
+    return L"DB" + std::to_wstring(m_DbNumber);
+}
+
+CS7PError
+CMc5codeParser::_GetTreeTooLargeError() const
+{
+    return CS7PError(L"Symbol tree of " + _GetBlockName() + L" exceeds the maximum string size of " + std::to_wstring(UINT32_MAX) + L" bytes");
+}
+
 std::variant<CMc5ArrayDimension, CS7PError>
 CMc5codeParser::_GetNextArrayDimensionInfo(const std::string& strVariableName)
 {
     // The next non-comment token must be the start index.
-    auto TokenResult = _GetNextToken(".");
+    auto TokenResult = _GetNextToken();
     if (std::holds_alternative<std::monostate>(TokenResult))
     {
         return CS7PError(
@@ -624,12 +1129,12 @@ CMc5codeParser::_GetNextArrayDimensionInfo(const std::string& strVariableName)
         );
     }
 
-    std::string strToken = std::get<std::string>(std::move(TokenResult));
-    auto Option = StrToLong(strToken);
+    std::string_view svToken = std::get<std::string_view>(TokenResult);
+    auto Option = _ParseNumber<long>(svToken);
     if (!Option.has_value())
     {
         return CS7PError(
-            L"Expected start index but found \"" + StrToWstr(strToken) +
+            L"Expected start index but found \"" + Cp1252ToWstr(svToken) +
             L"\" while parsing array variable definition for " + StrToWstr(strVariableName)
         );
     }
@@ -646,7 +1151,7 @@ CMc5codeParser::_GetNextArrayDimensionInfo(const std::string& strVariableName)
     // The next two non-comment tokens must be dots.
     for (int i = 1; i <= 2; i++)
     {
-        TokenResult = _GetNextToken(".");
+        TokenResult = _GetNextToken();
         if (std::holds_alternative<std::monostate>(TokenResult))
         {
             return CS7PError(
@@ -655,29 +1160,29 @@ CMc5codeParser::_GetNextArrayDimensionInfo(const std::string& strVariableName)
             );
         }
 
-        strToken = std::get<std::string>(std::move(TokenResult));
-        if (strToken != ".")
+        svToken = std::get<std::string_view>(TokenResult);
+        if (svToken != ".")
         {
             return CS7PError(
-                L"Expected dot " + std::to_wstring(i) + L" but found \"" + StrToWstr(strToken) +
+                L"Expected dot " + std::to_wstring(i) + L" but found \"" + Cp1252ToWstr(svToken) +
                 L"\" while parsing array variable definition for " + StrToWstr(strVariableName)
             );
         }
     }
 
     // The next non-comment token must be the end index.
-    TokenResult = _GetNextToken(",]");
+    TokenResult = _GetNextToken();
     if (std::holds_alternative<std::monostate>(TokenResult))
     {
         return CS7PError(L"Expected end index but found EOF while parsing array variable definition for " + StrToWstr(strVariableName));
     }
 
-    strToken = std::get<std::string>(std::move(TokenResult));
-    Option = StrToLong(strToken);
+    svToken = std::get<std::string_view>(TokenResult);
+    Option = _ParseNumber<long>(svToken);
     if (!Option.has_value())
     {
         return CS7PError(
-            L"Expected end index but found \"" + StrToWstr(strToken) +
+            L"Expected end index but found \"" + Cp1252ToWstr(svToken) +
             L"\" while parsing array variable definition for " + StrToWstr(strVariableName)
         );
     }
@@ -696,65 +1201,27 @@ CMc5codeParser::_GetNextArrayDimensionInfo(const std::string& strVariableName)
     return Info;
 }
 
-std::variant<std::string, std::monostate>
-CMc5codeParser::_GetNextToken(const char* szTokens, bool bGetComments)
+std::variant<std::string_view, std::monostate>
+CMc5codeParser::_GetNextToken()
 {
-    for (;;)
+    // Have we reached the end of the MC5 Code?
+    if (m_TokenIndex == m_TokenStream.GetTokenCount())
     {
-        // Skip whitespace.
-        while (IsSpaceCharacter(*m_pszMc5codePosition))
-        {
-            m_pszMc5codePosition++;
-        }
-
-        // Have we reached the end of the MC5 Code?
-        if (*m_pszMc5codePosition == '\0')
-        {
-            return std::monostate();
-        }
-
-        const char* pszStart = m_pszMc5codePosition;
-
-        // Check if this is a line comment.
-        if (*pszStart == '/' && pszStart[1] == '/')
-        {
-            // Find the end of the comment (at the end of the line).
-            while (*m_pszMc5codePosition != '\0' && *m_pszMc5codePosition != '\r' && *m_pszMc5codePosition != '\n')
-            {
-                m_pszMc5codePosition++;
-            }
-
-            if (bGetComments)
-            {
-                // Return this comment.
-                size_t Length = m_pszMc5codePosition - pszStart;
-                return std::string(pszStart, Length);
-            }
-            else
-            {
-                // The caller is not interested in comments, so find another token.
-                continue;
-            }
-        }
-
-        // Check if we match one of the single-character tokens.
-        if (strchr(szTokens, *m_pszMc5codePosition))
-        {
-            // Return that single character token.
-            std::string strToken = std::string(1, *m_pszMc5codePosition);
-            m_pszMc5codePosition++;
-            return strToken;
-        }
+        return std::monostate();
+    }
 
-        // If this is none of the above, we return everything up to the next space or single-character token (= a word).
-        while (*m_pszMc5codePosition != '\0' && !IsSpaceCharacter(*m_pszMc5codePosition) && !strchr(szTokens, *m_pszMc5codePosition))
-        {
-            m_pszMc5codePosition++;
-        }
+    return m_TokenStream.GetToken(m_TokenIndex++);
+}
 
-        size_t Length = m_pszMc5codePosition - pszStart;
-        return std::string(pszStart, Length);
+size_t
+CMc5codeParser::_GetSymbolCount() const
+{
+    if (m_Context.pStatistics)
+    {
+        return m_Context.pStatistics->SymbolCount;
     }
+
+    return m_Context.pTree ? m_Context.pTree->SymbolCount : m_Symbols.size();
 }
 
 std::variant<bool, CS7PError>
@@ -768,37 +1235,37 @@ CMc5codeParser::_ParseStructureType(std::string& strStructureType)
         return false;
     }
 
-    std::string strToken = std::get<std::string>(std::move(TokenResult));
+    std::string_view svToken = std::get<std::string_view>(TokenResult);
 
     // This token must be the struct type.
-    if (strToken == "VAR_INPUT")
+    if (svToken == "VAR_INPUT")
     {
         strStructureType = "In";
     }
-    else if (strToken == "VAR_OUTPUT")
+    else if (svToken == "VAR_OUTPUT")
     {
         strStructureType = "Out";
     }
-    else if (strToken == "VAR_IN_OUT")
+    else if (svToken == "VAR_IN_OUT")
     {
         strStructureType = "InOut";
     }
-    else if (strToken == "VAR")
+    else if (svToken == "VAR")
     {
         strStructureType = "Var";
     }
-    else if (strToken == "STRUCT")
+    else if (svToken == "STRUCT")
     {
         strStructureType = "Struct";
     }
-    else if (strToken == "VAR_TEMP")
+    else if (svToken == "VAR_TEMP")
     {
         // There are no more interesting variables as soon as we hit VAR_TEMP.
         return false;
     }
     else
     {
-        return CS7PError(L"Unknown structure type \"" + StrToWstr(strToken) + L"\" while parsing DB" + std::to_wstring(m_DbNumber));
+        return CS7PError(L"Unknown structure type \"" + Cp1252ToWstr(svToken) + L"\" while parsing " + _GetBlockName());
     }
 
     return true;
@@ -810,45 +1277,61 @@ CMc5codeParser::_ParseInnerStructure(const std::string& strStructureType, const
     for (;;)
     {
         // Read the next non-comment token.
-        auto TokenResult = _GetNextToken(":;");
+        auto TokenResult = _GetNextToken();
         if (std::holds_alternative<std::monostate>(TokenResult))
         {
             // End of file, we are done!
             return false;
         }
 
-        std::string strToken = std::get<std::string>(std::move(TokenResult));
+        std::string_view svToken = std::get<std::string_view>(TokenResult);
 
         // Is this the end of the inner structure?
-        if (strToken == "END_VAR")
+        if (svToken == "END_VAR")
         {
             // We have finished this structure, but there may be additional structures to parse.
             return true;
         }
-        else if (strToken == "END_STRUCT")
+        else if (svToken == "END_STRUCT")
         {
             // END_STRUCT concludes with a final semicolon.
-            TokenResult = _GetNextToken(";");
+            TokenResult = _GetNextToken();
             if (std::holds_alternative<std::monostate>(TokenResult))
             {
                 // End of file, we are done!
                 return false;
             }
 
-            strToken = std::get<std::string>(std::move(TokenResult));
-            if (strToken == ";")
+            svToken = std::get<std::string_view>(TokenResult);
+            if (svToken == ";")
             {
                 // We have finished this structure, but there may be additional structures to parse.
                 return true;
             }
             else
             {
-                return CS7PError(L"Expected semicolon after END_STRUCT but got: " + StrToWstr(strToken));
+                return CS7PError(L"Expected semicolon after END_STRUCT but got: " + Cp1252ToWstr(svToken));
             }
         }
 
         // No, then we are at the beginning of a variable definition and this must be the variable name.
-        std::string strVariableName = strPrefix + Str1252ToStr(strToken);
+        // Statistics only need it for error messages, so the full name isn't built then.
+        std::string strVariableName;
+        if (m_Context.pStatistics)
+        {
+            strVariableName = svToken;
+        }
+        else if (m_Context.Options.bTranscodeStrings)
+        {
+            strVariableName = strPrefix;
+            AppendCp1252AsUtf8(strVariableName, svToken);
+        }
+        else
+        {
+            strVariableName = strPrefix;
+            strVariableName += svToken;
+        }
+
         auto Result = _AddVariable(strStructureType, strVariableName);
         if (const auto pError = std::get_if<CS7PError>(&Result))
         {
@@ -858,8 +1341,8 @@ CMc5codeParser::_ParseInnerStructure(const std::string& strStructureType, const
 }
 
 
-CMc5codeParser::CMc5codeParser(std::vector<S7Symbol>& Symbols, size_t& BitAddressCounter, const size_t DbNumber, const std::string& strMc5code, const std::map<std::string, std::map<size_t, std::string>>& Mc5codeMap)
-    : m_pszMc5codePosition(strMc5code.c_str()), m_Mc5codeMap(Mc5codeMap), m_BitAddressCounter(BitAddressCounter), m_DbNumber(DbNumber), m_Symbols(Symbols)
+CMc5codeParser::CMc5codeParser(std::vector<S7Symbol>& Symbols, size_t& BitAddressCounter, const size_t DbNumber, const CMc5codeTokenStream& TokenStream, const Mc5codeTypeMap& Mc5codeMap, Mc5codeParserContext& Context)
+    : m_TokenStream(TokenStream), m_TokenIndex(0), m_Mc5codeMap(Mc5codeMap), m_BitAddressCounter(BitAddressCounter), m_Context(Context), m_DbNumber(DbNumber), m_Symbols(Symbols)
 {
 }
 
@@ -7,37 +7,85 @@
 #pragma once
 
 #include <map>
+#include <memory_resource>
+#include <set>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "CMc5ArrayDimension.h"
+#include "CMc5codeTokenStream.h"
 #include "CS7PError.h"
 #include "s7p_parser.h"
 
+// MC5 Code of all blocks of a device, by block type ("DB", "DBREF", "FB", "SFB", "UDT") and block number.
+// Both the map nodes and the MC5 Code strings live in the temporary memory resource.
+using Mc5codeBlockMap = std::pmr::map<size_t, std::pmr::string>;
+// Transparently compared, so that the parser can look up block types by token.
+using Mc5codeTypeMap = std::pmr::map<std::string, Mc5codeBlockMap, std::less<>>;
+
+// State shared by all CMc5codeParser instances involved in parsing a single DB (including those for nested UDTs and FBs).
+// The token stream cache is additionally shared between all DBs of a device.
+struct Mc5codeParserContext
+{
+    const S7ParseOptions& Options;
+    size_t& ProjectSymbolCount;
+    std::pmr::map<std::pair<std::string, size_t>, CMc5codeTokenStream>& TokenStreamCache;
+    std::pmr::memory_resource* pTemporaryResource;
+    std::vector<std::pair<std::string, size_t>> InstantiationStack;
+    size_t NestingDepth;
+
+    // If set, symbols are only counted into these statistics instead of being added to the symbol vector.
+    // Names, datatypes and comments are then never built.
+    S7DbStatistics* pStatistics = nullptr;
+
+    // If set, symbols are added as nodes of this tree instead of being flattened into the symbol vector.
+    // Variable names then remain local names, and TreeParentIndex is the node that new nodes are added to.
+    S7SymbolTree* pTree = nullptr;
+    uint32_t TreeParentIndex = S7SymbolTree::NoParent;
+
+    // If set, every UDT/FB/SFB reference is recorded here, from the innermost instantiated block (or the DB itself) to the referenced block.
+    std::map<S7BlockKey, std::set<S7BlockKey>>* pDependencies = nullptr;
+
+    // Product of the element counts of all arrays enclosing the variables currently being parsed.
+    // Nested arrays check their own element count multiplied by this one against S7ParseOptions::MaxArrayElements.
+    uint64_t EnclosingArrayElementCount = 1;
+};
+
+class CMc5ArrayEnumerator;
+
 class CMc5codeParser
 {
 public:
-    CMc5codeParser(std::vector<S7Symbol>& Symbols, size_t& BitAddressCounter, const size_t DbNumber, const std::string& strMc5code, const std::map<std::string, std::map<size_t, std::string>>& Mc5codeMap);
+    CMc5codeParser(std::vector<S7Symbol>& Symbols, size_t& BitAddressCounter, const size_t DbNumber, const CMc5codeTokenStream& TokenStream, const Mc5codeTypeMap& Mc5codeMap, Mc5codeParserContext& Context);
 
     std::variant<std::monostate, CS7PError> Parse(const std::string& strPrefix = std::string());
 
 private:
-    const char* m_pszMc5codePosition;
-    const std::map<std::string, std::map<size_t, std::string>>& m_Mc5codeMap;
+    const CMc5codeTokenStream& m_TokenStream;
+    size_t m_TokenIndex;
+    const Mc5codeTypeMap& m_Mc5codeMap;
     size_t& m_BitAddressCounter;
+    Mc5codeParserContext& m_Context;
     size_t m_DbNumber;
     std::vector<S7Symbol>& m_Symbols;
     
     std::variant<std::monostate, CS7PError> _AddArrayVariable(const std::string& strStructureType, const std::string& strVariableName);
-    std::variant<std::monostate, CS7PError> _AddBlockVariable(const std::string& strVariableName, const std::string& strVariableType);
-    std::variant<std::monostate, CS7PError> _AddPrimitiveVariable(const std::string& strCurrentStructureType, const std::string& strVariableName, const std::string& strVariableType, const std::vector<CMc5ArrayDimension>* pArrayDimensions = nullptr);
-    std::variant<std::monostate, CS7PError> _AddSingleVariable(const std::string& strStructureType, const std::string& strVariableName, const std::string& strVariableType);
+    std::variant<std::monostate, CS7PError> _AddBlockVariable(const std::string& strVariableName, std::string_view svVariableType);
+    std::variant<std::monostate, CS7PError> _AddPrimitiveVariable(const std::string& strCurrentStructureType, const std::string& strVariableName, std::string_view svVariableType, const std::vector<CMc5ArrayDimension>* pArrayDimensions = nullptr);
+    std::variant<std::monostate, CS7PError> _AddSingleVariable(const std::string& strStructureType, const std::string& strVariableName, std::string_view svVariableType);
     std::variant<std::monostate, CS7PError> _AddStructVariable(const std::string& strVariableName);
     std::variant<std::monostate, CS7PError> _AddVariable(const std::string& strStructureType, const std::string& strVariableName);
     void _AlignUp(const size_t BitAlignment);
+    std::variant<uint32_t, CS7PError> _BeginTreeNode(S7SymbolNodeKind Kind, const std::string& strName, const std::string& strDatatype, size_t ElementCount = 1);
+    bool _CloneArrayElements(const CMc5ArrayEnumerator& Enumerator, const std::string& strVariableName, const std::string& strFirstElementName, size_t FirstSymbolIndex, size_t FirstElementBitAddress);
+    void _EndTreeNode(uint32_t NodeIndex);
+    std::wstring _GetBlockName() const;
+    CS7PError _GetTreeTooLargeError() const;
     std::variant<CMc5ArrayDimension, CS7PError> _GetNextArrayDimensionInfo(const std::string& strVariableName);
-    std::variant<std::string, std::monostate> _GetNextToken(const char* szTokens = "", bool bGetComments = false);
+    std::variant<std::string_view, std::monostate> _GetNextToken();
+    size_t _GetSymbolCount() const;
     std::variant<bool, CS7PError> _ParseStructureType(std::string& strStructureType);
     std::variant<bool, CS7PError> _ParseInnerStructure(const std::string& strStructureType, const std::string& strPrefix);
 };
@@ -0,0 +1,118 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstring>
+
+#include "CMc5codeTokenStream.h"
+#include "s7p_mc5code_scanner.h"
+
+
+static const char*
+_FindQuotedLiteralEnd(const char* pszPosition, const char* pszEnd)
+{
+    // Skip the opening quote and find the closing one.
+    // "$" escapes the following character (e.g. "$'" for a quote), and a literal never spans multiple lines.
+    for (pszPosition++; pszPosition != pszEnd; pszPosition++)
+    {
+        if (*pszPosition == '\r' || *pszPosition == '\n' || *pszPosition == '\0')
+        {
+            break;
+        }
+
+        if (*pszPosition == '\'')
+        {
+            return pszPosition + 1;
+        }
+
+        if (*pszPosition == '$' && pszEnd - pszPosition >= 2)
+        {
+            pszPosition++;
+        }
+    }
+
+    return pszPosition;
+}
+
+
+CMc5codeTokenStream::CMc5codeTokenStream(const std::pmr::string& strMc5code, std::pmr::memory_resource* pResource)
+    : m_svMc5code(strMc5code), m_Comments(pResource), m_Tokens(pResource)
+{
+    // This is the union of all single-character tokens CMc5codeParser ever looks for.
+    const char szDelimiters[] = "[];:{},.";
+
+    const char* pszBase = strMc5code.data();
+    const char* pszEnd = pszBase + strMc5code.size();
+    const char* pszPosition = pszBase;
+
+    for (;;)
+    {
+        // Skip whitespace.
+        pszPosition = SkipMc5codeSpaces(pszPosition, pszEnd);
+
+        // Have we reached the end of the MC5 Code?
+        if (pszPosition == pszEnd || *pszPosition == '\0')
+        {
+            break;
+        }
+
+        const char* pszStart = pszPosition;
+
+        if (pszEnd - pszStart >= 2 && pszStart[0] == '/' && pszStart[1] == '/')
+        {
+            // This is a line comment, which ends at the end of the line.
+            pszPosition = FindMc5codeLineEnd(pszPosition, pszEnd);
+
+            Mc5codeToken& Comment = m_Comments.emplace_back();
+            Comment.Offset = static_cast<uint32_t>(pszStart + 2 - pszBase);
+            Comment.Length = static_cast<uint32_t>(pszPosition - pszStart - 2);
+            Comment.TrailingCommentIndex = NoComment;
+
+            // Consecutive comments overwrite each other, so that the last one is attached to the preceding token.
+            if (!m_Tokens.empty())
+            {
+                m_Tokens.back().TrailingCommentIndex = static_cast<uint32_t>(m_Comments.size() - 1);
+            }
+
+            continue;
+        }
+
+        if (*pszPosition == '\'')
+        {
+            // This is a quoted literal, e.g. the initial value 'http://x' of a STRING.
+            // It is a single token, even if it contains whitespace, delimiters, or "//".
+            pszPosition = _FindQuotedLiteralEnd(pszPosition, pszEnd);
+        }
+        else if (strchr(szDelimiters, *pszPosition))
+        {
+            // This is a single-character token.
+            pszPosition++;
+        }
+        else
+        {
+            // This is a word up to the next space or single-character token.
+            pszPosition = FindMc5codeWordEnd(pszPosition, pszEnd, szDelimiters);
+        }
+
+        Mc5codeToken& Token = m_Tokens.emplace_back();
+        Token.Offset = static_cast<uint32_t>(pszStart - pszBase);
+        Token.Length = static_cast<uint32_t>(pszPosition - pszStart);
+        Token.TrailingCommentIndex = NoComment;
+    }
+}
+
+std::string_view
+CMc5codeTokenStream::GetComment(uint32_t CommentIndex) const
+{
+    const Mc5codeToken& Comment = m_Comments[CommentIndex];
+    return m_svMc5code.substr(Comment.Offset, Comment.Length);
+}
+
+std::string_view
+CMc5codeTokenStream::GetToken(size_t TokenIndex) const
+{
+    const Mc5codeToken& Token = m_Tokens[TokenIndex];
+    return m_svMc5code.substr(Token.Offset, Token.Length);
+}
@@ -0,0 +1,49 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Mc5codeToken
+{
+    // Position of the token within the MC5 Code.
+    // For comments, this excludes the leading "//".
+    uint32_t Offset;
+    uint32_t Length;
+
+    // Index of the last line comment between this token and the next one, or NoComment.
+    uint32_t TrailingCommentIndex;
+};
+
+// MC5 Code split into tokens once, so that every parse of the same block just walks an array.
+// A token is either a single delimiter character out of "[];:{},.", a quoted literal like 'a: b', or a word up to the next whitespace or delimiter.
+// Line comments are kept separately and attached to the token they follow.
+//
+// The stream only views the MC5 Code and hands out views of it, so the string passed to the constructor must outlive the stream.
+// All callers pass MC5 Code held by the Mc5codeTypeMap in the temporary memory resource, which outlives all token streams of a parse.
+class CMc5codeTokenStream
+{
+public:
+    static constexpr uint32_t NoComment = UINT32_MAX;
+
+    CMc5codeTokenStream(const std::pmr::string& strMc5code, std::pmr::memory_resource* pResource);
+    CMc5codeTokenStream(std::pmr::string&& strMc5code, std::pmr::memory_resource* pResource) = delete;
+
+    std::string_view GetComment(uint32_t CommentIndex) const;
+    std::string_view GetToken(size_t TokenIndex) const;
+    size_t GetTokenCount() const { return m_Tokens.size(); }
+    uint32_t GetTrailingCommentIndex(size_t TokenIndex) const { return m_Tokens[TokenIndex].TrailingCommentIndex; }
+
+private:
+    std::string_view m_svMc5code;
+    std::pmr::vector<Mc5codeToken> m_Comments;
+    std::pmr::vector<Mc5codeToken> m_Tokens;
+};
@@ -0,0 +1,609 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <immintrin.h>
+#include <intrin.h>
+#include <EnlyzeWinStringLib.h>
+
+#include "CS7DecodePlan.h"
+
+// See s7p_mc5code_scanner.cpp for why the vector kernels are compiled with per-function target attributes.
+#define SSSE3_FUNCTION __attribute__((target("ssse3")))
+
+struct ElementTypeInfo
+{
+    std::string_view ElementType;
+    size_t StringCharacterCount = 0;
+    size_t LastDimensionElementCount = 0;
+    bool bIsArray = false;
+};
+
+
+static ElementTypeInfo
+_ParseDatatype(const std::string& strDatatype)
+{
+    // Datatypes are output by CMc5codeParser and the Symbol List parser in forms like
+    // "INT", "STRING [10]", "ARRAY [1..2, 1..8] OF BOOL", or "ARRAY [0..3] OF STRING [10]".
+    ElementTypeInfo Info;
+    std::string_view Datatype = strDatatype;
+
+    if (Datatype.starts_with("ARRAY ["))
+    {
+        size_t ClosingBracket = Datatype.find(']');
+        size_t LastDimensionStart = Datatype.rfind(',', ClosingBracket);
+        LastDimensionStart = (LastDimensionStart == std::string_view::npos) ? 7 : LastDimensionStart + 1;
+
+        std::string strLastDimension(Datatype.substr(LastDimensionStart, ClosingBracket - LastDimensionStart));
+        strLastDimension.erase(std::remove(strLastDimension.begin(), strLastDimension.end(), ' '), strLastDimension.end());
+
+        size_t DotsPosition = strLastDimension.find("..");
+        if (DotsPosition != std::string::npos)
+        {
+            auto StartOption = StrToLong(strLastDimension.substr(0, DotsPosition));
+            auto EndOption = StrToLong(strLastDimension.substr(DotsPosition + 2));
+            if (StartOption.has_value() && EndOption.has_value())
+            {
+                Info.LastDimensionElementCount = EndOption.value() - StartOption.value() + 1;
+            }
+        }
+
+        Info.bIsArray = true;
+        size_t OfPosition = Datatype.find(" OF ", ClosingBracket);
+        Datatype = (OfPosition == std::string_view::npos) ? std::string_view() : Datatype.substr(OfPosition + 4);
+    }
+
+    if (Datatype.starts_with("STRING"))
+    {
+        size_t OpeningBracket = Datatype.find('[');
+        size_t ClosingBracket = Datatype.find(']');
+        if (OpeningBracket != std::string_view::npos && ClosingBracket != std::string_view::npos && OpeningBracket < ClosingBracket)
+        {
+            std::string strCount(Datatype.substr(OpeningBracket + 1, ClosingBracket - OpeningBracket - 1));
+            strCount.erase(std::remove(strCount.begin(), strCount.end(), ' '), strCount.end());
+
+            auto Option = StrToSizeT(strCount);
+            if (Option.has_value())
+            {
+                Info.StringCharacterCount = Option.value();
+            }
+        }
+
+        Datatype = "STRING";
+    }
+
+    // Symbol List datatypes may come with trailing spaces.
+    while (!Datatype.empty() && Datatype.back() == ' ')
+    {
+        Datatype.remove_suffix(1);
+    }
+
+    Info.ElementType = Datatype;
+    return Info;
+}
+
+static uint16_t
+_ReadBE16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static uint32_t
+_ReadBE32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// Most ops decode a single variable or a short array, which is faster in an inlined loop than through a kernel call.
+// Only ops with at least this number of values are passed to the kernels.
+static const uint32_t _MinKernelValueCount = 8;
+
+// Kernels decoding Count contiguous big-endian values starting at p.
+struct DecodeKernels
+{
+    void (*pfnDecodeInt16)(const uint8_t* p, uint32_t Count, int64_t* pInteger);
+    void (*pfnDecodeUInt16)(const uint8_t* p, uint32_t Count, int64_t* pInteger);
+    void (*pfnDecodeInt32)(const uint8_t* p, uint32_t Count, int64_t* pInteger);
+    void (*pfnDecodeUInt32)(const uint8_t* p, uint32_t Count, int64_t* pInteger);
+    void (*pfnDecodeReal)(const uint8_t* p, uint32_t Count, float* pReal);
+};
+
+//
+// Scalar fallback
+//
+static void
+_DecodeInt16Scalar(const uint8_t* p, uint32_t Count, int64_t* pInteger)
+{
+    for (uint32_t j = 0; j < Count; j++)
+    {
+        pInteger[j] = static_cast<int16_t>(_ReadBE16(p + j * 2));
+    }
+}
+
+static void
+_DecodeUInt16Scalar(const uint8_t* p, uint32_t Count, int64_t* pInteger)
+{
+    for (uint32_t j = 0; j < Count; j++)
+    {
+        pInteger[j] = _ReadBE16(p + j * 2);
+    }
+}
+
+static void
+_DecodeInt32Scalar(const uint8_t* p, uint32_t Count, int64_t* pInteger)
+{
+    for (uint32_t j = 0; j < Count; j++)
+    {
+        pInteger[j] = static_cast<int32_t>(_ReadBE32(p + j * 4));
+    }
+}
+
+static void
+_DecodeUInt32Scalar(const uint8_t* p, uint32_t Count, int64_t* pInteger)
+{
+    for (uint32_t j = 0; j < Count; j++)
+    {
+        pInteger[j] = _ReadBE32(p + j * 4);
+    }
+}
+
+static void
+_DecodeRealScalar(const uint8_t* p, uint32_t Count, float* pReal)
+{
+    for (uint32_t j = 0; j < Count; j++)
+    {
+        uint32_t Bits = _ReadBE32(p + j * 4);
+        memcpy(pReal + j, &Bits, sizeof(float));
+    }
+}
+
+//
+// SSSE3 kernels
+// PSHUFB byte-swaps 16 bytes at once. Everything else only needs SSE2.
+//
+SSSE3_FUNCTION static void
+_StoreInt64x4Ssse3(int64_t* pInteger, __m128i Values, bool bSigned)
+{
+    // Widen four 32-bit values to 64 bits by interleaving them with their sign (or zero) extension.
+    const __m128i Extension = bSigned ? _mm_srai_epi32(Values, 31) : _mm_setzero_si128();
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pInteger), _mm_unpacklo_epi32(Values, Extension));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pInteger + 2), _mm_unpackhi_epi32(Values, Extension));
+}
+
+SSSE3_FUNCTION static uint32_t
+_Decode16Ssse3(const uint8_t* p, uint32_t Count, int64_t* pInteger, bool bSigned)
+{
+    // Move each byte-swapped 16-bit value into the upper half of a 32-bit lane, so that a single shift extends it.
+    const __m128i LowMask = _mm_setr_epi8(-1, -1, 1, 0, -1, -1, 3, 2, -1, -1, 5, 4, -1, -1, 7, 6);
+    const __m128i HighMask = _mm_setr_epi8(-1, -1, 9, 8, -1, -1, 11, 10, -1, -1, 13, 12, -1, -1, 15, 14);
+    uint32_t j = 0;
+
+    for (; j + 8 <= Count; j += 8)
+    {
+        const __m128i Input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + j * 2));
+        const __m128i Low = _mm_shuffle_epi8(Input, LowMask);
+        const __m128i High = _mm_shuffle_epi8(Input, HighMask);
+
+        if (bSigned)
+        {
+            _StoreInt64x4Ssse3(pInteger + j, _mm_srai_epi32(Low, 16), true);
+            _StoreInt64x4Ssse3(pInteger + j + 4, _mm_srai_epi32(High, 16), true);
+        }
+        else
+        {
+            _StoreInt64x4Ssse3(pInteger + j, _mm_srli_epi32(Low, 16), false);
+            _StoreInt64x4Ssse3(pInteger + j + 4, _mm_srli_epi32(High, 16), false);
+        }
+    }
+
+    return j;
+}
+
+SSSE3_FUNCTION static void
+_DecodeInt16Ssse3(const uint8_t* p, uint32_t Count, int64_t* pInteger)
+{
+    const uint32_t j = _Decode16Ssse3(p, Count, pInteger, true);
+    _DecodeInt16Scalar(p + j * 2, Count - j, pInteger + j);
+}
+
+SSSE3_FUNCTION static void
+_DecodeUInt16Ssse3(const uint8_t* p, uint32_t Count, int64_t* pInteger)
+{
+    const uint32_t j = _Decode16Ssse3(p, Count, pInteger, false);
+    _DecodeUInt16Scalar(p + j * 2, Count - j, pInteger + j);
+}
+
+SSSE3_FUNCTION static __m128i
+_LoadBE32x4Ssse3(const uint8_t* p)
+{
+    const __m128i SwapMask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), SwapMask);
+}
+
+SSSE3_FUNCTION static void
+_DecodeInt32Ssse3(const uint8_t* p, uint32_t Count, int64_t* pInteger)
+{
+    uint32_t j = 0;
+    for (; j + 4 <= Count; j += 4)
+    {
+        _StoreInt64x4Ssse3(pInteger + j, _LoadBE32x4Ssse3(p + j * 4), true);
+    }
+
+    _DecodeInt32Scalar(p + j * 4, Count - j, pInteger + j);
+}
+
+SSSE3_FUNCTION static void
+_DecodeUInt32Ssse3(const uint8_t* p, uint32_t Count, int64_t* pInteger)
+{
+    uint32_t j = 0;
+    for (; j + 4 <= Count; j += 4)
+    {
+        _StoreInt64x4Ssse3(pInteger + j, _LoadBE32x4Ssse3(p + j * 4), false);
+    }
+
+    _DecodeUInt32Scalar(p + j * 4, Count - j, pInteger + j);
+}
+
+SSSE3_FUNCTION static void
+_DecodeRealSsse3(const uint8_t* p, uint32_t Count, float* pReal)
+{
+    // REAL values are IEEE 754 floats, so the byte-swapped bits can be stored as they are.
+    uint32_t j = 0;
+    for (; j + 4 <= Count; j += 4)
+    {
+        _mm_storeu_ps(pReal + j, _mm_castsi128_ps(_LoadBE32x4Ssse3(p + j * 4)));
+    }
+
+    _DecodeRealScalar(p + j * 4, Count - j, pReal + j);
+}
+
+//
+// Runtime dispatch
+//
+static DecodeKernels
+_SelectKernels()
+{
+    int CpuInfo[4];
+    __cpuid(CpuInfo, 1);
+
+    // SSSE3 implies SSE2.
+    if (CpuInfo[2] & (1 << 9))
+    {
+        return { _DecodeInt16Ssse3, _DecodeUInt16Ssse3, _DecodeInt32Ssse3, _DecodeUInt32Ssse3, _DecodeRealSsse3 };
+    }
+
+    return { _DecodeInt16Scalar, _DecodeUInt16Scalar, _DecodeInt32Scalar, _DecodeUInt32Scalar, _DecodeRealScalar };
+}
+
+static const DecodeKernels _Kernels = _SelectKernels();
+
+
+void
+CS7DecodePlan::_AddOp(OpKind Kind, uint32_t Offset, uint32_t Count, uint32_t Stride, uint32_t ElementSize)
+{
+    // Extend the previous op if this one continues its run.
+    // This merges e.g. a series of INT variables into a single op, which is then decoded in one tight loop.
+    if (!m_Ops.empty())
+    {
+        Op& LastOp = m_Ops.back();
+        if (LastOp.Kind == Kind &&
+            LastOp.Stride == Stride &&
+            LastOp.ElementSize == ElementSize &&
+            LastOp.Offset + LastOp.Count * LastOp.Stride == Offset)
+        {
+            LastOp.Count += Count;
+            return;
+        }
+    }
+
+    Op& NewOp = m_Ops.emplace_back();
+    NewOp.Kind = Kind;
+    NewOp.Offset = Offset;
+    NewOp.Count = Count;
+    NewOp.Stride = Stride;
+    NewOp.ElementSize = ElementSize;
+}
+
+CS7DecodePlan::CS7DecodePlan(const S7Block& Block, S7Area Area)
+    : m_BoolCount(0), m_IntegerCount(0), m_RealCount(0), m_ViewCount(0), m_RequiredBufferSize(0)
+{
+    static constexpr std::array<std::pair<std::string_view, OpKind>, 19> DecodedTypes = {{
+        {"BOOL", OpKind::Bool},
+        {"BYTE", OpKind::UInt8},
+        {"CHAR", OpKind::UInt8},
+        {"INT", OpKind::Int16},
+        {"WORD", OpKind::UInt16},
+        {"COUNTER", OpKind::UInt16},
+        {"DATE", OpKind::UInt16},
+        {"TIMER", OpKind::UInt16},
+        {"S5TIME", OpKind::UInt16},
+        {"BLOCK_DB", OpKind::UInt16},
+        {"BLOCK_FB", OpKind::UInt16},
+        {"BLOCK_FC", OpKind::UInt16},
+        {"BLOCK_SDB", OpKind::UInt16},
+        {"DINT", OpKind::Int32},
+        {"DWORD", OpKind::UInt32},
+        {"REAL", OpKind::Real},
+        {"TIME", OpKind::Int32},
+        {"TIME_OF_DAY", OpKind::UInt32},
+        {"STRING", OpKind::String},
+    }};
+
+    const std::vector<S7Symbol>& Symbols = Block.GetSymbols();
+    m_Symbols.resize(Symbols.size(), { S7ValueKind::None, 0, 0 });
+
+    // Compile the symbols of the requested area in address order, so that the ops are sorted by offset.
+    // All symbols of a DB block belong to the same DB, but the Symbol List block mixes symbols of the I, Q, and M areas.
+    // Symbols without a parsed address are never decoded.
+    std::vector<size_t> Order;
+    for (size_t i = 0; i < Symbols.size(); i++)
+    {
+        if (Symbols[i].Address.Area == Area && Symbols[i].strRawCode.empty())
+        {
+            Order.push_back(i);
+        }
+    }
+
+    std::stable_sort(Order.begin(), Order.end(), [&](size_t a, size_t b)
+    {
+        return Symbols[a].Address.BitOffset < Symbols[b].Address.BitOffset;
+    });
+
+    for (size_t i : Order)
+    {
+        const S7Address& Address = Symbols[i].Address;
+        const ElementTypeInfo Info = _ParseDatatype(Symbols[i].strDatatype);
+        const uint32_t ElementCount = std::max<uint32_t>(Address.ElementCount, 1);
+
+        // Everything we don't know how to decode is returned as raw bytes (e.g. DATE_AND_TIME, POINTER, ANY).
+        OpKind Kind = OpKind::Raw;
+        const auto it = std::find_if(DecodedTypes.begin(), DecodedTypes.end(), [&](const auto& Type)
+        {
+            return Type.first == Info.ElementType;
+        });
+
+        if (it != DecodedTypes.end())
+        {
+            Kind = it->second;
+        }
+
+        S7DecodedSymbol& DecodedSymbol = m_Symbols[i];
+
+        if (Kind == OpKind::Bool)
+        {
+            // Multi-dimensional BOOL arrays start each row of their last dimension on a byte boundary (see CMc5codeParser::_AddPrimitiveVariable).
+            uint32_t RowElementCount = ElementCount;
+            if (Info.bIsArray && Info.LastDimensionElementCount > 0 && Info.LastDimensionElementCount < ElementCount)
+            {
+                RowElementCount = static_cast<uint32_t>(Info.LastDimensionElementCount);
+            }
+
+            uint32_t RowStride = (RowElementCount + 7) / 8 * 8;
+            for (uint32_t Row = 0; Row < ElementCount / RowElementCount; Row++)
+            {
+                _AddOp(OpKind::Bool, Address.BitOffset + Row * RowStride, RowElementCount, 1, 1);
+            }
+
+            DecodedSymbol.Kind = S7ValueKind::Bool;
+            DecodedSymbol.FirstValueIndex = m_BoolCount;
+            DecodedSymbol.ValueCount = ElementCount;
+            m_BoolCount += ElementCount;
+
+            m_RequiredBufferSize = std::max<size_t>(m_RequiredBufferSize, (Address.BitOffset + Address.BitSize + 7) / 8);
+            continue;
+        }
+
+        // All other types are byte-aligned.
+        uint32_t ByteOffset = Address.BitOffset / 8;
+        uint32_t ElementSize;
+        uint32_t Stride;
+
+        if (Kind == OpKind::String)
+        {
+            // Each STRING element consists of the maximum length, the actual length, and the characters, and starts on a 2-byte boundary.
+            ElementSize = static_cast<uint32_t>(2 + Info.StringCharacterCount);
+            Stride = (ElementSize + 1) & ~1u;
+        }
+        else
+        {
+            ElementSize = Address.BitSize / 8 / ElementCount;
+            Stride = ElementSize;
+        }
+
+        if (ElementSize == 0)
+        {
+            continue;
+        }
+
+        // The decode kernels rely on numeric values following each other without gaps.
+        // An address not matching the size of the datatype (e.g. an INT at an MD address in the Symbol List) is returned as raw bytes instead.
+        if (Kind != OpKind::String && Kind != OpKind::Raw)
+        {
+            const uint32_t ValueSize = (Kind == OpKind::UInt8) ? 1 : (Kind == OpKind::Int16 || Kind == OpKind::UInt16) ? 2 : 4;
+            if (ElementSize != ValueSize)
+            {
+                Kind = OpKind::Raw;
+            }
+        }
+
+        switch (Kind)
+        {
+            case OpKind::Real:
+                DecodedSymbol.Kind = S7ValueKind::Real;
+                DecodedSymbol.FirstValueIndex = m_RealCount;
+                m_RealCount += ElementCount;
+                break;
+
+            case OpKind::String:
+            case OpKind::Raw:
+                DecodedSymbol.Kind = (Kind == OpKind::String) ? S7ValueKind::String : S7ValueKind::Raw;
+                DecodedSymbol.FirstValueIndex = m_ViewCount;
+                m_ViewCount += ElementCount;
+                break;
+
+            default:
+                DecodedSymbol.Kind = S7ValueKind::Integer;
+                DecodedSymbol.FirstValueIndex = m_IntegerCount;
+                m_IntegerCount += ElementCount;
+                break;
+        }
+
+        DecodedSymbol.ValueCount = ElementCount;
+
+        _AddOp(Kind, ByteOffset, ElementCount, Stride, ElementSize);
+        m_RequiredBufferSize = std::max<size_t>(m_RequiredBufferSize, ByteOffset + (ElementCount - 1) * Stride + ElementSize);
+    }
+}
+
+std::variant<std::monostate, CS7PError>
+CS7DecodePlan::Decode(S7DecodedValues& Values, const uint8_t* pBuffer, size_t BufferSize) const
+{
+    // Checking the buffer size once here saves us from checking it for every single value.
+    if (BufferSize < m_RequiredBufferSize)
+    {
+        return CS7PError(
+            L"Buffer of " + std::to_wstring(BufferSize) + L" bytes is too small for decoding, " +
+            std::to_wstring(m_RequiredBufferSize) + L" bytes are required"
+        );
+    }
+
+    Values.Bools.resize(m_BoolCount);
+    Values.Integers.resize(m_IntegerCount);
+    Values.Reals.resize(m_RealCount);
+    Values.Views.resize(m_ViewCount);
+
+    // The ops have been compiled in the same order as the values were assigned to symbols.
+    // Hence, every op just continues writing where the previous op of the same column stopped.
+    uint8_t* pBool = Values.Bools.data();
+    int64_t* pInteger = Values.Integers.data();
+    float* pReal = Values.Reals.data();
+    std::string_view* pView = Values.Views.data();
+
+    for (const Op& CurrentOp : m_Ops)
+    {
+        const uint8_t* p = pBuffer + CurrentOp.Offset;
+        const uint32_t Count = CurrentOp.Count;
+        const uint32_t Stride = CurrentOp.Stride;
+
+        switch (CurrentOp.Kind)
+        {
+            case OpKind::Bool:
+            {
+                // Load each byte only once and extract its bits by mask.
+                uint32_t BitOffset = CurrentOp.Offset;
+                for (uint32_t j = 0; j < Count;)
+                {
+                    const uint8_t Byte = pBuffer[BitOffset / 8];
+                    uint8_t Mask = static_cast<uint8_t>(1 << (BitOffset % 8));
+
+                    do
+                    {
+                        *pBool++ = (Byte & Mask) ? 1 : 0;
+                        Mask <<= 1;
+                        BitOffset++;
+                        j++;
+                    }
+                    while (Mask && j < Count);
+                }
+
+                break;
+            }
+
+            case OpKind::UInt8:
+                for (uint32_t j = 0; j < Count; j++)
+                {
+                    *pInteger++ = p[j * Stride];
+                }
+                break;
+
+            case OpKind::Int16:
+                if (Count >= _MinKernelValueCount)
+                {
+                    _Kernels.pfnDecodeInt16(p, Count, pInteger);
+                }
+                else
+                {
+                    _DecodeInt16Scalar(p, Count, pInteger);
+                }
+
+                pInteger += Count;
+                break;
+
+            case OpKind::UInt16:
+                if (Count >= _MinKernelValueCount)
+                {
+                    _Kernels.pfnDecodeUInt16(p, Count, pInteger);
+                }
+                else
+                {
+                    _DecodeUInt16Scalar(p, Count, pInteger);
+                }
+
+                pInteger += Count;
+                break;
+
+            case OpKind::Int32:
+                if (Count >= _MinKernelValueCount)
+                {
+                    _Kernels.pfnDecodeInt32(p, Count, pInteger);
+                }
+                else
+                {
+                    _DecodeInt32Scalar(p, Count, pInteger);
+                }
+
+                pInteger += Count;
+                break;
+
+            case OpKind::UInt32:
+                if (Count >= _MinKernelValueCount)
+                {
+                    _Kernels.pfnDecodeUInt32(p, Count, pInteger);
+                }
+                else
+                {
+                    _DecodeUInt32Scalar(p, Count, pInteger);
+                }
+
+                pInteger += Count;
+                break;
+
+            case OpKind::Real:
+                if (Count >= _MinKernelValueCount)
+                {
+                    _Kernels.pfnDecodeReal(p, Count, pReal);
+                }
+                else
+                {
+                    _DecodeRealScalar(p, Count, pReal);
+                }
+
+                pReal += Count;
+                break;
+
+            case OpKind::String:
+                for (uint32_t j = 0; j < Count; j++)
+                {
+                    // Point to the actual characters without copying them, but never exceed the declared length.
+                    const uint8_t* pString = p + j * Stride;
+                    size_t Length = std::min<size_t>(pString[1], CurrentOp.ElementSize - 2);
+                    *pView++ = std::string_view(reinterpret_cast<const char*>(pString + 2), Length);
+                }
+                break;
+
+            case OpKind::Raw:
+                for (uint32_t j = 0; j < Count; j++)
+                {
+                    *pView++ = std::string_view(reinterpret_cast<const char*>(p + j * Stride), CurrentOp.ElementSize);
+                }
+                break;
+        }
+    }
+
+    return std::monostate();
+}
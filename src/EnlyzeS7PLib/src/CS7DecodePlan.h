@@ -0,0 +1,94 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_parser.h"
+
+enum class S7ValueKind : uint8_t
+{
+    None,
+    Bool,
+    Integer,
+    Real,
+    String,
+    Raw,
+};
+
+struct S7DecodedSymbol
+{
+    // Index of the first value in the column selected by Kind, and the number of values (array elements).
+    S7ValueKind Kind;
+    size_t FirstValueIndex;
+    uint32_t ValueCount;
+};
+
+struct S7DecodedValues
+{
+    std::vector<uint8_t> Bools;
+    std::vector<int64_t> Integers;
+    std::vector<float> Reals;
+
+    // STRING characters and raw bytes (e.g. DATE_AND_TIME, ANY) point directly into the decoded buffer.
+    std::vector<std::string_view> Views;
+};
+
+// Flat decode program for turning a raw big-endian snapshot of a DB or an I/Q/M area into typed values.
+// The program is compiled once from the symbol layout and can then decode any number of snapshots.
+// Where the values of each symbol end up is the same for every snapshot, so it is only stored once in the plan (see GetSymbols).
+// Passing the same S7DecodedValues to every Decode call reuses its memory.
+// Runs of 16-bit and 32-bit values are byte-swapped 16 bytes at a time if the CPU supports SSSE3.
+class CS7DecodePlan
+{
+public:
+    CS7DecodePlan(const S7Block& Block, S7Area Area);
+
+    std::variant<std::monostate, CS7PError> Decode(S7DecodedValues& Values, const uint8_t* pBuffer, size_t BufferSize) const;
+    size_t GetRequiredBufferSize() const { return m_RequiredBufferSize; }
+
+    // One entry per symbol of the block passed to the constructor, locating its values in S7DecodedValues.
+    const std::vector<S7DecodedSymbol>& GetSymbols() const { return m_Symbols; }
+
+private:
+    enum class OpKind : uint8_t
+    {
+        Bool,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Real,
+        String,
+        Raw,
+    };
+
+    struct Op
+    {
+        // Offset and Stride are in bits for OpKind::Bool and in bytes for all other kinds.
+        OpKind Kind;
+        uint32_t Offset;
+        uint32_t Count;
+        uint32_t Stride;
+        uint32_t ElementSize;
+    };
+
+    std::vector<Op> m_Ops;
+    size_t m_BoolCount;
+    size_t m_IntegerCount;
+    size_t m_RealCount;
+    size_t m_ViewCount;
+    size_t m_RequiredBufferSize;
+    std::vector<S7DecodedSymbol> m_Symbols;
+
+    void _AddOp(OpKind Kind, uint32_t Offset, uint32_t Count, uint32_t Stride, uint32_t ElementSize);
+};
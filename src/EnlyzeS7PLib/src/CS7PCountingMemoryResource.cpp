@@ -0,0 +1,37 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+
+#include "CS7PCountingMemoryResource.h"
+
+
+void*
+CS7PCountingMemoryResource::do_allocate(size_t Bytes, size_t Alignment)
+{
+    void* p = m_pUpstream->allocate(Bytes, Alignment);
+
+    m_AllocationCount++;
+    m_BytesAllocated += Bytes;
+    m_CurrentBytes += Bytes;
+    m_PeakBytes = std::max(m_PeakBytes, m_CurrentBytes);
+
+    return p;
+}
+
+void
+CS7PCountingMemoryResource::do_deallocate(void* p, size_t Bytes, size_t Alignment)
+{
+    m_pUpstream->deallocate(p, Bytes, Alignment);
+    m_CurrentBytes -= Bytes;
+}
+
+bool
+CS7PCountingMemoryResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    // Memory allocated through one counting resource must also be returned through it, otherwise the counters drift.
+    return this == &other;
+}
@@ -0,0 +1,36 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <memory_resource>
+
+// Memory resource that forwards all requests to an upstream resource and counts them.
+// Used for the memory report of a parse (see S7ParseOptions::pMemoryReport).
+// Like std::pmr::monotonic_buffer_resource, it is not thread-safe.
+class CS7PCountingMemoryResource : public std::pmr::memory_resource
+{
+public:
+    explicit CS7PCountingMemoryResource(std::pmr::memory_resource* pUpstream)
+        : m_pUpstream(pUpstream), m_AllocationCount(0), m_BytesAllocated(0), m_CurrentBytes(0), m_PeakBytes(0) {}
+
+    size_t GetAllocationCount() const { return m_AllocationCount; }
+    size_t GetBytesAllocated() const { return m_BytesAllocated; }
+    size_t GetCurrentBytes() const { return m_CurrentBytes; }
+    size_t GetPeakBytes() const { return m_PeakBytes; }
+    void ResetPeakBytes() { m_PeakBytes = m_CurrentBytes; }
+
+private:
+    std::pmr::memory_resource* m_pUpstream;
+    size_t m_AllocationCount;
+    size_t m_BytesAllocated;
+    size_t m_CurrentBytes;
+    size_t m_PeakBytes;
+
+    void* do_allocate(size_t Bytes, size_t Alignment) override;
+    void do_deallocate(void* p, size_t Bytes, size_t Alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
@@ -0,0 +1,201 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include "CS7PProject.h"
+#include "s7p_archive.h"
+
+// The project whose prefetch thread is the current thread, if any.
+static thread_local const CS7PProject* _pPrefetchingProject = nullptr;
+
+
+CS7PProject::CS7PProject(const S7ParseOptions& Options)
+    : m_Options(Options), m_ProjectSymbolCount(0), m_bStopPrefetch(false)
+{
+}
+
+CS7PProject::~CS7PProject()
+{
+    StopPrefetch();
+
+    if (!m_wstrTempFolderPath.empty())
+    {
+        DeleteExtractedS7PArchive(m_wstrTempFolderPath);
+    }
+}
+
+std::variant<const S7DeviceSymbolInfo*, CS7PError>
+CS7PProject::GetDevice(size_t Index)
+{
+    if (auto CachedDevice = _GetCachedDevice(Index))
+    {
+        return *CachedDevice;
+    }
+
+    std::lock_guard<std::mutex> ParseLock(m_ParseMutex);
+
+    // Another thread may have parsed this device while we were waiting.
+    if (auto CachedDevice = _GetCachedDevice(Index))
+    {
+        return *CachedDevice;
+    }
+
+    auto Result = ParseDevice(m_Devices[Index].Files, m_wstrS7PFolderPath, m_Options, m_ProjectSymbolCount);
+
+    {
+        std::lock_guard<std::mutex> StateLock(m_StateMutex);
+        m_Devices[Index].Result = std::move(Result);
+    }
+
+    return *_GetCachedDevice(Index);
+}
+
+bool
+CS7PProject::IsDeviceParsed(size_t Index) const
+{
+    std::lock_guard<std::mutex> StateLock(m_StateMutex);
+    return m_Devices[Index].Result.has_value();
+}
+
+std::variant<std::unique_ptr<CS7PProject>, CS7PError>
+CS7PProject::Open(const std::wstring& wstrS7PFilePath, const S7ParseOptions& Options)
+{
+    // Created upfront, so that its destructor cleans up an extracted archive on every error path.
+    auto pProject = std::unique_ptr<CS7PProject>(new CS7PProject(Options));
+
+    std::wstring wstrProjectS7PFilePath = wstrS7PFilePath;
+    if (IsS7PArchivePath(wstrS7PFilePath))
+    {
+        auto ExtractResult = ExtractS7PArchive(wstrProjectS7PFilePath, pProject->m_wstrTempFolderPath, wstrS7PFilePath);
+        if (const auto pError = std::get_if<CS7PError>(&ExtractResult))
+        {
+            return *pError;
+        }
+    }
+
+    auto Result = GetS7PFolderPath(pProject->m_wstrS7PFolderPath, wstrProjectS7PFilePath);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    std::vector<S7DeviceFiles> DeviceFiles;
+    Result = ParseDeviceFiles(DeviceFiles, pProject->m_wstrS7PFolderPath, Options);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    pProject->m_Devices.resize(DeviceFiles.size());
+    for (size_t i = 0; i < DeviceFiles.size(); i++)
+    {
+        pProject->m_Devices[i].Files = std::move(DeviceFiles[i]);
+    }
+
+    return pProject;
+}
+
+void
+CS7PProject::StartPrefetch(const std::vector<size_t>& PriorityOrder)
+{
+    if (_IsPrefetchThread())
+    {
+        // We can neither join nor replace the thread we are running on.
+        m_bStopPrefetch = true;
+        return;
+    }
+
+    std::lock_guard<std::mutex> PrefetchLock(m_PrefetchMutex);
+    _StopPrefetchLocked();
+
+    // Prefetch the prioritized devices first and then all others in their regular order.
+    std::vector<size_t> Order;
+    std::vector<bool> Queued(m_Devices.size(), false);
+
+    for (size_t Index : PriorityOrder)
+    {
+        if (Index < m_Devices.size() && !Queued[Index])
+        {
+            Order.push_back(Index);
+            Queued[Index] = true;
+        }
+    }
+
+    for (size_t Index = 0; Index < m_Devices.size(); Index++)
+    {
+        if (!Queued[Index])
+        {
+            Order.push_back(Index);
+        }
+    }
+
+    m_bStopPrefetch = false;
+    m_PrefetchThread = std::thread([this, Order = std::move(Order)]()
+    {
+        _pPrefetchingProject = this;
+
+        for (size_t Index : Order)
+        {
+            if (m_bStopPrefetch)
+            {
+                break;
+            }
+
+            // Errors are cached along with the device and returned to the first caller of GetDevice.
+            GetDevice(Index);
+        }
+    });
+}
+
+void
+CS7PProject::StopPrefetch()
+{
+    if (_IsPrefetchThread())
+    {
+        // Joining ourselves would fail, so only let the thread end after the current device.
+        // The next StartPrefetch, StopPrefetch or the destructor joins it.
+        m_bStopPrefetch = true;
+        return;
+    }
+
+    std::lock_guard<std::mutex> PrefetchLock(m_PrefetchMutex);
+    _StopPrefetchLocked();
+}
+
+bool
+CS7PProject::_IsPrefetchThread() const
+{
+    return _pPrefetchingProject == this;
+}
+
+void
+CS7PProject::_StopPrefetchLocked()
+{
+    m_bStopPrefetch = true;
+
+    if (m_PrefetchThread.joinable())
+    {
+        m_PrefetchThread.join();
+    }
+}
+
+std::optional<std::variant<const S7DeviceSymbolInfo*, CS7PError>>
+CS7PProject::_GetCachedDevice(size_t Index) const
+{
+    std::lock_guard<std::mutex> StateLock(m_StateMutex);
+
+    const auto& Result = m_Devices[Index].Result;
+    if (!Result.has_value())
+    {
+        return std::nullopt;
+    }
+
+    if (const auto pError = std::get_if<CS7PError>(&Result.value()))
+    {
+        return *pError;
+    }
+
+    return &std::get<S7DeviceSymbolInfo>(Result.value());
+}
@@ -0,0 +1,92 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_device_parser.h"
+#include "s7p_parser.h"
+
+// Handle to a STEP 7 project whose devices are parsed on demand.
+// Open only reads the device list, which is cheap compared to parsing all Symbol Lists and Subblock Lists.
+// The Symbol List and DBs of a device are parsed on its first access through GetDevice and cached afterwards.
+//
+// All methods are thread-safe.
+// Devices are parsed one at a time, so accessing an unparsed device may have to wait for a device being prefetched.
+// StartPrefetch and StopPrefetch may also be called from the prefetch thread itself (e.g. from a callback in the parse options),
+// where they cannot wait for that thread and only request it to stop.
+// Options.MaxSymbolsPerProject is checked against the devices parsed so far, in the order they are accessed.
+class CS7PProject
+{
+public:
+    CS7PProject(const CS7PProject&) = delete;
+    CS7PProject& operator=(const CS7PProject&) = delete;
+    ~CS7PProject();
+
+    // wstrS7PFilePath is either the path to an .s7p file or to a zipped project archive (.zip).
+    // An archive stays extracted until the project is destroyed.
+    static std::variant<std::unique_ptr<CS7PProject>, CS7PError> Open(
+        const std::wstring& wstrS7PFilePath,
+        const S7ParseOptions& Options = S7ParseOptions()
+        );
+
+    // The returned pointer stays valid for the lifetime of the project.
+    std::variant<const S7DeviceSymbolInfo*, CS7PError> GetDevice(size_t Index);
+    size_t GetDeviceCount() const { return m_Devices.size(); }
+    const std::string& GetDeviceName(size_t Index) const { return m_Devices[Index].Files.strName; }
+    bool IsDeviceParsed(size_t Index) const;
+
+    // Parses all devices in a background thread, starting with the ones in PriorityOrder.
+    // Any previous prefetch is stopped first.
+    // When called from the prefetch thread, the prefetch is only stopped and no new one is started.
+    void StartPrefetch(const std::vector<size_t>& PriorityOrder = std::vector<size_t>());
+
+    // Waits until the device currently being prefetched has been parsed.
+    // When called from the prefetch thread, the prefetch stops after the current device without waiting.
+    void StopPrefetch();
+
+private:
+    struct Device
+    {
+        S7DeviceFiles Files;
+
+        // Guarded by m_StateMutex.
+        // Never changes again once it has been set.
+        std::optional<std::variant<S7DeviceSymbolInfo, CS7PError>> Result;
+    };
+
+    S7ParseOptions m_Options;
+    std::wstring m_wstrS7PFolderPath;
+    std::wstring m_wstrTempFolderPath;
+    std::vector<Device> m_Devices;
+
+    // m_ParseMutex serializes parsing, m_StateMutex only guards the cached results.
+    // This way, parsed devices can be accessed while another one is being parsed.
+    std::mutex m_ParseMutex;
+    mutable std::mutex m_StateMutex;
+    size_t m_ProjectSymbolCount;
+
+    // m_PrefetchMutex guards m_PrefetchThread.
+    // It is never taken by the prefetch thread, so holding it while joining that thread cannot deadlock.
+    std::mutex m_PrefetchMutex;
+    std::thread m_PrefetchThread;
+    std::atomic<bool> m_bStopPrefetch;
+
+    explicit CS7PProject(const S7ParseOptions& Options);
+
+    std::optional<std::variant<const S7DeviceSymbolInfo*, CS7PError>> _GetCachedDevice(size_t Index) const;
+    bool _IsPrefetchThread() const;
+    void _StopPrefetchLocked();
+};
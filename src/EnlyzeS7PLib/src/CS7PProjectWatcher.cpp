@@ -0,0 +1,425 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cwctype>
+#include <numeric>
+#include <windows.h>
+
+#include "CS7PProjectWatcher.h"
+#include "s7p_archive.h"
+
+
+static std::wstring
+_ToUpper(std::wstring wstr)
+{
+    std::transform(wstr.begin(), wstr.end(), wstr.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towupper(c)); });
+    return wstr;
+}
+
+static bool
+_StartsWith(const std::wstring& wstr, const std::wstring& wstrPrefix)
+{
+    return wstr.compare(0, wstrPrefix.size(), wstrPrefix) == 0;
+}
+
+static std::optional<size_t>
+_ParseHexId(const std::wstring& wstrId)
+{
+    // Subblock List folders are named by 8 hex digits, but anything that fits into a size_t is accepted.
+    // Longer or malformed names can't belong to a device.
+    if (wstrId.empty() || wstrId.size() > sizeof(size_t) * 2)
+    {
+        return std::nullopt;
+    }
+
+    size_t Id = 0;
+    for (wchar_t c : wstrId)
+    {
+        size_t Digit;
+        if (c >= L'0' && c <= L'9')
+        {
+            Digit = static_cast<size_t>(c - L'0');
+        }
+        else if (c >= L'A' && c <= L'F')
+        {
+            Digit = static_cast<size_t>(c - L'A' + 10);
+        }
+        else
+        {
+            return std::nullopt;
+        }
+
+        Id = (Id << 4) | Digit;
+    }
+
+    return Id;
+}
+
+
+CS7PProjectWatcher::CS7PProjectWatcher(UpdateCallback Callback, const S7ParseOptions& Options, uint32_t DebounceMilliseconds)
+    : m_Callback(std::move(Callback)), m_Options(Options), m_DebounceMilliseconds(DebounceMilliseconds),
+    m_hDirectory(INVALID_HANDLE_VALUE), m_hChangeEvent(nullptr), m_hStopEvent(nullptr)
+{
+}
+
+CS7PProjectWatcher::~CS7PProjectWatcher()
+{
+    Stop();
+
+    if (m_hStopEvent)
+    {
+        CloseHandle(m_hStopEvent);
+    }
+
+    if (m_hChangeEvent)
+    {
+        CloseHandle(m_hChangeEvent);
+    }
+
+    if (m_hDirectory != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hDirectory);
+    }
+}
+
+std::variant<std::unique_ptr<CS7PProjectWatcher>, CS7PError>
+CS7PProjectWatcher::Start(const std::wstring& wstrS7PFilePath, UpdateCallback Callback, const S7ParseOptions& Options, uint32_t DebounceMilliseconds)
+{
+    if (IsS7PArchivePath(wstrS7PFilePath))
+    {
+        return CS7PError(L"Project archives cannot be watched for changes: " + wstrS7PFilePath);
+    }
+
+    auto pWatcher = std::unique_ptr<CS7PProjectWatcher>(new CS7PProjectWatcher(std::move(Callback), Options, DebounceMilliseconds));
+
+    auto Result = GetS7PFolderPath(pWatcher->m_wstrS7PFolderPath, wstrS7PFilePath);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    // Open the folder before the initial parse, so that no change in between goes unnoticed.
+    pWatcher->m_hDirectory = CreateFileW(
+        pWatcher->m_wstrS7PFolderPath.c_str(),
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        nullptr
+    );
+    if (pWatcher->m_hDirectory == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not open folder " + pWatcher->m_wstrS7PFolderPath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    // The change event is a manual-reset event, because ReadDirectoryChangesW resets it when issuing a read.
+    pWatcher->m_hChangeEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    pWatcher->m_hStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!pWatcher->m_hChangeEvent || !pWatcher->m_hStopEvent)
+    {
+        return CS7PError(L"Could not create event, error " + std::to_wstring(GetLastError()));
+    }
+
+    Result = pWatcher->_ParseProject();
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    std::vector<size_t> ChangedDeviceIndexes(pWatcher->m_DeviceSymbolInfos.size());
+    std::iota(ChangedDeviceIndexes.begin(), ChangedDeviceIndexes.end(), 0);
+    pWatcher->m_Callback(pWatcher->m_DeviceSymbolInfos, ChangedDeviceIndexes, std::nullopt);
+
+    pWatcher->m_WatchThread = std::thread(&CS7PProjectWatcher::_WatchThread, pWatcher.get());
+    return pWatcher;
+}
+
+void
+CS7PProjectWatcher::Stop()
+{
+    if (m_WatchThread.joinable())
+    {
+        SetEvent(m_hStopEvent);
+
+        // When called from the callback, the watcher thread can't wait for itself.
+        // It sees the stop event as soon as the callback returns, and is joined by the next call or the destructor.
+        if (m_WatchThread.get_id() != std::this_thread::get_id())
+        {
+            m_WatchThread.join();
+        }
+    }
+}
+
+void
+CS7PProjectWatcher::_ClassifyChange(const std::wstring& wstrRelativePath, std::set<size_t>& ChangedDevices, bool& bReparseProject) const
+{
+    const std::wstring wstrPath = _ToUpper(wstrRelativePath);
+
+    // These files and folders list the devices and their Symbol Lists and Subblock Lists.
+    // A change to them may add, remove or reassign devices.
+    if (wstrPath == L"YDBS\\SYMLISTS.DBF" ||
+        wstrPath == L"OMBSTX\\OFFLINE\\BSTCNTOF.DBF" ||
+        _StartsWith(wstrPath, L"HOMSAVE7\\") ||
+        _StartsWith(wstrPath, L"HRS\\"))
+    {
+        bReparseProject = true;
+        return;
+    }
+
+    // Files of a Symbol List (e.g. "YDBs\1234\SYMLIST.DBF").
+    for (const auto& [wstrFolderPrefix, DeviceIndex] : m_SymbolListFolderDevices)
+    {
+        if (_StartsWith(wstrPath, wstrFolderPrefix))
+        {
+            ChangedDevices.insert(DeviceIndex);
+            return;
+        }
+    }
+
+    // Files of a Subblock List (e.g. "ombstx\offline\00000005\SUBBLK.DBF").
+    const std::wstring wstrSubblockPrefix = L"OMBSTX\\OFFLINE\\";
+    if (_StartsWith(wstrPath, wstrSubblockPrefix))
+    {
+        const size_t IdEnd = wstrPath.find(L'\\', wstrSubblockPrefix.size());
+        if (IdEnd == std::wstring::npos)
+        {
+            return;
+        }
+
+        const auto Id = _ParseHexId(wstrPath.substr(wstrSubblockPrefix.size(), IdEnd - wstrSubblockPrefix.size()));
+        if (!Id.has_value())
+        {
+            return;
+        }
+
+        // Subblock Lists without a device are skipped during parsing, so changes to them don't matter either.
+        const auto It = m_SubblockListDevices.find(Id.value());
+        if (It != m_SubblockListDevices.end())
+        {
+            ChangedDevices.insert(It->second);
+        }
+    }
+}
+
+std::variant<std::monostate, CS7PError>
+CS7PProjectWatcher::_ParseProject()
+{
+    std::vector<S7DeviceFiles> DeviceFiles;
+    auto Result = ParseDeviceFiles(DeviceFiles, m_wstrS7PFolderPath, m_Options);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    std::vector<S7DeviceSymbolInfo> DeviceSymbolInfos;
+    std::vector<size_t> DeviceSymbolCounts;
+    size_t ProjectSymbolCount = 0;
+
+    for (const S7DeviceFiles& Files : DeviceFiles)
+    {
+        const size_t PreviousProjectSymbolCount = ProjectSymbolCount;
+
+        auto ParseResult = ParseDevice(Files, m_wstrS7PFolderPath, m_Options, ProjectSymbolCount);
+        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        {
+            return *pError;
+        }
+
+        DeviceSymbolInfos.push_back(std::move(std::get<S7DeviceSymbolInfo>(ParseResult)));
+        DeviceSymbolCounts.push_back(ProjectSymbolCount - PreviousProjectSymbolCount);
+    }
+
+    // Only replace the previous result once the entire project has been parsed successfully.
+    m_DeviceFiles = std::move(DeviceFiles);
+    m_DeviceSymbolInfos = std::move(DeviceSymbolInfos);
+    m_DeviceSymbolCounts = std::move(DeviceSymbolCounts);
+
+    // Build the lookup tables for classifying changes.
+    // Paths reported by ReadDirectoryChangesW are relative to the project folder.
+    m_SymbolListFolderDevices.clear();
+    m_SubblockListDevices.clear();
+
+    for (size_t i = 0; i < m_DeviceFiles.size(); i++)
+    {
+        const std::wstring& wstrSymbolListFilePath = m_DeviceFiles[i].wstrSymbolListFilePath;
+        const size_t FolderStart = m_wstrS7PFolderPath.size() + 1;
+        const size_t FolderEnd = wstrSymbolListFilePath.rfind(L'\\') + 1;
+        m_SymbolListFolderDevices.emplace_back(_ToUpper(wstrSymbolListFilePath.substr(FolderStart, FolderEnd - FolderStart)), i);
+
+        for (size_t SubblockListId : m_DeviceFiles[i].SubblockListIds)
+        {
+            m_SubblockListDevices[SubblockListId] = i;
+        }
+    }
+
+    return std::monostate();
+}
+
+void
+CS7PProjectWatcher::_ReparseDevices(const std::set<size_t>& ChangedDevices)
+{
+    // Start with the symbols of all unchanged devices, so that Options.MaxSymbolsPerProject applies to the entire project.
+    size_t ProjectSymbolCount = 0;
+    for (size_t i = 0; i < m_DeviceSymbolCounts.size(); i++)
+    {
+        if (ChangedDevices.count(i) == 0)
+        {
+            ProjectSymbolCount += m_DeviceSymbolCounts[i];
+        }
+    }
+
+    for (size_t DeviceIndex : ChangedDevices)
+    {
+        const size_t PreviousProjectSymbolCount = ProjectSymbolCount;
+
+        auto ParseResult = ParseDevice(m_DeviceFiles[DeviceIndex], m_wstrS7PFolderPath, m_Options, ProjectSymbolCount);
+        if (auto pError = std::get_if<CS7PError>(&ParseResult))
+        {
+            // STEP 7 may still be writing the files of this device.
+            // Keep the device in the result, but without symbols, and let the next change fix it.
+            S7DeviceSymbolInfo DeviceSymbolInfo;
+            DeviceSymbolInfo.strName = m_DeviceFiles[DeviceIndex].strName;
+            DeviceSymbolInfo.Warnings.push_back(std::move(*pError));
+            m_DeviceSymbolInfos[DeviceIndex] = std::move(DeviceSymbolInfo);
+        }
+        else
+        {
+            m_DeviceSymbolInfos[DeviceIndex] = std::move(std::get<S7DeviceSymbolInfo>(ParseResult));
+        }
+
+        m_DeviceSymbolCounts[DeviceIndex] = ProjectSymbolCount - PreviousProjectSymbolCount;
+    }
+}
+
+void
+CS7PProjectWatcher::_WatchThread()
+{
+    // ReadDirectoryChangesW requires a DWORD-aligned buffer.
+    std::vector<DWORD> Buffer(16384);
+    OVERLAPPED Overlapped = {};
+    Overlapped.hEvent = m_hChangeEvent;
+
+    std::set<size_t> ChangedDevices;
+    bool bReparseProject = false;
+    bool bChangePending = false;
+    DWORD dwLastChangeTick = 0;
+    bool bReadPending = false;
+
+    const DWORD dwNotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+    for (;;)
+    {
+        if (!bReadPending)
+        {
+            if (!ReadDirectoryChangesW(m_hDirectory, Buffer.data(), static_cast<DWORD>(Buffer.size() * sizeof(DWORD)), TRUE, dwNotifyFilter, nullptr, &Overlapped, nullptr))
+            {
+                m_Callback(m_DeviceSymbolInfos, {}, CS7PError(L"Could not watch folder " + m_wstrS7PFolderPath + L", error " + std::to_wstring(GetLastError())));
+                return;
+            }
+
+            bReadPending = true;
+        }
+
+        // Sleep until something changes or, if changes are pending, until the debounce interval has elapsed.
+        DWORD dwTimeout = INFINITE;
+        if (bChangePending)
+        {
+            // Unsigned arithmetic also handles the wraparound of GetTickCount after 49.7 days.
+            const DWORD dwElapsed = GetTickCount() - dwLastChangeTick;
+            dwTimeout = (dwElapsed >= m_DebounceMilliseconds) ? 0 : m_DebounceMilliseconds - dwElapsed;
+        }
+
+        const HANDLE Handles[] = { m_hStopEvent, m_hChangeEvent };
+        const DWORD dwWaitResult = WaitForMultipleObjects(2, Handles, FALSE, dwTimeout);
+
+        if (dwWaitResult == WAIT_OBJECT_0 + 1)
+        {
+            bReadPending = false;
+
+            DWORD cbReturned;
+            if (!GetOverlappedResult(m_hDirectory, &Overlapped, &cbReturned, FALSE))
+            {
+                m_Callback(m_DeviceSymbolInfos, {}, CS7PError(L"Could not watch folder " + m_wstrS7PFolderPath + L", error " + std::to_wstring(GetLastError())));
+                return;
+            }
+
+            if (cbReturned == 0)
+            {
+                // The buffer has overflowed and the individual changes are lost.
+                bReparseProject = true;
+            }
+            else
+            {
+                const auto* pBuffer = reinterpret_cast<const uint8_t*>(Buffer.data());
+
+                for (;;)
+                {
+                    const auto* pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(pBuffer);
+                    std::wstring wstrRelativePath(pInfo->FileName, pInfo->FileNameLength / sizeof(wchar_t));
+                    _ClassifyChange(wstrRelativePath, ChangedDevices, bReparseProject);
+
+                    if (pInfo->NextEntryOffset == 0)
+                    {
+                        break;
+                    }
+
+                    pBuffer += pInfo->NextEntryOffset;
+                }
+            }
+
+            if (bReparseProject || !ChangedDevices.empty())
+            {
+                bChangePending = true;
+                dwLastChangeTick = GetTickCount();
+            }
+        }
+        else if (dwWaitResult == WAIT_TIMEOUT)
+        {
+            std::vector<size_t> ChangedDeviceIndexes;
+
+            if (bReparseProject)
+            {
+                auto Result = _ParseProject();
+                if (auto pError = std::get_if<CS7PError>(&Result))
+                {
+                    m_Callback(m_DeviceSymbolInfos, ChangedDeviceIndexes, std::move(*pError));
+                }
+                else
+                {
+                    ChangedDeviceIndexes.resize(m_DeviceSymbolInfos.size());
+                    std::iota(ChangedDeviceIndexes.begin(), ChangedDeviceIndexes.end(), 0);
+                    m_Callback(m_DeviceSymbolInfos, ChangedDeviceIndexes, std::nullopt);
+                }
+            }
+            else
+            {
+                _ReparseDevices(ChangedDevices);
+                ChangedDeviceIndexes.assign(ChangedDevices.begin(), ChangedDevices.end());
+                m_Callback(m_DeviceSymbolInfos, ChangedDeviceIndexes, std::nullopt);
+            }
+
+            ChangedDevices.clear();
+            bReparseProject = false;
+            bChangePending = false;
+        }
+        else
+        {
+            // Stop has been requested or waiting has failed.
+            break;
+        }
+    }
+
+    // Cancel the outstanding read and wait for it, because it still references Buffer and Overlapped.
+    if (bReadPending)
+    {
+        CancelIo(m_hDirectory);
+
+        DWORD cbReturned;
+        GetOverlappedResult(m_hDirectory, &Overlapped, &cbReturned, TRUE);
+    }
+}
@@ -0,0 +1,83 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_device_parser.h"
+#include "s7p_parser.h"
+
+// Keeps the parse result of a project up to date while STEP 7 saves changes to it.
+//
+// The project folder is monitored via ReadDirectoryChangesW, so the watcher thread sleeps while nothing happens.
+// Bursts of changes are collected until no further change has arrived for the debounce interval.
+// Changes to the Symbol List or a Subblock List of a device then only reparse that device.
+// Changes to the files listing the devices reparse the entire project.
+class CS7PProjectWatcher
+{
+public:
+    // Called once with the initial parse result on the thread calling Start, and then on the watcher thread after every update.
+    // If an update fails, Error is set, DeviceSymbolInfos is the last successful result, and ChangedDeviceIndexes is empty.
+    using UpdateCallback = std::function<void(
+        const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos,
+        const std::vector<size_t>& ChangedDeviceIndexes,
+        const std::optional<CS7PError>& Error
+        )>;
+
+    CS7PProjectWatcher(const CS7PProjectWatcher&) = delete;
+    CS7PProjectWatcher& operator=(const CS7PProjectWatcher&) = delete;
+    ~CS7PProjectWatcher();
+
+    // Zipped project archives cannot be watched.
+    static std::variant<std::unique_ptr<CS7PProjectWatcher>, CS7PError> Start(
+        const std::wstring& wstrS7PFilePath,
+        UpdateCallback Callback,
+        const S7ParseOptions& Options = S7ParseOptions(),
+        uint32_t DebounceMilliseconds = 2000
+        );
+
+    // Stops watching and waits for a running update to finish.
+    // May also be called from the callback, in which case it returns immediately and the watcher stops once the callback returns.
+    // The watcher must not be destroyed from its own callback though.
+    void Stop();
+
+private:
+    UpdateCallback m_Callback;
+    S7ParseOptions m_Options;
+    uint32_t m_DebounceMilliseconds;
+    std::wstring m_wstrS7PFolderPath;
+
+    // Only accessed by the thread currently owning the watcher (Start or the watcher thread).
+    std::vector<S7DeviceFiles> m_DeviceFiles;
+    std::vector<S7DeviceSymbolInfo> m_DeviceSymbolInfos;
+    std::vector<size_t> m_DeviceSymbolCounts;
+    std::vector<std::pair<std::wstring, size_t>> m_SymbolListFolderDevices;
+    std::map<size_t, size_t> m_SubblockListDevices;
+
+    void* m_hDirectory;
+    void* m_hChangeEvent;
+    void* m_hStopEvent;
+    std::thread m_WatchThread;
+
+    CS7PProjectWatcher(UpdateCallback Callback, const S7ParseOptions& Options, uint32_t DebounceMilliseconds);
+
+    void _ClassifyChange(const std::wstring& wstrRelativePath, std::set<size_t>& ChangedDevices, bool& bReparseProject) const;
+    std::variant<std::monostate, CS7PError> _ParseProject();
+    void _ReparseDevices(const std::set<size_t>& ChangedDevices);
+    void _WatchThread();
+};
@@ -0,0 +1,700 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <windows.h>
+
+#include "CS7PQueryServer.h"
+
+#ifndef PIPE_REJECT_REMOTE_CLIENTS
+#define PIPE_REJECT_REMOTE_CLIENTS              0x00000008
+#endif
+
+static const DWORD _PipeBufferSize = 65536;
+
+
+static void
+_AppendField(std::string& strResponses, const std::string& strField)
+{
+    // Tabs and line breaks would break the framing, and comments may well contain them.
+    strResponses += '\t';
+    for (char c : strField)
+    {
+        strResponses += (c == '\t' || c == '\r' || c == '\n') ? ' ' : c;
+    }
+}
+
+static std::string
+_GetQualifiedName(const S7Block& Block, const S7Symbol& Symbol)
+{
+    if (Block.DbNumber == 0)
+    {
+        return Symbol.strName;
+    }
+
+    return "DB" + std::to_string(Block.DbNumber) + "." + Symbol.strName;
+}
+
+static void
+_AppendSymbol(std::string& strResponses, const std::string& strQualifiedName, const S7Block& Block, const S7Symbol& Symbol)
+{
+    strResponses += "SYM";
+    _AppendField(strResponses, strQualifiedName);
+    _AppendField(strResponses, Block.GetCode(Symbol));
+    _AppendField(strResponses, Symbol.strDatatype);
+    _AppendField(strResponses, Symbol.strComment);
+    strResponses += '\n';
+}
+
+static bool
+_ParseUnsigned(const std::string& str, size_t& Position, uint32_t& Value)
+{
+    const size_t Start = Position;
+    uint64_t Result = 0;
+
+    while (Position < str.size() && str[Position] >= '0' && str[Position] <= '9' && Result <= UINT32_MAX)
+    {
+        Result = Result * 10 + (str[Position] - '0');
+        Position++;
+    }
+
+    if (Position == Start || Result > UINT32_MAX)
+    {
+        return false;
+    }
+
+    Value = static_cast<uint32_t>(Result);
+    return true;
+}
+
+static bool
+_ParseAddress(const std::string& strAddress, S7Area& Area, uint16_t& DbNumber, uint32_t& BitOffset)
+{
+    // Accepts everything S7Address::AsString outputs, i.e. "DBn:a.b", "Ia.b", "IBa", "IWa", "IDa", and "Ia" for all I/Q/M areas.
+    size_t Position = 0;
+    uint32_t ByteAddress;
+    uint32_t BitNumber = 0;
+
+    if (strAddress.compare(0, 2, "DB") == 0)
+    {
+        Area = S7Area::DB;
+        Position = 2;
+
+        uint32_t Number;
+        if (!_ParseUnsigned(strAddress, Position, Number) || Number > UINT16_MAX)
+        {
+            return false;
+        }
+
+        DbNumber = static_cast<uint16_t>(Number);
+
+        if (Position >= strAddress.size() || strAddress[Position] != ':')
+        {
+            return false;
+        }
+
+        Position++;
+    }
+    else
+    {
+        if (strAddress.empty())
+        {
+            return false;
+        }
+
+        switch (strAddress[0])
+        {
+            case 'I': Area = S7Area::I; break;
+            case 'Q': Area = S7Area::Q; break;
+            case 'M': Area = S7Area::M; break;
+            default: return false;
+        }
+
+        DbNumber = 0;
+        Position = 1;
+
+        if (Position < strAddress.size() && (strAddress[Position] == 'B' || strAddress[Position] == 'W' || strAddress[Position] == 'D'))
+        {
+            Position++;
+        }
+    }
+
+    if (!_ParseUnsigned(strAddress, Position, ByteAddress) || ByteAddress > UINT32_MAX / 8)
+    {
+        return false;
+    }
+
+    if (Position < strAddress.size() && strAddress[Position] == '.')
+    {
+        Position++;
+
+        if (!_ParseUnsigned(strAddress, Position, BitNumber) || BitNumber > 7)
+        {
+            return false;
+        }
+    }
+
+    if (Position != strAddress.size())
+    {
+        return false;
+    }
+
+    BitOffset = ByteAddress * 8 + BitNumber;
+    return true;
+}
+
+static std::variant<std::monostate, CS7PError>
+_BuildCurrentUserSecurity(std::vector<uint8_t>& SecurityDescriptor, std::vector<uint8_t>& Acl)
+{
+    // Get the SID of the user running this process.
+    HANDLE hToken;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &hToken))
+    {
+        return CS7PError(L"Could not open the process token, error " + std::to_wstring(GetLastError()));
+    }
+
+    DWORD cbTokenUser = 0;
+    GetTokenInformation(hToken, TokenUser, nullptr, 0, &cbTokenUser);
+
+    std::vector<uint8_t> TokenUserBuffer(cbTokenUser);
+    const BOOL bGotTokenUser = cbTokenUser > 0 && GetTokenInformation(hToken, TokenUser, TokenUserBuffer.data(), cbTokenUser, &cbTokenUser);
+    const DWORD dwTokenError = GetLastError();
+    CloseHandle(hToken);
+    if (!bGotTokenUser)
+    {
+        return CS7PError(L"Could not get the user of the process token, error " + std::to_wstring(dwTokenError));
+    }
+
+    PSID pUserSid = reinterpret_cast<const TOKEN_USER*>(TokenUserBuffer.data())->User.Sid;
+
+    // Build a DACL with a single entry for this user.
+    // Everybody else, including other users on the same machine, is denied access by not being listed.
+    Acl.resize(sizeof(ACL) + sizeof(ACCESS_ALLOWED_ACE) - sizeof(DWORD) + GetLengthSid(pUserSid));
+    auto pAcl = reinterpret_cast<PACL>(Acl.data());
+    if (!InitializeAcl(pAcl, static_cast<DWORD>(Acl.size()), ACL_REVISION) || !AddAccessAllowedAce(pAcl, ACL_REVISION, GENERIC_ALL, pUserSid))
+    {
+        return CS7PError(L"Could not build the pipe DACL, error " + std::to_wstring(GetLastError()));
+    }
+
+    SecurityDescriptor.resize(SECURITY_DESCRIPTOR_MIN_LENGTH);
+    if (!InitializeSecurityDescriptor(SecurityDescriptor.data(), SECURITY_DESCRIPTOR_REVISION) ||
+        !SetSecurityDescriptorDacl(SecurityDescriptor.data(), TRUE, pAcl, FALSE))
+    {
+        return CS7PError(L"Could not build the pipe security descriptor, error " + std::to_wstring(GetLastError()));
+    }
+
+    return std::monostate();
+}
+
+static bool
+_WaitForIo(HANDLE hPipe, OVERLAPPED& Overlapped, HANDLE hStopEvent, DWORD& cbTransferred)
+{
+    const HANDLE Handles[] = { hStopEvent, Overlapped.hEvent };
+    if (WaitForMultipleObjects(2, Handles, FALSE, INFINITE) != WAIT_OBJECT_0 + 1)
+    {
+        // Stop has been requested. Cancel the I/O and wait for it, because it still references our buffers.
+        CancelIo(hPipe);
+        GetOverlappedResult(hPipe, &Overlapped, &cbTransferred, TRUE);
+        return false;
+    }
+
+    return GetOverlappedResult(hPipe, &Overlapped, &cbTransferred, FALSE);
+}
+
+
+CS7PQueryServer::CS7PQueryServer()
+    : m_PipeMode(PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS), m_hStopEvent(nullptr)
+{
+}
+
+CS7PQueryServer::~CS7PQueryServer()
+{
+    Stop();
+
+    for (void* hPipe : m_PipeHandles)
+    {
+        if (hPipe != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(hPipe);
+        }
+    }
+
+    if (m_hStopEvent)
+    {
+        CloseHandle(m_hStopEvent);
+    }
+}
+
+std::variant<std::monostate, CS7PError>
+CS7PQueryServer::LoadProject(const std::string& strProjectName, const std::wstring& wstrS7PFilePath, const S7ParseOptions& Options)
+{
+    auto ParseResult = ParseS7P(wstrS7PFilePath, Options);
+    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    {
+        return *pError;
+    }
+
+    SetProject(strProjectName, std::move(std::get<std::vector<S7DeviceSymbolInfo>>(ParseResult)));
+    return std::monostate();
+}
+
+void
+CS7PQueryServer::ProcessRequests(std::string& strRequests, std::string& strResponses) const
+{
+    size_t LineStart = 0;
+
+    for (;;)
+    {
+        const size_t LineEnd = strRequests.find('\n', LineStart);
+        if (LineEnd == std::string::npos)
+        {
+            break;
+        }
+
+        // Also accept CRLF line endings.
+        size_t RequestEnd = LineEnd;
+        if (RequestEnd > LineStart && strRequests[RequestEnd - 1] == '\r')
+        {
+            RequestEnd--;
+        }
+
+        _ProcessRequest(strRequests.substr(LineStart, RequestEnd - LineStart), strResponses);
+        LineStart = LineEnd + 1;
+    }
+
+    strRequests.erase(0, LineStart);
+}
+
+void
+CS7PQueryServer::SetProject(const std::string& strProjectName, std::vector<S7DeviceSymbolInfo> DeviceSymbolInfos)
+{
+    // Build the new project completely before swapping it in, so that requests never wait for indexing.
+    auto pProject = std::make_shared<Project>();
+    pProject->DeviceSymbolInfos = std::move(DeviceSymbolInfos);
+    pProject->Devices.reserve(pProject->DeviceSymbolInfos.size());
+
+    for (size_t DeviceIndex = 0; DeviceIndex < pProject->DeviceSymbolInfos.size(); DeviceIndex++)
+    {
+        const S7DeviceSymbolInfo& DeviceSymbolInfo = pProject->DeviceSymbolInfos[DeviceIndex];
+        Device& NewDevice = pProject->Devices.emplace_back(DeviceSymbolInfo);
+
+        // Like a linear search would, the first device or block of the same name wins.
+        pProject->DeviceIndexes.emplace(DeviceSymbolInfo.strName, DeviceIndex);
+
+        for (size_t BlockIndex = 0; BlockIndex < DeviceSymbolInfo.Blocks.size(); BlockIndex++)
+        {
+            const S7Block& Block = DeviceSymbolInfo.Blocks[BlockIndex];
+            const std::vector<S7Symbol>& Symbols = Block.GetSymbols();
+
+            NewDevice.BlockIndexes.emplace(Block.strName, BlockIndex);
+            if (Block.DbNumber != 0)
+            {
+                NewDevice.BlockIndexes.emplace("DB" + std::to_string(Block.DbNumber), BlockIndex);
+            }
+
+            for (size_t SymbolIndex = 0; SymbolIndex < Symbols.size(); SymbolIndex++)
+            {
+                NewDevice.Names.emplace_back(_GetQualifiedName(Block, Symbols[SymbolIndex]), S7SymbolLocation{ BlockIndex, SymbolIndex });
+            }
+        }
+
+        std::sort(NewDevice.Names.begin(), NewDevice.Names.end(), [](const auto& a, const auto& b)
+        {
+            return a.first < b.first;
+        });
+    }
+
+    std::shared_ptr<const Project> pOldProject;
+
+    {
+        std::lock_guard<std::mutex> Lock(m_ProjectsMutex);
+        pOldProject = std::exchange(m_Projects[strProjectName], std::move(pProject));
+    }
+
+    // pOldProject is destroyed here outside the lock, unless requests are still working on it.
+}
+
+std::variant<std::unique_ptr<CS7PQueryServer>, CS7PError>
+CS7PQueryServer::Start(const std::wstring& wstrPipeName, size_t InstanceCount)
+{
+    auto pServer = std::unique_ptr<CS7PQueryServer>(new CS7PQueryServer());
+    pServer->m_wstrPipeName = wstrPipeName;
+
+    pServer->m_hStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!pServer->m_hStopEvent)
+    {
+        return CS7PError(L"Could not create event, error " + std::to_wstring(GetLastError()));
+    }
+
+    auto Result = _BuildCurrentUserSecurity(pServer->m_PipeSecurityDescriptor, pServer->m_PipeAcl);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    // Create all pipe instances upfront to report errors here and not in a thread.
+    // The first instance must be a new pipe, so that we don't end up serving requests of another process' pipe.
+    for (size_t i = 0; i < InstanceCount; i++)
+    {
+        HANDLE hPipe;
+        Result = pServer->_CreatePipeInstance(hPipe, i == 0);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return *pError;
+        }
+
+        pServer->m_PipeHandles.push_back(hPipe);
+    }
+
+    for (size_t i = 0; i < pServer->m_PipeHandles.size(); i++)
+    {
+        pServer->m_PipeThreads.emplace_back(&CS7PQueryServer::_PipeThread, pServer.get(), i);
+    }
+
+    return pServer;
+}
+
+void
+CS7PQueryServer::Stop()
+{
+    if (m_hStopEvent)
+    {
+        SetEvent(m_hStopEvent);
+    }
+
+    for (std::thread& PipeThread : m_PipeThreads)
+    {
+        if (PipeThread.joinable())
+        {
+            PipeThread.join();
+        }
+    }
+}
+
+void
+CS7PQueryServer::UnloadProject(const std::string& strProjectName)
+{
+    std::shared_ptr<const Project> pOldProject;
+
+    {
+        std::lock_guard<std::mutex> Lock(m_ProjectsMutex);
+
+        const auto it = m_Projects.find(strProjectName);
+        if (it != m_Projects.end())
+        {
+            pOldProject = std::move(it->second);
+            m_Projects.erase(it);
+        }
+    }
+}
+
+std::variant<std::monostate, CS7PError>
+CS7PQueryServer::_CreatePipeInstance(void*& hPipe, bool bFirstInstance)
+{
+    DWORD dwOpenMode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED;
+    if (bFirstInstance)
+    {
+        dwOpenMode |= FILE_FLAG_FIRST_PIPE_INSTANCE;
+    }
+
+    SECURITY_ATTRIBUTES SecurityAttributes = {};
+    SecurityAttributes.nLength = sizeof(SecurityAttributes);
+    SecurityAttributes.lpSecurityDescriptor = m_PipeSecurityDescriptor.data();
+
+    // The number of instances is limited by the pipe threads.
+    // Allowing unlimited instances lets _RecreatePipeInstance create a replacement before closing a broken instance,
+    // so that the pipe name never ceases to exist and can't be taken over by another process.
+    for (;;)
+    {
+        hPipe = CreateNamedPipeW(
+            m_wstrPipeName.c_str(),
+            dwOpenMode,
+            m_PipeMode,
+            PIPE_UNLIMITED_INSTANCES,
+            _PipeBufferSize,
+            _PipeBufferSize,
+            0,
+            &SecurityAttributes
+        );
+        if (hPipe != INVALID_HANDLE_VALUE)
+        {
+            return std::monostate();
+        }
+
+        const DWORD dwError = GetLastError();
+        if (dwError == ERROR_INVALID_PARAMETER && (m_PipeMode & PIPE_REJECT_REMOTE_CLIENTS))
+        {
+            // Windows XP doesn't know this flag.
+            m_PipeMode &= ~PIPE_REJECT_REMOTE_CLIENTS;
+            continue;
+        }
+
+        return CS7PError(L"Could not create pipe " + m_wstrPipeName + L", error " + std::to_wstring(dwError));
+    }
+}
+
+std::shared_ptr<const CS7PQueryServer::Project>
+CS7PQueryServer::_GetProject(const std::string& strProjectName) const
+{
+    std::lock_guard<std::mutex> Lock(m_ProjectsMutex);
+
+    const auto it = m_Projects.find(strProjectName);
+    if (it == m_Projects.end())
+    {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+void
+CS7PQueryServer::_PipeThread(size_t InstanceIndex)
+{
+    HANDLE hIoEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!hIoEvent)
+    {
+        return;
+    }
+
+    std::vector<char> ReadBuffer(_PipeBufferSize);
+    std::string strRequests;
+    std::string strResponses;
+
+    for (;;)
+    {
+        // This instance may have been replaced by _RecreatePipeInstance.
+        HANDLE hPipe = m_PipeHandles[InstanceIndex];
+
+        // Wait for the next client.
+        OVERLAPPED Overlapped = {};
+        Overlapped.hEvent = hIoEvent;
+        DWORD cbTransferred;
+        bool bConnected = true;
+
+        if (!ConnectNamedPipe(hPipe, &Overlapped))
+        {
+            const DWORD dwError = GetLastError();
+            if (dwError == ERROR_IO_PENDING)
+            {
+                if (!_WaitForIo(hPipe, Overlapped, m_hStopEvent, cbTransferred))
+                {
+                    if (WaitForSingleObject(m_hStopEvent, 0) == WAIT_OBJECT_0)
+                    {
+                        break;
+                    }
+
+                    bConnected = false;
+                }
+            }
+            else if (dwError != ERROR_PIPE_CONNECTED)
+            {
+                bConnected = false;
+            }
+        }
+
+        if (!bConnected)
+        {
+            // This instance can't accept clients anymore (e.g. because a client has vanished in an unexpected way).
+            // Giving up would permanently reduce the number of clients served concurrently, so replace the instance.
+            // If that fails too, retry after a while.
+            if (!_RecreatePipeInstance(InstanceIndex) && WaitForSingleObject(m_hStopEvent, 1000) == WAIT_OBJECT_0)
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        // Serve the client until it disconnects.
+        strRequests.clear();
+        bool bStop = false;
+
+        for (;;)
+        {
+            Overlapped = {};
+            Overlapped.hEvent = hIoEvent;
+
+            if (!ReadFile(hPipe, ReadBuffer.data(), static_cast<DWORD>(ReadBuffer.size()), nullptr, &Overlapped) && GetLastError() != ERROR_IO_PENDING)
+            {
+                break;
+            }
+
+            if (!_WaitForIo(hPipe, Overlapped, m_hStopEvent, cbTransferred))
+            {
+                bStop = (WaitForSingleObject(m_hStopEvent, 0) == WAIT_OBJECT_0);
+                break;
+            }
+
+            strRequests.append(ReadBuffer.data(), cbTransferred);
+
+            strResponses.clear();
+            ProcessRequests(strRequests, strResponses);
+
+            // No valid request is that long, so don't let a client make us buffer endlessly.
+            if (strRequests.size() >= _PipeBufferSize)
+            {
+                break;
+            }
+
+            if (strResponses.empty())
+            {
+                continue;
+            }
+
+            Overlapped = {};
+            Overlapped.hEvent = hIoEvent;
+
+            if (!WriteFile(hPipe, strResponses.data(), static_cast<DWORD>(strResponses.size()), nullptr, &Overlapped) && GetLastError() != ERROR_IO_PENDING)
+            {
+                break;
+            }
+
+            if (!_WaitForIo(hPipe, Overlapped, m_hStopEvent, cbTransferred))
+            {
+                bStop = (WaitForSingleObject(m_hStopEvent, 0) == WAIT_OBJECT_0);
+                break;
+            }
+        }
+
+        DisconnectNamedPipe(hPipe);
+
+        if (bStop)
+        {
+            break;
+        }
+    }
+
+    CloseHandle(hIoEvent);
+}
+
+void
+CS7PQueryServer::_ProcessRequest(const std::string& strRequest, std::string& strResponses) const
+{
+    // Split the request into its four fields.
+    // The last one may contain anything but a tab (e.g. spaces in symbol names).
+    std::string Fields[4];
+    size_t FieldStart = 0;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        const size_t FieldEnd = (i < 3) ? strRequest.find('\t', FieldStart) : strRequest.size();
+        if (FieldEnd == std::string::npos)
+        {
+            strResponses += "ERR\tExpected 4 tab-separated fields\n";
+            return;
+        }
+
+        Fields[i] = strRequest.substr(FieldStart, FieldEnd - FieldStart);
+        FieldStart = FieldEnd + 1;
+    }
+
+    const std::string& strCommand = Fields[0];
+    const std::string& strArgument = Fields[3];
+
+    const auto pProject = _GetProject(Fields[1]);
+    if (!pProject)
+    {
+        strResponses += "ERR\tUnknown project\n";
+        return;
+    }
+
+    const auto DeviceIt = pProject->DeviceIndexes.find(Fields[2]);
+    if (DeviceIt == pProject->DeviceIndexes.end())
+    {
+        strResponses += "ERR\tUnknown device\n";
+        return;
+    }
+
+    const S7DeviceSymbolInfo& DeviceSymbolInfo = pProject->DeviceSymbolInfos[DeviceIt->second];
+    const Device& IndexedDevice = pProject->Devices[DeviceIt->second];
+
+    auto AppendLocation = [&](const std::string& strQualifiedName, const S7SymbolLocation& Location)
+    {
+        const S7Block& Block = DeviceSymbolInfo.Blocks[Location.BlockIndex];
+        _AppendSymbol(strResponses, strQualifiedName, Block, Block.GetSymbols()[Location.SymbolIndex]);
+    };
+
+    auto CompareName = [](const std::pair<std::string, S7SymbolLocation>& Entry, const std::string& strName)
+    {
+        return Entry.first < strName;
+    };
+
+    if (strCommand == "NAME")
+    {
+        const auto it = std::lower_bound(IndexedDevice.Names.begin(), IndexedDevice.Names.end(), strArgument, CompareName);
+        if (it != IndexedDevice.Names.end() && it->first == strArgument)
+        {
+            AppendLocation(it->first, it->second);
+        }
+    }
+    else if (strCommand == "ADDR")
+    {
+        S7Area Area;
+        uint16_t DbNumber;
+        uint32_t BitOffset;
+        if (!_ParseAddress(strArgument, Area, DbNumber, BitOffset))
+        {
+            strResponses += "ERR\tInvalid address\n";
+            return;
+        }
+
+        if (const auto Location = IndexedDevice.AddressIndex.FindSymbolAt(Area, DbNumber, BitOffset))
+        {
+            const S7Block& Block = DeviceSymbolInfo.Blocks[Location->BlockIndex];
+            const S7Symbol& Symbol = Block.GetSymbols()[Location->SymbolIndex];
+            _AppendSymbol(strResponses, _GetQualifiedName(Block, Symbol), Block, Symbol);
+        }
+    }
+    else if (strCommand == "PREFIX")
+    {
+        for (auto it = std::lower_bound(IndexedDevice.Names.begin(), IndexedDevice.Names.end(), strArgument, CompareName);
+            it != IndexedDevice.Names.end() && it->first.compare(0, strArgument.size(), strArgument) == 0;
+            ++it)
+        {
+            AppendLocation(it->first, it->second);
+        }
+    }
+    else if (strCommand == "BLOCK")
+    {
+        // Accept both the full block name (e.g. "DB12 (Motors)") and the plain "DB12".
+        const auto BlockIt = IndexedDevice.BlockIndexes.find(strArgument);
+        if (BlockIt == IndexedDevice.BlockIndexes.end())
+        {
+            strResponses += "ERR\tUnknown block\n";
+            return;
+        }
+
+        const S7Block& Block = DeviceSymbolInfo.Blocks[BlockIt->second];
+        for (const S7Symbol& Symbol : Block.GetSymbols())
+        {
+            _AppendSymbol(strResponses, _GetQualifiedName(Block, Symbol), Block, Symbol);
+        }
+    }
+    else
+    {
+        strResponses += "ERR\tUnknown command\n";
+        return;
+    }
+
+    strResponses += "END\n";
+}
+
+bool
+CS7PQueryServer::_RecreatePipeInstance(size_t InstanceIndex)
+{
+    // Create the replacement first, so that the pipe name keeps existing.
+    HANDLE hNewPipe;
+    auto Result = _CreatePipeInstance(hNewPipe, false);
+    if (std::holds_alternative<CS7PError>(Result))
+    {
+        return false;
+    }
+
+    // Only this instance's thread ever accesses its handle after Start, so no locking is required.
+    CloseHandle(m_PipeHandles[InstanceIndex]);
+    m_PipeHandles[InstanceIndex] = hNewPipe;
+    return true;
+}
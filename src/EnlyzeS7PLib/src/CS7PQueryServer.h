@@ -0,0 +1,118 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "CS7SymbolIndex.h"
+#include "s7p_parser.h"
+
+// Keeps parsed projects in memory and answers symbol queries over a named pipe (e.g. "\\.\pipe\S7PQuery").
+//
+// Requests and responses are UTF-8 lines of tab-separated fields:
+//
+//   NAME    <project> <device> <name>      Symbol with the given name
+//   ADDR    <project> <device> <address>   Symbol covering the given address (e.g. "DB12:340.3", "MW200", "I1.0")
+//   PREFIX  <project> <device> <prefix>    All symbols whose name starts with the given prefix, sorted by name
+//   BLOCK   <project> <device> <block>     All symbols of a block (e.g. "DB12" or "Symbol List")
+//
+// Symbols of the Symbol List are named as they are, DB symbols are prefixed by their DB (e.g. "DB12.Motor.Speed").
+// Each request is answered by zero or more lines "SYM <name> <address> <datatype> <comment>",
+// followed by a single "END" line, or an "ERR <message>" line if the request was invalid.
+//
+// Requests are batched by sending multiple lines at once.
+// All responses to what has been read in one go are sent back in a single write.
+//
+// Projects can be loaded and replaced while queries are running.
+// Each request works on the project version that was current when it started.
+//
+// Only processes of the user running the server can connect, and remote clients are rejected (except on Windows XP,
+// which doesn't support this, but still applies the user restriction).
+class CS7PQueryServer
+{
+public:
+    CS7PQueryServer(const CS7PQueryServer&) = delete;
+    CS7PQueryServer& operator=(const CS7PQueryServer&) = delete;
+    ~CS7PQueryServer();
+
+    // Each pipe instance is served by its own thread, so InstanceCount is the number of clients served concurrently.
+    static std::variant<std::unique_ptr<CS7PQueryServer>, CS7PError> Start(
+        const std::wstring& wstrPipeName,
+        size_t InstanceCount = 8
+        );
+
+    std::variant<std::monostate, CS7PError> LoadProject(
+        const std::string& strProjectName,
+        const std::wstring& wstrS7PFilePath,
+        const S7ParseOptions& Options = S7ParseOptions()
+        );
+
+    // Adds or replaces a project with an existing parse result (e.g. from a CS7PProjectWatcher callback).
+    void SetProject(const std::string& strProjectName, std::vector<S7DeviceSymbolInfo> DeviceSymbolInfos);
+    void UnloadProject(const std::string& strProjectName);
+
+    // Answers all complete lines in strRequests and removes them, leaving an incomplete last line in place.
+    // This is what the pipe threads call, but it can also be used in-process.
+    void ProcessRequests(std::string& strRequests, std::string& strResponses) const;
+
+    void Stop();
+
+private:
+    struct Device
+    {
+        explicit Device(const S7DeviceSymbolInfo& DeviceSymbolInfo) : AddressIndex(DeviceSymbolInfo) {}
+
+        CS7SymbolIndex AddressIndex;
+
+        // Block indexes by full block name (e.g. "DB12 (Motors)") and by plain DB name (e.g. "DB12").
+        std::unordered_map<std::string, size_t> BlockIndexes;
+
+        // All symbol names of this device, sorted for exact and prefix lookups.
+        std::vector<std::pair<std::string, S7SymbolLocation>> Names;
+    };
+
+    // Never modified after construction, so any number of requests can use it without locking.
+    struct Project
+    {
+        std::vector<S7DeviceSymbolInfo> DeviceSymbolInfos;
+        std::vector<Device> Devices;
+        std::unordered_map<std::string, size_t> DeviceIndexes;
+    };
+
+    std::wstring m_wstrPipeName;
+    uint32_t m_PipeMode;
+
+    // Absolute security descriptor with a DACL that only grants access to the current user, applied to all pipe instances.
+    std::vector<uint8_t> m_PipeSecurityDescriptor;
+    std::vector<uint8_t> m_PipeAcl;
+
+    // Guards the map only. Requests take a reference to the current project and release the lock before working on it.
+    mutable std::mutex m_ProjectsMutex;
+    std::map<std::string, std::shared_ptr<const Project>> m_Projects;
+
+    void* m_hStopEvent;
+    std::vector<void*> m_PipeHandles;
+    std::vector<std::thread> m_PipeThreads;
+
+    CS7PQueryServer();
+
+    std::variant<std::monostate, CS7PError> _CreatePipeInstance(void*& hPipe, bool bFirstInstance);
+    std::shared_ptr<const Project> _GetProject(const std::string& strProjectName) const;
+    void _PipeThread(size_t InstanceIndex);
+    void _ProcessRequest(const std::string& strRequest, std::string& strResponses) const;
+    bool _RecreatePipeInstance(size_t InstanceIndex);
+};
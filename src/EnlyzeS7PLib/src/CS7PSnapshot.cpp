@@ -0,0 +1,486 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <utility>
+#include <unordered_map>
+#include <windows.h>
+#include <EnlyzeWinStringLib.h>
+
+#include "CS7PSnapshot.h"
+#include "s7p_cp1252.h"
+
+using namespace S7PSnapshotFormat;
+
+static_assert(sizeof(Header) == 64, "Snapshot header must not contain padding");
+static_assert(sizeof(Device) == 32, "Snapshot device record must not contain padding");
+static_assert(sizeof(Block) == 24, "Snapshot block record must not contain padding");
+static_assert(sizeof(Symbol) == 48, "Snapshot symbol record must not contain padding");
+static_assert(sizeof(DbName) == 12, "Snapshot DB name record must not contain padding");
+
+struct StringHeap
+{
+    std::string strData;
+
+    // Datatypes and comments repeat a lot, so every distinct string is only stored once.
+    // The keys point into the S7DeviceSymbolInfo structures being written, or into TranscodedStrings.
+    std::unordered_map<std::string_view, StringRef> Index;
+
+    // Windows-1252 strings converted to UTF-8 while writing.
+    std::deque<std::string> TranscodedStrings;
+};
+
+
+static StringRef
+_AddString(StringHeap& Heap, std::string_view sv)
+{
+    auto it = Heap.Index.find(sv);
+    if (it != Heap.Index.end())
+    {
+        return it->second;
+    }
+
+    // Offsets exceeding 32 bits are caught by the file size check in WriteS7PSnapshot.
+    const StringRef Ref = { static_cast<uint32_t>(Heap.strData.size()), static_cast<uint32_t>(sv.size()) };
+    Heap.strData.append(sv);
+    Heap.Index.emplace(sv, Ref);
+    return Ref;
+}
+
+static StringRef
+_AddTextString(StringHeap& Heap, const std::string& str, S7StringEncoding Encoding)
+{
+    // Snapshot strings are always UTF-8, so convert those of devices parsed without S7ParseOptions::bTranscodeStrings.
+    // Only non-ASCII characters change the length, and pure ASCII strings can be added as they are.
+    if (Encoding == S7StringEncoding::Cp1252)
+    {
+        std::string strUtf8 = Cp1252ToUtf8(str);
+        if (strUtf8.size() != str.size())
+        {
+            return _AddString(Heap, Heap.TranscodedStrings.emplace_back(std::move(strUtf8)));
+        }
+    }
+
+    return _AddString(Heap, str);
+}
+
+static StringRef
+_AddUnindexedString(StringHeap& Heap, const std::string& str)
+{
+    const StringRef Ref = { static_cast<uint32_t>(Heap.strData.size()), static_cast<uint32_t>(str.size()) };
+    Heap.strData.append(str);
+    return Ref;
+}
+
+static bool
+_IsSectionInBounds(uint32_t Offset, uint32_t Count, size_t RecordSize, size_t FileSize)
+{
+    return Offset % 4 == 0 && static_cast<uint64_t>(Offset) + static_cast<uint64_t>(Count) * RecordSize <= FileSize;
+}
+
+static bool
+_IsRangeInBounds(uint32_t First, uint32_t Count, uint32_t Total)
+{
+    return static_cast<uint64_t>(First) + Count <= Total;
+}
+
+static std::optional<CS7PError>
+_WriteSection(HANDLE hFile, const std::wstring& wstrFilePath, const void* pData, size_t Size)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(pData);
+
+    while (Size > 0)
+    {
+        const DWORD BytesToWrite = static_cast<DWORD>(std::min<size_t>(Size, 1 << 24));
+        DWORD BytesWritten;
+        if (!WriteFile(hFile, p, BytesToWrite, &BytesWritten, nullptr) || BytesWritten != BytesToWrite)
+        {
+            return CS7PError(L"Could not write " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+        }
+
+        p += BytesToWrite;
+        Size -= BytesToWrite;
+    }
+
+    return std::nullopt;
+}
+
+
+S7Address
+S7SymbolView::GetAddress() const
+{
+    S7Address Address;
+    Address.Area = static_cast<S7Area>(m_Record.Area);
+    Address.DbNumber = m_InstanceDbNumber.value_or(m_Record.DbNumber);
+    Address.BitOffset = m_Record.BitOffset;
+    Address.BitSize = m_Record.BitSize;
+    Address.ElementCount = m_Record.ElementCount;
+    return Address;
+}
+
+std::string
+S7SymbolView::GetCode() const
+{
+    if (m_Record.RawCode.Length > 0)
+    {
+        return std::string(m_Snapshot._GetString(m_Record.RawCode));
+    }
+
+    return GetAddress().AsString();
+}
+
+std::string_view
+S7SymbolView::GetComment() const
+{
+    return m_Snapshot._GetString(m_Record.Comment);
+}
+
+std::string_view
+S7SymbolView::GetDatatype() const
+{
+    return m_Snapshot._GetString(m_Record.Datatype);
+}
+
+std::string_view
+S7SymbolView::GetName() const
+{
+    return m_Snapshot._GetString(m_Record.Name);
+}
+
+std::string_view
+S7BlockView::GetName() const
+{
+    return m_Snapshot._GetString(m_Record.Name);
+}
+
+S7SymbolView
+S7BlockView::GetSymbol(size_t Index) const
+{
+    const auto& Record = m_Snapshot._GetRecord<Symbol>(m_Snapshot.m_pHeader->SymbolsOffset, m_Record.FirstSymbol + Index);
+
+    std::optional<uint16_t> InstanceDbNumber;
+    if (m_Record.Flags & BlockFlagInstanceLayout)
+    {
+        InstanceDbNumber = m_Record.DbNumber;
+    }
+
+    return S7SymbolView(m_Snapshot, Record, InstanceDbNumber);
+}
+
+S7BlockView
+S7DeviceSymbolInfoView::GetBlock(size_t Index) const
+{
+    const auto& Record = m_Snapshot._GetRecord<Block>(m_Snapshot.m_pHeader->BlocksOffset, m_Record.FirstBlock + Index);
+    return S7BlockView(m_Snapshot, Record);
+}
+
+std::optional<std::string_view>
+S7DeviceSymbolInfoView::GetDbName(size_t DbNumber) const
+{
+    const DbName* pBegin = &m_Snapshot._GetRecord<DbName>(m_Snapshot.m_pHeader->DbNamesOffset, m_Record.FirstDbName);
+    const DbName* pEnd = pBegin + m_Record.DbNameCount;
+
+    const DbName* pDbName = std::lower_bound(pBegin, pEnd, DbNumber, [](const DbName& Record, size_t Number)
+    {
+        return Record.DbNumber < Number;
+    });
+    if (pDbName == pEnd || pDbName->DbNumber != DbNumber)
+    {
+        return std::nullopt;
+    }
+
+    return m_Snapshot._GetString(pDbName->Name);
+}
+
+std::string_view
+S7DeviceSymbolInfoView::GetName() const
+{
+    return m_Snapshot._GetString(m_Record.Name);
+}
+
+std::string_view
+S7DeviceSymbolInfoView::GetWarning(size_t Index) const
+{
+    const auto& Ref = m_Snapshot._GetRecord<StringRef>(m_Snapshot.m_pHeader->WarningsOffset, m_Record.FirstWarning + Index);
+    return m_Snapshot._GetString(Ref);
+}
+
+CS7PSnapshot::CS7PSnapshot(void* hMapping, const uint8_t* pBase)
+    : m_hMapping(hMapping), m_pBase(pBase), m_pHeader(reinterpret_cast<const Header*>(pBase))
+{
+}
+
+CS7PSnapshot::~CS7PSnapshot()
+{
+    UnmapViewOfFile(m_pBase);
+    CloseHandle(m_hMapping);
+}
+
+S7DeviceSymbolInfoView
+CS7PSnapshot::GetDevice(size_t Index) const
+{
+    return S7DeviceSymbolInfoView(*this, _GetRecord<Device>(m_pHeader->DevicesOffset, Index));
+}
+
+std::variant<std::unique_ptr<CS7PSnapshot>, CS7PError>
+CS7PSnapshot::Open(const std::wstring& wstrFilePath)
+{
+    HANDLE hFile = CreateFileW(wstrFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not open " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(hFile, &FileSize))
+    {
+        CloseHandle(hFile);
+        return CS7PError(L"Could not get the size of " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    if (FileSize.QuadPart < static_cast<long long>(sizeof(Header)) || FileSize.QuadPart > UINT32_MAX)
+    {
+        CloseHandle(hFile);
+        return CS7PError(L"Invalid snapshot file size of " + wstrFilePath);
+    }
+
+    // The mapping keeps its own reference to the file, so the file handle is no longer needed afterwards.
+    HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const DWORD dwMappingError = GetLastError();
+    CloseHandle(hFile);
+    if (!hMapping)
+    {
+        return CS7PError(L"Could not map " + wstrFilePath + L", error " + std::to_wstring(dwMappingError));
+    }
+
+    const void* pBase = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!pBase)
+    {
+        const DWORD dwError = GetLastError();
+        CloseHandle(hMapping);
+        return CS7PError(L"Could not map " + wstrFilePath + L", error " + std::to_wstring(dwError));
+    }
+
+    auto pSnapshot = std::unique_ptr<CS7PSnapshot>(new CS7PSnapshot(hMapping, static_cast<const uint8_t*>(pBase)));
+    if (auto pError = pSnapshot->_Validate(static_cast<size_t>(FileSize.QuadPart)))
+    {
+        return CS7PError(wstrFilePath + L": " + pError->Message());
+    }
+
+    return pSnapshot;
+}
+
+std::string_view
+CS7PSnapshot::_GetString(const StringRef& Ref) const
+{
+    // String references are checked on access instead of when opening the snapshot.
+    // This keeps opening independent of the number of symbols.
+    if (static_cast<uint64_t>(Ref.Offset) + Ref.Length > m_pHeader->StringsSize)
+    {
+        return std::string_view();
+    }
+
+    return std::string_view(reinterpret_cast<const char*>(m_pBase + m_pHeader->StringsOffset + Ref.Offset), Ref.Length);
+}
+
+std::optional<CS7PError>
+CS7PSnapshot::_Validate(size_t MappedSize) const
+{
+    const Header& Hdr = *m_pHeader;
+
+    if (memcmp(Hdr.Magic, Magic, sizeof(Magic)) != 0)
+    {
+        return CS7PError(L"Not a snapshot file");
+    }
+
+    if (Hdr.Version != Version)
+    {
+        return CS7PError(L"Unsupported snapshot version " + std::to_wstring(Hdr.Version));
+    }
+
+    if (Hdr.FileSize != MappedSize)
+    {
+        return CS7PError(L"Truncated snapshot file");
+    }
+
+    if (!_IsSectionInBounds(Hdr.DevicesOffset, Hdr.DeviceCount, sizeof(Device), MappedSize) ||
+        !_IsSectionInBounds(Hdr.BlocksOffset, Hdr.BlockCount, sizeof(Block), MappedSize) ||
+        !_IsSectionInBounds(Hdr.SymbolsOffset, Hdr.SymbolCount, sizeof(Symbol), MappedSize) ||
+        !_IsSectionInBounds(Hdr.WarningsOffset, Hdr.WarningCount, sizeof(StringRef), MappedSize) ||
+        !_IsSectionInBounds(Hdr.DbNamesOffset, Hdr.DbNameCount, sizeof(DbName), MappedSize) ||
+        static_cast<uint64_t>(Hdr.StringsOffset) + Hdr.StringsSize > MappedSize)
+    {
+        return CS7PError(L"Invalid snapshot section table");
+    }
+
+    // Devices and blocks are few compared to symbols, so their ranges are checked upfront.
+    // This lets all views index their records without further checks.
+    for (uint32_t i = 0; i < Hdr.DeviceCount; i++)
+    {
+        const Device& DeviceRecord = _GetRecord<Device>(Hdr.DevicesOffset, i);
+        if (!_IsRangeInBounds(DeviceRecord.FirstBlock, DeviceRecord.BlockCount, Hdr.BlockCount) ||
+            !_IsRangeInBounds(DeviceRecord.FirstWarning, DeviceRecord.WarningCount, Hdr.WarningCount) ||
+            !_IsRangeInBounds(DeviceRecord.FirstDbName, DeviceRecord.DbNameCount, Hdr.DbNameCount))
+        {
+            return CS7PError(L"Invalid range in snapshot device record " + std::to_wstring(i));
+        }
+    }
+
+    for (uint32_t i = 0; i < Hdr.BlockCount; i++)
+    {
+        const Block& BlockRecord = _GetRecord<Block>(Hdr.BlocksOffset, i);
+        if (!_IsRangeInBounds(BlockRecord.FirstSymbol, BlockRecord.SymbolCount, Hdr.SymbolCount))
+        {
+            return CS7PError(L"Invalid range in snapshot block record " + std::to_wstring(i));
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::variant<std::monostate, CS7PError>
+WriteS7PSnapshot(
+    const std::wstring& wstrFilePath,
+    const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos
+    )
+{
+    StringHeap Heap;
+    std::vector<Device> Devices;
+    std::vector<Block> Blocks;
+    std::vector<Symbol> Symbols;
+    std::vector<StringRef> Warnings;
+    std::vector<DbName> DbNames;
+
+    // Instance DBs sharing a layout or symbol tree also share a single symbol range in the snapshot.
+    // The symbols of both have a DbNumber of 0, which the reader replaces by the DbNumber of the block.
+    std::map<const void*, uint32_t> LayoutFirstSymbols;
+
+    for (const S7DeviceSymbolInfo& Info : DeviceSymbolInfos)
+    {
+        Device DeviceRecord = {};
+        DeviceRecord.Name = _AddString(Heap, Info.strName);
+        DeviceRecord.FirstBlock = static_cast<uint32_t>(Blocks.size());
+        DeviceRecord.BlockCount = static_cast<uint32_t>(Info.Blocks.size());
+        DeviceRecord.FirstWarning = static_cast<uint32_t>(Warnings.size());
+        DeviceRecord.WarningCount = static_cast<uint32_t>(Info.Warnings.size());
+        DeviceRecord.FirstDbName = static_cast<uint32_t>(DbNames.size());
+        DeviceRecord.DbNameCount = static_cast<uint32_t>(Info.DbNamesMap.size());
+
+        for (const S7Block& SourceBlock : Info.Blocks)
+        {
+            const std::vector<S7Symbol>& SourceSymbols = SourceBlock.GetSymbols();
+
+            Block BlockRecord = {};
+            BlockRecord.Name = _AddTextString(Heap, SourceBlock.strName, Info.StringEncoding);
+            BlockRecord.DbNumber = SourceBlock.DbNumber;
+            BlockRecord.FirstSymbol = static_cast<uint32_t>(Symbols.size());
+            BlockRecord.SymbolCount = static_cast<uint32_t>(SourceSymbols.size());
+
+            const void* pSharedSymbols = SourceBlock.pSymbolTree ? static_cast<const void*>(SourceBlock.pSymbolTree.get()) : SourceBlock.pInstanceLayout.get();
+            if (pSharedSymbols)
+            {
+                BlockRecord.Flags |= BlockFlagInstanceLayout;
+
+                auto [it, bInserted] = LayoutFirstSymbols.try_emplace(pSharedSymbols, BlockRecord.FirstSymbol);
+                BlockRecord.FirstSymbol = it->second;
+                if (!bInserted)
+                {
+                    Blocks.push_back(BlockRecord);
+                    continue;
+                }
+            }
+
+            for (const S7Symbol& SourceSymbol : SourceSymbols)
+            {
+                Symbol SymbolRecord = {};
+                SymbolRecord.Name = _AddTextString(Heap, SourceSymbol.strName, Info.StringEncoding);
+                SymbolRecord.Datatype = _AddString(Heap, SourceSymbol.strDatatype);
+                SymbolRecord.Comment = _AddTextString(Heap, SourceSymbol.strComment, Info.StringEncoding);
+                SymbolRecord.RawCode = _AddString(Heap, SourceSymbol.strRawCode);
+                SymbolRecord.Area = static_cast<uint8_t>(SourceSymbol.Address.Area);
+                SymbolRecord.DbNumber = SourceSymbol.Address.DbNumber;
+                SymbolRecord.BitOffset = SourceSymbol.Address.BitOffset;
+                SymbolRecord.BitSize = SourceSymbol.Address.BitSize;
+                SymbolRecord.ElementCount = SourceSymbol.Address.ElementCount;
+                Symbols.push_back(SymbolRecord);
+            }
+
+            Blocks.push_back(BlockRecord);
+        }
+
+        for (const CS7PError& Warning : Info.Warnings)
+        {
+            Warnings.push_back(_AddUnindexedString(Heap, WstrToStr(Warning.Message())));
+        }
+
+        // std::map already iterates in DB number order, which GetDbName relies on for its binary search.
+        for (const auto& [DbNumber, strDbName] : Info.DbNamesMap)
+        {
+            DbNames.push_back({ static_cast<uint32_t>(DbNumber), _AddTextString(Heap, strDbName, Info.StringEncoding) });
+        }
+
+        Devices.push_back(DeviceRecord);
+    }
+
+    Header Hdr = {};
+    memcpy(Hdr.Magic, Magic, sizeof(Magic));
+    Hdr.Version = Version;
+
+    uint64_t Offset = sizeof(Header);
+    auto AddSection = [&Offset](uint32_t& SectionOffset, uint32_t& SectionCount, size_t Count, size_t RecordSize)
+    {
+        SectionOffset = static_cast<uint32_t>(Offset);
+        SectionCount = static_cast<uint32_t>(Count);
+        Offset += static_cast<uint64_t>(Count) * RecordSize;
+    };
+
+    AddSection(Hdr.DevicesOffset, Hdr.DeviceCount, Devices.size(), sizeof(Device));
+    AddSection(Hdr.BlocksOffset, Hdr.BlockCount, Blocks.size(), sizeof(Block));
+    AddSection(Hdr.SymbolsOffset, Hdr.SymbolCount, Symbols.size(), sizeof(Symbol));
+    AddSection(Hdr.WarningsOffset, Hdr.WarningCount, Warnings.size(), sizeof(StringRef));
+    AddSection(Hdr.DbNamesOffset, Hdr.DbNameCount, DbNames.size(), sizeof(DbName));
+    AddSection(Hdr.StringsOffset, Hdr.StringsSize, Heap.strData.size(), 1);
+
+    // All offsets, counts and string references are 32-bit, which also matches what a 32-bit process can map at once.
+    if (Offset > UINT32_MAX)
+    {
+        return CS7PError(L"Project is too large for a snapshot");
+    }
+
+    Hdr.FileSize = static_cast<uint32_t>(Offset);
+
+    HANDLE hFile = CreateFileW(wstrFilePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not create " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    const std::pair<const void*, size_t> Sections[] = {
+        { &Hdr, sizeof(Hdr) },
+        { Devices.data(), Devices.size() * sizeof(Device) },
+        { Blocks.data(), Blocks.size() * sizeof(Block) },
+        { Symbols.data(), Symbols.size() * sizeof(Symbol) },
+        { Warnings.data(), Warnings.size() * sizeof(StringRef) },
+        { DbNames.data(), DbNames.size() * sizeof(DbName) },
+        { Heap.strData.data(), Heap.strData.size() },
+    };
+
+    for (const auto& [pData, Size] : Sections)
+    {
+        if (auto pError = _WriteSection(hFile, wstrFilePath, pData, Size))
+        {
+            CloseHandle(hFile);
+            DeleteFileW(wstrFilePath.c_str());
+            return *pError;
+        }
+    }
+
+    CloseHandle(hFile);
+    return std::monostate();
+}
@@ -0,0 +1,194 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_parser.h"
+
+// On-disk records of the snapshot format.
+// All integers are little-endian, all offsets are relative to the beginning of the file, and all records are naturally aligned.
+// Strings are UTF-8 and stored in a single string heap without terminators.
+namespace S7PSnapshotFormat
+{
+    const char Magic[8] = { 'S', '7', 'P', 'S', 'N', 'A', 'P', '\0' };
+    const uint32_t Version = 2;
+
+    // Block uses a symbol range with a DbNumber of 0, shared between all instance DBs of the same FB (see S7Block::pInstanceLayout and S7Block::pSymbolTree).
+    const uint32_t BlockFlagInstanceLayout = 0x01;
+
+    struct StringRef
+    {
+        uint32_t Offset;
+        uint32_t Length;
+    };
+
+    struct Header
+    {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t FileSize;
+        uint32_t DeviceCount;
+        uint32_t DevicesOffset;
+        uint32_t BlockCount;
+        uint32_t BlocksOffset;
+        uint32_t SymbolCount;
+        uint32_t SymbolsOffset;
+        uint32_t WarningCount;
+        uint32_t WarningsOffset;
+        uint32_t DbNameCount;
+        uint32_t DbNamesOffset;
+        uint32_t StringsSize;
+        uint32_t StringsOffset;
+    };
+
+    struct Device
+    {
+        StringRef Name;
+        uint32_t FirstBlock;
+        uint32_t BlockCount;
+        uint32_t FirstWarning;
+        uint32_t WarningCount;
+
+        // DB names of a device are sorted by DB number.
+        uint32_t FirstDbName;
+        uint32_t DbNameCount;
+    };
+
+    struct Block
+    {
+        StringRef Name;
+        uint16_t DbNumber;
+        uint16_t Reserved;
+        uint32_t Flags;
+        uint32_t FirstSymbol;
+        uint32_t SymbolCount;
+    };
+
+    struct Symbol
+    {
+        StringRef Name;
+        StringRef Datatype;
+        StringRef Comment;
+
+        // Only non-empty for Symbol List codes that could not be parsed into an address (see S7Symbol::strRawCode).
+        StringRef RawCode;
+        uint8_t Area;
+        uint8_t Reserved;
+        uint16_t DbNumber;
+        uint32_t BitOffset;
+        uint32_t BitSize;
+        uint32_t ElementCount;
+    };
+
+    struct DbName
+    {
+        uint32_t DbNumber;
+        StringRef Name;
+    };
+}
+
+class CS7PSnapshot;
+
+class S7SymbolView
+{
+public:
+    S7SymbolView(const CS7PSnapshot& Snapshot, const S7PSnapshotFormat::Symbol& Record, std::optional<uint16_t> InstanceDbNumber)
+        : m_Snapshot(Snapshot), m_Record(Record), m_InstanceDbNumber(InstanceDbNumber) {}
+
+    S7Address GetAddress() const;
+    std::string GetCode() const;
+    std::string_view GetComment() const;
+    std::string_view GetDatatype() const;
+    std::string_view GetName() const;
+
+private:
+    const CS7PSnapshot& m_Snapshot;
+    const S7PSnapshotFormat::Symbol& m_Record;
+    std::optional<uint16_t> m_InstanceDbNumber;
+};
+
+class S7BlockView
+{
+public:
+    S7BlockView(const CS7PSnapshot& Snapshot, const S7PSnapshotFormat::Block& Record)
+        : m_Snapshot(Snapshot), m_Record(Record) {}
+
+    uint16_t GetDbNumber() const { return m_Record.DbNumber; }
+    std::string_view GetName() const;
+    S7SymbolView GetSymbol(size_t Index) const;
+    size_t GetSymbolCount() const { return m_Record.SymbolCount; }
+
+private:
+    const CS7PSnapshot& m_Snapshot;
+    const S7PSnapshotFormat::Block& m_Record;
+};
+
+class S7DeviceSymbolInfoView
+{
+public:
+    S7DeviceSymbolInfoView(const CS7PSnapshot& Snapshot, const S7PSnapshotFormat::Device& Record)
+        : m_Snapshot(Snapshot), m_Record(Record) {}
+
+    S7BlockView GetBlock(size_t Index) const;
+    size_t GetBlockCount() const { return m_Record.BlockCount; }
+    std::optional<std::string_view> GetDbName(size_t DbNumber) const;
+    std::string_view GetName() const;
+    std::string_view GetWarning(size_t Index) const;
+    size_t GetWarningCount() const { return m_Record.WarningCount; }
+
+private:
+    const CS7PSnapshot& m_Snapshot;
+    const S7PSnapshotFormat::Device& m_Record;
+};
+
+// Read-only, memory-mapped snapshot of a ParseS7P result.
+// Opening a snapshot only validates the header and the record ranges. All queries work directly on the mapped file,
+// which is shared between all processes mapping the same snapshot.
+class CS7PSnapshot
+{
+public:
+    CS7PSnapshot(const CS7PSnapshot&) = delete;
+    CS7PSnapshot& operator=(const CS7PSnapshot&) = delete;
+    ~CS7PSnapshot();
+
+    static std::variant<std::unique_ptr<CS7PSnapshot>, CS7PError> Open(const std::wstring& wstrFilePath);
+
+    S7DeviceSymbolInfoView GetDevice(size_t Index) const;
+    size_t GetDeviceCount() const { return m_pHeader->DeviceCount; }
+
+private:
+    friend class S7SymbolView;
+    friend class S7BlockView;
+    friend class S7DeviceSymbolInfoView;
+
+    void* m_hMapping;
+    const uint8_t* m_pBase;
+    const S7PSnapshotFormat::Header* m_pHeader;
+
+    CS7PSnapshot(void* hMapping, const uint8_t* pBase);
+
+    template<class T> const T& _GetRecord(uint32_t SectionOffset, size_t Index) const
+    {
+        return reinterpret_cast<const T*>(m_pBase + SectionOffset)[Index];
+    }
+
+    std::string_view _GetString(const S7PSnapshotFormat::StringRef& Ref) const;
+    std::optional<CS7PError> _Validate(size_t MappedSize) const;
+};
+
+std::variant<std::monostate, CS7PError> WriteS7PSnapshot(
+    const std::wstring& wstrFilePath,
+    const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos
+    );
@@ -0,0 +1,41 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Worker threads that are joined when the group goes out of scope.
+// This also happens when starting a further thread throws std::system_error or anything else leaves the scope early,
+// which would otherwise destroy a joinable std::thread and terminate the process.
+class CS7PThreadGroup
+{
+public:
+    CS7PThreadGroup() {}
+    CS7PThreadGroup(const CS7PThreadGroup&) = delete;
+    CS7PThreadGroup& operator=(const CS7PThreadGroup&) = delete;
+    ~CS7PThreadGroup() { Join(); }
+
+    void Join()
+    {
+        for (std::thread& Thread : m_Threads)
+        {
+            Thread.join();
+        }
+
+        m_Threads.clear();
+    }
+
+    template<typename Function, typename... Arguments> void Start(Function&& f, Arguments&&... args)
+    {
+        m_Threads.emplace_back(std::forward<Function>(f), std::forward<Arguments>(args)...);
+    }
+
+private:
+    std::vector<std::thread> m_Threads;
+};
@@ -0,0 +1,277 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cstring>
+#include <immintrin.h>
+#include <intrin.h>
+
+#include "CS7SnapshotDelta.h"
+
+// See s7p_mc5code_scanner.cpp for why the vector kernels are compiled with per-function target attributes.
+#define SSE2_FUNCTION __attribute__((target("sse2")))
+
+// Size of the blocks compared by the kernels below. Every chunk consists of whole blocks.
+static const size_t _BlockSize = 16;
+
+// Kernel returning the offset of the first block at or after Offset that differs between both buffers, or EndOffset if none does.
+// EndOffset - Offset must be a multiple of _BlockSize.
+using FindChangedBlockFunction = size_t (*)(const uint8_t* pPrevious, const uint8_t* pCurrent, size_t Offset, size_t EndOffset);
+
+
+static bool
+_IsChunkEqual(const uint8_t* pPrevious, const uint8_t* pCurrent, size_t Size)
+{
+    // Compare 4 bytes at a time and combine the differences, so that there is only a single branch per chunk.
+    uint32_t Difference = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= Size; i += 4)
+    {
+        uint32_t Previous;
+        uint32_t Current;
+        memcpy(&Previous, pPrevious + i, 4);
+        memcpy(&Current, pCurrent + i, 4);
+        Difference |= Previous ^ Current;
+    }
+
+    for (; i < Size; i++)
+    {
+        Difference |= pPrevious[i] ^ pCurrent[i];
+    }
+
+    return Difference == 0;
+}
+
+//
+// Scalar fallback
+//
+static size_t
+_FindChangedBlockScalar(const uint8_t* pPrevious, const uint8_t* pCurrent, size_t Offset, size_t EndOffset)
+{
+    while (Offset < EndOffset && _IsChunkEqual(pPrevious + Offset, pCurrent + Offset, _BlockSize))
+    {
+        Offset += _BlockSize;
+    }
+
+    return Offset;
+}
+
+//
+// SSE2 kernel
+//
+SSE2_FUNCTION static bool
+_IsBlockEqualSse2(const uint8_t* pPrevious, const uint8_t* pCurrent)
+{
+    const __m128i Previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPrevious));
+    const __m128i Current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCurrent));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(Previous, Current)) == 0xFFFF;
+}
+
+SSE2_FUNCTION static size_t
+_FindChangedBlockSse2(const uint8_t* pPrevious, const uint8_t* pCurrent, size_t Offset, size_t EndOffset)
+{
+    // Compare 4 blocks per iteration, so that unchanged areas only cost a single branch per 64 bytes.
+    while (EndOffset - Offset >= 4 * _BlockSize)
+    {
+        __m128i Equal = _mm_set1_epi8(-1);
+        for (size_t i = 0; i < 4 * _BlockSize; i += _BlockSize)
+        {
+            const __m128i Previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPrevious + Offset + i));
+            const __m128i Current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCurrent + Offset + i));
+            Equal = _mm_and_si128(Equal, _mm_cmpeq_epi8(Previous, Current));
+        }
+
+        if (_mm_movemask_epi8(Equal) != 0xFFFF)
+        {
+            break;
+        }
+
+        Offset += 4 * _BlockSize;
+    }
+
+    // Find the changed block among the remaining ones.
+    while (Offset < EndOffset && _IsBlockEqualSse2(pPrevious + Offset, pCurrent + Offset))
+    {
+        Offset += _BlockSize;
+    }
+
+    return Offset;
+}
+
+//
+// Runtime dispatch
+//
+static FindChangedBlockFunction
+_SelectFindChangedBlock()
+{
+    int CpuInfo[4];
+    __cpuid(CpuInfo, 1);
+
+    if (CpuInfo[3] & (1 << 26))
+    {
+        return _FindChangedBlockSse2;
+    }
+
+    return _FindChangedBlockScalar;
+}
+
+static const FindChangedBlockFunction _pfnFindChangedBlock = _SelectFindChangedBlock();
+
+
+CS7SnapshotDelta::CS7SnapshotDelta(const S7Block& Block, S7Area Area)
+    : m_RequiredBufferSize(0)
+{
+    // Precompute the exact byte range and the relevant bits of the first and last byte for each symbol of the requested area.
+    const std::vector<S7Symbol>& Symbols = Block.GetSymbols();
+    for (size_t i = 0; i < Symbols.size(); i++)
+    {
+        const S7Address& Address = Symbols[i].Address;
+        if (Address.Area != Area || !Symbols[i].strRawCode.empty())
+        {
+            continue;
+        }
+
+        uint32_t EndBitOffset = Address.BitOffset + std::max<uint32_t>(Address.BitSize, 1);
+
+        SymbolRange& Range = m_SymbolRanges.emplace_back();
+        Range.SymbolIndex = i;
+        Range.FirstByte = Address.BitOffset / 8;
+        Range.EndByte = (EndBitOffset + 7) / 8;
+        Range.FirstByteMask = static_cast<uint8_t>(0xFF << (Address.BitOffset % 8));
+        Range.LastByteMask = static_cast<uint8_t>(0xFF >> ((8 - EndBitOffset % 8) % 8));
+
+        if (Range.EndByte - Range.FirstByte == 1)
+        {
+            // Both masks apply to the same byte.
+            Range.FirstByteMask &= Range.LastByteMask;
+            Range.LastByteMask = Range.FirstByteMask;
+        }
+
+        m_RequiredBufferSize = std::max<size_t>(m_RequiredBufferSize, Range.EndByte);
+    }
+
+    // Build the chunk -> symbol map.
+    // First count the symbols per chunk, then turn the counts into start indexes, and finally fill in the symbols.
+    size_t ChunkCount = (m_RequiredBufferSize + ChunkSize - 1) / ChunkSize;
+    m_ChunkStarts.assign(ChunkCount + 1, 0);
+
+    for (const SymbolRange& Range : m_SymbolRanges)
+    {
+        for (size_t Chunk = Range.FirstByte / ChunkSize; Chunk <= (Range.EndByte - 1) / ChunkSize; Chunk++)
+        {
+            m_ChunkStarts[Chunk + 1]++;
+        }
+    }
+
+    for (size_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+    {
+        m_ChunkStarts[Chunk + 1] += m_ChunkStarts[Chunk];
+    }
+
+    m_ChunkSymbolRanges.resize(m_ChunkStarts[ChunkCount]);
+    std::vector<uint32_t> FillPositions(m_ChunkStarts.begin(), m_ChunkStarts.end() - 1);
+
+    for (size_t i = 0; i < m_SymbolRanges.size(); i++)
+    {
+        const SymbolRange& Range = m_SymbolRanges[i];
+        for (size_t Chunk = Range.FirstByte / ChunkSize; Chunk <= (Range.EndByte - 1) / ChunkSize; Chunk++)
+        {
+            m_ChunkSymbolRanges[FillPositions[Chunk]++] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+bool
+CS7SnapshotDelta::_HasSymbolChanged(const SymbolRange& Range, const uint8_t* pPreviousBuffer, const uint8_t* pCurrentBuffer)
+{
+    // Check the first byte and the last byte using their bit masks.
+    if ((pPreviousBuffer[Range.FirstByte] ^ pCurrentBuffer[Range.FirstByte]) & Range.FirstByteMask)
+    {
+        return true;
+    }
+
+    uint32_t LastByte = Range.EndByte - 1;
+    if (LastByte == Range.FirstByte)
+    {
+        return false;
+    }
+
+    if ((pPreviousBuffer[LastByte] ^ pCurrentBuffer[LastByte]) & Range.LastByteMask)
+    {
+        return true;
+    }
+
+    // All bytes in between are fully occupied by this symbol.
+    return !_IsChunkEqual(pPreviousBuffer + Range.FirstByte + 1, pCurrentBuffer + Range.FirstByte + 1, LastByte - Range.FirstByte - 1);
+}
+
+std::variant<std::monostate, CS7PError>
+CS7SnapshotDelta::GetChangedSymbols(std::vector<size_t>& ChangedSymbolIndexes, const uint8_t* pPreviousBuffer, const uint8_t* pCurrentBuffer, size_t BufferSize) const
+{
+    ChangedSymbolIndexes.clear();
+
+    if (BufferSize < m_RequiredBufferSize)
+    {
+        return CS7PError(
+            L"Buffer of " + std::to_wstring(BufferSize) + L" bytes is too small for comparing, " +
+            std::to_wstring(m_RequiredBufferSize) + L" bytes are required"
+        );
+    }
+
+    static_assert(ChunkSize % _BlockSize == 0, "Chunks must consist of whole blocks");
+
+    // Unchanged whole chunks are skipped at once by the kernel, only a trailing partial chunk is compared on its own.
+    const size_t ChunkCount = m_ChunkStarts.size() - 1;
+    const size_t WholeChunkCount = m_RequiredBufferSize / ChunkSize;
+
+    // A symbol spanning multiple changed chunks must only be checked and reported once.
+    // Its chunks are contiguous, so it has already been checked if it starts before the end of the previous changed chunk.
+    size_t ChangedChunkEnd = 0;
+
+    for (size_t Chunk = 0; Chunk < ChunkCount; Chunk++)
+    {
+        if (Chunk < WholeChunkCount)
+        {
+            Chunk = _pfnFindChangedBlock(pPreviousBuffer, pCurrentBuffer, Chunk * ChunkSize, WholeChunkCount * ChunkSize) / ChunkSize;
+            if (Chunk == ChunkCount)
+            {
+                break;
+            }
+        }
+
+        if (Chunk >= WholeChunkCount)
+        {
+            const size_t ChunkOffset = Chunk * ChunkSize;
+            if (_IsChunkEqual(pPreviousBuffer + ChunkOffset, pCurrentBuffer + ChunkOffset, m_RequiredBufferSize - ChunkOffset))
+            {
+                continue;
+            }
+        }
+
+        // This chunk has changed, so check the symbols overlapping it in detail.
+        for (uint32_t j = m_ChunkStarts[Chunk]; j < m_ChunkStarts[Chunk + 1]; j++)
+        {
+            const SymbolRange& Range = m_SymbolRanges[m_ChunkSymbolRanges[j]];
+            if (Range.FirstByte / ChunkSize < ChangedChunkEnd)
+            {
+                continue;
+            }
+
+            if (_HasSymbolChanged(Range, pPreviousBuffer, pCurrentBuffer))
+            {
+                ChangedSymbolIndexes.push_back(Range.SymbolIndex);
+            }
+        }
+
+        ChangedChunkEnd = Chunk + 1;
+    }
+
+    // Return the symbol indexes in the order of the symbols of the block passed to the constructor.
+    std::sort(ChangedSymbolIndexes.begin(), ChangedSymbolIndexes.end());
+
+    return std::monostate();
+}
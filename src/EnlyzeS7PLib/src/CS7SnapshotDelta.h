@@ -0,0 +1,47 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_parser.h"
+
+// Finds the symbols whose values differ between two consecutive raw snapshots of a DB or an I/Q/M area.
+// Both snapshots are compared in fixed-size chunks first (using SSE2 if available), and only the symbols mapped to changed chunks are checked in detail.
+// GetChangedSymbols doesn't allocate any memory once ChangedSymbolIndexes has grown to the number of changed symbols.
+class CS7SnapshotDelta
+{
+public:
+    CS7SnapshotDelta(const S7Block& Block, S7Area Area);
+
+    std::variant<std::monostate, CS7PError> GetChangedSymbols(std::vector<size_t>& ChangedSymbolIndexes, const uint8_t* pPreviousBuffer, const uint8_t* pCurrentBuffer, size_t BufferSize) const;
+    size_t GetRequiredBufferSize() const { return m_RequiredBufferSize; }
+
+private:
+    static constexpr size_t ChunkSize = 16;
+
+    struct SymbolRange
+    {
+        size_t SymbolIndex;
+        uint32_t FirstByte;
+        uint32_t EndByte;
+        uint8_t FirstByteMask;
+        uint8_t LastByteMask;
+    };
+
+    // Compressed chunk -> symbol map:
+    // The symbols overlapping chunk i are m_ChunkSymbolRanges[m_ChunkStarts[i]] up to m_ChunkSymbolRanges[m_ChunkStarts[i + 1]].
+    std::vector<uint32_t> m_ChunkStarts;
+    std::vector<uint32_t> m_ChunkSymbolRanges;
+    std::vector<SymbolRange> m_SymbolRanges;
+    size_t m_RequiredBufferSize;
+
+    static bool _HasSymbolChanged(const SymbolRange& Range, const uint8_t* pPreviousBuffer, const uint8_t* pCurrentBuffer);
+};
@@ -0,0 +1,189 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+#include "CS7SymbolIndex.h"
+
+
+CS7SymbolIndex::CS7SymbolIndex(const S7DeviceSymbolInfo& DeviceSymbolInfo)
+{
+    // Sort all symbols into their address space groups (one per DB and one per I/Q/M area).
+    for (size_t BlockIndex = 0; BlockIndex < DeviceSymbolInfo.Blocks.size(); BlockIndex++)
+    {
+        const S7Block& Block = DeviceSymbolInfo.Blocks[BlockIndex];
+
+        const std::vector<S7Symbol>& Symbols = Block.GetSymbols();
+
+        for (size_t SymbolIndex = 0; SymbolIndex < Symbols.size(); SymbolIndex++)
+        {
+            const S7Address Address = Block.GetAddress(Symbols[SymbolIndex]);
+
+            Entry& NewEntry = m_Groups[{Address.Area, Address.DbNumber}].Entries.emplace_back();
+            NewEntry.BitOffset = Address.BitOffset;
+            NewEntry.EndBitOffset = Address.BitOffset + Address.BitSize;
+            NewEntry.Location = { BlockIndex, SymbolIndex };
+        }
+    }
+
+    // Sort each group by address and precompute the running maximum of end addresses.
+    for (auto& [Key, CurrentGroup] : m_Groups)
+    {
+        std::stable_sort(CurrentGroup.Entries.begin(), CurrentGroup.Entries.end(), [](const Entry& a, const Entry& b)
+        {
+            return a.BitOffset < b.BitOffset;
+        });
+
+        CurrentGroup.MaxEndBitOffsets.reserve(CurrentGroup.Entries.size());
+
+        uint32_t MaxEndBitOffset = 0;
+        for (const auto& CurrentEntry : CurrentGroup.Entries)
+        {
+            MaxEndBitOffset = std::max(MaxEndBitOffset, CurrentEntry.EndBitOffset);
+            CurrentGroup.MaxEndBitOffsets.push_back(MaxEndBitOffset);
+        }
+    }
+}
+
+std::optional<S7SymbolLocation>
+CS7SymbolIndex::_FindSymbolAtInGroup(const Group& SearchGroup, uint32_t BitOffset)
+{
+    // Entries before the first one with a maximum end address beyond BitOffset cannot cover BitOffset.
+    auto FirstIt = std::upper_bound(SearchGroup.MaxEndBitOffsets.begin(), SearchGroup.MaxEndBitOffsets.end(), BitOffset);
+    size_t First = FirstIt - SearchGroup.MaxEndBitOffsets.begin();
+
+    // Entries starting after BitOffset cannot cover it either.
+    auto LastIt = std::upper_bound(SearchGroup.Entries.begin(), SearchGroup.Entries.end(), BitOffset, [](uint32_t Value, const Entry& Candidate)
+    {
+        return Value < Candidate.BitOffset;
+    });
+    size_t Last = LastIt - SearchGroup.Entries.begin();
+
+    // Return the narrowest candidate covering BitOffset.
+    // DB symbols never overlap, so this loop usually checks a single entry.
+    // Symbol List entries may overlap, and we prefer "M200.1" over "MW200" then.
+    const Entry* pBestEntry = nullptr;
+    for (size_t i = First; i < Last; i++)
+    {
+        const Entry& Candidate = SearchGroup.Entries[i];
+        if (Candidate.EndBitOffset > BitOffset)
+        {
+            if (!pBestEntry || Candidate.EndBitOffset - Candidate.BitOffset < pBestEntry->EndBitOffset - pBestEntry->BitOffset)
+            {
+                pBestEntry = &Candidate;
+            }
+        }
+    }
+
+    if (!pBestEntry)
+    {
+        return std::nullopt;
+    }
+
+    return pBestEntry->Location;
+}
+
+const CS7SymbolIndex::Group*
+CS7SymbolIndex::_GetGroup(S7Area Area, uint16_t DbNumber) const
+{
+    // Only DBs are distinguished by their number.
+    if (Area != S7Area::DB)
+    {
+        DbNumber = 0;
+    }
+
+    const auto it = m_Groups.find({Area, DbNumber});
+    if (it == m_Groups.end())
+    {
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+std::optional<S7SymbolLocation>
+CS7SymbolIndex::FindSymbolAt(S7Area Area, uint16_t DbNumber, uint32_t BitOffset) const
+{
+    const Group* pGroup = _GetGroup(Area, DbNumber);
+    if (!pGroup)
+    {
+        return std::nullopt;
+    }
+
+    return _FindSymbolAtInGroup(*pGroup, BitOffset);
+}
+
+void
+CS7SymbolIndex::FindSymbolsAt(std::vector<std::optional<S7SymbolLocation>>& Locations, const std::vector<S7Address>& Addresses) const
+{
+    Locations.assign(Addresses.size(), std::nullopt);
+
+    // Process the queries sorted by address space, so that each group is only looked up once.
+    // The results are still returned in the order of the input addresses.
+    std::vector<size_t> Order(Addresses.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    std::sort(Order.begin(), Order.end(), [&](size_t a, size_t b)
+    {
+        const S7Address& AddressA = Addresses[a];
+        const S7Address& AddressB = Addresses[b];
+        return std::tie(AddressA.Area, AddressA.DbNumber, AddressA.BitOffset) < std::tie(AddressB.Area, AddressB.DbNumber, AddressB.BitOffset);
+    });
+
+    const Group* pGroup = nullptr;
+    std::optional<std::pair<S7Area, uint16_t>> CurrentKey;
+
+    for (size_t i : Order)
+    {
+        const S7Address& Address = Addresses[i];
+
+        if (!CurrentKey.has_value() || CurrentKey->first != Address.Area || CurrentKey->second != Address.DbNumber)
+        {
+            CurrentKey = {Address.Area, Address.DbNumber};
+            pGroup = _GetGroup(Address.Area, Address.DbNumber);
+        }
+
+        if (pGroup)
+        {
+            Locations[i] = _FindSymbolAtInGroup(*pGroup, Address.BitOffset);
+        }
+    }
+}
+
+void
+CS7SymbolIndex::FindSymbolsInRange(std::vector<S7SymbolLocation>& Locations, S7Area Area, uint16_t DbNumber, uint32_t BitOffset, uint32_t BitSize) const
+{
+    Locations.clear();
+
+    const Group* pGroup = _GetGroup(Area, DbNumber);
+    if (!pGroup || BitSize == 0)
+    {
+        return;
+    }
+
+    // Compute the end in 64 bits, so that a range reaching beyond the 32-bit address space doesn't wrap around to a small offset.
+    const uint64_t EndBitOffset = static_cast<uint64_t>(BitOffset) + BitSize;
+
+    // Same candidate window as in _FindSymbolAtInGroup, but for the range [BitOffset, EndBitOffset).
+    auto FirstIt = std::upper_bound(pGroup->MaxEndBitOffsets.begin(), pGroup->MaxEndBitOffsets.end(), BitOffset);
+    size_t First = FirstIt - pGroup->MaxEndBitOffsets.begin();
+
+    auto LastIt = std::lower_bound(pGroup->Entries.begin(), pGroup->Entries.end(), EndBitOffset, [](const Entry& Candidate, uint64_t Value)
+    {
+        return Candidate.BitOffset < Value;
+    });
+    size_t Last = LastIt - pGroup->Entries.begin();
+
+    for (size_t i = First; i < Last; i++)
+    {
+        const Entry& Candidate = pGroup->Entries[i];
+        if (Candidate.EndBitOffset > BitOffset)
+        {
+            Locations.push_back(Candidate.Location);
+        }
+    }
+}
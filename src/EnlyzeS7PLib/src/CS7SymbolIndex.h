@@ -0,0 +1,56 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "s7p_parser.h"
+
+struct S7SymbolLocation
+{
+    size_t BlockIndex;
+    size_t SymbolIndex;
+};
+
+// Address-range index over all symbols of a single device.
+// Answers which symbols cover a given address (e.g. "DB12.DBX 340.3") in O(log n) without parsing any symbol code strings.
+class CS7SymbolIndex
+{
+public:
+    explicit CS7SymbolIndex(const S7DeviceSymbolInfo& DeviceSymbolInfo);
+
+    std::optional<S7SymbolLocation> FindSymbolAt(S7Area Area, uint16_t DbNumber, uint32_t BitOffset) const;
+    void FindSymbolsAt(std::vector<std::optional<S7SymbolLocation>>& Locations, const std::vector<S7Address>& Addresses) const;
+    void FindSymbolsInRange(std::vector<S7SymbolLocation>& Locations, S7Area Area, uint16_t DbNumber, uint32_t BitOffset, uint32_t BitSize) const;
+
+private:
+    struct Entry
+    {
+        uint32_t BitOffset;
+        uint32_t EndBitOffset;
+        S7SymbolLocation Location;
+    };
+
+    struct Group
+    {
+        // Entries sorted by BitOffset.
+        std::vector<Entry> Entries;
+
+        // MaxEndBitOffsets[i] is the maximum EndBitOffset of Entries[0..i].
+        // This makes the array binary-searchable even for overlapping entries (like "MW200" and "M200.1" in the Symbol List).
+        std::vector<uint32_t> MaxEndBitOffsets;
+    };
+
+    std::map<std::pair<S7Area, uint16_t>, Group> m_Groups;
+
+    static std::optional<S7SymbolLocation> _FindSymbolAtInGroup(const Group& Group, uint32_t BitOffset);
+    const Group* _GetGroup(S7Area Area, uint16_t DbNumber) const;
+};
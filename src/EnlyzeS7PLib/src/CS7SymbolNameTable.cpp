@@ -0,0 +1,530 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <windows.h>
+
+#include "CS7SymbolNameTable.h"
+
+using namespace S7SymbolNameTableFormat;
+
+static_assert(sizeof(Header) == 32, "Name table header must not contain padding");
+static_assert(sizeof(Entry) == 20, "Name table entry must not contain padding");
+
+// Average number of keys per bucket.
+// Larger buckets save displacements, but take longer to place.
+static const size_t _KeysPerBucket = 4;
+
+// Buckets with multiple keys whose keys cannot be placed within this many displacements make the build fail.
+// With 64-bit hashes, this only happens for identical hashes of different keys.
+static const uint32_t _MaxDisplacement = 1 << 20;
+
+
+static uint64_t
+_HashStep(uint64_t Hash, uint64_t Word)
+{
+    Hash = (Hash ^ Word) * 0x9E3779B97F4A7C15;
+    return Hash ^ (Hash >> 29);
+}
+
+static uint64_t
+_HashKey(std::string_view svDeviceName, std::string_view svBlockName, std::string_view svSymbolName)
+{
+    // Hashes "device\0block\0name" 8 bytes at a time, without building that string.
+    // Symbol names are long enough that hashing them byte by byte would dominate a lookup.
+    uint64_t Hash = 0xCBF29CE484222325;
+
+    auto HashPart = [&Hash](std::string_view svPart)
+    {
+        const char* p = svPart.data();
+        size_t Remaining = svPart.size();
+
+        for (; Remaining >= sizeof(uint64_t); p += sizeof(uint64_t), Remaining -= sizeof(uint64_t))
+        {
+            uint64_t Word;
+            memcpy(&Word, p, sizeof(Word));
+            Hash = _HashStep(Hash, Word);
+        }
+
+        // The last step takes the remaining bytes and the length in its top byte, so that the part boundaries count.
+        uint64_t Word = static_cast<uint64_t>(svPart.size() & 0xFF) << 56;
+        memcpy(&Word, p, Remaining);
+        Hash = _HashStep(Hash, Word);
+    };
+
+    HashPart(svDeviceName);
+    HashPart(svBlockName);
+    HashPart(svSymbolName);
+
+    return Hash;
+}
+
+static uint64_t
+_Mix(uint64_t x)
+{
+    // Finalizer of SplitMix64, which spreads every input bit over all output bits.
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EB;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint32_t
+_Reduce(uint64_t x, uint32_t Count)
+{
+    // Maps the upper 32 bits to [0, Count) with a multiplication instead of a much slower 64-bit modulo.
+    return static_cast<uint32_t>(((x >> 32) * Count) >> 32);
+}
+
+static uint32_t
+_GetBucket(uint64_t Hash, uint32_t BucketCount)
+{
+    return _Reduce(_Mix(Hash), BucketCount);
+}
+
+static uint32_t
+_GetSlot(uint64_t Hash, uint32_t Displacement, uint32_t EntryCount)
+{
+    if (Displacement & DirectSlotFlag)
+    {
+        return Displacement & ~DirectSlotFlag;
+    }
+
+    return _Reduce(_Mix(Hash + (Displacement + 1) * 0x9E3779B97F4A7C15), EntryCount);
+}
+
+static bool
+_KeyEquals(std::string_view svKey, std::string_view svDeviceName, std::string_view svBlockName, std::string_view svSymbolName)
+{
+    if (svKey.size() != svDeviceName.size() + svBlockName.size() + svSymbolName.size() + 2)
+    {
+        return false;
+    }
+
+    const size_t BlockStart = svDeviceName.size() + 1;
+    const size_t SymbolStart = BlockStart + svBlockName.size() + 1;
+
+    return svKey.compare(0, svDeviceName.size(), svDeviceName) == 0 &&
+        svKey[svDeviceName.size()] == '\0' &&
+        svKey.compare(BlockStart, svBlockName.size(), svBlockName) == 0 &&
+        svKey[SymbolStart - 1] == '\0' &&
+        svKey.compare(SymbolStart, svSymbolName.size(), svSymbolName) == 0;
+}
+
+static uint64_t
+_GetBufferSize(uint32_t EntryCount, uint32_t BucketCount, uint32_t KeysSize)
+{
+    // Computed in 64 bits, because the header values of a loaded table can add up to more than a 32-bit size_t holds.
+    return sizeof(Header) + static_cast<uint64_t>(BucketCount) * sizeof(uint32_t) + static_cast<uint64_t>(EntryCount) * sizeof(Entry) + KeysSize;
+}
+
+
+CS7SymbolNameTable::CS7SymbolNameTable(std::vector<uint8_t> Buffer)
+    : m_Buffer(std::move(Buffer))
+{
+    m_pHeader = reinterpret_cast<const Header*>(m_Buffer.data());
+    m_pDisplacements = reinterpret_cast<const uint32_t*>(m_Buffer.data() + sizeof(Header));
+    m_pEntries = reinterpret_cast<const Entry*>(m_pDisplacements + m_pHeader->BucketCount);
+    m_pKeys = reinterpret_cast<const char*>(m_pEntries + m_pHeader->EntryCount);
+}
+
+std::variant<std::unique_ptr<CS7SymbolNameTable>, CS7PError>
+CS7SymbolNameTable::Build(const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos)
+{
+    struct Key
+    {
+        uint64_t Hash;
+        uint32_t Bucket;
+        S7SymbolNameLocation Location;
+    };
+
+    // Hash all keys.
+    std::vector<Key> Keys;
+    for (size_t DeviceIndex = 0; DeviceIndex < DeviceSymbolInfos.size(); DeviceIndex++)
+    {
+        const S7DeviceSymbolInfo& DeviceSymbolInfo = DeviceSymbolInfos[DeviceIndex];
+
+        for (size_t BlockIndex = 0; BlockIndex < DeviceSymbolInfo.Blocks.size(); BlockIndex++)
+        {
+            const S7Block& Block = DeviceSymbolInfo.Blocks[BlockIndex];
+            const std::vector<S7Symbol>& Symbols = Block.GetSymbols();
+
+            for (size_t SymbolIndex = 0; SymbolIndex < Symbols.size(); SymbolIndex++)
+            {
+                const uint64_t Hash = _HashKey(DeviceSymbolInfo.strName, Block.strName, Symbols[SymbolIndex].strName);
+                Keys.push_back({ Hash, 0, { DeviceIndex, BlockIndex, SymbolIndex } });
+            }
+        }
+    }
+
+    auto GetKeyParts = [&](const S7SymbolNameLocation& Location)
+    {
+        const S7DeviceSymbolInfo& DeviceSymbolInfo = DeviceSymbolInfos[Location.DeviceIndex];
+        const S7Block& Block = DeviceSymbolInfo.Blocks[Location.BlockIndex];
+        const S7Symbol& Symbol = Block.GetSymbols()[Location.SymbolIndex];
+        return std::make_tuple(std::string_view(DeviceSymbolInfo.strName), std::string_view(Block.strName), std::string_view(Symbol.strName));
+    };
+
+    // Remove duplicate keys, keeping the first one in parse order.
+    // The stable sort keeps keys with equal hashes in parse order.
+    std::stable_sort(Keys.begin(), Keys.end(), [](const Key& a, const Key& b) { return a.Hash < b.Hash; });
+
+    std::vector<Key> UniqueKeys;
+    UniqueKeys.reserve(Keys.size());
+
+    for (size_t i = 0; i < Keys.size(); i++)
+    {
+        bool bDuplicate = false;
+
+        for (size_t j = UniqueKeys.size(); j > 0 && UniqueKeys[j - 1].Hash == Keys[i].Hash; j--)
+        {
+            if (GetKeyParts(UniqueKeys[j - 1].Location) == GetKeyParts(Keys[i].Location))
+            {
+                bDuplicate = true;
+                break;
+            }
+        }
+
+        if (!bDuplicate)
+        {
+            UniqueKeys.push_back(Keys[i]);
+        }
+    }
+
+    Keys.clear();
+    Keys.shrink_to_fit();
+
+    if (UniqueKeys.size() >= DirectSlotFlag)
+    {
+        return CS7PError(L"Too many symbols for a name table");
+    }
+
+    const uint32_t EntryCount = static_cast<uint32_t>(UniqueKeys.size());
+    const uint32_t BucketCount = static_cast<uint32_t>(std::max<size_t>(1, (UniqueKeys.size() + _KeysPerBucket - 1) / _KeysPerBucket));
+
+    // Group the keys by bucket.
+    for (Key& CurrentKey : UniqueKeys)
+    {
+        CurrentKey.Bucket = _GetBucket(CurrentKey.Hash, BucketCount);
+    }
+
+    std::sort(UniqueKeys.begin(), UniqueKeys.end(), [](const Key& a, const Key& b) { return a.Bucket < b.Bucket; });
+
+    std::vector<std::pair<size_t, size_t>> BucketRanges(BucketCount, { 0, 0 });
+    for (size_t i = 0; i < UniqueKeys.size(); i++)
+    {
+        auto& Range = BucketRanges[UniqueKeys[i].Bucket];
+        if (Range.second == 0)
+        {
+            Range.first = i;
+        }
+
+        Range.second++;
+    }
+
+    // Place the largest buckets first, while most slots are still free.
+    std::vector<uint32_t> BucketOrder(BucketCount);
+    std::iota(BucketOrder.begin(), BucketOrder.end(), 0);
+    std::stable_sort(BucketOrder.begin(), BucketOrder.end(), [&](uint32_t a, uint32_t b)
+    {
+        return BucketRanges[a].second > BucketRanges[b].second;
+    });
+
+    std::vector<uint32_t> Displacements(BucketCount, 0);
+    std::vector<uint32_t> SlotKeys(EntryCount, UINT32_MAX);
+    std::vector<uint32_t> CandidateSlots;
+    uint32_t NextFreeSlot = 0;
+
+    for (uint32_t Bucket : BucketOrder)
+    {
+        const auto [First, Count] = BucketRanges[Bucket];
+        if (Count == 0)
+        {
+            break;
+        }
+
+        if (Count == 1)
+        {
+            // Single keys go to any free slot directly, which avoids searching for the last few free slots.
+            while (SlotKeys[NextFreeSlot] != UINT32_MAX)
+            {
+                NextFreeSlot++;
+            }
+
+            SlotKeys[NextFreeSlot] = static_cast<uint32_t>(First);
+            Displacements[Bucket] = NextFreeSlot | DirectSlotFlag;
+            continue;
+        }
+
+        bool bPlaced = false;
+
+        for (uint32_t Displacement = 0; Displacement < _MaxDisplacement && !bPlaced; Displacement++)
+        {
+            CandidateSlots.clear();
+
+            for (size_t i = First; i < First + Count; i++)
+            {
+                const uint32_t Slot = _GetSlot(UniqueKeys[i].Hash, Displacement, EntryCount);
+                if (SlotKeys[Slot] != UINT32_MAX || std::find(CandidateSlots.begin(), CandidateSlots.end(), Slot) != CandidateSlots.end())
+                {
+                    break;
+                }
+
+                CandidateSlots.push_back(Slot);
+            }
+
+            if (CandidateSlots.size() == Count)
+            {
+                for (size_t i = 0; i < Count; i++)
+                {
+                    SlotKeys[CandidateSlots[i]] = static_cast<uint32_t>(First + i);
+                }
+
+                Displacements[Bucket] = Displacement;
+                bPlaced = true;
+            }
+        }
+
+        if (!bPlaced)
+        {
+            return CS7PError(L"Could not find a perfect hash for " + std::to_wstring(EntryCount) + L" symbol names");
+        }
+    }
+
+    // Lay out the table and copy the keys into their heap in slot order, so that consecutive slots are close in memory.
+    size_t KeysSize = 0;
+    for (const Key& CurrentKey : UniqueKeys)
+    {
+        const auto [svDeviceName, svBlockName, svSymbolName] = GetKeyParts(CurrentKey.Location);
+        KeysSize += svDeviceName.size() + svBlockName.size() + svSymbolName.size() + 2;
+    }
+
+    if (KeysSize > UINT32_MAX)
+    {
+        return CS7PError(L"Symbol names exceed the maximum size of a name table");
+    }
+
+    const uint64_t BufferSize = _GetBufferSize(EntryCount, BucketCount, static_cast<uint32_t>(KeysSize));
+    if (BufferSize > SIZE_MAX)
+    {
+        return CS7PError(L"Symbol names exceed the maximum size of a name table");
+    }
+
+    std::vector<uint8_t> Buffer(static_cast<size_t>(BufferSize));
+
+    Header TableHeader = {};
+    memcpy(TableHeader.Magic, Magic, sizeof(Magic));
+    TableHeader.Version = Version;
+    TableHeader.EntryCount = EntryCount;
+    TableHeader.BucketCount = BucketCount;
+    TableHeader.KeysSize = static_cast<uint32_t>(KeysSize);
+    TableHeader.Fingerprint = GetFingerprint(DeviceSymbolInfos);
+
+    uint8_t* p = Buffer.data();
+    memcpy(p, &TableHeader, sizeof(TableHeader));
+    p += sizeof(TableHeader);
+    memcpy(p, Displacements.data(), Displacements.size() * sizeof(uint32_t));
+    p += Displacements.size() * sizeof(uint32_t);
+
+    Entry* pEntries = reinterpret_cast<Entry*>(p);
+    char* pKeys = reinterpret_cast<char*>(pEntries + EntryCount);
+    uint32_t KeyOffset = 0;
+
+    for (uint32_t Slot = 0; Slot < EntryCount; Slot++)
+    {
+        const Key& CurrentKey = UniqueKeys[SlotKeys[Slot]];
+        const auto [svDeviceName, svBlockName, svSymbolName] = GetKeyParts(CurrentKey.Location);
+
+        Entry& CurrentEntry = pEntries[Slot];
+        CurrentEntry.KeyOffset = KeyOffset;
+        CurrentEntry.KeyLength = static_cast<uint32_t>(svDeviceName.size() + svBlockName.size() + svSymbolName.size() + 2);
+        CurrentEntry.DeviceIndex = static_cast<uint32_t>(CurrentKey.Location.DeviceIndex);
+        CurrentEntry.BlockIndex = static_cast<uint32_t>(CurrentKey.Location.BlockIndex);
+        CurrentEntry.SymbolIndex = static_cast<uint32_t>(CurrentKey.Location.SymbolIndex);
+
+        char* pKey = pKeys + KeyOffset;
+        memcpy(pKey, svDeviceName.data(), svDeviceName.size());
+        pKey += svDeviceName.size();
+        *pKey++ = '\0';
+        memcpy(pKey, svBlockName.data(), svBlockName.size());
+        pKey += svBlockName.size();
+        *pKey++ = '\0';
+        memcpy(pKey, svSymbolName.data(), svSymbolName.size());
+
+        KeyOffset += CurrentEntry.KeyLength;
+    }
+
+    return std::unique_ptr<CS7SymbolNameTable>(new CS7SymbolNameTable(std::move(Buffer)));
+}
+
+std::optional<S7SymbolNameLocation>
+CS7SymbolNameTable::Find(std::string_view svDeviceName, std::string_view svBlockName, std::string_view svSymbolName) const
+{
+    if (m_pHeader->EntryCount == 0)
+    {
+        return std::nullopt;
+    }
+
+    const uint64_t Hash = _HashKey(svDeviceName, svBlockName, svSymbolName);
+    const uint32_t Displacement = m_pDisplacements[_GetBucket(Hash, m_pHeader->BucketCount)];
+    const Entry& CurrentEntry = m_pEntries[_GetSlot(Hash, Displacement, m_pHeader->EntryCount)];
+
+    // Every key maps to some slot, so compare it to rule out keys that are not in the table.
+    const std::string_view svKey(m_pKeys + CurrentEntry.KeyOffset, CurrentEntry.KeyLength);
+    if (!_KeyEquals(svKey, svDeviceName, svBlockName, svSymbolName))
+    {
+        return std::nullopt;
+    }
+
+    return S7SymbolNameLocation{ CurrentEntry.DeviceIndex, CurrentEntry.BlockIndex, CurrentEntry.SymbolIndex };
+}
+
+uint64_t
+CS7SymbolNameTable::GetFingerprint(const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos)
+{
+    // FNV-1a over all names, each followed by a separator, so that moving a character between names changes the result.
+    uint64_t Hash = 0xCBF29CE484222325;
+
+    auto HashName = [&Hash](std::string_view svName)
+    {
+        for (char c : svName)
+        {
+            Hash = (Hash ^ static_cast<uint8_t>(c)) * 0x100000001B3;
+        }
+
+        Hash *= 0x100000001B3;
+    };
+
+    for (const S7DeviceSymbolInfo& DeviceSymbolInfo : DeviceSymbolInfos)
+    {
+        HashName(DeviceSymbolInfo.strName);
+
+        for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+        {
+            HashName(Block.strName);
+
+            for (const S7Symbol& Symbol : Block.GetSymbols())
+            {
+                HashName(Symbol.strName);
+            }
+
+            // Marks the end of the block, so that symbols cannot move between blocks unnoticed.
+            Hash = (Hash ^ 0xFF) * 0x100000001B3;
+        }
+
+        Hash = (Hash ^ 0xFE) * 0x100000001B3;
+    }
+
+    return Hash;
+}
+
+std::variant<std::unique_ptr<CS7SymbolNameTable>, CS7PError>
+CS7SymbolNameTable::Load(const std::wstring& wstrFilePath, const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos)
+{
+    HANDLE hFile = CreateFileW(wstrFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not open " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(hFile, &FileSize))
+    {
+        CloseHandle(hFile);
+        return CS7PError(L"Could not get the size of " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    if (FileSize.QuadPart < static_cast<long long>(sizeof(Header)) || FileSize.QuadPart > UINT32_MAX)
+    {
+        CloseHandle(hFile);
+        return CS7PError(L"Invalid name table file size of " + wstrFilePath);
+    }
+
+    std::vector<uint8_t> Buffer(static_cast<size_t>(FileSize.QuadPart));
+    DWORD BytesRead;
+    const BOOL bRead = ReadFile(hFile, Buffer.data(), static_cast<DWORD>(Buffer.size()), &BytesRead, nullptr);
+    const DWORD dwReadError = GetLastError();
+    CloseHandle(hFile);
+    if (!bRead || BytesRead != Buffer.size())
+    {
+        return CS7PError(L"Could not read " + wstrFilePath + L", error " + std::to_wstring(dwReadError));
+    }
+
+    // Validate everything a lookup relies on, so that Find never has to check anything.
+    Header TableHeader;
+    memcpy(&TableHeader, Buffer.data(), sizeof(TableHeader));
+
+    if (memcmp(TableHeader.Magic, Magic, sizeof(Magic)) != 0 || TableHeader.Version != Version)
+    {
+        return CS7PError(wstrFilePath + L": Not a name table of version " + std::to_wstring(Version));
+    }
+
+    if (TableHeader.BucketCount == 0 || TableHeader.EntryCount >= DirectSlotFlag ||
+        _GetBufferSize(TableHeader.EntryCount, TableHeader.BucketCount, TableHeader.KeysSize) != Buffer.size())
+    {
+        return CS7PError(wstrFilePath + L": Invalid name table size");
+    }
+
+    if (TableHeader.Fingerprint != GetFingerprint(DeviceSymbolInfos))
+    {
+        return CS7PError(wstrFilePath + L": Name table was built from a different parse result");
+    }
+
+    auto pTable = std::unique_ptr<CS7SymbolNameTable>(new CS7SymbolNameTable(std::move(Buffer)));
+
+    for (uint32_t i = 0; i < TableHeader.BucketCount; i++)
+    {
+        const uint32_t Displacement = pTable->m_pDisplacements[i];
+        if ((Displacement & DirectSlotFlag) && (Displacement & ~DirectSlotFlag) >= TableHeader.EntryCount)
+        {
+            return CS7PError(wstrFilePath + L": Invalid displacement of bucket " + std::to_wstring(i));
+        }
+    }
+
+    for (uint32_t i = 0; i < TableHeader.EntryCount; i++)
+    {
+        const Entry& CurrentEntry = pTable->m_pEntries[i];
+        if (static_cast<uint64_t>(CurrentEntry.KeyOffset) + CurrentEntry.KeyLength > TableHeader.KeysSize)
+        {
+            return CS7PError(wstrFilePath + L": Invalid key of entry " + std::to_wstring(i));
+        }
+
+        // A matching fingerprint doesn't prove that the file is intact, so check the location as well.
+        if (CurrentEntry.DeviceIndex >= DeviceSymbolInfos.size() ||
+            CurrentEntry.BlockIndex >= DeviceSymbolInfos[CurrentEntry.DeviceIndex].Blocks.size() ||
+            CurrentEntry.SymbolIndex >= DeviceSymbolInfos[CurrentEntry.DeviceIndex].Blocks[CurrentEntry.BlockIndex].GetSymbols().size())
+        {
+            return CS7PError(wstrFilePath + L": Invalid location of entry " + std::to_wstring(i));
+        }
+    }
+
+    return pTable;
+}
+
+std::variant<std::monostate, CS7PError>
+CS7SymbolNameTable::Save(const std::wstring& wstrFilePath) const
+{
+    HANDLE hFile = CreateFileW(wstrFilePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not create " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    DWORD BytesWritten;
+    const BOOL bWritten = WriteFile(hFile, m_Buffer.data(), static_cast<DWORD>(m_Buffer.size()), &BytesWritten, nullptr);
+    const DWORD dwWriteError = GetLastError();
+    CloseHandle(hFile);
+    if (!bWritten || BytesWritten != m_Buffer.size())
+    {
+        return CS7PError(L"Could not write " + wstrFilePath + L", error " + std::to_wstring(dwWriteError));
+    }
+
+    return std::monostate();
+}
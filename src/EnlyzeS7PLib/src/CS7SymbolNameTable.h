@@ -0,0 +1,94 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_parser.h"
+
+// On-disk layout of a name table, which is also its in-memory layout.
+// All integers are little-endian, and the sections follow each other in the order of the header fields.
+namespace S7SymbolNameTableFormat
+{
+    const char Magic[8] = { 'S', '7', 'P', 'N', 'A', 'M', 'E', 'S' };
+    const uint32_t Version = 2;
+
+    // A displacement with this bit set directly holds the slot of the only key in its bucket.
+    const uint32_t DirectSlotFlag = 0x80000000;
+
+    struct Header
+    {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t EntryCount;
+        uint32_t BucketCount;
+        uint32_t KeysSize;
+
+        // CS7SymbolNameTable::GetFingerprint of the parse result the table was built from.
+        uint64_t Fingerprint;
+    };
+
+    struct Entry
+    {
+        // Keys are stored as "device\0block\0name" in the key heap.
+        uint32_t KeyOffset;
+        uint32_t KeyLength;
+        uint32_t DeviceIndex;
+        uint32_t BlockIndex;
+        uint32_t SymbolIndex;
+    };
+}
+
+struct S7SymbolNameLocation
+{
+    size_t DeviceIndex;
+    size_t BlockIndex;
+    size_t SymbolIndex;
+};
+
+// Immutable lookup table from (device name, block name, symbol name) to the location of a symbol in a ParseS7P result,
+// e.g. ("PLC1", "DB12 (Motors)", "M1.Speed") or ("PLC1", "Symbol List", "Motor1").
+//
+// It uses a minimal perfect hash (hash and displace): Every key hashes to a bucket, and every bucket stores a displacement
+// that sends its keys to distinct slots. A lookup hashes the key once and compares a single slot.
+// The entire table is one buffer, which is written and read as is.
+class CS7SymbolNameTable
+{
+public:
+    CS7SymbolNameTable(const CS7SymbolNameTable&) = delete;
+    CS7SymbolNameTable& operator=(const CS7SymbolNameTable&) = delete;
+
+    // If a key occurs more than once, the first symbol in parse order wins.
+    static std::variant<std::unique_ptr<CS7SymbolNameTable>, CS7PError> Build(const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos);
+
+    // Hash over the names of all devices, blocks and symbols in parse order, which is everything the locations of a table depend on.
+    static uint64_t GetFingerprint(const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos);
+
+    // Loads a table saved for DeviceSymbolInfos.
+    // Fails if the table was built from a different parse result, so that every location returned by Find is valid for DeviceSymbolInfos.
+    static std::variant<std::unique_ptr<CS7SymbolNameTable>, CS7PError> Load(const std::wstring& wstrFilePath, const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos);
+
+    std::optional<S7SymbolNameLocation> Find(std::string_view svDeviceName, std::string_view svBlockName, std::string_view svSymbolName) const;
+    size_t GetSize() const { return m_pHeader->EntryCount; }
+    std::variant<std::monostate, CS7PError> Save(const std::wstring& wstrFilePath) const;
+
+private:
+    std::vector<uint8_t> m_Buffer;
+    const S7SymbolNameTableFormat::Header* m_pHeader;
+    const uint32_t* m_pDisplacements;
+    const S7SymbolNameTableFormat::Entry* m_pEntries;
+    const char* m_pKeys;
+
+    explicit CS7SymbolNameTable(std::vector<uint8_t> Buffer);
+};
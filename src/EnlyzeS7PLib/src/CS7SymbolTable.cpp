@@ -0,0 +1,411 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <immintrin.h>
+#include <intrin.h>
+
+#include "CS7SymbolTable.h"
+
+// See s7p_mc5code_scanner.cpp for why the vector kernels are compiled with per-function target attributes.
+#define SSE2_FUNCTION __attribute__((target("sse2")))
+
+// Number of rows compared at once by the kernels below.
+static const uint32_t _RowsPerMask = 16;
+
+// Kernels comparing a column chunk of _RowsPerMask values to a single value.
+// Bit i of the returned mask is set if p[i] equals Value.
+struct FilterKernels
+{
+    uint32_t (*pfnMatch8)(const uint8_t* p, uint8_t Value);
+    uint32_t (*pfnMatch16)(const uint16_t* p, uint16_t Value);
+    uint32_t (*pfnMatch32)(const uint32_t* p, uint32_t Value);
+};
+
+
+static unsigned long
+_FindFirstSetBit(uint32_t Mask)
+{
+    unsigned long Index;
+    _BitScanForward(&Index, Mask);
+    return Index;
+}
+
+//
+// Scalar fallback
+//
+template<class T> static uint32_t
+_MatchScalar(const T* p, uint32_t Count, T Value)
+{
+    uint32_t Mask = 0;
+
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        if (p[i] == Value)
+        {
+            Mask |= 1u << i;
+        }
+    }
+
+    return Mask;
+}
+
+static uint32_t
+_Match8Scalar(const uint8_t* p, uint8_t Value)
+{
+    return _MatchScalar(p, _RowsPerMask, Value);
+}
+
+static uint32_t
+_Match16Scalar(const uint16_t* p, uint16_t Value)
+{
+    return _MatchScalar(p, _RowsPerMask, Value);
+}
+
+static uint32_t
+_Match32Scalar(const uint32_t* p, uint32_t Value)
+{
+    return _MatchScalar(p, _RowsPerMask, Value);
+}
+
+//
+// SSE2 kernels
+//
+// Wider comparison results are narrowed to one byte per row with signed saturation, which keeps all-ones lanes all-ones.
+//
+SSE2_FUNCTION static uint32_t
+_Match8Sse2(const uint8_t* p, uint8_t Value)
+{
+    const __m128i Values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(Values, _mm_set1_epi8(static_cast<char>(Value)))));
+}
+
+SSE2_FUNCTION static uint32_t
+_Match16Sse2(const uint16_t* p, uint16_t Value)
+{
+    const __m128i Needle = _mm_set1_epi16(static_cast<short>(Value));
+    const __m128i Low = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), Needle);
+    const __m128i High = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8)), Needle);
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(Low, High)));
+}
+
+SSE2_FUNCTION static uint32_t
+_Match32Sse2(const uint32_t* p, uint32_t Value)
+{
+    const __m128i Needle = _mm_set1_epi32(static_cast<int>(Value));
+    const __m128i* pValues = reinterpret_cast<const __m128i*>(p);
+    const __m128i Match0 = _mm_cmpeq_epi32(_mm_loadu_si128(pValues), Needle);
+    const __m128i Match1 = _mm_cmpeq_epi32(_mm_loadu_si128(pValues + 1), Needle);
+    const __m128i Match2 = _mm_cmpeq_epi32(_mm_loadu_si128(pValues + 2), Needle);
+    const __m128i Match3 = _mm_cmpeq_epi32(_mm_loadu_si128(pValues + 3), Needle);
+    const __m128i Low = _mm_packs_epi32(Match0, Match1);
+    const __m128i High = _mm_packs_epi32(Match2, Match3);
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(Low, High)));
+}
+
+//
+// Runtime dispatch
+//
+static FilterKernels
+_SelectKernels()
+{
+    int CpuInfo[4];
+    __cpuid(CpuInfo, 1);
+
+    if (CpuInfo[3] & (1 << 26))
+    {
+        return { _Match8Sse2, _Match16Sse2, _Match32Sse2 };
+    }
+
+    return { _Match8Scalar, _Match16Scalar, _Match32Scalar };
+}
+
+static const FilterKernels _Kernels = _SelectKernels();
+
+
+std::variant<std::unique_ptr<CS7SymbolTable>, CS7PError>
+CS7SymbolTable::Build(const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos)
+{
+    auto pTable = std::unique_ptr<CS7SymbolTable>(new CS7SymbolTable());
+
+    size_t RowCount = 0;
+    size_t BlockCount = 0;
+    for (const S7DeviceSymbolInfo& DeviceSymbolInfo : DeviceSymbolInfos)
+    {
+        BlockCount += DeviceSymbolInfo.Blocks.size();
+
+        for (const S7Block& SourceBlock : DeviceSymbolInfo.Blocks)
+        {
+            RowCount += SourceBlock.GetSymbols().size();
+        }
+    }
+
+    if (RowCount >= UINT32_MAX || BlockCount >= UINT32_MAX)
+    {
+        return CS7PError(L"Too many symbols for a symbol table");
+    }
+
+    pTable->m_DeviceIds.reserve(RowCount);
+    pTable->m_BlockIds.reserve(RowCount);
+    pTable->m_DatatypeIds.reserve(RowCount);
+    pTable->m_Areas.reserve(RowCount);
+    pTable->m_DbNumbers.reserve(RowCount);
+    pTable->m_BitOffsets.reserve(RowCount);
+    pTable->m_BitSizes.reserve(RowCount);
+    pTable->m_ElementCounts.reserve(RowCount);
+    pTable->m_Blocks.reserve(BlockCount);
+    pTable->m_Devices.reserve(DeviceSymbolInfos.size());
+
+    for (StringColumn* pColumn : { &pTable->m_Names, &pTable->m_Comments })
+    {
+        pColumn->Offsets.reserve(RowCount);
+        pColumn->Lengths.reserve(RowCount);
+    }
+
+    auto AppendString = [](StringColumn& Column, const std::string& str)
+    {
+        if (Column.strHeap.size() + str.size() > UINT32_MAX)
+        {
+            return false;
+        }
+
+        Column.Offsets.push_back(static_cast<uint32_t>(Column.strHeap.size()));
+        Column.Lengths.push_back(static_cast<uint32_t>(str.size()));
+        Column.strHeap += str;
+        return true;
+    };
+
+    for (const S7DeviceSymbolInfo& DeviceSymbolInfo : DeviceSymbolInfos)
+    {
+        const uint32_t DeviceId = static_cast<uint32_t>(pTable->m_Devices.size());
+
+        Device& NewDevice = pTable->m_Devices.emplace_back();
+        NewDevice.strName = DeviceSymbolInfo.strName;
+        NewDevice.StringEncoding = DeviceSymbolInfo.StringEncoding;
+        NewDevice.FirstBlockId = static_cast<uint32_t>(pTable->m_Blocks.size());
+        NewDevice.BlockCount = static_cast<uint32_t>(DeviceSymbolInfo.Blocks.size());
+        NewDevice.DbNamesMap = DeviceSymbolInfo.DbNamesMap;
+        NewDevice.Warnings = DeviceSymbolInfo.Warnings;
+
+        for (const S7Block& SourceBlock : DeviceSymbolInfo.Blocks)
+        {
+            const uint32_t BlockId = static_cast<uint32_t>(pTable->m_Blocks.size());
+            const std::vector<S7Symbol>& Symbols = SourceBlock.GetSymbols();
+
+            Block& NewBlock = pTable->m_Blocks.emplace_back();
+            NewBlock.strName = SourceBlock.strName;
+            NewBlock.DbNumber = SourceBlock.DbNumber;
+            NewBlock.FirstRow = static_cast<uint32_t>(pTable->m_DeviceIds.size());
+            NewBlock.RowCount = static_cast<uint32_t>(Symbols.size());
+
+            for (const S7Symbol& Symbol : Symbols)
+            {
+                // Dictionary-encode the datatype.
+                auto [DatatypeIt, bInserted] = pTable->m_DatatypeIdMap.try_emplace(Symbol.strDatatype, static_cast<uint32_t>(pTable->m_Datatypes.size()));
+                if (bInserted)
+                {
+                    pTable->m_Datatypes.push_back(Symbol.strDatatype);
+                }
+
+                const S7Address Address = SourceBlock.GetAddress(Symbol);
+
+                pTable->m_DeviceIds.push_back(DeviceId);
+                pTable->m_BlockIds.push_back(BlockId);
+                pTable->m_DatatypeIds.push_back(DatatypeIt->second);
+                pTable->m_Areas.push_back(Address.Area);
+                pTable->m_DbNumbers.push_back(Address.DbNumber);
+                pTable->m_BitOffsets.push_back(Address.BitOffset);
+                pTable->m_BitSizes.push_back(Address.BitSize);
+                pTable->m_ElementCounts.push_back(Address.ElementCount);
+
+                if (!Symbol.strRawCode.empty())
+                {
+                    pTable->m_RawCodes.emplace(static_cast<uint32_t>(pTable->m_DeviceIds.size() - 1), Symbol.strRawCode);
+                }
+
+                if (!AppendString(pTable->m_Names, Symbol.strName) || !AppendString(pTable->m_Comments, Symbol.strComment))
+                {
+                    return CS7PError(L"Symbol names or comments exceed the maximum size of a symbol table");
+                }
+            }
+        }
+    }
+
+    return pTable;
+}
+
+std::optional<uint32_t>
+CS7SymbolTable::FindDatatypeId(std::string_view svDatatype) const
+{
+    auto it = m_DatatypeIdMap.find(svDatatype);
+    if (it == m_DatatypeIdMap.end())
+    {
+        return std::nullopt;
+    }
+
+    return it->second;
+}
+
+S7Address
+CS7SymbolTable::GetAddress(uint32_t Row) const
+{
+    S7Address Address;
+    Address.Area = m_Areas[Row];
+    Address.DbNumber = m_DbNumbers[Row];
+    Address.BitOffset = m_BitOffsets[Row];
+    Address.BitSize = m_BitSizes[Row];
+    Address.ElementCount = m_ElementCounts[Row];
+    return Address;
+}
+
+std::string
+CS7SymbolTable::GetCode(uint32_t Row) const
+{
+    auto it = m_RawCodes.find(Row);
+    if (it != m_RawCodes.end())
+    {
+        return it->second;
+    }
+
+    return GetAddress(Row).AsString();
+}
+
+void
+CS7SymbolTable::Select(std::vector<uint32_t>& Rows, const S7SymbolFilter& Filter) const
+{
+    Rows.clear();
+
+    // Rows of a device or block are contiguous, so these filters only narrow down the range of rows to scan.
+    uint32_t FirstRow = 0;
+    uint32_t EndRow = static_cast<uint32_t>(GetRowCount());
+
+    if (Filter.DeviceId)
+    {
+        if (*Filter.DeviceId >= m_Devices.size())
+        {
+            return;
+        }
+
+        const Device& FilterDevice = m_Devices[*Filter.DeviceId];
+        if (FilterDevice.BlockCount == 0)
+        {
+            return;
+        }
+
+        const Block& DeviceFirstBlock = m_Blocks[FilterDevice.FirstBlockId];
+        const Block& DeviceLastBlock = m_Blocks[FilterDevice.FirstBlockId + FilterDevice.BlockCount - 1];
+        FirstRow = std::max(FirstRow, DeviceFirstBlock.FirstRow);
+        EndRow = std::min(EndRow, DeviceLastBlock.FirstRow + DeviceLastBlock.RowCount);
+    }
+
+    if (Filter.BlockId)
+    {
+        if (*Filter.BlockId >= m_Blocks.size())
+        {
+            return;
+        }
+
+        const Block& FilterBlock = m_Blocks[*Filter.BlockId];
+        FirstRow = std::max(FirstRow, FilterBlock.FirstRow);
+        EndRow = std::min(EndRow, FilterBlock.FirstRow + FilterBlock.RowCount);
+    }
+
+    // Compare the remaining filters chunk by chunk, and skip the other columns of a chunk as soon as no row is left.
+    // The last chunk may be shorter and is compared by the scalar kernels.
+    const uint8_t* pAreas = reinterpret_cast<const uint8_t*>(m_Areas.data());
+
+    for (uint32_t ChunkRow = FirstRow; ChunkRow < EndRow; ChunkRow += _RowsPerMask)
+    {
+        const uint32_t Count = std::min(_RowsPerMask, EndRow - ChunkRow);
+        const bool bFullChunk = (Count == _RowsPerMask);
+        uint32_t Mask = (1u << Count) - 1;
+
+        if (Mask && Filter.Area)
+        {
+            const uint8_t Value = static_cast<uint8_t>(*Filter.Area);
+            Mask &= bFullChunk ? _Kernels.pfnMatch8(pAreas + ChunkRow, Value) : _MatchScalar(pAreas + ChunkRow, Count, Value);
+        }
+
+        if (Mask && Filter.DbNumber)
+        {
+            const uint16_t* p = m_DbNumbers.data() + ChunkRow;
+            Mask &= bFullChunk ? _Kernels.pfnMatch16(p, *Filter.DbNumber) : _MatchScalar(p, Count, *Filter.DbNumber);
+        }
+
+        if (Mask && Filter.DatatypeId)
+        {
+            const uint32_t* p = m_DatatypeIds.data() + ChunkRow;
+            Mask &= bFullChunk ? _Kernels.pfnMatch32(p, *Filter.DatatypeId) : _MatchScalar(p, Count, *Filter.DatatypeId);
+        }
+
+        if (Mask && Filter.bHasComment)
+        {
+            const uint32_t* p = m_Comments.Lengths.data() + ChunkRow;
+            const uint32_t EmptyMask = bFullChunk ? _Kernels.pfnMatch32(p, 0) : _MatchScalar(p, Count, 0u);
+            Mask &= *Filter.bHasComment ? ~EmptyMask : EmptyMask;
+        }
+
+        while (Mask)
+        {
+            Rows.push_back(ChunkRow + _FindFirstSetBit(Mask));
+            Mask &= Mask - 1;
+        }
+    }
+}
+
+S7DeviceSymbolInfo
+CS7SymbolTable::ToDeviceSymbolInfo(uint32_t DeviceId) const
+{
+    const Device& SourceDevice = m_Devices[DeviceId];
+
+    S7DeviceSymbolInfo DeviceSymbolInfo;
+    DeviceSymbolInfo.strName = SourceDevice.strName;
+    DeviceSymbolInfo.StringEncoding = SourceDevice.StringEncoding;
+    DeviceSymbolInfo.DbNamesMap = SourceDevice.DbNamesMap;
+    DeviceSymbolInfo.Warnings = SourceDevice.Warnings;
+    DeviceSymbolInfo.Blocks.reserve(SourceDevice.BlockCount);
+
+    for (uint32_t BlockId = SourceDevice.FirstBlockId; BlockId < SourceDevice.FirstBlockId + SourceDevice.BlockCount; BlockId++)
+    {
+        const Block& SourceBlock = m_Blocks[BlockId];
+
+        S7Block& NewBlock = DeviceSymbolInfo.Blocks.emplace_back();
+        NewBlock.strName = SourceBlock.strName;
+        NewBlock.DbNumber = SourceBlock.DbNumber;
+        NewBlock.Symbols.reserve(SourceBlock.RowCount);
+
+        for (uint32_t Row = SourceBlock.FirstRow; Row < SourceBlock.FirstRow + SourceBlock.RowCount; Row++)
+        {
+            S7Symbol& NewSymbol = NewBlock.Symbols.emplace_back();
+            NewSymbol.strName = GetName(Row);
+            NewSymbol.strDatatype = GetDatatype(Row);
+            NewSymbol.strComment = GetComment(Row);
+            NewSymbol.Address = GetAddress(Row);
+
+            auto RawCodeIt = m_RawCodes.find(Row);
+            if (RawCodeIt != m_RawCodes.end())
+            {
+                NewSymbol.strRawCode = RawCodeIt->second;
+            }
+        }
+    }
+
+    return DeviceSymbolInfo;
+}
+
+std::vector<S7DeviceSymbolInfo>
+CS7SymbolTable::ToDeviceSymbolInfos() const
+{
+    std::vector<S7DeviceSymbolInfo> DeviceSymbolInfos;
+    DeviceSymbolInfos.reserve(m_Devices.size());
+
+    for (uint32_t DeviceId = 0; DeviceId < m_Devices.size(); DeviceId++)
+    {
+        DeviceSymbolInfos.push_back(ToDeviceSymbolInfo(DeviceId));
+    }
+
+    return DeviceSymbolInfos;
+}
@@ -0,0 +1,129 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_parser.h"
+
+// Predicate for CS7SymbolTable::Select.
+// Unset fields match every symbol, and a symbol has to match all set fields.
+struct S7SymbolFilter
+{
+    std::optional<uint32_t> DeviceId;
+    std::optional<uint32_t> BlockId;
+    std::optional<uint32_t> DatatypeId;
+    std::optional<S7Area> Area;
+    std::optional<uint16_t> DbNumber;
+    std::optional<bool> bHasComment;
+};
+
+// Column-oriented copy of a ParseS7P result, with one row per symbol.
+//
+// Every attribute is stored in its own contiguous column: Device, block and datatype are stored as IDs,
+// the address as its numeric fields, and names and comments as offset and length into a string heap each.
+// Filters over a single attribute (e.g. "all REAL symbols" or "all symbols in area M") therefore only touch
+// the columns they need, and Select compares 16 rows at once if the CPU supports SSE2.
+//
+// Rows are ordered by device, then block, then symbol, just like in the S7DeviceSymbolInfo structures.
+// Row IDs, block IDs and device IDs are indexes in that order.
+class CS7SymbolTable
+{
+public:
+    CS7SymbolTable(const CS7SymbolTable&) = delete;
+    CS7SymbolTable& operator=(const CS7SymbolTable&) = delete;
+
+    static std::variant<std::unique_ptr<CS7SymbolTable>, CS7PError> Build(const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos);
+
+    size_t GetRowCount() const { return m_Names.Offsets.size(); }
+    size_t GetBlockCount() const { return m_Blocks.size(); }
+    size_t GetDeviceCount() const { return m_Devices.size(); }
+
+    // Filtering
+    std::optional<uint32_t> FindDatatypeId(std::string_view svDatatype) const;
+    void Select(std::vector<uint32_t>& Rows, const S7SymbolFilter& Filter) const;
+
+    // Row access
+    uint32_t GetDeviceId(uint32_t Row) const { return m_DeviceIds[Row]; }
+    uint32_t GetBlockId(uint32_t Row) const { return m_BlockIds[Row]; }
+    uint32_t GetDatatypeId(uint32_t Row) const { return m_DatatypeIds[Row]; }
+    S7Address GetAddress(uint32_t Row) const;
+    std::string GetCode(uint32_t Row) const;
+    std::string_view GetName(uint32_t Row) const { return m_Names.Get(Row); }
+    std::string_view GetDatatype(uint32_t Row) const { return m_Datatypes[m_DatatypeIds[Row]]; }
+    std::string_view GetComment(uint32_t Row) const { return m_Comments.Get(Row); }
+
+    // Block and device access
+    const std::string& GetBlockName(uint32_t BlockId) const { return m_Blocks[BlockId].strName; }
+    uint16_t GetBlockDbNumber(uint32_t BlockId) const { return m_Blocks[BlockId].DbNumber; }
+    const std::string& GetDeviceName(uint32_t DeviceId) const { return m_Devices[DeviceId].strName; }
+
+    // Converts the table back into the row-oriented structures returned by ParseS7P.
+    // Instance DBs come back with their own copy of the symbols (as returned by S7Block::Flatten) instead of a shared layout.
+    S7DeviceSymbolInfo ToDeviceSymbolInfo(uint32_t DeviceId) const;
+    std::vector<S7DeviceSymbolInfo> ToDeviceSymbolInfos() const;
+
+private:
+    struct StringColumn
+    {
+        std::string_view Get(uint32_t Row) const { return std::string_view(strHeap.data() + Offsets[Row], Lengths[Row]); }
+
+        std::string strHeap;
+        std::vector<uint32_t> Offsets;
+        std::vector<uint32_t> Lengths;
+    };
+
+    struct Block
+    {
+        std::string strName;
+        uint16_t DbNumber;
+        uint32_t FirstRow;
+        uint32_t RowCount;
+    };
+
+    struct Device
+    {
+        std::string strName;
+        S7StringEncoding StringEncoding;
+        uint32_t FirstBlockId;
+        uint32_t BlockCount;
+        std::map<size_t, std::string> DbNamesMap;
+        std::vector<CS7PError> Warnings;
+    };
+
+    // Columns
+    std::vector<uint32_t> m_DeviceIds;
+    std::vector<uint32_t> m_BlockIds;
+    std::vector<uint32_t> m_DatatypeIds;
+    std::vector<S7Area> m_Areas;
+    std::vector<uint16_t> m_DbNumbers;
+    std::vector<uint32_t> m_BitOffsets;
+    std::vector<uint32_t> m_BitSizes;
+    std::vector<uint32_t> m_ElementCounts;
+    StringColumn m_Names;
+    StringColumn m_Comments;
+
+    // Dictionaries
+    std::vector<std::string> m_Datatypes;
+    std::map<std::string, uint32_t, std::less<>> m_DatatypeIdMap;
+    std::vector<Block> m_Blocks;
+    std::vector<Device> m_Devices;
+
+    // Symbol List codes that could not be parsed into an address (see S7Symbol::strRawCode), by row.
+    // They are too rare to deserve a column.
+    std::map<uint32_t, std::string> m_RawCodes;
+
+    CS7SymbolTable() {}
+};
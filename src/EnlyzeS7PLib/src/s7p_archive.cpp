@@ -0,0 +1,679 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <thread>
+#include <vector>
+#include <windows.h>
+#include <EnlyzeWinStringLib.h>
+
+#include "CS7PThreadGroup.h"
+#include "s7p_archive.h"
+#include "s7p_inflate.h"
+
+struct ZipMember
+{
+    // Path relative to the folder of the .s7p file, with backslashes as separators.
+    std::string strRelativePath;
+
+    uint16_t Flags;
+    uint16_t CompressionMethod;
+    uint32_t Crc32;
+    uint64_t CompressedSize;
+    uint64_t UncompressedSize;
+    uint64_t LocalHeaderOffset;
+};
+
+static constexpr std::array<uint32_t, 256>
+_BuildCrc32Table()
+{
+    std::array<uint32_t, 256> Table = {};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t Value = i;
+        for (int Bit = 0; Bit < 8; Bit++)
+        {
+            Value = (Value & 1) ? (0xEDB88320u ^ (Value >> 1)) : (Value >> 1);
+        }
+
+        Table[i] = Value;
+    }
+
+    return Table;
+}
+
+static constexpr std::array<uint32_t, 256> _Crc32Table = _BuildCrc32Table();
+
+// Size of the chunks in which members stored without compression are copied.
+static const size_t _StoredChunkSize = 262144;
+
+
+static uint32_t
+_UpdateCrc32(uint32_t Crc, const uint8_t* pData, size_t Size)
+{
+    // Pass 0 for the first chunk and the previous result for all following chunks.
+    Crc = ~Crc;
+    for (size_t i = 0; i < Size; i++)
+    {
+        Crc = _Crc32Table[(Crc ^ pData[i]) & 0xFF] ^ (Crc >> 8);
+    }
+
+    return ~Crc;
+}
+
+static bool
+_EndsWithCaseInsensitive(const std::string& str, const char* szSuffix)
+{
+    const size_t SuffixLength = strlen(szSuffix);
+    if (str.size() < SuffixLength)
+    {
+        return false;
+    }
+
+    return std::equal(str.end() - SuffixLength, str.end(), szSuffix, [](char a, char b)
+    {
+        return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+    });
+}
+
+static bool
+_StartsWithCaseInsensitive(const std::string& str, const char* szPrefix)
+{
+    const size_t PrefixLength = strlen(szPrefix);
+    if (str.size() < PrefixLength)
+    {
+        return false;
+    }
+
+    return std::equal(str.begin(), str.begin() + PrefixLength, szPrefix, [](char a, char b)
+    {
+        return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+    });
+}
+
+static bool
+_IsRequiredMember(const std::string& strRelativePath)
+{
+    // ParseS7P only reads dBASE tables (with their memo files) and linkhrs.lnk from these folders.
+    // Everything else in a project archive (e.g. sources, hardware configurations) is never extracted.
+    static const char* const RequiredFolders[] = { "hOmSave7\\", "hrs\\", "ombstx\\offline\\", "YDBs\\" };
+    static const char* const RequiredExtensions[] = { ".dbf", ".dbt", ".lnk" };
+
+    // Never let a member escape the extraction folder.
+    if (strRelativePath.find("..") != std::string::npos || strRelativePath.find(':') != std::string::npos)
+    {
+        return false;
+    }
+
+    const bool bInRequiredFolder = std::any_of(std::begin(RequiredFolders), std::end(RequiredFolders), [&](const char* szFolder)
+    {
+        return _StartsWithCaseInsensitive(strRelativePath, szFolder);
+    });
+
+    const bool bHasRequiredExtension = std::any_of(std::begin(RequiredExtensions), std::end(RequiredExtensions), [&](const char* szExtension)
+    {
+        return _EndsWithCaseInsensitive(strRelativePath, szExtension);
+    });
+
+    return bInRequiredFolder && bHasRequiredExtension;
+}
+
+static uint16_t
+_ReadLE16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t
+_ReadLE32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t
+_ReadLE64(const uint8_t* p)
+{
+    return static_cast<uint64_t>(_ReadLE32(p)) | (static_cast<uint64_t>(_ReadLE32(p + 4)) << 32);
+}
+
+static bool
+_ReadAt(HANDLE hFile, uint64_t Offset, void* pBuffer, size_t Size)
+{
+    // Positional reads don't depend on a shared file pointer, so multiple threads can read from the same handle.
+    uint8_t* pCurrent = static_cast<uint8_t*>(pBuffer);
+    while (Size > 0)
+    {
+        const DWORD ChunkSize = static_cast<DWORD>(std::min<size_t>(Size, 1 << 24));
+
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset = static_cast<DWORD>(Offset);
+        Overlapped.OffsetHigh = static_cast<DWORD>(Offset >> 32);
+
+        DWORD BytesRead;
+        if (!ReadFile(hFile, pCurrent, ChunkSize, &BytesRead, &Overlapped) || BytesRead != ChunkSize)
+        {
+            return false;
+        }
+
+        pCurrent += ChunkSize;
+        Offset += ChunkSize;
+        Size -= ChunkSize;
+    }
+
+    return true;
+}
+
+static bool
+_WriteAll(HANDLE hFile, const uint8_t* pData, size_t Size)
+{
+    while (Size > 0)
+    {
+        const DWORD ChunkSize = static_cast<DWORD>(std::min<size_t>(Size, 1 << 24));
+
+        DWORD BytesWritten;
+        if (!WriteFile(hFile, pData, ChunkSize, &BytesWritten, nullptr) || BytesWritten != ChunkSize)
+        {
+            return false;
+        }
+
+        pData += ChunkSize;
+        Size -= ChunkSize;
+    }
+
+    return true;
+}
+
+static std::variant<std::monostate, CS7PError>
+_ReadCentralDirectory(std::vector<ZipMember>& Members, HANDLE hArchive, uint64_t ArchiveSize)
+{
+    const uint32_t EndOfCentralDirectorySignature = 0x06054b50;
+    const uint32_t Zip64EndOfCentralDirectoryLocatorSignature = 0x07064b50;
+    const uint32_t Zip64EndOfCentralDirectorySignature = 0x06064b50;
+    const uint32_t CentralDirectoryHeaderSignature = 0x02014b50;
+    const size_t EndOfCentralDirectorySize = 22;
+    const size_t MaxCommentLength = 0xFFFF;
+
+    // The End of Central Directory record is at the very end of the archive, only followed by an optional comment.
+    const size_t TailSize = static_cast<size_t>(std::min<uint64_t>(ArchiveSize, EndOfCentralDirectorySize + MaxCommentLength));
+    const uint64_t TailOffset = ArchiveSize - TailSize;
+    if (TailSize < EndOfCentralDirectorySize)
+    {
+        return CS7PError(L"File is too small to be a ZIP archive");
+    }
+
+    std::vector<uint8_t> Tail(TailSize);
+    if (!_ReadAt(hArchive, TailOffset, Tail.data(), TailSize))
+    {
+        return CS7PError(L"Could not read the end of the ZIP archive");
+    }
+
+    size_t EndOfCentralDirectoryPosition = TailSize - EndOfCentralDirectorySize;
+    while (_ReadLE32(&Tail[EndOfCentralDirectoryPosition]) != EndOfCentralDirectorySignature)
+    {
+        if (EndOfCentralDirectoryPosition == 0)
+        {
+            return CS7PError(L"Could not find the ZIP End of Central Directory record");
+        }
+
+        EndOfCentralDirectoryPosition--;
+    }
+
+    const uint8_t* pEndOfCentralDirectory = &Tail[EndOfCentralDirectoryPosition];
+    if (_ReadLE16(pEndOfCentralDirectory + 4) != 0 || _ReadLE16(pEndOfCentralDirectory + 6) != 0)
+    {
+        return CS7PError(L"Split ZIP archives are not supported");
+    }
+
+    uint64_t EntryCount = _ReadLE16(pEndOfCentralDirectory + 10);
+    uint64_t CentralDirectorySize = _ReadLE32(pEndOfCentralDirectory + 12);
+    uint64_t CentralDirectoryOffset = _ReadLE32(pEndOfCentralDirectory + 16);
+
+    if (EntryCount == 0xFFFF || CentralDirectorySize == 0xFFFFFFFF || CentralDirectoryOffset == 0xFFFFFFFF)
+    {
+        // This is a ZIP64 archive, so the real values are in the ZIP64 End of Central Directory record.
+        // Its locator immediately precedes the regular End of Central Directory record.
+        const uint64_t LocatorOffset = TailOffset + EndOfCentralDirectoryPosition - 20;
+        uint8_t Locator[20];
+        if (TailOffset + EndOfCentralDirectoryPosition < 20 ||
+            !_ReadAt(hArchive, LocatorOffset, Locator, sizeof(Locator)) ||
+            _ReadLE32(Locator) != Zip64EndOfCentralDirectoryLocatorSignature)
+        {
+            return CS7PError(L"Could not find the ZIP64 End of Central Directory Locator");
+        }
+
+        uint8_t Zip64EndOfCentralDirectory[56];
+        if (!_ReadAt(hArchive, _ReadLE64(Locator + 8), Zip64EndOfCentralDirectory, sizeof(Zip64EndOfCentralDirectory)) ||
+            _ReadLE32(Zip64EndOfCentralDirectory) != Zip64EndOfCentralDirectorySignature)
+        {
+            return CS7PError(L"Could not read the ZIP64 End of Central Directory record");
+        }
+
+        EntryCount = _ReadLE64(Zip64EndOfCentralDirectory + 32);
+        CentralDirectorySize = _ReadLE64(Zip64EndOfCentralDirectory + 40);
+        CentralDirectoryOffset = _ReadLE64(Zip64EndOfCentralDirectory + 48);
+    }
+
+    if (CentralDirectoryOffset > ArchiveSize || CentralDirectorySize > ArchiveSize - CentralDirectoryOffset || CentralDirectorySize > SIZE_MAX)
+    {
+        return CS7PError(L"Invalid ZIP Central Directory location");
+    }
+
+    std::vector<uint8_t> CentralDirectory(static_cast<size_t>(CentralDirectorySize));
+    if (!_ReadAt(hArchive, CentralDirectoryOffset, CentralDirectory.data(), CentralDirectory.size()))
+    {
+        return CS7PError(L"Could not read the ZIP Central Directory");
+    }
+
+    // Parse all Central Directory headers.
+    size_t Position = 0;
+    for (uint64_t i = 0; i < EntryCount; i++)
+    {
+        if (CentralDirectory.size() - Position < 46 || _ReadLE32(&CentralDirectory[Position]) != CentralDirectoryHeaderSignature)
+        {
+            return CS7PError(L"Invalid ZIP Central Directory header");
+        }
+
+        const uint8_t* pHeader = &CentralDirectory[Position];
+        const size_t NameLength = _ReadLE16(pHeader + 28);
+        const size_t ExtraLength = _ReadLE16(pHeader + 30);
+        const size_t CommentLength = _ReadLE16(pHeader + 32);
+        if (CentralDirectory.size() - Position - 46 < NameLength + ExtraLength + CommentLength)
+        {
+            return CS7PError(L"Truncated ZIP Central Directory header");
+        }
+
+        ZipMember& Member = Members.emplace_back();
+        Member.Flags = _ReadLE16(pHeader + 8);
+        Member.CompressionMethod = _ReadLE16(pHeader + 10);
+        Member.Crc32 = _ReadLE32(pHeader + 16);
+        Member.CompressedSize = _ReadLE32(pHeader + 20);
+        Member.UncompressedSize = _ReadLE32(pHeader + 24);
+        Member.LocalHeaderOffset = _ReadLE32(pHeader + 42);
+
+        // Use backslashes like the rest of the parser does.
+        Member.strRelativePath.assign(reinterpret_cast<const char*>(pHeader + 46), NameLength);
+        std::replace(Member.strRelativePath.begin(), Member.strRelativePath.end(), '/', '\\');
+
+        // Sizes and offsets that don't fit into 32 bits are stored in the ZIP64 extra field.
+        const uint8_t* pExtra = pHeader + 46 + NameLength;
+        const uint8_t* pExtraEnd = pExtra + ExtraLength;
+        while (pExtraEnd - pExtra >= 4)
+        {
+            const uint16_t ExtraId = _ReadLE16(pExtra);
+            const uint16_t ExtraSize = _ReadLE16(pExtra + 2);
+            const uint8_t* pData = pExtra + 4;
+            const uint8_t* pDataEnd = pData + std::min<size_t>(ExtraSize, pExtraEnd - pData);
+
+            if (ExtraId == 0x0001)
+            {
+                for (uint64_t* pValue : { &Member.UncompressedSize, &Member.CompressedSize, &Member.LocalHeaderOffset })
+                {
+                    if (*pValue == 0xFFFFFFFF && pDataEnd - pData >= 8)
+                    {
+                        *pValue = _ReadLE64(pData);
+                        pData += 8;
+                    }
+                }
+            }
+
+            pExtra = pDataEnd;
+        }
+
+        Position += 46 + NameLength + ExtraLength + CommentLength;
+    }
+
+    return std::monostate();
+}
+
+static std::variant<std::monostate, CS7PError>
+_DecompressMember(HANDLE hArchive, uint64_t DataOffset, const ZipMember& Member, const std::wstring& wstrMemberName, HANDLE hFile, const std::wstring& wstrFilePath)
+{
+    // Read the compressed data and write the decompressed data in chunks, so that a member never has to fit into memory.
+    uint64_t ReadOffset = DataOffset;
+    uint64_t RemainingSize = Member.CompressedSize;
+    uint32_t Crc = 0;
+
+    auto Read = [&](uint8_t* pBuffer, size_t BufferSize) -> std::variant<size_t, CS7PError>
+    {
+        const size_t Size = static_cast<size_t>(std::min<uint64_t>(RemainingSize, BufferSize));
+        if (!_ReadAt(hArchive, ReadOffset, pBuffer, Size))
+        {
+            return CS7PError(L"Could not read archive member " + wstrMemberName);
+        }
+
+        ReadOffset += Size;
+        RemainingSize -= Size;
+        return Size;
+    };
+
+    auto Write = [&](const uint8_t* pData, size_t Size) -> std::variant<std::monostate, CS7PError>
+    {
+        Crc = _UpdateCrc32(Crc, pData, Size);
+        if (!_WriteAll(hFile, pData, Size))
+        {
+            return CS7PError(L"Could not write " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+        }
+
+        return std::monostate();
+    };
+
+    if (Member.CompressionMethod == 0)
+    {
+        // Stored without compression.
+        if (Member.CompressedSize != Member.UncompressedSize)
+        {
+            return CS7PError(L"Size mismatch in stored archive member " + wstrMemberName);
+        }
+
+        std::vector<uint8_t> Buffer(_StoredChunkSize);
+        while (RemainingSize > 0)
+        {
+            auto ReadResult = Read(Buffer.data(), Buffer.size());
+            if (const auto pError = std::get_if<CS7PError>(&ReadResult))
+            {
+                return *pError;
+            }
+
+            auto WriteResult = Write(Buffer.data(), std::get<size_t>(ReadResult));
+            if (const auto pError = std::get_if<CS7PError>(&WriteResult))
+            {
+                return *pError;
+            }
+        }
+    }
+    else if (Member.CompressionMethod == 8)
+    {
+        auto InflateResult = Inflate(Read, Write, Member.UncompressedSize);
+        if (const auto pError = std::get_if<CS7PError>(&InflateResult))
+        {
+            return CS7PError(L"Could not decompress archive member " + wstrMemberName + L": " + pError->Message());
+        }
+    }
+    else
+    {
+        return CS7PError(
+            L"Archive member " + wstrMemberName + L" uses unsupported compression method " + std::to_wstring(Member.CompressionMethod)
+        );
+    }
+
+    if (Crc != Member.Crc32)
+    {
+        return CS7PError(L"CRC mismatch in archive member " + wstrMemberName);
+    }
+
+    return std::monostate();
+}
+
+static std::variant<std::monostate, CS7PError>
+_ExtractMember(HANDLE hArchive, uint64_t ArchiveSize, const ZipMember& Member, const std::wstring& wstrFilePath)
+{
+    const uint32_t LocalFileHeaderSignature = 0x04034b50;
+    const std::wstring wstrMemberName = StrToWstr(Member.strRelativePath);
+
+    if (Member.Flags & 0x0001)
+    {
+        return CS7PError(L"Archive member " + wstrMemberName + L" is encrypted");
+    }
+
+    // The data starts after the Local File Header, whose name and extra field lengths may differ from the Central Directory.
+    uint8_t LocalHeader[30];
+    if (!_ReadAt(hArchive, Member.LocalHeaderOffset, LocalHeader, sizeof(LocalHeader)) || _ReadLE32(LocalHeader) != LocalFileHeaderSignature)
+    {
+        return CS7PError(L"Could not read the Local File Header of archive member " + wstrMemberName);
+    }
+
+    const uint64_t DataOffset = Member.LocalHeaderOffset + sizeof(LocalHeader) + _ReadLE16(LocalHeader + 26) + _ReadLE16(LocalHeader + 28);
+    if (DataOffset > ArchiveSize || Member.CompressedSize > ArchiveSize - DataOffset)
+    {
+        return CS7PError(L"Archive member " + wstrMemberName + L" exceeds the end of the archive");
+    }
+
+    // Write the member into the extraction folder.
+    // A partially written file is removed along with the folder if extraction fails.
+    HANDLE hFile = CreateFileW(wstrFilePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not create " + wstrFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    auto Result = _DecompressMember(hArchive, DataOffset, Member, wstrMemberName, hFile, wstrFilePath);
+    CloseHandle(hFile);
+    return Result;
+}
+
+static std::variant<std::monostate, CS7PError>
+_ExtractRequiredMembers(std::wstring& wstrS7PFilePath, HANDLE hArchive, const std::wstring& wstrTempFolderPath)
+{
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(hArchive, &FileSize))
+    {
+        return CS7PError(L"Could not get the size of the archive, error " + std::to_wstring(GetLastError()));
+    }
+
+    const uint64_t ArchiveSize = static_cast<uint64_t>(FileSize.QuadPart);
+
+    std::vector<ZipMember> AllMembers;
+    auto Result = _ReadCentralDirectory(AllMembers, hArchive, ArchiveSize);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    // The project folder is the folder of the topmost .s7p file in the archive.
+    const ZipMember* pS7PMember = nullptr;
+    for (const ZipMember& Member : AllMembers)
+    {
+        if (_EndsWithCaseInsensitive(Member.strRelativePath, ".s7p"))
+        {
+            if (!pS7PMember || std::count(Member.strRelativePath.begin(), Member.strRelativePath.end(), '\\') < std::count(pS7PMember->strRelativePath.begin(), pS7PMember->strRelativePath.end(), '\\'))
+            {
+                pS7PMember = &Member;
+            }
+        }
+    }
+
+    if (!pS7PMember)
+    {
+        return CS7PError(L"Did not find any .s7p file in the archive");
+    }
+
+    const size_t BackslashPosition = pS7PMember->strRelativePath.find_last_of('\\');
+    const std::string strProjectPrefix = (BackslashPosition == std::string::npos) ? std::string() : pS7PMember->strRelativePath.substr(0, BackslashPosition + 1);
+
+    // Keep only the members within the project folder that ParseS7P actually reads.
+    std::vector<ZipMember> Members;
+    for (ZipMember& Member : AllMembers)
+    {
+        if (Member.strRelativePath.starts_with(strProjectPrefix))
+        {
+            Member.strRelativePath.erase(0, strProjectPrefix.size());
+            if (_IsRequiredMember(Member.strRelativePath))
+            {
+                Members.push_back(std::move(Member));
+            }
+        }
+    }
+
+    // Create all required subfolders up front.
+    // A std::set sorts every parent folder before its subfolders.
+    std::set<std::wstring> FolderPaths;
+    for (const ZipMember& Member : Members)
+    {
+        const std::wstring wstrRelativePath = StrToWstr(Member.strRelativePath);
+        for (size_t Position = wstrRelativePath.find(L'\\'); Position != std::wstring::npos; Position = wstrRelativePath.find(L'\\', Position + 1))
+        {
+            FolderPaths.insert(wstrTempFolderPath + L"\\" + wstrRelativePath.substr(0, Position));
+        }
+    }
+
+    for (const std::wstring& wstrFolderPath : FolderPaths)
+    {
+        if (!CreateDirectoryW(wstrFolderPath.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+        {
+            return CS7PError(L"Could not create " + wstrFolderPath + L", error " + std::to_wstring(GetLastError()));
+        }
+    }
+
+    // Decompress the members in parallel.
+    // Each worker picks the next member until all are done or one of them has failed.
+    // Members are streamed in fixed-size chunks (see _DecompressMember), so a worker needs the same memory for any member size.
+    std::atomic<size_t> NextMemberIndex = 0;
+    std::mutex ErrorMutex;
+    std::optional<CS7PError> Error;
+
+    auto ExtractMembers = [&]()
+    {
+        for (;;)
+        {
+            const size_t MemberIndex = NextMemberIndex++;
+            if (MemberIndex >= Members.size())
+            {
+                break;
+            }
+
+            {
+                std::lock_guard<std::mutex> Lock(ErrorMutex);
+                if (Error.has_value())
+                {
+                    break;
+                }
+            }
+
+            const ZipMember& Member = Members[MemberIndex];
+            auto ExtractResult = _ExtractMember(hArchive, ArchiveSize, Member, wstrTempFolderPath + L"\\" + StrToWstr(Member.strRelativePath));
+            if (const auto pError = std::get_if<CS7PError>(&ExtractResult))
+            {
+                std::lock_guard<std::mutex> Lock(ErrorMutex);
+                if (!Error.has_value())
+                {
+                    Error = *pError;
+                }
+
+                break;
+            }
+        }
+    };
+
+    const size_t ThreadCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(Members.size(), 1));
+    CS7PThreadGroup Threads;
+    for (size_t i = 1; i < ThreadCount; i++)
+    {
+        Threads.Start(ExtractMembers);
+    }
+
+    ExtractMembers();
+    Threads.Join();
+
+    if (Error.has_value())
+    {
+        return *Error;
+    }
+
+    // ParseS7P only needs the .s7p file for its folder path, so an empty placeholder is sufficient.
+    wstrS7PFilePath = wstrTempFolderPath + L"\\Project.s7p";
+    HANDLE hS7PFile = CreateFileW(wstrS7PFilePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hS7PFile == INVALID_HANDLE_VALUE)
+    {
+        return CS7PError(L"Could not create " + wstrS7PFilePath + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    CloseHandle(hS7PFile);
+    return std::monostate();
+}
+
+static void
+_DeleteFolderRecursively(const std::wstring& wstrFolderPath)
+{
+    WIN32_FIND_DATAW FindData;
+    HANDLE hFind = FindFirstFileW((wstrFolderPath + L"\\*").c_str(), &FindData);
+    if (hFind != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (wcscmp(FindData.cFileName, L".") == 0 || wcscmp(FindData.cFileName, L"..") == 0)
+            {
+                continue;
+            }
+
+            const std::wstring wstrPath = wstrFolderPath + L"\\" + FindData.cFileName;
+            if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                _DeleteFolderRecursively(wstrPath);
+            }
+            else
+            {
+                DeleteFileW(wstrPath.c_str());
+            }
+        }
+        while (FindNextFileW(hFind, &FindData));
+
+        FindClose(hFind);
+    }
+
+    RemoveDirectoryW(wstrFolderPath.c_str());
+}
+
+
+bool
+IsS7PArchivePath(const std::wstring& wstrFilePath)
+{
+    return wstrFilePath.size() >= 4 && _wcsicmp(wstrFilePath.c_str() + wstrFilePath.size() - 4, L".zip") == 0;
+}
+
+std::variant<std::monostate, CS7PError>
+ExtractS7PArchive(std::wstring& wstrS7PFilePath, std::wstring& wstrTempFolderPath, const std::wstring& wstrArchiveFilePath)
+{
+    // Create a unique temporary folder for the extracted members.
+    // GetTempFileNameW creates a file to reserve the unique name, which we replace by a folder.
+    wchar_t wszTempPath[MAX_PATH];
+    wchar_t wszTempFolderPath[MAX_PATH];
+    if (!GetTempPathW(MAX_PATH, wszTempPath) || !GetTempFileNameW(wszTempPath, L"S7P", 0, wszTempFolderPath))
+    {
+        return CS7PError(L"Could not get a temporary file name, error " + std::to_wstring(GetLastError()));
+    }
+
+    DeleteFileW(wszTempFolderPath);
+    if (!CreateDirectoryW(wszTempFolderPath, nullptr))
+    {
+        return CS7PError(L"Could not create " + std::wstring(wszTempFolderPath) + L", error " + std::to_wstring(GetLastError()));
+    }
+
+    HANDLE hArchive = CreateFileW(wstrArchiveFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hArchive == INVALID_HANDLE_VALUE)
+    {
+        const DWORD dwOpenError = GetLastError();
+        _DeleteFolderRecursively(wszTempFolderPath);
+        return CS7PError(L"Could not open " + wstrArchiveFilePath + L", error " + std::to_wstring(dwOpenError));
+    }
+
+    auto Result = _ExtractRequiredMembers(wstrS7PFilePath, hArchive, wszTempFolderPath);
+    CloseHandle(hArchive);
+
+    // Don't leave partially extracted members behind.
+    if (std::holds_alternative<CS7PError>(Result))
+    {
+        _DeleteFolderRecursively(wszTempFolderPath);
+        return Result;
+    }
+
+    wstrTempFolderPath = wszTempFolderPath;
+    return Result;
+}
+
+void
+DeleteExtractedS7PArchive(const std::wstring& wstrTempFolderPath)
+{
+    if (!wstrTempFolderPath.empty())
+    {
+        _DeleteFolderRecursively(wstrTempFolderPath);
+    }
+}
@@ -0,0 +1,26 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <string>
+#include <variant>
+
+#include "CS7PError.h"
+
+bool IsS7PArchivePath(const std::wstring& wstrFilePath);
+
+// Extracts only the members required by ParseS7P from a zipped STEP 7 project archive into a new temporary folder.
+// On success, wstrS7PFilePath receives the path of the .s7p file inside that folder.
+// On success, the caller must remove the folder using DeleteExtractedS7PArchive afterwards.
+// On failure, the folder has already been removed and wstrTempFolderPath is left unchanged.
+std::variant<std::monostate, CS7PError> ExtractS7PArchive(
+    std::wstring& wstrS7PFilePath,
+    std::wstring& wstrTempFolderPath,
+    const std::wstring& wstrArchiveFilePath
+    );
+
+void DeleteExtractedS7PArchive(const std::wstring& wstrTempFolderPath);
@@ -0,0 +1,137 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstdint>
+#include <cstring>
+
+#include "s7p_cp1252.h"
+
+// Unicode code points of the Windows-1252 characters 0x80 to 0x9F.
+// 0xA0 to 0xFF are identical to their Unicode code points.
+// Unassigned characters (0x81, 0x8D, 0x8F, 0x90, 0x9D) are mapped to the C1 control characters like MultiByteToWideChar does.
+static constexpr uint16_t _Cp1252CodePoints[32] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+
+static uint16_t
+_GetCodePoint(unsigned char c)
+{
+    if (c >= 0x80 && c < 0xA0)
+    {
+        return _Cp1252CodePoints[c - 0x80];
+    }
+
+    return c;
+}
+
+static size_t
+_GetAsciiPrefixLength(const char* p, size_t Length)
+{
+    size_t i = 0;
+
+    // Check 16 bytes per iteration by combining four 32-bit words and testing all their high bits at once.
+    // This works on any x86 CPU, even without SSE2.
+    while (i + 16 <= Length)
+    {
+        uint32_t Words[4];
+        memcpy(Words, p + i, sizeof(Words));
+
+        if ((Words[0] | Words[1] | Words[2] | Words[3]) & 0x80808080u)
+        {
+            break;
+        }
+
+        i += 16;
+    }
+
+    // Find the exact position of the first non-ASCII character in the remaining bytes.
+    while (i < Length && static_cast<unsigned char>(p[i]) < 0x80)
+    {
+        i++;
+    }
+
+    return i;
+}
+
+void
+AppendCp1252AsUtf8(std::string& strOutput, std::string_view str1252)
+{
+    const char* p = str1252.data();
+    const char* pEnd = p + str1252.size();
+
+    for (;;)
+    {
+        // Copy the next run of ASCII characters in one go.
+        size_t AsciiLength = _GetAsciiPrefixLength(p, pEnd - p);
+        strOutput.append(p, AsciiLength);
+        p += AsciiLength;
+
+        if (p == pEnd)
+        {
+            break;
+        }
+
+        // Encode all following non-ASCII characters, which need 2 or 3 bytes in UTF-8.
+        while (p < pEnd && static_cast<unsigned char>(*p) >= 0x80)
+        {
+            uint16_t CodePoint = _GetCodePoint(static_cast<unsigned char>(*p));
+            if (CodePoint < 0x800)
+            {
+                const char Utf8[2] = {
+                    static_cast<char>(0xC0 | (CodePoint >> 6)),
+                    static_cast<char>(0x80 | (CodePoint & 0x3F)),
+                };
+                strOutput.append(Utf8, sizeof(Utf8));
+            }
+            else
+            {
+                const char Utf8[3] = {
+                    static_cast<char>(0xE0 | (CodePoint >> 12)),
+                    static_cast<char>(0x80 | ((CodePoint >> 6) & 0x3F)),
+                    static_cast<char>(0x80 | (CodePoint & 0x3F)),
+                };
+                strOutput.append(Utf8, sizeof(Utf8));
+            }
+
+            p++;
+        }
+    }
+}
+
+std::string
+Cp1252ToUtf8(std::string str1252)
+{
+    size_t AsciiLength = _GetAsciiPrefixLength(str1252.data(), str1252.size());
+    if (AsciiLength == str1252.size())
+    {
+        return str1252;
+    }
+
+    // Keep the ASCII prefix and only convert the rest.
+    // Every remaining character needs at most 3 bytes.
+    std::string strUtf8;
+    strUtf8.reserve(AsciiLength + (str1252.size() - AsciiLength) * 3);
+    strUtf8.append(str1252, 0, AsciiLength);
+    AppendCp1252AsUtf8(strUtf8, std::string_view(str1252).substr(AsciiLength));
+
+    return strUtf8;
+}
+
+std::wstring
+Cp1252ToWstr(std::string_view str1252)
+{
+    // Every Windows-1252 character maps to exactly one UTF-16 code unit.
+    std::wstring wstr(str1252.size(), L'\0');
+
+    for (size_t i = 0; i < str1252.size(); i++)
+    {
+        wstr[i] = static_cast<wchar_t>(_GetCodePoint(static_cast<unsigned char>(str1252[i])));
+    }
+
+    return wstr;
+}
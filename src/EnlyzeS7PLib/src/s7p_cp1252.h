@@ -0,0 +1,23 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// STEP 7 stores all names and comments in Windows-1252.
+// These functions convert them, with a fast path for the pure ASCII strings that make up the vast majority.
+
+// Appends the Windows-1252 string str1252 to strOutput as UTF-8.
+void AppendCp1252AsUtf8(std::string& strOutput, std::string_view str1252);
+
+// Converts a Windows-1252 string to UTF-8.
+// A pure ASCII string is already valid UTF-8 and returned as is, so passing it via std::move avoids any copy.
+std::string Cp1252ToUtf8(std::string str1252);
+
+// Converts a Windows-1252 string directly to UTF-16, e.g. for strings kept in Windows-1252 by S7ParseOptions::bTranscodeStrings.
+std::wstring Cp1252ToWstr(std::string_view str1252);
@@ -6,21 +6,40 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <set>
 #include <sstream>
+#include <utility>
 #include <EnlyzeWinStringLib.h>
 #include <CDbfReader.h>
 
 #include "CMc5codeParser.h"
+#include "CS7PCountingMemoryResource.h"
 #include "s7p_db_parser.h"
 
+// Block and warnings of a DB from a previous parse, which _ParseDBs takes over instead of parsing the DB again.
+struct ReusableDbInfo
+{
+    std::optional<S7Block> Block;
+    std::vector<CS7PError> Warnings;
+};
+
 
 static std::variant<std::monostate, CS7PError>
-_ParseSingleDB(std::vector<S7Symbol>& Symbols, const size_t DbNumber, const std::string& strMc5code, const std::map<std::string, std::map<size_t, std::string>>& Mc5codeMap)
+_ParseSingleDB(std::vector<S7Symbol>& Symbols, const size_t DbNumber, const CMc5codeTokenStream& TokenStream, const Mc5codeTypeMap& Mc5codeMap, Mc5codeParserContext& Context)
 {
     size_t BitAddressCounter = 0;
 
-    CMc5codeParser Parser(Symbols, BitAddressCounter, DbNumber, strMc5code, Mc5codeMap);
+    CMc5codeParser Parser(Symbols, BitAddressCounter, DbNumber, TokenStream, Mc5codeMap, Context);
     auto Result = Parser.Parse();
+
+    if (Context.pStatistics)
+    {
+        Context.pStatistics->ByteSize = (BitAddressCounter + 7) / 8;
+    }
+
     if (const auto pError = std::get_if<CS7PError>(&Result))
     {
         return *pError;
@@ -29,11 +48,25 @@ _ParseSingleDB(std::vector<S7Symbol>& Symbols, const size_t DbNumber, const std:
     return std::monostate();
 }
 
+// Adds the statistics of a DB to the device statistics, unless the DB has neither symbols nor warnings.
+static void
+_AddDbStatistics(S7DeviceStatistics& DeviceStatistics, size_t DbNumber, const S7DbStatistics& DbStatistics, size_t WarningCount)
+{
+    if (DbStatistics.SymbolCount == 0 && WarningCount == 0)
+    {
+        return;
+    }
+
+    S7DbStatistics& AddedDbStatistics = DeviceStatistics.Dbs.emplace_back(DbStatistics);
+    AddedDbStatistics.DbNumber = static_cast<uint16_t>(DbNumber);
+    AddedDbStatistics.WarningCount = WarningCount;
+}
+
 // A DB reference info subblock (subblock type "00066") has a weird format, which I didn't fully understand yet.
 // However, when the DB block Mc5code is empty, testing has shown that the DB reference info subblock contains a reference to an FB block just at the beginning.
 // This function is only meant to extract that reference.
 static bool
-_ExtractFBFromDBReferenceMap(const std::map<size_t, std::string>& DbReferenceMc5codeMap, const size_t DbNumber, size_t& FbNumber)
+_ExtractFBFromDBReferenceMap(const Mc5codeBlockMap& DbReferenceMc5codeMap, const size_t DbNumber, size_t& FbNumber)
 {
     // Check if we have a DB reference info subblock for this DB number.
     const auto it = DbReferenceMc5codeMap.find(DbNumber);
@@ -42,7 +75,7 @@ _ExtractFBFromDBReferenceMap(const std::map<size_t, std::string>& DbReferenceMc5
         return false;
     }
 
-    const std::string& strDbReferenceMc5code = it->second;
+    const std::pmr::string& strDbReferenceMc5code = it->second;
 
     // Check if this DB reference info subblock begins with a reference to an FB block.
     if (!strDbReferenceMc5code.starts_with("FB"))
@@ -77,81 +110,378 @@ _ExtractFBFromDBReferenceMap(const std::map<size_t, std::string>& DbReferenceMc5
     return true;
 }
 
+static std::string
+_GetDBBlockName(const S7DeviceSymbolInfo& DeviceSymbolInfo, const size_t DbNumber)
+{
+    // The block name is "DB#" and a human-readable name appended (if available from the DbNamesMap).
+    std::string strName = "DB" + std::to_string(DbNumber);
+
+    const auto it = DeviceSymbolInfo.DbNamesMap.find(DbNumber);
+    if (it != DeviceSymbolInfo.DbNamesMap.end())
+    {
+        strName += " (" + it->second + ")";
+    }
+
+    return strName;
+}
+
+static S7Block&
+_AddDBBlock(S7DeviceSymbolInfo& DeviceSymbolInfo, const size_t DbNumber)
+{
+    S7Block& Block = DeviceSymbolInfo.Blocks.emplace_back();
+    Block.strName = _GetDBBlockName(DeviceSymbolInfo, DbNumber);
+    Block.DbNumber = static_cast<uint16_t>(DbNumber);
+
+    return Block;
+}
+
+static std::wstring
+_GetSubblockFilePath(const std::wstring& wstrS7PFolderPath, size_t SubblockListId)
+{
+    // Construct the full path to the SUBBLK.DBF in the Subblock List subdirectory.
+    // (e.g. "...\ombstx\offline\00000005\SUBBLK.DBF")
+    std::wostringstream wssSubblockFilePath;
+    wssSubblockFilePath << wstrS7PFolderPath << L"\\ombstx\\offline\\";
+    wssSubblockFilePath << std::hex << std::setfill(L'0') << std::setw(8) << SubblockListId;
+    wssSubblockFilePath << L"\\SUBBLK.DBF";
+
+    return wssSubblockFilePath.str();
+}
+
+static void
+_HashMc5codeMap(const Mc5codeTypeMap& Mc5codeMap, std::map<S7BlockKey, uint64_t>& CodeHashes)
+{
+    // FNV-1a is good enough to notice changes of a block, nobody crafts collisions to hide them.
+    for (const auto& [strType, BlockMc5codeMap] : Mc5codeMap)
+    {
+        for (const auto& [BlockNumber, strMc5code] : BlockMc5codeMap)
+        {
+            uint64_t Hash = 0xCBF29CE484222325;
+            for (char c : strMc5code)
+            {
+                Hash = (Hash ^ static_cast<uint8_t>(c)) * 0x100000001B3;
+            }
+
+            CodeHashes.emplace(S7BlockKey(strType, BlockNumber), Hash);
+        }
+    }
+}
+
 static std::variant<std::monostate, CS7PError>
-_ParseDBs(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::map<std::string, std::map<size_t, std::string>>& Mc5codeMap)
+_ParseDBs(S7DeviceSymbolInfo& DeviceSymbolInfo, const Mc5codeTypeMap& Mc5codeMap, const S7ParseOptions& Options, size_t& ProjectSymbolCount, std::pmr::memory_resource* pTemporaryResource, S7DeviceStatistics* pStatistics, S7SubblockListInfo* pSubblockListInfo = nullptr, std::map<size_t, ReusableDbInfo>* pReusableDbs = nullptr)
 {
-    const std::map<size_t, std::string>& DbMc5codeMap = Mc5codeMap.at("DB");
-    const std::map<size_t, std::string>& DbReferenceMc5codeMap = Mc5codeMap.at("DBREF");
+    struct InstanceLayoutInfo
+    {
+        std::shared_ptr<const S7Layout> pLayout;
+        std::shared_ptr<const S7SymbolTree> pTree;
+        S7DbStatistics Statistics;
+        std::optional<CS7PError> Error;
+    };
+
+    const Mc5codeBlockMap& DbMc5codeMap = Mc5codeMap.at("DB");
+    const Mc5codeBlockMap& DbReferenceMc5codeMap = Mc5codeMap.at("DBREF");
+
+    DeviceSymbolInfo.StringEncoding = Options.bTranscodeStrings ? S7StringEncoding::Utf8 : S7StringEncoding::Cp1252;
+
+    // Instance DBs of the same FB all share the layout of that FB, so we parse each FB only once.
+    std::map<size_t, InstanceLayoutInfo> InstanceLayoutsMap;
+
+    // Tokenized MC5 Code of all UDT/FB/SFB blocks referenced so far, shared between all DBs of this device.
+    std::pmr::map<std::pair<std::string, size_t>, CMc5codeTokenStream> TokenStreamCache(pTemporaryResource);
+
+    // Warnings are also recorded per DB, so that a later ReparseOmbstxSubblockList can replace them.
+    auto AddWarning = [&](size_t DbNumber, CS7PError Warning)
+    {
+        if (pSubblockListInfo)
+        {
+            pSubblockListInfo->DbWarnings[DbNumber].push_back(Warning);
+        }
+
+        DeviceSymbolInfo.Warnings.push_back(std::move(Warning));
+    };
+
+    std::map<S7BlockKey, std::set<S7BlockKey>>* pDependencies = pSubblockListInfo ? &pSubblockListInfo->Dependencies : nullptr;
+
+    const size_t FirstListBlockIndex = DeviceSymbolInfo.Blocks.size();
+    const size_t FirstListWarningIndex = DeviceSymbolInfo.Warnings.size();
+
+    // Layouts and trees shared between reused instance DBs, whose symbols have already been counted.
+    std::set<const void*> CountedSharedSymbols;
 
     for (const auto& [DbNumber, strMc5code] : DbMc5codeMap)
     {
-        std::variant<std::monostate, CS7PError> Result;
-        std::vector<S7Symbol> Symbols;
-        size_t FbNumber;
+        // All warnings from here on belong to this DB, which the statistics count per DB.
+        const size_t FirstWarningIndex = DeviceSymbolInfo.Warnings.size();
 
-        if (!strMc5code.empty())
+        if (pReusableDbs)
         {
-            // Parse the MC5 Code for this DB.
-            Result = _ParseSingleDB(Symbols, DbNumber, strMc5code, Mc5codeMap);
+            auto ReusableIt = pReusableDbs->find(DbNumber);
+            if (ReusableIt != pReusableDbs->end())
+            {
+                // Nothing this DB depends on has changed, so take over the previous result.
+                // Only its name may have changed in the meantime.
+                ReusableDbInfo& ReusableDb = ReusableIt->second;
+                for (CS7PError& Warning : ReusableDb.Warnings)
+                {
+                    AddWarning(DbNumber, std::move(Warning));
+                }
+
+                if (ReusableDb.Block.has_value())
+                {
+                    S7Block& Block = DeviceSymbolInfo.Blocks.emplace_back(std::move(*ReusableDb.Block));
+                    Block.strName = _GetDBBlockName(DeviceSymbolInfo, DbNumber);
+
+                    // Count the symbols like a full parse does, i.e. those of an FB only once for all its instance DBs.
+                    // If another instance DB of that FB is parsed again, its layout is counted once more, which only makes the limit apply earlier.
+                    const void* pSharedSymbols = Block.pSymbolTree ? static_cast<const void*>(Block.pSymbolTree.get()) : Block.pInstanceLayout.get();
+                    if (!pSharedSymbols || CountedSharedSymbols.insert(pSharedSymbols).second)
+                    {
+                        ProjectSymbolCount += Block.pSymbolTree ? Block.pSymbolTree->SymbolCount : Block.GetSymbols().size();
+                    }
+                }
+
+                continue;
+            }
         }
-        else if (_ExtractFBFromDBReferenceMap(DbReferenceMc5codeMap, DbNumber, FbNumber))
+
+        if (ProjectSymbolCount >= Options.MaxSymbolsPerProject)
         {
-            // Find the referenced FB block.
-            const std::map<size_t, std::string>& FbMc5codeMap = Mc5codeMap.at("FB");
-            const auto it = FbMc5codeMap.find(FbNumber);
-            if (it == FbMc5codeMap.end())
+            // Don't add the same warning for every remaining DB.
+            AddWarning(
+                DbNumber,
+                CS7PError(
+                    L"Stopped parsing DBs at DB" + std::to_wstring(DbNumber) + L", because the project exceeds the maximum of " +
+                    std::to_wstring(Options.MaxSymbolsPerProject) + L" symbols"
+                )
+            );
+
+            if (pSubblockListInfo)
+            {
+                pSubblockListInfo->StoppedAtDbNumber = DbNumber;
+            }
+
+            if (pStatistics)
             {
-                // Ignore this DB, but extract all possible information from the remaining ones.
-                DeviceSymbolInfo.Warnings.push_back(
-                    CS7PError(
-                        L"Could not find referenced FB" + std::to_wstring(FbNumber) +
-                        L" while parsing DB" + std::to_wstring(DbNumber)
-                    )
+                _AddDbStatistics(*pStatistics, DbNumber, S7DbStatistics(), DeviceSymbolInfo.Warnings.size() - FirstWarningIndex);
+            }
+
+            break;
+        }
+
+        size_t FbNumber;
+
+        if (strMc5code.empty() && _ExtractFBFromDBReferenceMap(DbReferenceMc5codeMap, DbNumber, FbNumber))
+        {
+            if (pDependencies)
+            {
+                (*pDependencies)[S7BlockKey("DB", DbNumber)].emplace("FB", FbNumber);
+            }
+
+            auto LayoutIt = InstanceLayoutsMap.find(FbNumber);
+            if (LayoutIt == InstanceLayoutsMap.end())
+            {
+                // Find the referenced FB block.
+                const Mc5codeBlockMap& FbMc5codeMap = Mc5codeMap.at("FB");
+                const auto it = FbMc5codeMap.find(FbNumber);
+                if (it == FbMc5codeMap.end())
+                {
+                    // Ignore this DB, but extract all possible information from the remaining ones.
+                    AddWarning(
+                        DbNumber,
+                        CS7PError(
+                            L"Could not find referenced FB" + std::to_wstring(FbNumber) +
+                            L" while parsing DB" + std::to_wstring(DbNumber)
+                        )
+                    );
+
+                    if (pStatistics)
+                    {
+                        _AddDbStatistics(*pStatistics, DbNumber, S7DbStatistics(), DeviceSymbolInfo.Warnings.size() - FirstWarningIndex);
+                    }
+
+                    continue;
+                }
+
+                // Parse the MC5 Code of the referenced FB block into a layout that is shared by all its instance DBs.
+                // The FB itself is the first entry on the instantiation stack, so that an FB containing a multi-instance of itself is caught.
+                auto pLayout = std::make_shared<S7Layout>();
+                auto pTree = (Options.bBuildSymbolTrees && !pStatistics) ? std::make_shared<S7SymbolTree>() : nullptr;
+                InstanceLayoutInfo Info;
+
+                const auto FbKey = std::make_pair(std::string("FB"), FbNumber);
+                const CMc5codeTokenStream& TokenStream = TokenStreamCache.try_emplace(FbKey, it->second, pTemporaryResource).first->second;
+
+                Mc5codeParserContext Context{Options, ProjectSymbolCount, TokenStreamCache, pTemporaryResource, {FbKey}, 0, pStatistics ? &Info.Statistics : nullptr};
+                Context.pTree = pTree.get();
+                Context.pDependencies = pDependencies;
+                // The layout is parsed without a DB number, so neither its addresses nor its errors belong to the first instance DB.
+                auto Result = _ParseSingleDB(pLayout->Symbols, 0, TokenStream, Mc5codeMap, Context);
+                if (const auto pError = std::get_if<CS7PError>(&Result))
+                {
+                    Info.Error = *pError;
+                }
+
+                Info.pLayout = std::move(pLayout);
+                Info.pTree = std::move(pTree);
+                LayoutIt = InstanceLayoutsMap.emplace(FbNumber, std::move(Info)).first;
+            }
+
+            const InstanceLayoutInfo& Info = LayoutIt->second;
+            if (Info.Error.has_value())
+            {
+                // We couldn't completely extract information for the FB - note down a warning for each instance DB.
+                AddWarning(
+                    DbNumber,
+                    CS7PError(L"Instance DB" + std::to_wstring(DbNumber) + L" of FB" + std::to_wstring(FbNumber) + L": " + Info.Error->Message())
                 );
+            }
+
+            if (pStatistics)
+            {
+                // All instance DBs have the statistics of their FB, but their own warnings.
+                _AddDbStatistics(*pStatistics, DbNumber, Info.Statistics, DeviceSymbolInfo.Warnings.size() - FirstWarningIndex);
+                continue;
+            }
+
+            if (Info.pTree)
+            {
+                // Trees don't contain DB numbers, so all instance DBs share the tree of their FB.
+                if (Info.pTree->SymbolCount > 0)
+                {
+                    S7Block& Block = _AddDBBlock(DeviceSymbolInfo, DbNumber);
+                    Block.pSymbolTree = Info.pTree;
+                }
+
+                continue;
+            }
+
+            if (Info.pLayout->Symbols.empty())
+            {
                 continue;
             }
 
-            // Parse this DB using the MC5 Code of the referenced FB block.
-            Result = _ParseSingleDB(Symbols, DbNumber, it->second, Mc5codeMap);
+            // Only reference the shared layout for this block.
+            S7Block& Block = _AddDBBlock(DeviceSymbolInfo, DbNumber);
+            Block.pInstanceLayout = Info.pLayout;
+            continue;
         }
-        else
+
+        if (strMc5code.empty())
         {
             // This DB apparently has no information we can use, so continue with the next one.
             continue;
         }
 
+        // Parse the MC5 Code for this DB.
+        std::vector<S7Symbol> Symbols;
+        S7DbStatistics DbStatistics;
+        auto pTree = (Options.bBuildSymbolTrees && !pStatistics) ? std::make_shared<S7SymbolTree>() : nullptr;
+        CMc5codeTokenStream TokenStream(strMc5code, pTemporaryResource);
+        Mc5codeParserContext Context{Options, ProjectSymbolCount, TokenStreamCache, pTemporaryResource, {}, 0, pStatistics ? &DbStatistics : nullptr};
+        Context.pTree = pTree.get();
+        Context.pDependencies = pDependencies;
+        auto Result = _ParseSingleDB(Symbols, DbNumber, TokenStream, Mc5codeMap, Context);
         if (const auto pError = std::get_if<CS7PError>(&Result))
         {
             // We couldn't completely extract information for this DB - note down a warning.
             // Anyway, we may have successfully extracted the first few symbols, so add what we have.
             // And also try to extract all possible information from the remaining DBs.
-            DeviceSymbolInfo.Warnings.push_back(*pError);
+            AddWarning(DbNumber, *pError);
         }
 
-        if (Symbols.empty())
+        if (pStatistics)
         {
+            _AddDbStatistics(*pStatistics, DbNumber, DbStatistics, DeviceSymbolInfo.Warnings.size() - FirstWarningIndex);
             continue;
         }
 
-        // Construct the block name, which is "DB#" and a human-readable name appended (if available from the DbNamesMap).
-        S7Block& Block = DeviceSymbolInfo.Blocks.emplace_back();
-        Block.strName = "DB" + std::to_string(DbNumber);
+        if (pTree)
+        {
+            if (pTree->SymbolCount > 0)
+            {
+                S7Block& Block = _AddDBBlock(DeviceSymbolInfo, DbNumber);
+                Block.pSymbolTree = std::move(pTree);
+            }
+
+            continue;
+        }
 
-        const auto it = DeviceSymbolInfo.DbNamesMap.find(DbNumber);
-        if (it != DeviceSymbolInfo.DbNamesMap.end())
+        if (Symbols.empty())
         {
-            Block.strName += " (" + it->second + ")";
+            continue;
         }
 
         // Insert the symbols for this block.
+        S7Block& Block = _AddDBBlock(DeviceSymbolInfo, DbNumber);
         Block.Symbols = std::move(Symbols);
     }
 
+    if (pSubblockListInfo)
+    {
+        pSubblockListInfo->BlockRange = {FirstListBlockIndex, DeviceSymbolInfo.Blocks.size() - FirstListBlockIndex};
+        pSubblockListInfo->WarningRange = {FirstListWarningIndex, DeviceSymbolInfo.Warnings.size() - FirstListWarningIndex};
+    }
+
     return std::monostate();
 }
 
+static void
+_ClampSubblockListRange(S7SubblockListRange& Range, size_t Size)
+{
+    // The recorded range only lies outside the device if the caller has modified it since the last parse.
+    Range.First = std::min(Range.First, Size);
+    Range.Count = std::min(Range.Count, Size - Range.First);
+}
+
+template<class T>
+static void
+_MoveToSubblockListRange(std::vector<T>& Elements, S7SubblockListRange& Range, const S7SubblockListRange& OldRange)
+{
+    // The elements of Range are the last ones, and those of OldRange have already been erased.
+    std::rotate(Elements.begin() + OldRange.First, Elements.begin() + Range.First, Elements.end());
+    Range.First = OldRange.First;
+}
+
+static void
+_ShiftSubblockListRange(S7SubblockListRange& Range, const S7SubblockListRange& OldRange, const S7SubblockListRange& NewRange)
+{
+    // Only ranges behind the replaced one move. An empty range at the same position belongs to a Subblock List parsed before.
+    if (Range.First > OldRange.First || (Range.First == OldRange.First && Range.Count > 0))
+    {
+        Range.First = Range.First - OldRange.Count + NewRange.Count;
+    }
+}
+
+template<class ParseFunction>
+static std::variant<std::monostate, CS7PError>
+_ParseInArena(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::string& strPhaseName, const S7ParseOptions& Options, ParseFunction Parse)
+{
+    // All temporaries are drawn from an arena, which is released in one shot when going out of scope.
+    // The counting resources below and above the arena provide the numbers for the memory report.
+    std::pmr::memory_resource* pUpstreamResource = Options.pMemoryResource ? Options.pMemoryResource : std::pmr::get_default_resource();
+    CS7PCountingMemoryResource UpstreamResource(pUpstreamResource);
+    std::pmr::monotonic_buffer_resource Arena(&UpstreamResource);
+    CS7PCountingMemoryResource TemporaryResource(&Arena);
+
+    std::variant<std::monostate, CS7PError> ParseResult = Parse(&TemporaryResource);
+
+    if (Options.pMemoryReport)
+    {
+        S7ParseMemoryReport::Phase Phase;
+        Phase.strName = strPhaseName;
+        Phase.BytesAllocated = TemporaryResource.GetBytesAllocated();
+        Phase.AllocationCount = TemporaryResource.GetAllocationCount();
+        Phase.PeakBytes = UpstreamResource.GetPeakBytes();
+
+        Options.pMemoryReport->PeakBytes = std::max(Options.pMemoryReport->PeakBytes, Phase.PeakBytes);
+        Options.pMemoryReport->Phases.push_back(std::move(Phase));
+    }
+
+    return ParseResult;
+}
+
 static std::variant<std::monostate, CS7PError>
-_ParseSingleOmbstxSubblock(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::wstring& wstrSubblockFilePath)
+_ReadOmbstxSubblock(Mc5codeTypeMap& Mc5codeMap, const std::wstring& wstrSubblockFilePath, const S7ParseOptions& Options, std::pmr::memory_resource* pTemporaryResource)
 {
     // Parse the SUBBLK.DBF dBASE file.
     auto ReadDbfResult = CDbfReader::ReadDbf(wstrSubblockFilePath);
@@ -196,11 +526,11 @@ _ParseSingleOmbstxSubblock(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::wstr
     size_t Mc5codeIndex = std::get<size_t>(GetIndexResult);
 
     // Iterate through all records to collect DB and UDT code information.
-    std::map<size_t, std::string> DbMc5codeMap;
-    std::map<size_t, std::string> DbReferenceMc5codeMap;
-    std::map<size_t, std::string> FbMc5codeMap;
-    std::map<size_t, std::string> SfbMc5codeMap;
-    std::map<size_t, std::string> UdtMc5codeMap;
+    Mc5codeBlockMap DbMc5codeMap(pTemporaryResource);
+    Mc5codeBlockMap DbReferenceMc5codeMap(pTemporaryResource);
+    Mc5codeBlockMap FbMc5codeMap(pTemporaryResource);
+    Mc5codeBlockMap SfbMc5codeMap(pTemporaryResource);
+    Mc5codeBlockMap UdtMc5codeMap(pTemporaryResource);
 
     for (;;)
     {
@@ -229,6 +559,13 @@ _ParseSingleOmbstxSubblock(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::wstr
 
         size_t BlockNumber = Option.value();
 
+        // Drop the records of unselected DBs before storing their MC5 Code, so that _ParseDBs never sees them.
+        const std::string& strSubblockType = Record[SubblktypIndex];
+        if ((strSubblockType == "00006" || strSubblockType == "00066") && !Options.IsDbSelected(BlockNumber))
+        {
+            continue;
+        }
+
         // Get the MC5LEN column and try to convert it to a size_t.
         Option = StrToSizeT(Record[Mc5lenIndex]);
         if (!Option.has_value())
@@ -239,12 +576,10 @@ _ParseSingleOmbstxSubblock(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::wstr
 
         size_t BlockLength = Option.value();
 
-        // Truncate the MC5 code to the block length.
-        std::string strMc5code = std::move(Record[Mc5codeIndex]);
-        if (BlockLength < strMc5code.size())
-        {
-            strMc5code.resize(BlockLength);
-        }
+        // Copy the MC5 code truncated to the block length into the arena, so that it is accounted like all other temporaries.
+        // The record itself is released before reading the next one.
+        const std::string& strRecordMc5code = Record[Mc5codeIndex];
+        const std::string_view svMc5code(strRecordMc5code.data(), std::min(BlockLength, strRecordMc5code.size()));
 
         // What type of record is this?
         if (Record[SubblktypIndex] == "00006")
@@ -252,52 +587,79 @@ _ParseSingleOmbstxSubblock(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::wstr
             // This is a DB block (data block).
             // It's basically everything we are interested in, but its Mc5code may reference FB and UDT blocks.
             // And if it's empty, we have to look into the record with the same block number and subblock type index "00066".
-            DbMc5codeMap[BlockNumber] = strMc5code;
+            DbMc5codeMap[BlockNumber] = svMc5code;
         }
         else if (Record[SubblktypIndex] == "00066")
         {
             // This is part of a DB block.
             // This subblock type contains information about all blocks referenced by a DB block.
             // We are only interested in it if a DB block is empty and this subblock contains a reference to an FB block instead.
-            DbReferenceMc5codeMap[BlockNumber] = strMc5code;
+            DbReferenceMc5codeMap[BlockNumber] = svMc5code;
         }
         else if (Record[SubblktypIndex] == "00004")
         {
             // This is an FB block (function block).
-            FbMc5codeMap[BlockNumber] = strMc5code;
+            FbMc5codeMap[BlockNumber] = svMc5code;
         }
         else if (Record[SubblktypIndex] == "00009")
         {
             // This is an SFB block (system function block).
-            SfbMc5codeMap[BlockNumber] = strMc5code;
+            SfbMc5codeMap[BlockNumber] = svMc5code;
         }
         else if (Record[SubblktypIndex] == "00001")
         {
             // This is a UDT block (custom datatype).
-            UdtMc5codeMap[BlockNumber] = strMc5code;
+            UdtMc5codeMap[BlockNumber] = svMc5code;
         }
     }
 
     // Put them into one big map to rule them all!
-    std::map<std::string, std::map<size_t, std::string>> Mc5codeMap;
     Mc5codeMap["DB"] = std::move(DbMc5codeMap);
     Mc5codeMap["DBREF"] = std::move(DbReferenceMc5codeMap);
     Mc5codeMap["FB"] = std::move(FbMc5codeMap);
     Mc5codeMap["SFB"] = std::move(SfbMc5codeMap);
     Mc5codeMap["UDT"] = std::move(UdtMc5codeMap);
 
-    // Parse all DBs from the MC5 Code.
-    auto ParseResult = _ParseDBs(DeviceSymbolInfo, Mc5codeMap);
-    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    return std::monostate();
+}
+
+std::variant<std::monostate, CS7PError>
+ParseMc5code(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::map<std::string, std::map<size_t, std::string>>& Mc5code, const S7ParseOptions& Options, size_t& ProjectSymbolCount, S7DeviceStatistics* pStatistics)
+{
+    return _ParseInArena(DeviceSymbolInfo, "MC5 Code of " + DeviceSymbolInfo.strName, Options, [&](std::pmr::memory_resource* pTemporaryResource)
     {
-        return *pError;
-    }
+        // _ParseDBs expects all block types to be present, and the MC5 Code in the arena like _ReadOmbstxSubblock puts it.
+        Mc5codeTypeMap Mc5codeMap(pTemporaryResource);
+        for (const char* szType : { "DB", "DBREF", "FB", "SFB", "UDT" })
+        {
+            Mc5codeMap[szType];
+        }
 
-    return std::monostate();
+        for (const auto& [strType, BlockMap] : Mc5code)
+        {
+            const auto TypeIt = Mc5codeMap.find(strType);
+            if (TypeIt == Mc5codeMap.end())
+            {
+                return std::variant<std::monostate, CS7PError>(CS7PError(L"Unknown MC5 Code block type: " + StrToWstr(strType)));
+            }
+
+            for (const auto& [BlockNumber, strMc5code] : BlockMap)
+            {
+                if (strType.compare(0, 2, "DB") == 0 && !Options.IsDbSelected(BlockNumber))
+                {
+                    continue;
+                }
+
+                TypeIt->second.emplace(BlockNumber, std::string_view(strMc5code));
+            }
+        }
+
+        return _ParseDBs(DeviceSymbolInfo, Mc5codeMap, Options, ProjectSymbolCount, pTemporaryResource, pStatistics);
+    });
 }
 
 std::variant<std::monostate, CS7PError>
-ParseOmbstx(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<S7DeviceIdInfo>& DeviceIdInfos, const std::wstring& wstrS7PFolderPath)
+ParseOmbstxSubblockListIds(std::vector<size_t>& SubblockListIds, const std::wstring& wstrS7PFolderPath)
 {
     // Parse the BSTCNTOF.DBF dBASE file.
     auto ReadDbfResult = CDbfReader::ReadDbf(wstrS7PFolderPath + L"\\ombstx\\offline\\BSTCNTOF.DBF");
@@ -341,15 +703,227 @@ ParseOmbstx(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vecto
             return CS7PError(L"Invalid BSTCNFOF.DBF ID: " + StrToWstr(Record[IdIndex]));
         }
 
-        size_t SubblockListId = Option.value();
+        SubblockListIds.push_back(Option.value());
+    }
+
+    return std::monostate();
+}
+
+std::variant<std::monostate, CS7PError>
+ParseOmbstxSubblockList(S7DeviceSymbolInfo& DeviceSymbolInfo, size_t SubblockListId, const std::wstring& wstrS7PFolderPath, const S7ParseOptions& Options, size_t& ProjectSymbolCount, S7DeviceStatistics* pStatistics)
+{
+    return _ParseInArena(DeviceSymbolInfo, "Subblock List of " + DeviceSymbolInfo.strName, Options, [&](std::pmr::memory_resource* pTemporaryResource)
+    {
+        Mc5codeTypeMap Mc5codeMap(pTemporaryResource);
+        auto Result = _ReadOmbstxSubblock(Mc5codeMap, _GetSubblockFilePath(wstrS7PFolderPath, SubblockListId), Options, pTemporaryResource);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return Result;
+        }
+
+        // Statistics don't add any blocks, so there is nothing to reparse later.
+        S7SubblockListInfo* pSubblockListInfo = nullptr;
+        if (!pStatistics)
+        {
+            pSubblockListInfo = &DeviceSymbolInfo.SubblockListInfos[SubblockListId];
+            *pSubblockListInfo = S7SubblockListInfo();
+            _HashMc5codeMap(Mc5codeMap, pSubblockListInfo->CodeHashes);
+        }
+
+        // Parse all DBs from the MC5 Code.
+        return _ParseDBs(DeviceSymbolInfo, Mc5codeMap, Options, ProjectSymbolCount, pTemporaryResource, pStatistics, pSubblockListInfo);
+    });
+}
+
+std::variant<std::monostate, CS7PError>
+ReparseOmbstxSubblockList(S7DeviceSymbolInfo& DeviceSymbolInfo, std::vector<size_t>& ReparsedDbNumbers, size_t SubblockListId, const std::wstring& wstrS7PFolderPath, const S7ParseOptions& Options, size_t& ProjectSymbolCount)
+{
+    return _ParseInArena(DeviceSymbolInfo, "Subblock List of " + DeviceSymbolInfo.strName, Options, [&](std::pmr::memory_resource* pTemporaryResource)
+    {
+        Mc5codeTypeMap Mc5codeMap(pTemporaryResource);
+        auto Result = _ReadOmbstxSubblock(Mc5codeMap, _GetSubblockFilePath(wstrS7PFolderPath, SubblockListId), Options, pTemporaryResource);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return Result;
+        }
+
+        // Without a previous parse of this Subblock List, everything is new and appended to the device.
+        S7SubblockListInfo OldInfo;
+        OldInfo.BlockRange.First = DeviceSymbolInfo.Blocks.size();
+        OldInfo.WarningRange.First = DeviceSymbolInfo.Warnings.size();
+
+        auto OldInfoIt = DeviceSymbolInfo.SubblockListInfos.find(SubblockListId);
+        if (OldInfoIt != DeviceSymbolInfo.SubblockListInfos.end())
+        {
+            OldInfo = std::move(OldInfoIt->second);
+        }
+
+        _ClampSubblockListRange(OldInfo.BlockRange, DeviceSymbolInfo.Blocks.size());
+        _ClampSubblockListRange(OldInfo.WarningRange, DeviceSymbolInfo.Warnings.size());
+
+        S7SubblockListInfo& NewInfo = DeviceSymbolInfo.SubblockListInfos[SubblockListId];
+        NewInfo = S7SubblockListInfo();
+        _HashMc5codeMap(Mc5codeMap, NewInfo.CodeHashes);
+
+        // A block is dirty if it has been added, removed, or changed.
+        std::set<S7BlockKey> DirtyKeys;
+        for (const auto& [Key, Hash] : NewInfo.CodeHashes)
+        {
+            auto OldIt = OldInfo.CodeHashes.find(Key);
+            if (OldIt == OldInfo.CodeHashes.end() || OldIt->second != Hash)
+            {
+                DirtyKeys.insert(Key);
+            }
+        }
+
+        for (const auto& [Key, Hash] : OldInfo.CodeHashes)
+        {
+            if (!NewInfo.CodeHashes.contains(Key))
+            {
+                DirtyKeys.insert(Key);
+            }
+        }
+
+        // So is every block that (transitively) depends on a dirty block.
+        // Walk the dependency edges backwards until no more blocks become dirty.
+        std::map<S7BlockKey, std::vector<S7BlockKey>> Dependents;
+        for (const auto& [Key, Dependencies] : OldInfo.Dependencies)
+        {
+            for (const S7BlockKey& Dependency : Dependencies)
+            {
+                Dependents[Dependency].push_back(Key);
+            }
+        }
+
+        std::vector<S7BlockKey> PendingKeys(DirtyKeys.begin(), DirtyKeys.end());
+        while (!PendingKeys.empty())
+        {
+            S7BlockKey Key = std::move(PendingKeys.back());
+            PendingKeys.pop_back();
+
+            auto DependentsIt = Dependents.find(Key);
+            if (DependentsIt == Dependents.end())
+            {
+                continue;
+            }
+
+            for (const S7BlockKey& Dependent : DependentsIt->second)
+            {
+                if (DirtyKeys.insert(Dependent).second)
+                {
+                    PendingKeys.push_back(Dependent);
+                }
+            }
+        }
+
+        // Edges of blocks that are not dirty remain valid, the others are recorded again by _ParseDBs.
+        for (auto& [Key, Dependencies] : OldInfo.Dependencies)
+        {
+            if (!DirtyKeys.contains(Key))
+            {
+                NewInfo.Dependencies.emplace(Key, std::move(Dependencies));
+            }
+        }
+
+        // Remove all warnings of the previous parse of this Subblock List.
+        // Those of reused DBs are added again by _ParseDBs, in the order of the DBs.
+        auto WarningsBegin = DeviceSymbolInfo.Warnings.begin() + OldInfo.WarningRange.First;
+        DeviceSymbolInfo.Warnings.erase(WarningsBegin, WarningsBegin + OldInfo.WarningRange.Count);
+
+        // A DB can be reused if it has been parsed before and neither its own records nor anything it depends on has changed.
+        std::map<size_t, ReusableDbInfo> ReusableDbs;
+        for (const auto& [Key, Hash] : OldInfo.CodeHashes)
+        {
+            const auto& [strType, DbNumber] = Key;
+            if (strType == "DB" &&
+                (!OldInfo.StoppedAtDbNumber.has_value() || DbNumber < OldInfo.StoppedAtDbNumber.value()) &&
+                !DirtyKeys.contains(Key) &&
+                !DirtyKeys.contains(S7BlockKey("DBREF", DbNumber)))
+            {
+                ReusableDbInfo& ReusableDb = ReusableDbs[DbNumber];
+
+                auto WarningsIt = OldInfo.DbWarnings.find(DbNumber);
+                if (WarningsIt != OldInfo.DbWarnings.end())
+                {
+                    ReusableDb.Warnings = std::move(WarningsIt->second);
+                }
+            }
+        }
+
+        // Take the previous DB blocks of this Subblock List out of the device.
+        // The Symbol List and the DBs of other Subblock Lists stay where they are.
+        auto BlocksBegin = DeviceSymbolInfo.Blocks.begin() + OldInfo.BlockRange.First;
+        auto BlocksEnd = BlocksBegin + OldInfo.BlockRange.Count;
+        for (auto BlockIt = BlocksBegin; BlockIt != BlocksEnd; ++BlockIt)
+        {
+            auto ReusableIt = ReusableDbs.find(BlockIt->DbNumber);
+            if (ReusableIt != ReusableDbs.end())
+            {
+                ReusableIt->second.Block = std::move(*BlockIt);
+            }
+        }
+
+        DeviceSymbolInfo.Blocks.erase(BlocksBegin, BlocksEnd);
+
+        // Report every DB that is parsed again, added, or gone.
+        std::set<size_t> DbNumbers;
+        for (const auto& [Key, Hash] : OldInfo.CodeHashes)
+        {
+            if (Key.first == "DB")
+            {
+                DbNumbers.insert(Key.second);
+            }
+        }
 
-        // Construct the full path to the SUBBLK.DBF in the Subblock List subdirectory.
-        // (e.g. "...\ombstx\offline\00000005\SUBBLK.DBF")
-        std::wostringstream wssSubblockFilePath;
-        wssSubblockFilePath << wstrS7PFolderPath << L"\\ombstx\\offline\\";
-        wssSubblockFilePath << std::hex << std::setfill(L'0') << std::setw(8) << SubblockListId;
-        wssSubblockFilePath << L"\\SUBBLK.DBF";
+        for (const auto& [Key, Hash] : NewInfo.CodeHashes)
+        {
+            if (Key.first == "DB")
+            {
+                DbNumbers.insert(Key.second);
+            }
+        }
+
+        ReparsedDbNumbers.clear();
+        std::copy_if(DbNumbers.begin(), DbNumbers.end(), std::back_inserter(ReparsedDbNumbers), [&](size_t DbNumber)
+        {
+            return !ReusableDbs.contains(DbNumber);
+        });
+
+        auto ParseResult = _ParseDBs(DeviceSymbolInfo, Mc5codeMap, Options, ProjectSymbolCount, pTemporaryResource, nullptr, &NewInfo, &ReusableDbs);
+
+        // _ParseDBs has appended the blocks and warnings of this Subblock List.
+        // Move them back to where the previous ones were, so that the device is ordered like after a full parse.
+        _MoveToSubblockListRange(DeviceSymbolInfo.Blocks, NewInfo.BlockRange, OldInfo.BlockRange);
+        _MoveToSubblockListRange(DeviceSymbolInfo.Warnings, NewInfo.WarningRange, OldInfo.WarningRange);
+
+        for (auto& [OtherSubblockListId, OtherInfo] : DeviceSymbolInfo.SubblockListInfos)
+        {
+            if (OtherSubblockListId != SubblockListId)
+            {
+                _ShiftSubblockListRange(OtherInfo.BlockRange, OldInfo.BlockRange, NewInfo.BlockRange);
+                _ShiftSubblockListRange(OtherInfo.WarningRange, OldInfo.WarningRange, NewInfo.WarningRange);
+            }
+        }
+
+        return ParseResult;
+    });
+}
 
+std::variant<std::monostate, CS7PError>
+ParseOmbstx(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<S7DeviceIdInfo>& DeviceIdInfos, const std::wstring& wstrS7PFolderPath, const S7ParseOptions& Options)
+{
+    std::vector<size_t> SubblockListIds;
+    auto Result = ParseOmbstxSubblockListIds(SubblockListIds, wstrS7PFolderPath);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    // Number of DB symbols over all devices, checked against Options.MaxSymbolsPerProject.
+    size_t ProjectSymbolCount = 0;
+
+    for (size_t SubblockListId : SubblockListIds)
+    {
         // Find the Device that corresponds to this Subblock List.
         const auto& DeviceIdInfoIt = std::find_if(DeviceIdInfos.begin(), DeviceIdInfos.end(), [&](const S7DeviceIdInfo& other)
         {
@@ -364,8 +938,15 @@ ParseOmbstx(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vecto
             continue;
         }
 
-        // Find the corresponding entry in the DeviceSymbolInfos vector.
+        // Skip devices that haven't been selected without even reading their SUBBLK.DBF.
+        // ParseYDBs hasn't added a DeviceSymbolInfo for them either.
         const std::string& strDeviceName = DeviceIdInfoIt->strName;
+        if (!Options.IsDeviceSelected(strDeviceName))
+        {
+            continue;
+        }
+
+        // Find the corresponding entry in the DeviceSymbolInfos vector.
         auto DeviceSymbolInfoIt = std::find_if(DeviceSymbolInfos.begin(), DeviceSymbolInfos.end(), [&](const S7DeviceSymbolInfo& other)
         {
             return other.strName == strDeviceName;
@@ -380,8 +961,8 @@ ParseOmbstx(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vecto
         }
 
         // Parse this subblock.
-        auto ParseResult = _ParseSingleOmbstxSubblock(*DeviceSymbolInfoIt, wssSubblockFilePath.str());
-        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        Result = ParseOmbstxSubblockList(*DeviceSymbolInfoIt, SubblockListId, wstrS7PFolderPath, Options, ProjectSymbolCount);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
         {
             return *pError;
         }
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <variant>
 #include <vector>
@@ -14,8 +15,57 @@
 #include "s7p_device_id_info_parser.h"
 #include "s7p_parser.h"
 
+// Parses DBs from MC5 Code held in memory instead of a Subblock List, by block type ("DB", "DBREF", "FB", "SFB", "UDT") and block number.
+// This makes CMc5codeParser usable on declaration texts outside a project, e.g. for profiling it on a corpus.
+// Like ParseOmbstxSubblockList, it adds a phase to Options.pMemoryReport and only counts the DBs into pStatistics if that is set.
+std::variant<std::monostate, CS7PError> ParseMc5code(
+    S7DeviceSymbolInfo& DeviceSymbolInfo,
+    const std::map<std::string, std::map<size_t, std::string>>& Mc5code,
+    const S7ParseOptions& Options,
+    size_t& ProjectSymbolCount,
+    S7DeviceStatistics* pStatistics = nullptr
+    );
+
+// Parses the DBs of all devices.
 std::variant<std::monostate, CS7PError> ParseOmbstx(
     std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos,
     const std::vector<S7DeviceIdInfo>& DeviceIdInfos,
+    const std::wstring& wstrS7PFolderPath,
+    const S7ParseOptions& Options
+    );
+
+// Returns the IDs of all Subblock Lists referenced by BSTCNTOF.DBF.
+std::variant<std::monostate, CS7PError> ParseOmbstxSubblockListIds(
+    std::vector<size_t>& SubblockListIds,
     const std::wstring& wstrS7PFolderPath
     );
+
+// Parses the DBs of a single device from its Subblock List.
+// ProjectSymbolCount is the number of DB symbols parsed so far over all devices, checked against Options.MaxSymbolsPerProject.
+// If pStatistics is set, the DBs are only counted into it and no blocks are added to DeviceSymbolInfo (warnings still are).
+std::variant<std::monostate, CS7PError> ParseOmbstxSubblockList(
+    S7DeviceSymbolInfo& DeviceSymbolInfo,
+    size_t SubblockListId,
+    const std::wstring& wstrS7PFolderPath,
+    const S7ParseOptions& Options,
+    size_t& ProjectSymbolCount,
+    S7DeviceStatistics* pStatistics = nullptr
+    );
+
+// Parses a Subblock List again after it has changed on disk, e.g. from CS7PProjectWatcher.
+// Only DBs whose MC5 Code or any (transitively) referenced FB, SFB or UDT block has changed since the last parse are parsed again.
+// All other DBs keep their blocks and warnings. This needs the DeviceSymbolInfo.SubblockListInfos entry recorded by that parse,
+// and the same Options. Without that entry, the whole Subblock List is parsed again.
+// ReparsedDbNumbers returns the DBs that have been parsed again, added, or removed.
+// Pass a ProjectSymbolCount that excludes this Subblock List. The symbols of all its DBs are added to it, including those of reused DBs.
+// The blocks and warnings of this Subblock List are put back at their previous position in DeviceSymbolInfo.
+// Reparsed DBs still get new symbols, and the blocks behind them move if DBs have been added or removed.
+// Hence, anything derived from the blocks (e.g. a CS7SymbolIndex or CS7SymbolNameTable) has to be rebuilt afterwards.
+std::variant<std::monostate, CS7PError> ReparseOmbstxSubblockList(
+    S7DeviceSymbolInfo& DeviceSymbolInfo,
+    std::vector<size_t>& ReparsedDbNumbers,
+    size_t SubblockListId,
+    const std::wstring& wstrS7PFolderPath,
+    const S7ParseOptions& Options,
+    size_t& ProjectSymbolCount
+    );
@@ -10,6 +10,7 @@
 #include <EnlyzeWinStringLib.h>
 #include <CDbfReader.h>
 
+#include "s7p_cp1252.h"
 #include "s7p_device_id_info_parser.h"
 
 struct IntermediateInfo
@@ -97,7 +98,8 @@ _ParseStations(std::vector<IntermediateInfo>& StationInfos, const std::wstring&
 
         // Yes, then collect information about it.
         IntermediateInfo& Info = StationInfos.emplace_back();
-        Info.strName = it->second + ": " + Str1252ToStr(Record[NameIndex]);
+        Info.strName = it->second + ": ";
+        AppendCp1252AsUtf8(Info.strName, Record[NameIndex]);
         Info.strObjId = Record[IdIndex];
         Info.strObjTyp = Record[ObjTypIndex];
     }
@@ -272,7 +274,8 @@ _ParseDevices(std::vector<IntermediateInfo>& DeviceInfos, const std::wstring& ws
 
             // Yes, then extend the name and collect it.
             IntermediateInfo& Info = DeviceInfos.emplace_back();
-            Info.strName = PreviousInfo.strName + " -> " + Str1252ToStr(Record[NameIndex]);
+            Info.strName = PreviousInfo.strName + " -> ";
+            AppendCp1252AsUtf8(Info.strName, Record[NameIndex]);
             Info.strObjId = PreviousInfo.strObjId;
             Info.strObjTyp = PreviousInfo.strObjTyp;
         }
@@ -356,7 +359,7 @@ _ParseResoffAndLinkhrs(std::vector<S7DeviceIdInfo>& DeviceIdInfos, const std::ws
             }
         }
 
-        Info.strName += Str1252ToStr(Record[NameIndex]);
+        AppendCp1252AsUtf8(Info.strName, Record[NameIndex]);
 
         // Convert the RSRVD4_L column value to a size_t.
         // It describes an offset in the linkhrs.lnk file.
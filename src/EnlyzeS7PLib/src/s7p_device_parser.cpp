@@ -0,0 +1,165 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <utility>
+#include <EnlyzeWinStringLib.h>
+
+#include "s7p_db_parser.h"
+#include "s7p_device_id_info_parser.h"
+#include "s7p_device_parser.h"
+#include "s7p_symbol_list_parser.h"
+
+
+std::variant<S7DeviceSymbolInfo, CS7PError>
+ParseDevice(const S7DeviceFiles& DeviceFiles, const std::wstring& wstrS7PFolderPath, const S7ParseOptions& Options, size_t& ProjectSymbolCount)
+{
+    S7DeviceSymbolInfo DeviceSymbolInfo;
+    DeviceSymbolInfo.strName = DeviceFiles.strName;
+
+    // Parse the Symbol List of this device.
+    auto Result = ParseYDBSymbolList(DeviceSymbolInfo, DeviceFiles.wstrSymbolListFilePath, Options);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    // Parse its Subblock Lists.
+    for (size_t SubblockListId : DeviceFiles.SubblockListIds)
+    {
+        Result = ParseOmbstxSubblockList(DeviceSymbolInfo, SubblockListId, wstrS7PFolderPath, Options, ProjectSymbolCount);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return *pError;
+        }
+    }
+
+    return DeviceSymbolInfo;
+}
+
+std::variant<S7DeviceStatistics, CS7PError>
+ParseDeviceStatistics(const S7DeviceFiles& DeviceFiles, const std::wstring& wstrS7PFolderPath, const S7ParseOptions& Options, size_t& ProjectSymbolCount)
+{
+    S7DeviceStatistics DeviceStatistics;
+    DeviceStatistics.strName = DeviceFiles.strName;
+
+    // Only collects the warnings, no DB is added to it in statistics mode.
+    S7DeviceSymbolInfo DeviceSymbolInfo;
+    DeviceSymbolInfo.strName = DeviceFiles.strName;
+
+    // DB names from the Symbol List don't show up in statistics, so it is only parsed for its symbol count.
+    if (Options.bParseSymbolLists)
+    {
+        auto Result = ParseYDBSymbolList(DeviceSymbolInfo, DeviceFiles.wstrSymbolListFilePath, Options);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return *pError;
+        }
+
+        for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+        {
+            DeviceStatistics.SymbolListSymbolCount += Block.Symbols.size();
+        }
+    }
+
+    for (size_t SubblockListId : DeviceFiles.SubblockListIds)
+    {
+        auto Result = ParseOmbstxSubblockList(DeviceSymbolInfo, SubblockListId, wstrS7PFolderPath, Options, ProjectSymbolCount, &DeviceStatistics);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return *pError;
+        }
+    }
+
+    DeviceStatistics.WarningCount = DeviceSymbolInfo.Warnings.size();
+    return DeviceStatistics;
+}
+
+std::variant<std::monostate, CS7PError>
+ParseDeviceFiles(std::vector<S7DeviceFiles>& DeviceFiles, const std::wstring& wstrS7PFolderPath, const S7ParseOptions& Options)
+{
+    // This mirrors what ParseYDBs and ParseOmbstx do, but only reads the files listing the devices.
+    std::vector<S7DeviceIdInfo> DeviceIdInfos;
+    auto Result = ParseDeviceIdInfos(DeviceIdInfos, wstrS7PFolderPath);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    // Every device has a Symbol List.
+    std::vector<std::pair<size_t, std::wstring>> SymbolListPaths;
+    Result = ParseYDBSymbolListPaths(SymbolListPaths, wstrS7PFolderPath);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    for (auto& [SymbolListId, wstrSymbolListFilePath] : SymbolListPaths)
+    {
+        const auto DeviceIdInfoIt = std::find_if(DeviceIdInfos.begin(), DeviceIdInfos.end(), [&](const S7DeviceIdInfo& other)
+        {
+            return other.SymbolListId == SymbolListId;
+        });
+
+        if (DeviceIdInfoIt == DeviceIdInfos.end())
+        {
+            return CS7PError(L"Could not find DeviceIdInfo for Symbol List " + std::to_wstring(SymbolListId));
+        }
+
+        if (!Options.IsDeviceSelected(DeviceIdInfoIt->strName))
+        {
+            continue;
+        }
+
+        S7DeviceFiles& NewDeviceFiles = DeviceFiles.emplace_back();
+        NewDeviceFiles.strName = DeviceIdInfoIt->strName;
+        NewDeviceFiles.wstrSymbolListFilePath = std::move(wstrSymbolListFilePath);
+    }
+
+    if (!Options.bParseDBs)
+    {
+        return std::monostate();
+    }
+
+    // Assign the Subblock Lists to their devices.
+    std::vector<size_t> SubblockListIds;
+    Result = ParseOmbstxSubblockListIds(SubblockListIds, wstrS7PFolderPath);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    for (size_t SubblockListId : SubblockListIds)
+    {
+        const auto DeviceIdInfoIt = std::find_if(DeviceIdInfos.begin(), DeviceIdInfos.end(), [&](const S7DeviceIdInfo& other)
+        {
+            return other.SubblockListId == SubblockListId;
+        });
+
+        // See ParseOmbstx for why Subblock Lists without a device and unselected devices are skipped silently.
+        if (DeviceIdInfoIt == DeviceIdInfos.end() || !Options.IsDeviceSelected(DeviceIdInfoIt->strName))
+        {
+            continue;
+        }
+
+        const auto DeviceFilesIt = std::find_if(DeviceFiles.begin(), DeviceFiles.end(), [&](const S7DeviceFiles& other)
+        {
+            return other.strName == DeviceIdInfoIt->strName;
+        });
+
+        if (DeviceFilesIt == DeviceFiles.end())
+        {
+            return CS7PError(
+                L"Could not find DeviceSymbolInfo for \"" + StrToWstr(DeviceIdInfoIt->strName) +
+                L"\" and Subblock List " + std::to_wstring(SubblockListId)
+            );
+        }
+
+        DeviceFilesIt->SubblockListIds.push_back(SubblockListId);
+    }
+
+    return std::monostate();
+}
@@ -0,0 +1,47 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_parser.h"
+
+// Files making up the symbols of a single device.
+struct S7DeviceFiles
+{
+    std::string strName;
+    std::wstring wstrSymbolListFilePath;
+    std::vector<size_t> SubblockListIds;
+};
+
+// Collects the statistics of a single device, see ParseS7PStatistics.
+std::variant<S7DeviceStatistics, CS7PError> ParseDeviceStatistics(
+    const S7DeviceFiles& DeviceFiles,
+    const std::wstring& wstrS7PFolderPath,
+    const S7ParseOptions& Options,
+    size_t& ProjectSymbolCount
+    );
+
+// Reads the device list of a project (DeviceIdInfos, SYMLISTS.DBF and BSTCNTOF.DBF) without parsing any Symbol List or Subblock List.
+// The devices are in the same order as in the result of ParseS7P.
+std::variant<std::monostate, CS7PError> ParseDeviceFiles(
+    std::vector<S7DeviceFiles>& DeviceFiles,
+    const std::wstring& wstrS7PFolderPath,
+    const S7ParseOptions& Options
+    );
+
+// Parses the Symbol List and Subblock Lists of a single device.
+// ProjectSymbolCount is the number of DB symbols parsed so far over all devices, checked against Options.MaxSymbolsPerProject.
+std::variant<S7DeviceSymbolInfo, CS7PError> ParseDevice(
+    const S7DeviceFiles& DeviceFiles,
+    const std::wstring& wstrS7PFolderPath,
+    const S7ParseOptions& Options,
+    size_t& ProjectSymbolCount
+    );
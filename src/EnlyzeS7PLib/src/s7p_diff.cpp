@@ -0,0 +1,358 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "s7p_diff.h"
+
+static const uint64_t FnvOffsetBasis = 14695981039346656037ull;
+static const uint64_t FnvPrime = 1099511628211ull;
+
+
+static uint64_t
+_HashBytes(uint64_t Hash, const void* pData, size_t Size)
+{
+    // 64-bit FNV-1a
+    const unsigned char* p = static_cast<const unsigned char*>(pData);
+    for (size_t i = 0; i < Size; i++)
+    {
+        Hash ^= p[i];
+        Hash *= FnvPrime;
+    }
+
+    return Hash;
+}
+
+static uint64_t
+_HashString(uint64_t Hash, const std::string& str)
+{
+    // Hash the size as well, so that e.g. "ab" + "c" and "a" + "bc" don't collide.
+    size_t Size = str.size();
+    Hash = _HashBytes(Hash, &Size, sizeof(Size));
+    return _HashBytes(Hash, str.data(), str.size());
+}
+
+static uint64_t
+_HashAddress(uint64_t Hash, const S7Address& Address)
+{
+    Hash = _HashBytes(Hash, &Address.Area, sizeof(Address.Area));
+    Hash = _HashBytes(Hash, &Address.DbNumber, sizeof(Address.DbNumber));
+    Hash = _HashBytes(Hash, &Address.BitOffset, sizeof(Address.BitOffset));
+    Hash = _HashBytes(Hash, &Address.BitSize, sizeof(Address.BitSize));
+    return _HashBytes(Hash, &Address.ElementCount, sizeof(Address.ElementCount));
+}
+
+static uint64_t
+_HashBlock(const S7Block& Block)
+{
+    uint64_t Hash = FnvOffsetBasis;
+
+    for (const S7Symbol& Symbol : Block.GetSymbols())
+    {
+        Hash = _HashString(Hash, Symbol.strName);
+        Hash = _HashString(Hash, Symbol.strDatatype);
+        Hash = _HashString(Hash, Symbol.strComment);
+        Hash = _HashAddress(Hash, Block.GetAddress(Symbol));
+        Hash = _HashString(Hash, Symbol.strRawCode);
+    }
+
+    return Hash;
+}
+
+static S7DeviceHashes
+_HashDevice(const S7DeviceSymbolInfo& DeviceSymbolInfo)
+{
+    // Combine the hashes of all blocks and their names into a hash for the device.
+    S7DeviceHashes DeviceHashes;
+    DeviceHashes.Hash = FnvOffsetBasis;
+    DeviceHashes.BlockHashes.reserve(DeviceSymbolInfo.Blocks.size());
+
+    for (const S7Block& Block : DeviceSymbolInfo.Blocks)
+    {
+        uint64_t Hash = _HashBlock(Block);
+        DeviceHashes.BlockHashes.push_back(Hash);
+        DeviceHashes.Hash = _HashString(_HashBytes(DeviceHashes.Hash, &Hash, sizeof(Hash)), Block.strName);
+    }
+
+    return DeviceHashes;
+}
+
+static bool
+_AreAddressesEqual(const S7Address& a, const S7Address& b)
+{
+    return a.Area == b.Area &&
+        a.DbNumber == b.DbNumber &&
+        a.BitOffset == b.BitOffset &&
+        a.BitSize == b.BitSize &&
+        a.ElementCount == b.ElementCount;
+}
+
+static void
+_AddAllSymbols(std::vector<S7Change>& Changes, S7ChangeKind Kind, size_t DeviceIndex, size_t BlockIndex, const S7Block& Block)
+{
+    for (size_t SymbolIndex = 0; SymbolIndex < Block.GetSymbols().size(); SymbolIndex++)
+    {
+        S7Change& Change = Changes.emplace_back();
+        Change.Kind = Kind;
+        Change.ModifiedFlags = 0;
+
+        S7SymbolPosition& Position = (Kind == S7ChangeKind::Added) ? Change.NewPosition : Change.OldPosition;
+        Position = { DeviceIndex, BlockIndex, SymbolIndex };
+    }
+}
+
+static void
+_DiffBlock(std::vector<S7Change>& Changes, size_t OldDeviceIndex, size_t OldBlockIndex, const S7Block& OldBlock, size_t NewDeviceIndex, size_t NewBlockIndex, const S7Block& NewBlock)
+{
+    const std::vector<S7Symbol>& OldSymbols = OldBlock.GetSymbols();
+    const std::vector<S7Symbol>& NewSymbols = NewBlock.GetSymbols();
+
+    // Match the symbols by name.
+    std::unordered_map<std::string_view, size_t> OldSymbolIndexes;
+    OldSymbolIndexes.reserve(OldSymbols.size());
+
+    for (size_t i = 0; i < OldSymbols.size(); i++)
+    {
+        OldSymbolIndexes.emplace(OldSymbols[i].strName, i);
+    }
+
+    std::vector<bool> OldSymbolMatched(OldSymbols.size(), false);
+
+    for (size_t NewSymbolIndex = 0; NewSymbolIndex < NewSymbols.size(); NewSymbolIndex++)
+    {
+        const S7Symbol& NewSymbol = NewSymbols[NewSymbolIndex];
+
+        const auto it = OldSymbolIndexes.find(NewSymbol.strName);
+        if (it == OldSymbolIndexes.end())
+        {
+            S7Change& Change = Changes.emplace_back();
+            Change.Kind = S7ChangeKind::Added;
+            Change.ModifiedFlags = 0;
+            Change.NewPosition = { NewDeviceIndex, NewBlockIndex, NewSymbolIndex };
+            continue;
+        }
+
+        size_t OldSymbolIndex = it->second;
+        const S7Symbol& OldSymbol = OldSymbols[OldSymbolIndex];
+        OldSymbolMatched[OldSymbolIndex] = true;
+
+        uint8_t ModifiedFlags = 0;
+        if (!_AreAddressesEqual(OldBlock.GetAddress(OldSymbol), NewBlock.GetAddress(NewSymbol)) || OldSymbol.strRawCode != NewSymbol.strRawCode)
+        {
+            ModifiedFlags |= S7ChangeReaddressed;
+        }
+
+        if (OldSymbol.strDatatype != NewSymbol.strDatatype)
+        {
+            ModifiedFlags |= S7ChangeRetyped;
+        }
+
+        if (OldSymbol.strComment != NewSymbol.strComment)
+        {
+            ModifiedFlags |= S7ChangeRecommented;
+        }
+
+        if (ModifiedFlags)
+        {
+            S7Change& Change = Changes.emplace_back();
+            Change.Kind = S7ChangeKind::Modified;
+            Change.ModifiedFlags = ModifiedFlags;
+            Change.OldPosition = { OldDeviceIndex, OldBlockIndex, OldSymbolIndex };
+            Change.NewPosition = { NewDeviceIndex, NewBlockIndex, NewSymbolIndex };
+        }
+    }
+
+    // All old symbols without a match have been removed.
+    for (size_t OldSymbolIndex = 0; OldSymbolIndex < OldSymbols.size(); OldSymbolIndex++)
+    {
+        if (!OldSymbolMatched[OldSymbolIndex])
+        {
+            S7Change& Change = Changes.emplace_back();
+            Change.Kind = S7ChangeKind::Removed;
+            Change.ModifiedFlags = 0;
+            Change.OldPosition = { OldDeviceIndex, OldBlockIndex, OldSymbolIndex };
+        }
+    }
+}
+
+static void
+_DiffDevice(std::vector<S7Change>& Changes, size_t OldDeviceIndex, const S7DeviceSymbolInfo& OldDevice, const S7DeviceHashes& OldHashes, size_t NewDeviceIndex, const S7DeviceSymbolInfo& NewDevice, const S7DeviceHashes& NewHashes)
+{
+    // Skip identical devices without looking at their blocks.
+    if (OldHashes.Hash == NewHashes.Hash)
+    {
+        return;
+    }
+
+    // Index the old blocks.
+    // DBs are matched by number, so that renaming a DB doesn't report all of its symbols as removed and added.
+    // Blocks without a DB number (i.e. the Symbol List) are matched by name.
+    std::unordered_map<uint16_t, size_t> OldDbBlockIndexes;
+    std::unordered_map<std::string_view, size_t> OldOtherBlockIndexes;
+    OldDbBlockIndexes.reserve(OldDevice.Blocks.size());
+
+    for (size_t i = 0; i < OldDevice.Blocks.size(); i++)
+    {
+        const S7Block& OldBlock = OldDevice.Blocks[i];
+        if (OldBlock.DbNumber)
+        {
+            OldDbBlockIndexes.emplace(OldBlock.DbNumber, i);
+        }
+        else
+        {
+            OldOtherBlockIndexes.emplace(OldBlock.strName, i);
+        }
+    }
+
+    std::vector<bool> OldBlockMatched(OldDevice.Blocks.size(), false);
+
+    for (size_t NewBlockIndex = 0; NewBlockIndex < NewDevice.Blocks.size(); NewBlockIndex++)
+    {
+        const S7Block& NewBlock = NewDevice.Blocks[NewBlockIndex];
+
+        size_t OldBlockIndex;
+        if (NewBlock.DbNumber)
+        {
+            const auto it = OldDbBlockIndexes.find(NewBlock.DbNumber);
+            OldBlockIndex = (it == OldDbBlockIndexes.end()) ? SIZE_MAX : it->second;
+        }
+        else
+        {
+            const auto it = OldOtherBlockIndexes.find(NewBlock.strName);
+            OldBlockIndex = (it == OldOtherBlockIndexes.end()) ? SIZE_MAX : it->second;
+        }
+
+        if (OldBlockIndex == SIZE_MAX)
+        {
+            _AddAllSymbols(Changes, S7ChangeKind::Added, NewDeviceIndex, NewBlockIndex, NewBlock);
+            continue;
+        }
+
+        const S7Block& OldBlock = OldDevice.Blocks[OldBlockIndex];
+        OldBlockMatched[OldBlockIndex] = true;
+
+        if (OldBlock.strName != NewBlock.strName)
+        {
+            S7Change& Change = Changes.emplace_back();
+            Change.Kind = S7ChangeKind::BlockRenamed;
+            Change.ModifiedFlags = 0;
+            Change.OldPosition = { OldDeviceIndex, OldBlockIndex, 0 };
+            Change.NewPosition = { NewDeviceIndex, NewBlockIndex, 0 };
+        }
+
+        // Skip identical blocks without looking at their symbols.
+        if (OldHashes.BlockHashes[OldBlockIndex] == NewHashes.BlockHashes[NewBlockIndex])
+        {
+            continue;
+        }
+
+        _DiffBlock(Changes, OldDeviceIndex, OldBlockIndex, OldBlock, NewDeviceIndex, NewBlockIndex, NewBlock);
+    }
+
+    for (size_t OldBlockIndex = 0; OldBlockIndex < OldDevice.Blocks.size(); OldBlockIndex++)
+    {
+        if (!OldBlockMatched[OldBlockIndex])
+        {
+            _AddAllSymbols(Changes, S7ChangeKind::Removed, OldDeviceIndex, OldBlockIndex, OldDevice.Blocks[OldBlockIndex]);
+        }
+    }
+}
+
+static bool
+_AreHashesValid(const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<S7DeviceHashes>& DeviceHashes)
+{
+    if (DeviceHashes.size() != DeviceSymbolInfos.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < DeviceHashes.size(); i++)
+    {
+        if (DeviceHashes[i].BlockHashes.size() != DeviceSymbolInfos[i].Blocks.size())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+std::vector<S7DeviceHashes>
+HashS7P(const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos)
+{
+    std::vector<S7DeviceHashes> DeviceHashes;
+    DeviceHashes.reserve(DeviceSymbolInfos.size());
+
+    for (const S7DeviceSymbolInfo& DeviceSymbolInfo : DeviceSymbolInfos)
+    {
+        DeviceHashes.push_back(_HashDevice(DeviceSymbolInfo));
+    }
+
+    return DeviceHashes;
+}
+
+std::vector<S7Change>
+DiffS7P(const std::vector<S7DeviceSymbolInfo>& OldDeviceSymbolInfos, const std::vector<S7DeviceSymbolInfo>& NewDeviceSymbolInfos)
+{
+    return DiffS7P(OldDeviceSymbolInfos, HashS7P(OldDeviceSymbolInfos), NewDeviceSymbolInfos, HashS7P(NewDeviceSymbolInfos));
+}
+
+std::vector<S7Change>
+DiffS7P(const std::vector<S7DeviceSymbolInfo>& OldDeviceSymbolInfos, const std::vector<S7DeviceHashes>& OldDeviceHashes, const std::vector<S7DeviceSymbolInfo>& NewDeviceSymbolInfos, const std::vector<S7DeviceHashes>& NewDeviceHashes)
+{
+    if (!_AreHashesValid(OldDeviceSymbolInfos, OldDeviceHashes) || !_AreHashesValid(NewDeviceSymbolInfos, NewDeviceHashes))
+    {
+        return DiffS7P(OldDeviceSymbolInfos, NewDeviceSymbolInfos);
+    }
+
+    std::vector<S7Change> Changes;
+
+    // Match the devices by name.
+    std::unordered_map<std::string_view, size_t> OldDeviceIndexes;
+    for (size_t i = 0; i < OldDeviceSymbolInfos.size(); i++)
+    {
+        OldDeviceIndexes.emplace(OldDeviceSymbolInfos[i].strName, i);
+    }
+
+    std::vector<bool> OldDeviceMatched(OldDeviceSymbolInfos.size(), false);
+
+    for (size_t NewDeviceIndex = 0; NewDeviceIndex < NewDeviceSymbolInfos.size(); NewDeviceIndex++)
+    {
+        const S7DeviceSymbolInfo& NewDevice = NewDeviceSymbolInfos[NewDeviceIndex];
+
+        const auto it = OldDeviceIndexes.find(NewDevice.strName);
+        if (it == OldDeviceIndexes.end())
+        {
+            for (size_t BlockIndex = 0; BlockIndex < NewDevice.Blocks.size(); BlockIndex++)
+            {
+                _AddAllSymbols(Changes, S7ChangeKind::Added, NewDeviceIndex, BlockIndex, NewDevice.Blocks[BlockIndex]);
+            }
+
+            continue;
+        }
+
+        size_t OldDeviceIndex = it->second;
+        OldDeviceMatched[OldDeviceIndex] = true;
+        _DiffDevice(Changes, OldDeviceIndex, OldDeviceSymbolInfos[OldDeviceIndex], OldDeviceHashes[OldDeviceIndex], NewDeviceIndex, NewDevice, NewDeviceHashes[NewDeviceIndex]);
+    }
+
+    for (size_t OldDeviceIndex = 0; OldDeviceIndex < OldDeviceSymbolInfos.size(); OldDeviceIndex++)
+    {
+        if (!OldDeviceMatched[OldDeviceIndex])
+        {
+            const S7DeviceSymbolInfo& OldDevice = OldDeviceSymbolInfos[OldDeviceIndex];
+            for (size_t BlockIndex = 0; BlockIndex < OldDevice.Blocks.size(); BlockIndex++)
+            {
+                _AddAllSymbols(Changes, S7ChangeKind::Removed, OldDeviceIndex, BlockIndex, OldDevice.Blocks[BlockIndex]);
+            }
+        }
+    }
+
+    return Changes;
+}
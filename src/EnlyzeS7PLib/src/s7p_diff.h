@@ -0,0 +1,70 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "s7p_parser.h"
+
+enum class S7ChangeKind : uint8_t
+{
+    Added,
+    Removed,
+    Modified,
+    BlockRenamed,
+};
+
+// Bit flags describing what has changed about a modified symbol.
+const uint8_t S7ChangeReaddressed = 0x01;
+const uint8_t S7ChangeRetyped = 0x02;
+const uint8_t S7ChangeRecommented = 0x04;
+
+struct S7SymbolPosition
+{
+    size_t DeviceIndex;
+    size_t BlockIndex;
+    size_t SymbolIndex;
+};
+
+struct S7Change
+{
+    // OldPosition is only valid for removed and modified symbols, NewPosition only for added and modified ones.
+    // A renamed block (e.g. "DB5 (Motor)" to "DB5 (Pump)") is reported once with both positions, with a SymbolIndex of 0.
+    S7ChangeKind Kind;
+    uint8_t ModifiedFlags;
+    S7SymbolPosition OldPosition;
+    S7SymbolPosition NewPosition;
+};
+
+// Hashes of a parse result, one entry per device.
+// Keep them alongside a stored parse result, so that every further diff against it skips its unchanged devices and blocks
+// without hashing all of their symbols again. They are only valid as long as the parse result isn't modified.
+struct S7DeviceHashes
+{
+    uint64_t Hash;
+    std::vector<uint64_t> BlockHashes;
+};
+
+std::vector<S7DeviceHashes> HashS7P(
+    const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos
+    );
+
+// Devices are matched by name, DBs by their number (so renaming a DB is reported as BlockRenamed), and other blocks by name.
+std::vector<S7Change> DiffS7P(
+    const std::vector<S7DeviceSymbolInfo>& OldDeviceSymbolInfos,
+    const std::vector<S7DeviceSymbolInfo>& NewDeviceSymbolInfos
+    );
+
+// Same as above, but with hashes previously returned by HashS7P for both parse results.
+// Hashes that don't fit the number of devices or blocks are ignored and computed again.
+std::vector<S7Change> DiffS7P(
+    const std::vector<S7DeviceSymbolInfo>& OldDeviceSymbolInfos,
+    const std::vector<S7DeviceHashes>& OldDeviceHashes,
+    const std::vector<S7DeviceSymbolInfo>& NewDeviceSymbolInfos,
+    const std::vector<S7DeviceHashes>& NewDeviceHashes
+    );
@@ -0,0 +1,616 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include "s7p_inflate.h"
+
+// Codes of up to this many bits are decoded with a single table lookup.
+// Longer codes fall back to canonical decoding bit by bit.
+static constexpr unsigned FastBits = 9;
+static constexpr unsigned MaxCodeBits = 15;
+
+// Back-references reach at most this far into the previous output.
+static constexpr size_t WindowSize = 32768;
+
+// Sizes of the chunks in which the input is read and the output is written.
+// The output buffer additionally keeps the last WindowSize bytes of the previous chunk for back-references.
+static constexpr size_t InputChunkSize = 65536;
+static constexpr size_t OutputChunkSize = 262144;
+
+struct HuffmanTable
+{
+    // Number of codes of each length and the symbols sorted by code (canonical Huffman code).
+    uint16_t Counts[MaxCodeBits + 1];
+    uint16_t Symbols[288];
+
+    // Indexed by the next FastBits input bits: (code length << 9) | symbol, or 0 if the code is longer.
+    uint16_t FastEntries[1 << FastBits];
+};
+
+struct InflateState
+{
+    const InflateReadFunction* pRead;
+    const InflateWriteFunction* pWrite;
+
+    std::vector<uint8_t> Input;
+    size_t InputSize;
+    size_t InputPosition;
+    bool bInputEnd;
+    uint32_t BitBuffer;
+    unsigned BitCount;
+
+    // Number of zero bytes fed into the bit buffer beyond the end of the input.
+    size_t PaddingBytes;
+
+    // Output not written yet starts at OutputFlushPosition, everything before is only kept for back-references.
+    std::vector<uint8_t> Output;
+    size_t OutputPosition;
+    size_t OutputFlushPosition;
+    uint64_t TotalOutputSize;
+    uint64_t OutputSize;
+
+    // First error returned by Read or Write, which takes precedence over any error it has caused in decoding.
+    std::optional<CS7PError> CallbackError;
+};
+
+static const uint16_t _LengthBases[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t _LengthExtraBits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t _DistanceBases[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t _DistanceExtraBits[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+
+static void
+_ReadInput(InflateState& State)
+{
+    auto ReadResult = (*State.pRead)(State.Input.data(), State.Input.size());
+    if (const auto pError = std::get_if<CS7PError>(&ReadResult))
+    {
+        State.CallbackError = *pError;
+        State.bInputEnd = true;
+        return;
+    }
+
+    State.InputSize = std::get<size_t>(ReadResult);
+    State.InputPosition = 0;
+    State.bInputEnd = (State.InputSize == 0);
+}
+
+static void
+_Refill(InflateState& State)
+{
+    while (State.BitCount <= 24)
+    {
+        if (State.InputPosition == State.InputSize && !State.bInputEnd)
+        {
+            _ReadInput(State);
+        }
+
+        uint32_t Byte = 0;
+        if (State.InputPosition < State.InputSize)
+        {
+            Byte = State.Input[State.InputPosition];
+            State.InputPosition++;
+        }
+        else
+        {
+            State.PaddingBytes++;
+        }
+
+        State.BitBuffer |= Byte << State.BitCount;
+        State.BitCount += 8;
+    }
+}
+
+static bool
+_FlushOutput(InflateState& State)
+{
+    if (State.OutputPosition > State.OutputFlushPosition)
+    {
+        auto WriteResult = (*State.pWrite)(State.Output.data() + State.OutputFlushPosition, State.OutputPosition - State.OutputFlushPosition);
+        if (const auto pError = std::get_if<CS7PError>(&WriteResult))
+        {
+            State.CallbackError = *pError;
+            return false;
+        }
+    }
+
+    // Keep the last WindowSize bytes for back-references.
+    if (State.OutputPosition > WindowSize)
+    {
+        memmove(State.Output.data(), State.Output.data() + State.OutputPosition - WindowSize, WindowSize);
+        State.OutputPosition = WindowSize;
+    }
+
+    State.OutputFlushPosition = State.OutputPosition;
+    return true;
+}
+
+static std::variant<std::monostate, CS7PError>
+_ReserveOutput(InflateState& State, size_t Size)
+{
+    // Size is at most the 65535 bytes of a stored block, which always fit after a flush.
+    if (State.OutputSize - State.TotalOutputSize < Size)
+    {
+        return CS7PError(L"Deflate stream decompresses to more data than expected");
+    }
+
+    if (State.Output.size() - State.OutputPosition < Size && !_FlushOutput(State))
+    {
+        return *State.CallbackError;
+    }
+
+    State.TotalOutputSize += Size;
+    return std::monostate();
+}
+
+static bool
+_IsInputOverrun(const InflateState& State)
+{
+    // We may have consumed padding bits, but only as long as they haven't actually been used.
+    return State.PaddingBytes * 8 > State.BitCount;
+}
+
+static uint32_t
+_GetBits(InflateState& State, unsigned Count)
+{
+    _Refill(State);
+
+    uint32_t Value = State.BitBuffer & ((1u << Count) - 1);
+    State.BitBuffer >>= Count;
+    State.BitCount -= Count;
+    return Value;
+}
+
+static bool
+_BuildHuffmanTable(HuffmanTable& Table, const uint8_t* pLengths, size_t SymbolCount)
+{
+    memset(Table.Counts, 0, sizeof(Table.Counts));
+    memset(Table.FastEntries, 0, sizeof(Table.FastEntries));
+
+    for (size_t i = 0; i < SymbolCount; i++)
+    {
+        Table.Counts[pLengths[i]]++;
+    }
+
+    // Reject over-subscribed code lengths.
+    // Incomplete codes are accepted, but decoding an unassigned code fails later.
+    int Left = 1;
+    for (unsigned Length = 1; Length <= MaxCodeBits; Length++)
+    {
+        Left <<= 1;
+        Left -= Table.Counts[Length];
+        if (Left < 0)
+        {
+            return false;
+        }
+    }
+
+    // Sort the symbols by code length and, within the same length, by symbol value.
+    uint16_t Offsets[MaxCodeBits + 1];
+    Offsets[1] = 0;
+    for (unsigned Length = 1; Length < MaxCodeBits; Length++)
+    {
+        Offsets[Length + 1] = Offsets[Length] + Table.Counts[Length];
+    }
+
+    for (size_t i = 0; i < SymbolCount; i++)
+    {
+        if (pLengths[i] != 0)
+        {
+            Table.Symbols[Offsets[pLengths[i]]++] = static_cast<uint16_t>(i);
+        }
+    }
+
+    // Fill the lookup table for all short codes.
+    // Deflate stores Huffman codes starting with their most significant bit, so the lookup index is the bit-reversed code.
+    uint32_t Code = 0;
+    size_t SymbolIndex = 0;
+    for (unsigned Length = 1; Length <= FastBits; Length++)
+    {
+        for (unsigned i = 0; i < Table.Counts[Length]; i++)
+        {
+            uint32_t ReversedCode = 0;
+            for (unsigned Bit = 0; Bit < Length; Bit++)
+            {
+                ReversedCode |= ((Code >> Bit) & 1) << (Length - 1 - Bit);
+            }
+
+            const uint16_t Entry = static_cast<uint16_t>((Length << 9) | Table.Symbols[SymbolIndex]);
+            for (uint32_t Index = ReversedCode; Index < (1u << FastBits); Index += 1u << Length)
+            {
+                Table.FastEntries[Index] = Entry;
+            }
+
+            Code++;
+            SymbolIndex++;
+        }
+
+        Code <<= 1;
+    }
+
+    return true;
+}
+
+static int
+_DecodeSymbol(InflateState& State, const HuffmanTable& Table)
+{
+    _Refill(State);
+
+    const uint16_t Entry = Table.FastEntries[State.BitBuffer & ((1u << FastBits) - 1)];
+    if (Entry != 0)
+    {
+        const unsigned Length = Entry >> 9;
+        State.BitBuffer >>= Length;
+        State.BitCount -= Length;
+        return Entry & 0x1FF;
+    }
+
+    // Decode a longer code bit by bit.
+    int Code = 0;
+    int First = 0;
+    int Index = 0;
+    for (unsigned Length = 1; Length <= MaxCodeBits; Length++)
+    {
+        Code |= static_cast<int>(_GetBits(State, 1));
+
+        const int Count = Table.Counts[Length];
+        if (Code - Count < First)
+        {
+            return Table.Symbols[Index + (Code - First)];
+        }
+
+        Index += Count;
+        First += Count;
+        First <<= 1;
+        Code <<= 1;
+    }
+
+    return -1;
+}
+
+static std::variant<std::monostate, CS7PError>
+_InflateStoredBlock(InflateState& State)
+{
+    // Discard the remaining bits of the current byte.
+    _GetBits(State, State.BitCount % 8);
+
+    const size_t Length = _GetBits(State, 16);
+    const size_t InvertedLength = _GetBits(State, 16);
+    if (_IsInputOverrun(State))
+    {
+        return CS7PError(L"Deflate stream ends within a stored block header");
+    }
+
+    if (Length != (~InvertedLength & 0xFFFF))
+    {
+        return CS7PError(L"Invalid stored block length in Deflate stream");
+    }
+
+    auto ReserveResult = _ReserveOutput(State, Length);
+    if (const auto pError = std::get_if<CS7PError>(&ReserveResult))
+    {
+        return *pError;
+    }
+
+    // The first bytes may still be in the bit buffer, the rest is copied from the input directly.
+    size_t RemainingLength = Length;
+    while (RemainingLength > 0 && State.BitCount > State.PaddingBytes * 8)
+    {
+        State.Output[State.OutputPosition++] = static_cast<uint8_t>(State.BitBuffer);
+        State.BitBuffer >>= 8;
+        State.BitCount -= 8;
+        RemainingLength--;
+    }
+
+    while (RemainingLength > 0)
+    {
+        if (State.InputPosition == State.InputSize)
+        {
+            if (!State.bInputEnd)
+            {
+                _ReadInput(State);
+            }
+
+            if (State.bInputEnd)
+            {
+                return CS7PError(L"Deflate stream ends within a stored block");
+            }
+        }
+
+        const size_t CopySize = std::min(RemainingLength, State.InputSize - State.InputPosition);
+        memcpy(State.Output.data() + State.OutputPosition, State.Input.data() + State.InputPosition, CopySize);
+        State.OutputPosition += CopySize;
+        State.InputPosition += CopySize;
+        RemainingLength -= CopySize;
+    }
+
+    return std::monostate();
+}
+
+static std::variant<std::monostate, CS7PError>
+_InflateHuffmanBlock(InflateState& State, const HuffmanTable& LiteralLengthTable, const HuffmanTable& DistanceTable)
+{
+    for (;;)
+    {
+        int Symbol = _DecodeSymbol(State, LiteralLengthTable);
+        if (Symbol < 0)
+        {
+            return CS7PError(L"Invalid literal/length code in Deflate stream");
+        }
+
+        if (Symbol < 256)
+        {
+            // This is a literal byte.
+            auto ReserveResult = _ReserveOutput(State, 1);
+            if (const auto pError = std::get_if<CS7PError>(&ReserveResult))
+            {
+                return *pError;
+            }
+
+            State.Output[State.OutputPosition++] = static_cast<uint8_t>(Symbol);
+            continue;
+        }
+
+        if (Symbol == 256)
+        {
+            // This is the end of the block.
+            return std::monostate();
+        }
+
+        // This is a length/distance pair referencing previous output.
+        Symbol -= 257;
+        if (Symbol >= 29)
+        {
+            return CS7PError(L"Invalid length code in Deflate stream");
+        }
+
+        const size_t Length = _LengthBases[Symbol] + _GetBits(State, _LengthExtraBits[Symbol]);
+
+        Symbol = _DecodeSymbol(State, DistanceTable);
+        if (Symbol < 0 || Symbol >= 30)
+        {
+            return CS7PError(L"Invalid distance code in Deflate stream");
+        }
+
+        const size_t Distance = _DistanceBases[Symbol] + _GetBits(State, _DistanceExtraBits[Symbol]);
+        if (Distance > State.TotalOutputSize)
+        {
+            return CS7PError(L"Deflate stream references data before its beginning");
+        }
+
+        auto ReserveResult = _ReserveOutput(State, Length);
+        if (const auto pError = std::get_if<CS7PError>(&ReserveResult))
+        {
+            return *pError;
+        }
+
+        // Copy byte by byte, because source and destination may overlap (e.g. for runs of the same byte).
+        // The output buffer always holds at least the last WindowSize bytes, so the source is never out of range.
+        uint8_t* pDestination = State.Output.data() + State.OutputPosition;
+        const uint8_t* pSource = pDestination - Distance;
+        for (size_t i = 0; i < Length; i++)
+        {
+            pDestination[i] = pSource[i];
+        }
+
+        State.OutputPosition += Length;
+
+        if (_IsInputOverrun(State))
+        {
+            return CS7PError(L"Deflate stream ends unexpectedly");
+        }
+    }
+}
+
+static bool
+_BuildFixedHuffmanTables(HuffmanTable& LiteralLengthTable, HuffmanTable& DistanceTable)
+{
+    uint8_t Lengths[288];
+    memset(Lengths, 8, 144);
+    memset(Lengths + 144, 9, 256 - 144);
+    memset(Lengths + 256, 7, 280 - 256);
+    memset(Lengths + 280, 8, 288 - 280);
+    if (!_BuildHuffmanTable(LiteralLengthTable, Lengths, 288))
+    {
+        return false;
+    }
+
+    memset(Lengths, 5, 30);
+    return _BuildHuffmanTable(DistanceTable, Lengths, 30);
+}
+
+static std::variant<std::monostate, CS7PError>
+_ReadDynamicHuffmanTables(InflateState& State, HuffmanTable& LiteralLengthTable, HuffmanTable& DistanceTable)
+{
+    static const uint8_t CodeLengthOrder[19] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+    };
+
+    const size_t LiteralLengthCount = _GetBits(State, 5) + 257;
+    const size_t DistanceCount = _GetBits(State, 5) + 1;
+    const size_t CodeLengthCount = _GetBits(State, 4) + 4;
+    if (LiteralLengthCount > 286 || DistanceCount > 30)
+    {
+        return CS7PError(L"Invalid code counts in Deflate stream");
+    }
+
+    // Read the code lengths for the code length alphabet.
+    uint8_t Lengths[286 + 30] = {};
+    for (size_t i = 0; i < CodeLengthCount; i++)
+    {
+        Lengths[CodeLengthOrder[i]] = static_cast<uint8_t>(_GetBits(State, 3));
+    }
+
+    HuffmanTable CodeLengthTable;
+    if (!_BuildHuffmanTable(CodeLengthTable, Lengths, 19))
+    {
+        return CS7PError(L"Invalid code length code in Deflate stream");
+    }
+
+    // Read the code lengths for the literal/length and distance alphabets, which form a single sequence.
+    const size_t TotalCount = LiteralLengthCount + DistanceCount;
+    size_t Index = 0;
+    while (Index < TotalCount)
+    {
+        int Symbol = _DecodeSymbol(State, CodeLengthTable);
+        if (Symbol < 0)
+        {
+            return CS7PError(L"Invalid code length in Deflate stream");
+        }
+
+        if (Symbol < 16)
+        {
+            Lengths[Index++] = static_cast<uint8_t>(Symbol);
+            continue;
+        }
+
+        uint8_t RepeatedLength = 0;
+        size_t RepeatCount;
+        if (Symbol == 16)
+        {
+            if (Index == 0)
+            {
+                return CS7PError(L"Deflate stream repeats a code length without a previous one");
+            }
+
+            RepeatedLength = Lengths[Index - 1];
+            RepeatCount = 3 + _GetBits(State, 2);
+        }
+        else if (Symbol == 17)
+        {
+            RepeatCount = 3 + _GetBits(State, 3);
+        }
+        else
+        {
+            RepeatCount = 11 + _GetBits(State, 7);
+        }
+
+        if (TotalCount - Index < RepeatCount)
+        {
+            return CS7PError(L"Too many code lengths in Deflate stream");
+        }
+
+        memset(Lengths + Index, RepeatedLength, RepeatCount);
+        Index += RepeatCount;
+    }
+
+    if (Lengths[256] == 0)
+    {
+        return CS7PError(L"Deflate stream has no end-of-block code");
+    }
+
+    if (!_BuildHuffmanTable(LiteralLengthTable, Lengths, LiteralLengthCount) ||
+        !_BuildHuffmanTable(DistanceTable, Lengths + LiteralLengthCount, DistanceCount))
+    {
+        return CS7PError(L"Invalid Huffman code lengths in Deflate stream");
+    }
+
+    return std::monostate();
+}
+
+static std::variant<std::monostate, CS7PError>
+_Inflate(InflateState& State)
+{
+    HuffmanTable LiteralLengthTable;
+    HuffmanTable DistanceTable;
+
+    for (;;)
+    {
+        const bool bFinalBlock = _GetBits(State, 1) != 0;
+        const uint32_t BlockType = _GetBits(State, 2);
+
+        std::variant<std::monostate, CS7PError> Result;
+        if (BlockType == 0)
+        {
+            Result = _InflateStoredBlock(State);
+        }
+        else if (BlockType == 1)
+        {
+            if (!_BuildFixedHuffmanTables(LiteralLengthTable, DistanceTable))
+            {
+                return CS7PError(L"Could not build the fixed Huffman tables");
+            }
+
+            Result = _InflateHuffmanBlock(State, LiteralLengthTable, DistanceTable);
+        }
+        else if (BlockType == 2)
+        {
+            Result = _ReadDynamicHuffmanTables(State, LiteralLengthTable, DistanceTable);
+            if (std::holds_alternative<std::monostate>(Result))
+            {
+                Result = _InflateHuffmanBlock(State, LiteralLengthTable, DistanceTable);
+            }
+        }
+        else
+        {
+            return CS7PError(L"Invalid block type in Deflate stream");
+        }
+
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return *pError;
+        }
+
+        if (_IsInputOverrun(State))
+        {
+            return CS7PError(L"Deflate stream ends unexpectedly");
+        }
+
+        if (bFinalBlock)
+        {
+            break;
+        }
+    }
+
+    if (!_FlushOutput(State))
+    {
+        return *State.CallbackError;
+    }
+
+    if (State.TotalOutputSize != State.OutputSize)
+    {
+        return CS7PError(L"Deflate stream decompresses to less data than expected");
+    }
+
+    return std::monostate();
+}
+
+
+std::variant<std::monostate, CS7PError>
+Inflate(const InflateReadFunction& Read, const InflateWriteFunction& Write, uint64_t OutputSize)
+{
+    // Both buffers have a fixed size, no matter what OutputSize claims.
+    InflateState State = {};
+    State.pRead = &Read;
+    State.pWrite = &Write;
+    State.Input.resize(InputChunkSize);
+    State.Output.resize(WindowSize + OutputChunkSize);
+    State.OutputSize = OutputSize;
+
+    auto Result = _Inflate(State);
+
+    // A failed read ends the input, which is then reported as a truncated stream.
+    // Report the actual cause instead.
+    if (std::holds_alternative<CS7PError>(Result) && State.CallbackError.has_value())
+    {
+        return *State.CallbackError;
+    }
+
+    return Result;
+}
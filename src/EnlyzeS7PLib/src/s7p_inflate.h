@@ -0,0 +1,29 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <variant>
+
+#include "CS7PError.h"
+
+// Reads the next compressed bytes into pBuffer and returns their number, which is 0 at the end of the input.
+using InflateReadFunction = std::function<std::variant<size_t, CS7PError>(uint8_t* pBuffer, size_t BufferSize)>;
+
+// Receives the next chunk of decompressed data.
+using InflateWriteFunction = std::function<std::variant<std::monostate, CS7PError>(const uint8_t* pData, size_t Size)>;
+
+// Decompresses raw Deflate data (RFC 1951), as used for ZIP archive members.
+// The input is read and the output is written in chunks of a fixed size, so memory usage does not depend on the size of the data.
+// OutputSize is the expected size of the decompressed data, as recorded in the ZIP central directory.
+// It is untrusted: decompression fails as soon as the output would exceed OutputSize.
+std::variant<std::monostate, CS7PError> Inflate(
+    const InflateReadFunction& Read,
+    const InflateWriteFunction& Write,
+    uint64_t OutputSize
+    );
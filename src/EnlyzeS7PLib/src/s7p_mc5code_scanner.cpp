@@ -0,0 +1,317 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include <intrin.h>
+#include <EnlyzeWinStringLib.h>
+
+#include "s7p_mc5code_scanner.h"
+
+// We are built for the lowest common denominator (-march=pentium-mmx), so the vector kernels are compiled with
+// per-function target attributes and only selected at runtime if CPUID reports support for them.
+#define SSE2_FUNCTION __attribute__((target("sse2")))
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+
+struct ScanKernels
+{
+    const char* (*pfnSkipSpaces)(const char* p, const char* pEnd);
+    const char* (*pfnFindLineEnd)(const char* p, const char* pEnd);
+    const char* (*pfnFindWordEnd)(const char* p, const char* pEnd, const char* szTokens);
+};
+
+
+static unsigned long
+_FindFirstSetBit(uint32_t Mask)
+{
+    unsigned long Index;
+    _BitScanForward(&Index, Mask);
+    return Index;
+}
+
+//
+// Scalar fallback
+// The vector kernels also use these for the remaining bytes that don't fill a whole block.
+//
+static const char*
+_SkipSpacesScalar(const char* p, const char* pEnd)
+{
+    while (p < pEnd && IsSpaceCharacter(*p))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+static const char*
+_FindLineEndScalar(const char* p, const char* pEnd)
+{
+    while (p < pEnd && *p != '\0' && *p != '\r' && *p != '\n')
+    {
+        p++;
+    }
+
+    return p;
+}
+
+static const char*
+_FindWordEndScalar(const char* p, const char* pEnd, const char* szTokens)
+{
+    while (p < pEnd && *p != '\0' && !IsSpaceCharacter(*p) && !strchr(szTokens, *p))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+//
+// SSE2 kernels
+// They only load whole 16-byte blocks before pEnd and leave the remainder to the scalar fallback.
+//
+SSE2_FUNCTION static __m128i
+_SpaceMask128(__m128i Bytes)
+{
+    // '\t' to '\r' is a contiguous range, so subtract '\t' and check for an unsigned value <= 4.
+    const __m128i Shifted = _mm_sub_epi8(Bytes, _mm_set1_epi8('\t'));
+    const __m128i InRange = _mm_cmpeq_epi8(_mm_min_epu8(Shifted, _mm_set1_epi8(4)), Shifted);
+    return _mm_or_si128(InRange, _mm_cmpeq_epi8(Bytes, _mm_set1_epi8(' ')));
+}
+
+SSE2_FUNCTION static __m128i
+_LineEndMask128(__m128i Bytes)
+{
+    const __m128i Cr = _mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\r'));
+    const __m128i Lf = _mm_cmpeq_epi8(Bytes, _mm_set1_epi8('\n'));
+    const __m128i Nul = _mm_cmpeq_epi8(Bytes, _mm_setzero_si128());
+    return _mm_or_si128(_mm_or_si128(Cr, Lf), Nul);
+}
+
+SSE2_FUNCTION static __m128i
+_WordEndMask128(__m128i Bytes, const char* szTokens)
+{
+    __m128i Mask = _mm_or_si128(_SpaceMask128(Bytes), _mm_cmpeq_epi8(Bytes, _mm_setzero_si128()));
+    for (const char* p = szTokens; *p; p++)
+    {
+        Mask = _mm_or_si128(Mask, _mm_cmpeq_epi8(Bytes, _mm_set1_epi8(*p)));
+    }
+
+    return Mask;
+}
+
+SSE2_FUNCTION static const char*
+_SkipSpacesSse2(const char* p, const char* pEnd)
+{
+    while (pEnd - p >= 16)
+    {
+        // Look for the first byte that is not a space.
+        const __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const uint32_t Mask = ~static_cast<uint32_t>(_mm_movemask_epi8(_SpaceMask128(Bytes))) & 0xFFFF;
+        if (Mask)
+        {
+            return p + _FindFirstSetBit(Mask);
+        }
+
+        p += 16;
+    }
+
+    return _SkipSpacesScalar(p, pEnd);
+}
+
+SSE2_FUNCTION static const char*
+_FindLineEndSse2(const char* p, const char* pEnd)
+{
+    while (pEnd - p >= 16)
+    {
+        const __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const uint32_t Mask = static_cast<uint32_t>(_mm_movemask_epi8(_LineEndMask128(Bytes)));
+        if (Mask)
+        {
+            return p + _FindFirstSetBit(Mask);
+        }
+
+        p += 16;
+    }
+
+    return _FindLineEndScalar(p, pEnd);
+}
+
+SSE2_FUNCTION static const char*
+_FindWordEndSse2(const char* p, const char* pEnd, const char* szTokens)
+{
+    while (pEnd - p >= 16)
+    {
+        const __m128i Bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const uint32_t Mask = static_cast<uint32_t>(_mm_movemask_epi8(_WordEndMask128(Bytes, szTokens)));
+        if (Mask)
+        {
+            return p + _FindFirstSetBit(Mask);
+        }
+
+        p += 16;
+    }
+
+    return _FindWordEndScalar(p, pEnd, szTokens);
+}
+
+//
+// AVX2 kernels
+// Same as the SSE2 kernels, just with 32-byte blocks.
+//
+AVX2_FUNCTION static __m256i
+_SpaceMask256(__m256i Bytes)
+{
+    const __m256i Shifted = _mm256_sub_epi8(Bytes, _mm256_set1_epi8('\t'));
+    const __m256i InRange = _mm256_cmpeq_epi8(_mm256_min_epu8(Shifted, _mm256_set1_epi8(4)), Shifted);
+    return _mm256_or_si256(InRange, _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8(' ')));
+}
+
+AVX2_FUNCTION static __m256i
+_LineEndMask256(__m256i Bytes)
+{
+    const __m256i Cr = _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\r'));
+    const __m256i Lf = _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8('\n'));
+    const __m256i Nul = _mm256_cmpeq_epi8(Bytes, _mm256_setzero_si256());
+    return _mm256_or_si256(_mm256_or_si256(Cr, Lf), Nul);
+}
+
+AVX2_FUNCTION static __m256i
+_WordEndMask256(__m256i Bytes, const char* szTokens)
+{
+    __m256i Mask = _mm256_or_si256(_SpaceMask256(Bytes), _mm256_cmpeq_epi8(Bytes, _mm256_setzero_si256()));
+    for (const char* p = szTokens; *p; p++)
+    {
+        Mask = _mm256_or_si256(Mask, _mm256_cmpeq_epi8(Bytes, _mm256_set1_epi8(*p)));
+    }
+
+    return Mask;
+}
+
+AVX2_FUNCTION static const char*
+_SkipSpacesAvx2(const char* p, const char* pEnd)
+{
+    while (pEnd - p >= 32)
+    {
+        const __m256i Bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const uint32_t Mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_SpaceMask256(Bytes)));
+        if (Mask)
+        {
+            return p + _FindFirstSetBit(Mask);
+        }
+
+        p += 32;
+    }
+
+    return _SkipSpacesScalar(p, pEnd);
+}
+
+AVX2_FUNCTION static const char*
+_FindLineEndAvx2(const char* p, const char* pEnd)
+{
+    while (pEnd - p >= 32)
+    {
+        const __m256i Bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const uint32_t Mask = static_cast<uint32_t>(_mm256_movemask_epi8(_LineEndMask256(Bytes)));
+        if (Mask)
+        {
+            return p + _FindFirstSetBit(Mask);
+        }
+
+        p += 32;
+    }
+
+    return _FindLineEndScalar(p, pEnd);
+}
+
+AVX2_FUNCTION static const char*
+_FindWordEndAvx2(const char* p, const char* pEnd, const char* szTokens)
+{
+    while (pEnd - p >= 32)
+    {
+        const __m256i Bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const uint32_t Mask = static_cast<uint32_t>(_mm256_movemask_epi8(_WordEndMask256(Bytes, szTokens)));
+        if (Mask)
+        {
+            return p + _FindFirstSetBit(Mask);
+        }
+
+        p += 32;
+    }
+
+    return _FindWordEndScalar(p, pEnd, szTokens);
+}
+
+//
+// Runtime dispatch
+//
+__attribute__((target("xsave"))) static uint64_t
+_GetEnabledXStateFeatures()
+{
+    return _xgetbv(0);
+}
+
+static ScanKernels
+_SelectKernels()
+{
+    int CpuInfo[4];
+    __cpuid(CpuInfo, 0);
+    const int MaxLeaf = CpuInfo[0];
+
+    __cpuid(CpuInfo, 1);
+    const bool bSse2 = (CpuInfo[3] & (1 << 26)) != 0;
+    const bool bOsXSave = (CpuInfo[2] & (1 << 27)) != 0;
+    const bool bAvx = (CpuInfo[2] & (1 << 28)) != 0;
+
+    if (MaxLeaf >= 7 && bOsXSave && bAvx)
+    {
+        // AVX2 also requires the operating system to save the YMM registers on context switches.
+        // Windows XP never does that, so we use SSE2 there even on CPUs supporting AVX2.
+        if ((_GetEnabledXStateFeatures() & 0x6) == 0x6)
+        {
+            __cpuidex(CpuInfo, 7, 0);
+            if (CpuInfo[1] & (1 << 5))
+            {
+                return { _SkipSpacesAvx2, _FindLineEndAvx2, _FindWordEndAvx2 };
+            }
+        }
+    }
+
+    if (bSse2)
+    {
+        return { _SkipSpacesSse2, _FindLineEndSse2, _FindWordEndSse2 };
+    }
+
+    return { _SkipSpacesScalar, _FindLineEndScalar, _FindWordEndScalar };
+}
+
+static const ScanKernels _Kernels = _SelectKernels();
+
+
+const char*
+SkipMc5codeSpaces(const char* p, const char* pEnd)
+{
+    // Most tokens are separated by a single space, so check the first character before entering a vector kernel.
+    if (p == pEnd || !IsSpaceCharacter(*p))
+    {
+        return p;
+    }
+
+    return _Kernels.pfnSkipSpaces(p + 1, pEnd);
+}
+
+const char*
+FindMc5codeLineEnd(const char* p, const char* pEnd)
+{
+    return _Kernels.pfnFindLineEnd(p, pEnd);
+}
+
+const char*
+FindMc5codeWordEnd(const char* p, const char* pEnd, const char* szTokens)
+{
+    return _Kernels.pfnFindWordEnd(p, pEnd, szTokens);
+}
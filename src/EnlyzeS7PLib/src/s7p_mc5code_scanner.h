@@ -0,0 +1,21 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+// Scanning primitives for MC5 Code ending at pEnd.
+// They process 16 (SSE2) or 32 (AVX2) bytes at a time if the CPU supports it, and fall back to a byte loop otherwise.
+// No byte at or after pEnd is ever read, and an embedded NUL character ends the MC5 Code like pEnd does.
+// Whitespace is the same character set as recognized by IsSpaceCharacter (space and '\t' to '\r').
+
+// Returns a pointer to the first non-whitespace character (which may be a NUL character or pEnd).
+const char* SkipMc5codeSpaces(const char* p, const char* pEnd);
+
+// Returns a pointer to the first '\r', '\n', NUL character or pEnd.
+const char* FindMc5codeLineEnd(const char* p, const char* pEnd);
+
+// Returns a pointer to the first whitespace character, character contained in szTokens, NUL character or pEnd.
+const char* FindMc5codeWordEnd(const char* p, const char* pEnd, const char* szTokens);
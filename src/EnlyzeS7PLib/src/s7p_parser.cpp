@@ -4,16 +4,263 @@
 // SPDX-License-Identifier: MIT
 //
 
+#include <algorithm>
+#include <cctype>
 #include <EnlyzeWinStringLib.h>
 
+#include "s7p_archive.h"
 #include "s7p_db_parser.h"
 #include "s7p_device_id_info_parser.h"
+#include "s7p_device_parser.h"
 #include "s7p_parser.h"
 #include "s7p_symbol_list_parser.h"
 
 
-static std::variant<std::monostate, CS7PError>
-_GetS7PFolderPath(std::wstring& wstrS7PFolderPath, const std::wstring& wstrS7PFilePath)
+static void
+_AppendNodeName(std::string& strFullName, std::string_view svNodeName)
+{
+    // Array elements directly follow their array name, all other nodes are separated by a dot.
+    if (!strFullName.empty() && !svNodeName.starts_with('['))
+    {
+        strFullName += '.';
+    }
+
+    strFullName += svNodeName;
+}
+
+static bool
+_MatchesWildcardPattern(const std::string& str, const std::string& strPattern)
+{
+    auto CharEquals = [](char a, char b)
+    {
+        return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+    };
+
+    size_t StringPosition = 0;
+    size_t PatternPosition = 0;
+
+    // Position after the last '*' in the pattern and the string position it has been matched up to.
+    // On a mismatch, we let that '*' consume one more character and retry from there.
+    size_t StarPatternPosition = std::string::npos;
+    size_t StarStringPosition = 0;
+
+    while (StringPosition < str.size())
+    {
+        if (PatternPosition < strPattern.size() && strPattern[PatternPosition] == '*')
+        {
+            PatternPosition++;
+            StarPatternPosition = PatternPosition;
+            StarStringPosition = StringPosition;
+        }
+        else if (PatternPosition < strPattern.size() &&
+            (strPattern[PatternPosition] == '?' || CharEquals(strPattern[PatternPosition], str[StringPosition])))
+        {
+            PatternPosition++;
+            StringPosition++;
+        }
+        else if (StarPatternPosition != std::string::npos)
+        {
+            PatternPosition = StarPatternPosition;
+            StarStringPosition++;
+            StringPosition = StarStringPosition;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // Only trailing '*' may be left in the pattern.
+    return std::all_of(strPattern.begin() + PatternPosition, strPattern.end(), [](char c) { return c == '*'; });
+}
+
+
+std::string
+S7Address::AsString() const
+{
+    size_t ByteAddress = BitOffset / 8;
+    size_t BitNumber = BitOffset % 8;
+
+    switch (Area)
+    {
+        case S7Area::DB:
+            // Codes of DB variables always follow the "DBn:a.b" format.
+            return "DB" + std::to_string(DbNumber) + ":" + std::to_string(ByteAddress) + "." + std::to_string(BitNumber);
+
+        case S7Area::I:
+        case S7Area::Q:
+        case S7Area::M:
+        {
+            // Codes of Symbol List variables are output in their English form, e.g. "I1.0", "QB5", or "MW200".
+            std::string strCode = (Area == S7Area::I) ? "I" : (Area == S7Area::Q) ? "Q" : "M";
+
+            switch (BitSize)
+            {
+                case 1: return strCode + std::to_string(ByteAddress) + "." + std::to_string(BitNumber);
+                case 8: return strCode + "B" + std::to_string(ByteAddress);
+                case 16: return strCode + "W" + std::to_string(ByteAddress);
+                case 32: return strCode + "D" + std::to_string(ByteAddress);
+                default: return strCode + std::to_string(ByteAddress);
+            }
+        }
+    }
+
+    return std::string();
+}
+
+S7Address
+S7Block::GetAddress(const S7Symbol& Symbol) const
+{
+    S7Address Address = Symbol.Address;
+
+    if (pInstanceLayout || pSymbolTree)
+    {
+        // The shared layout or tree doesn't know about the DB number of this instance.
+        Address.DbNumber = DbNumber;
+    }
+
+    return Address;
+}
+
+std::string
+S7Block::GetCode(const S7Symbol& Symbol) const
+{
+    if (!Symbol.strRawCode.empty())
+    {
+        return Symbol.strRawCode;
+    }
+
+    return GetAddress(Symbol).AsString();
+}
+
+const std::vector<S7Symbol>&
+S7Block::GetSymbols() const
+{
+    if (pSymbolTree)
+    {
+        return pSymbolTree->GetSymbols();
+    }
+
+    return pInstanceLayout ? pInstanceLayout->Symbols : Symbols;
+}
+
+std::vector<S7Symbol>
+S7Block::Flatten() const
+{
+    if (pSymbolTree)
+    {
+        return pSymbolTree->Flatten(DbNumber);
+    }
+
+    if (!pInstanceLayout)
+    {
+        return Symbols;
+    }
+
+    std::vector<S7Symbol> FlattenedSymbols = pInstanceLayout->Symbols;
+    for (S7Symbol& Symbol : FlattenedSymbols)
+    {
+        Symbol.Address.DbNumber = DbNumber;
+    }
+
+    return FlattenedSymbols;
+}
+
+std::string
+S7SymbolTree::GetFullName(uint32_t NodeIndex) const
+{
+    std::vector<uint32_t> Path;
+    for (uint32_t i = NodeIndex; i != NoParent; i = Nodes[i].ParentIndex)
+    {
+        Path.push_back(i);
+    }
+
+    std::string strFullName;
+    for (auto it = Path.rbegin(); it != Path.rend(); it++)
+    {
+        _AppendNodeName(strFullName, GetName(Nodes[*it]));
+    }
+
+    return strFullName;
+}
+
+const std::vector<S7Symbol>&
+S7SymbolTree::GetSymbols() const
+{
+    std::call_once(m_FlattenOnce, [this]() { m_FlattenedSymbols = Flatten(0); });
+    return m_FlattenedSymbols;
+}
+
+std::vector<S7Symbol>
+S7SymbolTree::Flatten(uint16_t DbNumber) const
+{
+    std::vector<S7Symbol> Symbols;
+    Symbols.reserve(SymbolCount);
+
+    // Keep the full name of the current node and remember where each open node's name starts,
+    // so that every leaf name is built by appending only its local name.
+    std::string strFullName;
+    std::vector<std::pair<uint32_t, size_t>> OpenNodes;
+
+    for (uint32_t i = 0; i < Nodes.size(); i++)
+    {
+        while (!OpenNodes.empty() && OpenNodes.back().first <= i)
+        {
+            strFullName.resize(OpenNodes.back().second);
+            OpenNodes.pop_back();
+        }
+
+        const S7SymbolNode& Node = Nodes[i];
+        OpenNodes.emplace_back(Node.EndIndex, strFullName.size());
+        _AppendNodeName(strFullName, GetName(Node));
+
+        if (Node.Kind == S7SymbolNodeKind::Leaf)
+        {
+            S7Symbol& Symbol = Symbols.emplace_back();
+            Symbol.strName = strFullName;
+            Symbol.strDatatype = GetDatatype(Node);
+            Symbol.strComment = GetComment(Node);
+            Symbol.Address.Area = S7Area::DB;
+            Symbol.Address.DbNumber = DbNumber;
+            Symbol.Address.BitOffset = Node.BitOffset;
+            Symbol.Address.BitSize = Node.BitSize;
+            Symbol.Address.ElementCount = Node.ElementCount;
+        }
+    }
+
+    return Symbols;
+}
+
+bool
+S7ParseOptions::IsDbSelected(size_t DbNumber) const
+{
+    if (DbRanges.empty())
+    {
+        return true;
+    }
+
+    return std::any_of(DbRanges.begin(), DbRanges.end(), [DbNumber](const std::pair<size_t, size_t>& Range)
+    {
+        return DbNumber >= Range.first && DbNumber <= Range.second;
+    });
+}
+
+bool
+S7ParseOptions::IsDeviceSelected(const std::string& strDeviceName) const
+{
+    if (DevicePatterns.empty())
+    {
+        return true;
+    }
+
+    return std::any_of(DevicePatterns.begin(), DevicePatterns.end(), [&strDeviceName](const std::string& strPattern)
+    {
+        return _MatchesWildcardPattern(strDeviceName, strPattern);
+    });
+}
+
+std::variant<std::monostate, CS7PError>
+GetS7PFolderPath(std::wstring& wstrS7PFolderPath, const std::wstring& wstrS7PFilePath)
 {
     size_t BackslashPosition = wstrS7PFilePath.find_last_of(L'\\');
     if (BackslashPosition == std::wstring::npos)
@@ -25,13 +272,30 @@ _GetS7PFolderPath(std::wstring& wstrS7PFolderPath, const std::wstring& wstrS7PFi
     return std::monostate();
 }
 
-
 std::variant<std::vector<S7DeviceSymbolInfo>, CS7PError>
-ParseS7P(const std::wstring& wstrS7PFilePath)
+ParseS7P(const std::wstring& wstrS7PFilePath, const S7ParseOptions& Options)
 {
+    if (IsS7PArchivePath(wstrS7PFilePath))
+    {
+        // This is a zipped project archive.
+        // Extract only the files we need and parse the project from there.
+        std::wstring wstrExtractedS7PFilePath;
+        std::wstring wstrTempFolderPath;
+        auto ExtractResult = ExtractS7PArchive(wstrExtractedS7PFilePath, wstrTempFolderPath, wstrS7PFilePath);
+        if (const auto pError = std::get_if<CS7PError>(&ExtractResult))
+        {
+            return *pError;
+        }
+
+        auto ParseResult = ParseS7P(wstrExtractedS7PFilePath, Options);
+        DeleteExtractedS7PArchive(wstrTempFolderPath);
+
+        return ParseResult;
+    }
+
     // Get the .s7p folder path for subsequent calls.
     std::wstring wstrS7PFolderPath;
-    auto Result = _GetS7PFolderPath(wstrS7PFolderPath, wstrS7PFilePath);
+    auto Result = GetS7PFolderPath(wstrS7PFolderPath, wstrS7PFilePath);
     if (const auto pError = std::get_if<CS7PError>(&Result))
     {
         return *pError;
@@ -47,18 +311,72 @@ ParseS7P(const std::wstring& wstrS7PFilePath)
 
     // Parse the Symbol Tables in the YDBs directory.
     std::vector<S7DeviceSymbolInfo> DeviceSymbolInfos;
-    Result = ParseYDBs(DeviceSymbolInfos, DeviceIdInfos, wstrS7PFolderPath);
+    Result = ParseYDBs(DeviceSymbolInfos, DeviceIdInfos, wstrS7PFolderPath, Options);
     if (const auto pError = std::get_if<CS7PError>(&Result))
     {
         return *pError;
     }
 
     // Parse the Subblock Lists in the ombstx directory.
-    Result = ParseOmbstx(DeviceSymbolInfos, DeviceIdInfos, wstrS7PFolderPath);
+    if (Options.bParseDBs)
+    {
+        Result = ParseOmbstx(DeviceSymbolInfos, DeviceIdInfos, wstrS7PFolderPath, Options);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
+        {
+            return *pError;
+        }
+    }
+
+    return DeviceSymbolInfos;
+}
+
+std::variant<std::vector<S7DeviceStatistics>, CS7PError>
+ParseS7PStatistics(const std::wstring& wstrS7PFilePath, const S7ParseOptions& Options)
+{
+    if (IsS7PArchivePath(wstrS7PFilePath))
+    {
+        // See ParseS7P.
+        std::wstring wstrExtractedS7PFilePath;
+        std::wstring wstrTempFolderPath;
+        auto ExtractResult = ExtractS7PArchive(wstrExtractedS7PFilePath, wstrTempFolderPath, wstrS7PFilePath);
+        if (const auto pError = std::get_if<CS7PError>(&ExtractResult))
+        {
+            return *pError;
+        }
+
+        auto ParseResult = ParseS7PStatistics(wstrExtractedS7PFilePath, Options);
+        DeleteExtractedS7PArchive(wstrTempFolderPath);
+
+        return ParseResult;
+    }
+
+    std::wstring wstrS7PFolderPath;
+    auto Result = GetS7PFolderPath(wstrS7PFolderPath, wstrS7PFilePath);
     if (const auto pError = std::get_if<CS7PError>(&Result))
     {
         return *pError;
     }
 
-    return DeviceSymbolInfos;
+    std::vector<S7DeviceFiles> DeviceFiles;
+    Result = ParseDeviceFiles(DeviceFiles, wstrS7PFolderPath, Options);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    std::vector<S7DeviceStatistics> DeviceStatistics;
+    size_t ProjectSymbolCount = 0;
+
+    for (const S7DeviceFiles& Files : DeviceFiles)
+    {
+        auto StatisticsResult = ParseDeviceStatistics(Files, wstrS7PFolderPath, Options, ProjectSymbolCount);
+        if (const auto pError = std::get_if<CS7PError>(&StatisticsResult))
+        {
+            return *pError;
+        }
+
+        DeviceStatistics.push_back(std::move(std::get<S7DeviceStatistics>(StatisticsResult)));
+    }
+
+    return DeviceStatistics;
 }
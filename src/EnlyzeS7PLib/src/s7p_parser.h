@@ -6,35 +6,305 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "CS7PError.h"
 
+enum class S7Area : uint8_t
+{
+    DB,
+    I,
+    Q,
+    M,
+};
+
+struct S7Address
+{
+    std::string AsString() const;
+
+    S7Area Area = S7Area::DB;
+    uint16_t DbNumber = 0;
+    uint32_t BitOffset = 0;
+    uint32_t BitSize = 0;
+    uint32_t ElementCount = 0;
+};
+
 struct S7Symbol
 {
     std::string strName;
-    std::string strCode;
     std::string strDatatype;
     std::string strComment;
+    S7Address Address;
+
+    // Symbol List code as found in the project, if it could not be parsed into Address (which is then left empty with a BitSize of 0).
+    // Use S7Block::GetCode() to output the code of any symbol.
+    std::string strRawCode;
+};
+
+struct S7Layout
+{
+    // Symbols of a layout shared by multiple instance DBs have a DbNumber of 0 in their addresses.
+    std::vector<S7Symbol> Symbols;
+};
+
+enum class S7SymbolNodeKind : uint8_t
+{
+    Struct,
+    Array,
+    Leaf,
+};
+
+struct S7SymbolNode
+{
+    S7SymbolNodeKind Kind;
+
+    // Nodes are stored in depth-first order, so the descendants of node i are Nodes[i + 1] up to Nodes[EndIndex - 1].
+    // The first child (if any) is node i + 1, and the next sibling of a child c is node Nodes[c].EndIndex.
+    uint32_t ParentIndex;
+    uint32_t EndIndex;
+
+    // Offsets and lengths into S7SymbolTree::strStrings.
+    // Names are local, e.g. "Speed" for "Motor.Speed" or "[3,1]" for an element of the complex array "Recipe".
+    uint32_t NameOffset;
+    uint32_t NameLength;
+    uint32_t DatatypeOffset;
+    uint32_t DatatypeLength;
+    uint32_t CommentOffset;
+    uint32_t CommentLength;
+
+    uint32_t BitOffset;
+    uint32_t BitSize;
+    uint32_t ElementCount;
+};
+
+// Symbols of a DB as a tree of STRUCT/UDT/FB variables, arrays of them, and leaf variables.
+// Leaves are exactly the symbols of the flattened representation.
+struct S7SymbolTree
+{
+    static const uint32_t NoParent = UINT32_MAX;
+
+    std::string_view GetName(const S7SymbolNode& Node) const { return std::string_view(strStrings).substr(Node.NameOffset, Node.NameLength); }
+    std::string_view GetDatatype(const S7SymbolNode& Node) const { return std::string_view(strStrings).substr(Node.DatatypeOffset, Node.DatatypeLength); }
+    std::string_view GetComment(const S7SymbolNode& Node) const { return std::string_view(strStrings).substr(Node.CommentOffset, Node.CommentLength); }
+
+    // Returns the name of a node as it appears in the flattened representation, e.g. "Recipe[3,1].Speed".
+    std::string GetFullName(uint32_t NodeIndex) const;
+    std::vector<S7Symbol> Flatten(uint16_t DbNumber) const;
+
+    // Returns the leaves flattened with a DbNumber of 0, like the symbols of a shared S7Layout.
+    // They are flattened on the first call and kept along with the tree, so this costs the memory the tree saves.
+    // Thread-safe.
+    const std::vector<S7Symbol>& GetSymbols() const;
+
+    std::vector<S7SymbolNode> Nodes;
+    std::string strStrings;
+
+    // Number of leaves.
+    size_t SymbolCount = 0;
+
+private:
+    mutable std::once_flag m_FlattenOnce;
+    mutable std::vector<S7Symbol> m_FlattenedSymbols;
 };
 
 struct S7Block
 {
+    S7Address GetAddress(const S7Symbol& Symbol) const;
+    std::string GetCode(const S7Symbol& Symbol) const;
+    const std::vector<S7Symbol>& GetSymbols() const;
+    std::vector<S7Symbol> Flatten() const;
+
     std::string strName;
+    uint16_t DbNumber = 0;
     std::vector<S7Symbol> Symbols;
+
+    // Instance DBs of the same FB only reference a shared layout and leave Symbols empty.
+    // Use GetSymbols() and GetAddress() to access the symbols of any block.
+    std::shared_ptr<const S7Layout> pInstanceLayout;
+
+    // Only set for DBs parsed with S7ParseOptions::bBuildSymbolTrees, which leave Symbols empty.
+    // Instance DBs of the same FB share a single tree.
+    // GetSymbols() and GetAddress() also work for these blocks, by flattening the tree once (see S7SymbolTree::GetSymbols).
+    // Code that wants to keep the memory savings walks the tree instead.
+    std::shared_ptr<const S7SymbolTree> pSymbolTree;
+};
+
+struct S7ParseMemoryReport
+{
+    struct Phase
+    {
+        std::string strName;
+
+        // Bytes and number of allocations requested by parse-scoped temporaries during this phase.
+        size_t BytesAllocated;
+        size_t AllocationCount;
+
+        // Maximum number of bytes held from the upstream memory resource at once during this phase.
+        size_t PeakBytes;
+    };
+
+    std::vector<Phase> Phases;
+    size_t PeakBytes = 0;
+};
+
+struct S7ParseOptions
+{
+    bool IsDbSelected(size_t DbNumber) const;
+    bool IsDeviceSelected(const std::string& strDeviceName) const;
+
+    // Limits to keep parsing bounded in time and memory even for malformed or adversarial projects.
+    // Exceeding any of them makes the affected DB end with a warning.
+    size_t MaxNestingDepth = 32;
+    size_t MaxSymbolsPerDb = 1000000;
+    size_t MaxSymbolsPerProject = 20000000;
+
+    // Applies to the product of the element counts of an array and all arrays enclosing it.
+    size_t MaxArrayElements = 1000000;
+
+    // If false, symbol names, symbol comments and block names are kept in their original Windows-1252 encoding.
+    // Callers then need to convert them via Cp1252ToUtf8 or Cp1252ToWstr (s7p_cp1252.h) when displaying or exporting them.
+    // Every S7DeviceSymbolInfo records this in its StringEncoding, and WriteS7PSnapshot converts such strings to UTF-8 itself.
+    // This saves a conversion per symbol if only a few of them are ever displayed.
+    // Device names are always converted to UTF-8.
+    bool bTranscodeStrings = true;
+
+    // Upstream resource for the temporaries of a parse (MC5 Code of all blocks and their token streams).
+    // They are drawn from a monotonic arena per Subblock List, which is released in one shot after parsing it.
+    // nullptr uses std::pmr::get_default_resource().
+    std::pmr::memory_resource* pMemoryResource = nullptr;
+
+    // If set, one phase per parsed Subblock List is appended to this report.
+    // Allocations of the dBASE reader and of the returned S7DeviceSymbolInfo structures are not accounted.
+    S7ParseMemoryReport* pMemoryReport = nullptr;
+
+    // Selective parsing.
+    // Unselected devices are skipped entirely, and unselected DBs are dropped before their MC5 Code is stored.
+    // FB, SFB and UDT blocks are always loaded, because selected DBs may reference them.
+    //
+    // DevicePatterns are matched case-insensitively against device names and may contain the wildcards '*' and '?'.
+    // DbRanges are inclusive ranges of DB numbers.
+    // An empty vector selects everything.
+    std::vector<std::string> DevicePatterns;
+    std::vector<std::pair<size_t, size_t>> DbRanges;
+    bool bParseSymbolLists = true;
+    bool bParseDBs = true;
+
+    // If true, DB symbols are returned as trees in S7Block::pSymbolTree instead of being flattened into S7Block::Symbols.
+    // Every node then only stores its local name, so deeply nested STRUCTs and UDTs no longer repeat their parent names in every symbol.
+    // The Symbol List is always returned flattened.
+    // S7Block::GetSymbols() still works for these DBs, but flattens each tree on first use and then keeps both.
+    bool bBuildSymbolTrees = false;
+};
+
+// Statistics of a single DB, as collected by ParseS7PStatistics.
+struct S7DbStatistics
+{
+    uint16_t DbNumber = 0;
+    size_t SymbolCount = 0;
+
+    // Size as computed by the address counter, including padding.
+    size_t ByteSize = 0;
+
+    // 0 for a DB without any STRUCT, UDT or FB variables.
+    size_t MaxNestingDepth = 0;
+
+    // Total number of elements over all arrays, including arrays nested in array elements.
+    size_t ArrayElementCount = 0;
+
+    // Warnings added while parsing this DB.
+    // DBs that could not be parsed at all appear with a SymbolCount of 0 and their warnings.
+    size_t WarningCount = 0;
+};
+
+struct S7DeviceStatistics
+{
+    std::string strName;
+    size_t SymbolListSymbolCount = 0;
+    std::vector<S7DbStatistics> Dbs;
+
+    // All warnings of the device, including those of the Symbol List and those counted per DB.
+    size_t WarningCount = 0;
+};
+
+// Block type ("DB", "DBREF", "FB", "SFB", "UDT") and block number, e.g. {"UDT", 5}.
+using S7BlockKey = std::pair<std::string, size_t>;
+
+// Position of the elements a Subblock List has added to the Blocks or Warnings of its device.
+struct S7SubblockListRange
+{
+    size_t First = 0;
+    size_t Count = 0;
+};
+
+// Blocks of a Subblock List and their dependencies, as recorded while parsing its DBs.
+// This is what ReparseOmbstxSubblockList (s7p_db_parser.h) uses to find the DBs affected by a change.
+struct S7SubblockListInfo
+{
+    // Hash of the MC5 Code of every block read from the Subblock List.
+    std::map<S7BlockKey, uint64_t> CodeHashes;
+
+    // Blocks directly referenced by each DB, FB, SFB and UDT, e.g. DB5 -> FB2 for an instance DB, or UDT3 -> UDT7.
+    // References to blocks that could not be found are recorded as well, so that adding them later is noticed.
+    std::map<S7BlockKey, std::set<S7BlockKey>> Dependencies;
+
+    // Warnings added while parsing each DB, so that they can be replaced when the DB is parsed again.
+    std::map<size_t, std::vector<CS7PError>> DbWarnings;
+
+    // DB at which parsing stopped because of Options.MaxSymbolsPerProject. This and all following DBs have not been parsed.
+    std::optional<size_t> StoppedAtDbNumber;
+
+    // Blocks and warnings added by this Subblock List. Each are contiguous, so that a reparse can replace them in place.
+    S7SubblockListRange BlockRange;
+    S7SubblockListRange WarningRange;
+};
+
+// Encoding of symbol names, symbol comments, block names and DB names (see S7ParseOptions::bTranscodeStrings).
+enum class S7StringEncoding : uint8_t
+{
+    Utf8,
+    Cp1252,
 };
 
 struct S7DeviceSymbolInfo
 {
     std::string strName;
+    S7StringEncoding StringEncoding = S7StringEncoding::Utf8;
     std::vector<S7Block> Blocks;
     std::map<size_t, std::string> DbNamesMap;
     std::vector<CS7PError> Warnings;
+
+    // By Subblock List ID.
+    std::map<size_t, S7SubblockListInfo> SubblockListInfos;
 };
 
+// wstrS7PFilePath is either the path to an .s7p file or to a zipped project archive (.zip).
 std::variant<std::vector<S7DeviceSymbolInfo>, CS7PError> ParseS7P(
+    const std::wstring& wstrS7PFilePath,
+    const S7ParseOptions& Options = S7ParseOptions()
+    );
+
+// Collects statistics about all devices and their DBs without building any DB symbol.
+// This needs little memory, as the MC5 Code is only walked once to advance the address counter.
+// The statistics benchmark of S7PBench measures it against a full parse: about twice as fast for flat DBs and far faster for large arrays of STRUCTs or UDTs.
+// Options and limits apply just like for ParseS7P.
+std::variant<std::vector<S7DeviceStatistics>, CS7PError> ParseS7PStatistics(
+    const std::wstring& wstrS7PFilePath,
+    const S7ParseOptions& Options = S7ParseOptions()
+    );
+
+// Returns the folder containing the .s7p file, which is the base for all further project files.
+std::variant<std::monostate, CS7PError> GetS7PFolderPath(
+    std::wstring& wstrS7PFolderPath,
     const std::wstring& wstrS7PFilePath
     );
@@ -0,0 +1,105 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <tuple>
+
+#include "s7p_read_planner.h"
+
+// A "Read Var" response PDU consists of a 12-byte header, a 2-byte parameter block, and a 4-byte header per data item.
+// Hence, this is the overhead we have to subtract from the negotiated PDU size to get the maximum payload of a single read.
+static const size_t ReadResponseOverhead = 12 + 2 + 4;
+
+
+std::variant<S7ReadPlan, CS7PError>
+PlanS7Reads(const std::vector<S7Address>& Addresses, const size_t PduSize, const size_t MaxGapBytes)
+{
+    if (PduSize <= ReadResponseOverhead)
+    {
+        return CS7PError(L"PDU size " + std::to_wstring(PduSize) + L" is too small for any read request");
+    }
+
+    const uint32_t MaxRangeSize = static_cast<uint32_t>(PduSize - ReadResponseOverhead);
+
+    S7ReadPlan Plan;
+    Plan.Mappings.resize(Addresses.size());
+
+    // Process all addresses sorted by address space and byte offset.
+    // Addresses with a BitSize of 0 (symbols without a parsed address) are left out and keep their empty mapping.
+    std::vector<size_t> Order;
+    for (size_t i = 0; i < Addresses.size(); i++)
+    {
+        if (Addresses[i].BitSize > 0)
+        {
+            Order.push_back(i);
+        }
+    }
+
+    std::sort(Order.begin(), Order.end(), [&](size_t a, size_t b)
+    {
+        const S7Address& AddressA = Addresses[a];
+        const S7Address& AddressB = Addresses[b];
+        return std::tie(AddressA.Area, AddressA.DbNumber, AddressA.BitOffset) < std::tie(AddressB.Area, AddressB.DbNumber, AddressB.BitOffset);
+    });
+
+    S7ReadRange* pCurrentRange = nullptr;
+
+    for (size_t i : Order)
+    {
+        const S7Address& Address = Addresses[i];
+        uint16_t DbNumber = (Address.Area == S7Area::DB) ? Address.DbNumber : 0;
+
+        // PLCs can only read whole bytes.
+        uint32_t FirstByte = Address.BitOffset / 8;
+        uint32_t EndByte = (Address.BitOffset + Address.BitSize + 7) / 8;
+
+        // Can this symbol be added to the current range?
+        // This is the case if it's in the same address space, the gap to bridge is small enough, and the extended range still fits into a PDU.
+        if (pCurrentRange &&
+            pCurrentRange->Area == Address.Area &&
+            pCurrentRange->DbNumber == DbNumber &&
+            FirstByte <= pCurrentRange->ByteOffset + pCurrentRange->ByteSize + MaxGapBytes &&
+            std::max(EndByte, pCurrentRange->ByteOffset + pCurrentRange->ByteSize) - pCurrentRange->ByteOffset <= MaxRangeSize)
+        {
+            pCurrentRange->ByteSize = std::max(EndByte, pCurrentRange->ByteOffset + pCurrentRange->ByteSize) - pCurrentRange->ByteOffset;
+
+            S7ReadMapping& Mapping = Plan.Mappings[i];
+            Mapping.RangeIndex = Plan.Ranges.size() - 1;
+            Mapping.ByteOffset = FirstByte - pCurrentRange->ByteOffset;
+            Mapping.RangeCount = 1;
+            continue;
+        }
+
+        // No, then start a new range.
+        // Symbols larger than a single PDU are split up into multiple consecutive ranges.
+        S7ReadMapping& Mapping = Plan.Mappings[i];
+        Mapping.RangeIndex = Plan.Ranges.size();
+        Mapping.ByteOffset = 0;
+        Mapping.RangeCount = 0;
+
+        for (uint32_t ByteOffset = FirstByte; ByteOffset < EndByte; ByteOffset += MaxRangeSize)
+        {
+            S7ReadRange& Range = Plan.Ranges.emplace_back();
+            Range.Area = Address.Area;
+            Range.DbNumber = DbNumber;
+            Range.ByteOffset = ByteOffset;
+            Range.ByteSize = std::min(MaxRangeSize, EndByte - ByteOffset);
+
+            Mapping.RangeCount++;
+        }
+
+        pCurrentRange = &Plan.Ranges.back();
+
+        // Don't merge any further symbols into the last part of a split symbol.
+        // Otherwise, the symbol's parts wouldn't be the only contents of their ranges.
+        if (Mapping.RangeCount > 1)
+        {
+            pCurrentRange = nullptr;
+        }
+    }
+
+    return Plan;
+}
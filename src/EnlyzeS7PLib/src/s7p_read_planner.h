@@ -0,0 +1,44 @@
+//
+// EnlyzeS7PLib - Library for parsing symbols in Siemens STEP 7 project files
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+#include <cstdint>
+#include <variant>
+#include <vector>
+
+#include "CS7PError.h"
+#include "s7p_parser.h"
+
+struct S7ReadRange
+{
+    S7Area Area;
+    uint16_t DbNumber;
+    uint32_t ByteOffset;
+    uint32_t ByteSize;
+};
+
+struct S7ReadMapping
+{
+    // Index of the first range containing the symbol and the byte offset of the symbol within that range.
+    // A symbol larger than a single PDU spans RangeCount consecutive ranges.
+    // An address with a BitSize of 0 (e.g. a Symbol List entry only available as strRawCode) is not read and has a RangeCount of 0.
+    size_t RangeIndex;
+    uint32_t ByteOffset;
+    size_t RangeCount;
+};
+
+struct S7ReadPlan
+{
+    std::vector<S7ReadRange> Ranges;
+    std::vector<S7ReadMapping> Mappings;
+};
+
+std::variant<S7ReadPlan, CS7PError> PlanS7Reads(
+    const std::vector<S7Address>& Addresses,
+    const size_t PduSize,
+    const size_t MaxGapBytes
+    );
@@ -7,11 +7,76 @@
 #include <EnlyzeWinStringLib.h>
 #include <CDbfReader.h>
 
+#include "s7p_cp1252.h"
 #include "s7p_symbol_list_parser.h"
 
 
+static bool
+_ParseSymbolListAddress(S7Address& Address, const std::string& strCode)
+{
+    // Symbol List codes are in their English form, e.g. "I1.0", "QB5", "MW200", or "MD10".
+    // The first character is the area, followed by an optional size character and the byte address.
+    // Only single bits have no size character and a bit number after the byte address.
+    const char* pszCurrent = strCode.c_str();
+    switch (*pszCurrent)
+    {
+        case 'I': Address.Area = S7Area::I; break;
+        case 'Q': Address.Area = S7Area::Q; break;
+        case 'M': Address.Area = S7Area::M; break;
+        default: return false;
+    }
+
+    pszCurrent++;
+
+    bool bIsBit = false;
+    switch (*pszCurrent)
+    {
+        case 'B': Address.BitSize = 8; pszCurrent++; break;
+        case 'W': Address.BitSize = 16; pszCurrent++; break;
+        case 'D': Address.BitSize = 32; pszCurrent++; break;
+        case 'X': Address.BitSize = 1; bIsBit = true; pszCurrent++; break;
+        default: Address.BitSize = 1; bIsBit = true; break;
+    }
+
+    // Get the byte address.
+    const char* pszStart = pszCurrent;
+    while (isdigit(*pszCurrent))
+    {
+        pszCurrent++;
+    }
+
+    auto Option = StrToSizeT(std::string(pszStart, pszCurrent - pszStart));
+    if (!Option.has_value() || Option.value() > UINT32_MAX / 8)
+    {
+        return false;
+    }
+
+    size_t ByteAddress = Option.value();
+    size_t BitNumber = 0;
+
+    // Get the bit number if this is a single bit.
+    if (bIsBit)
+    {
+        if (pszCurrent[0] != '.' || pszCurrent[1] < '0' || pszCurrent[1] > '7' || pszCurrent[2] != '\0')
+        {
+            return false;
+        }
+
+        BitNumber = pszCurrent[1] - '0';
+    }
+    else if (*pszCurrent != '\0')
+    {
+        return false;
+    }
+
+    Address.DbNumber = 0;
+    Address.BitOffset = static_cast<uint32_t>(ByteAddress * 8 + BitNumber);
+    Address.ElementCount = 1;
+    return true;
+}
+
 static std::variant<std::monostate, CS7PError>
-_ParseSingleYDBSymbolList(const std::wstring& wstrSymbolListFilePath, std::vector<S7Symbol>& Symbols, std::map<size_t, std::string>& DbNamesMap)
+_ParseSingleYDBSymbolList(const std::wstring& wstrSymbolListFilePath, std::vector<S7Symbol>& Symbols, std::map<size_t, std::string>& DbNamesMap, std::vector<CS7PError>& Warnings, const S7ParseOptions& Options)
 {
     // Parse the SYMLIST.DBF dBASE file.
     auto ReadDbfResult = CDbfReader::ReadDbf(wstrSymbolListFilePath);
@@ -80,21 +145,49 @@ _ParseSingleYDBSymbolList(const std::wstring& wstrSymbolListFilePath, std::vecto
         // Only add inputs, memory ("Merker"), and output symbols to the Symbols vector.
         if (const char c = *strCode.c_str(); c == 'I' || c == 'M' || c == 'Q')
         {
+            if (!Options.bParseSymbolLists)
+            {
+                // We are only reading this Symbol List for the DB names.
+                continue;
+            }
+
             S7Symbol& Symbol = Symbols.emplace_back();
-            Symbol.strName = Str1252ToStr(Record[SkzIndex]);
-            Symbol.strCode = std::move(strCode);
-            Symbol.strDatatype = Record[DatatypeIndex];
-            Symbol.strComment = Str1252ToStr(Record[CommentIndex]);
+            Symbol.strName = std::move(Record[SkzIndex]);
+            Symbol.strDatatype = std::move(Record[DatatypeIndex]);
+            Symbol.strComment = std::move(Record[CommentIndex]);
+
+            S7Address Address;
+            if (_ParseSymbolListAddress(Address, strCode))
+            {
+                Symbol.Address = Address;
+            }
+            else
+            {
+                // Keep the symbol with the code as is, it's just not available for address lookups.
+                Warnings.push_back(CS7PError(L"Could not parse Symbol List address \"" + StrToWstr(strCode) + L"\""));
+                Symbol.strRawCode = std::move(strCode);
+            }
+
+            if (Options.bTranscodeStrings)
+            {
+                Symbol.strName = Cp1252ToUtf8(std::move(Symbol.strName));
+                Symbol.strComment = Cp1252ToUtf8(std::move(Symbol.strComment));
+            }
         }
         else if (strCode.starts_with("DB"))
         {
             // The YDB symlist also contains names for the DBs we parse later (in _ParseOmbstx).
             // Save these names in the DbNames map.
             auto Option = StrToSizeT(strCode.substr(2));
-            if (Option.has_value())
+            if (Option.has_value() && Options.IsDbSelected(Option.value()))
             {
                 size_t DbNumber = Option.value();
-                std::string strName = Str1252ToStr(Record[SkzIndex]);
+                std::string strName = std::move(Record[SkzIndex]);
+                if (Options.bTranscodeStrings)
+                {
+                    strName = Cp1252ToUtf8(std::move(strName));
+                }
+
                 DbNamesMap[DbNumber] = std::move(strName);
             }
         }
@@ -102,7 +195,7 @@ _ParseSingleYDBSymbolList(const std::wstring& wstrSymbolListFilePath, std::vecto
 }
 
 std::variant<std::monostate, CS7PError>
-ParseYDBs(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<S7DeviceIdInfo>& DeviceIdInfos, const std::wstring& wstrS7PFolderPath)
+ParseYDBSymbolListPaths(std::vector<std::pair<size_t, std::wstring>>& SymbolListPaths, const std::wstring& wstrS7PFolderPath)
 {
     // Parse the SYMLISTS.DBF dBASE file.
     auto ReadDbfResult = CDbfReader::ReadDbf(wstrS7PFolderPath + L"\\YDBs\\SYMLISTS.DBF");
@@ -162,6 +255,54 @@ ParseYDBs(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<
         wstrSymbolListFilePath += StrToWstr(Record[DbPathIndex]);
         wstrSymbolListFilePath += L"\\SYMLIST.DBF";
 
+        SymbolListPaths.emplace_back(SymbolListId, std::move(wstrSymbolListFilePath));
+    }
+
+    return std::monostate();
+}
+
+std::variant<std::monostate, CS7PError>
+ParseYDBSymbolList(S7DeviceSymbolInfo& DeviceSymbolInfo, const std::wstring& wstrSymbolListFilePath, const S7ParseOptions& Options)
+{
+    if (!Options.bParseSymbolLists && !Options.bParseDBs)
+    {
+        return std::monostate();
+    }
+
+    DeviceSymbolInfo.StringEncoding = Options.bTranscodeStrings ? S7StringEncoding::Utf8 : S7StringEncoding::Cp1252;
+
+    // Parse this Symbol List.
+    // Even if only DBs are selected, we need it for the DB names.
+    std::vector<S7Symbol> Symbols;
+    auto ParseResult = _ParseSingleYDBSymbolList(wstrSymbolListFilePath, Symbols, DeviceSymbolInfo.DbNamesMap, DeviceSymbolInfo.Warnings, Options);
+    if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+    {
+        return *pError;
+    }
+
+    if (Options.bParseSymbolLists)
+    {
+        S7Block& Block = DeviceSymbolInfo.Blocks.emplace_back();
+        Block.strName = "Symbol List";
+        Block.DbNumber = 0;
+        Block.Symbols = std::move(Symbols);
+    }
+
+    return std::monostate();
+}
+
+std::variant<std::monostate, CS7PError>
+ParseYDBs(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<S7DeviceIdInfo>& DeviceIdInfos, const std::wstring& wstrS7PFolderPath, const S7ParseOptions& Options)
+{
+    std::vector<std::pair<size_t, std::wstring>> SymbolListPaths;
+    auto Result = ParseYDBSymbolListPaths(SymbolListPaths, wstrS7PFolderPath);
+    if (const auto pError = std::get_if<CS7PError>(&Result))
+    {
+        return *pError;
+    }
+
+    for (const auto& [SymbolListId, wstrSymbolListFilePath] : SymbolListPaths)
+    {
         // Find the Device that corresponds to this Symbol List.
         const auto& DeviceIdInfoIt = std::find_if(DeviceIdInfos.begin(), DeviceIdInfos.end(), [&](const S7DeviceIdInfo& other)
         {
@@ -173,16 +314,18 @@ ParseYDBs(std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<
             return CS7PError(L"Could not find DeviceIdInfo for Symbol List " + std::to_wstring(SymbolListId));
         }
 
+        // Skip devices that haven't been selected (ParseOmbstx skips the same ones).
+        if (!Options.IsDeviceSelected(DeviceIdInfoIt->strName))
+        {
+            continue;
+        }
+
         // Add it to the final DeviceSymbolInfos vector.
         S7DeviceSymbolInfo& DeviceSymbolInfo = DeviceSymbolInfos.emplace_back();
         DeviceSymbolInfo.strName = DeviceIdInfoIt->strName;
 
-        // Parse this Symbol List.
-        S7Block& Block = DeviceSymbolInfo.Blocks.emplace_back();
-        Block.strName = "Symbol List";
-
-        auto ParseResult = _ParseSingleYDBSymbolList(wstrSymbolListFilePath, Block.Symbols, DeviceSymbolInfo.DbNamesMap);
-        if (const auto pError = std::get_if<CS7PError>(&ParseResult))
+        Result = ParseYDBSymbolList(DeviceSymbolInfo, wstrSymbolListFilePath, Options);
+        if (const auto pError = std::get_if<CS7PError>(&Result))
         {
             return *pError;
         }
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -14,8 +15,23 @@
 #include "s7p_device_id_info_parser.h"
 #include "s7p_parser.h"
 
+// Parses the Symbol Lists of all devices and adds a DeviceSymbolInfo for each of them.
 std::variant<std::monostate, CS7PError> ParseYDBs(
     std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos,
     const std::vector<S7DeviceIdInfo>& DeviceIdInfos,
+    const std::wstring& wstrS7PFolderPath,
+    const S7ParseOptions& Options
+    );
+
+// Returns the Symbol List ID and SYMLIST.DBF path of every record in SYMLISTS.DBF.
+std::variant<std::monostate, CS7PError> ParseYDBSymbolListPaths(
+    std::vector<std::pair<size_t, std::wstring>>& SymbolListPaths,
     const std::wstring& wstrS7PFolderPath
     );
+
+// Parses the Symbol List of a single device.
+std::variant<std::monostate, CS7PError> ParseYDBSymbolList(
+    S7DeviceSymbolInfo& DeviceSymbolInfo,
+    const std::wstring& wstrSymbolListFilePath,
+    const S7ParseOptions& Options
+    );
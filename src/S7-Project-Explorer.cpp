@@ -22,6 +22,25 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLin
     UNREFERENCED_PARAMETER(hPrevInstance);
     UNREFERENCED_PARAMETER(lpCmdLine);
 
+    // Check for the headless watch and serve modes, which don't need any GUI.
+    int argc;
+    PWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (argv && IsWatchModeCommandLine(argc, argv))
+    {
+        iReturnValue = RunWatchMode(argc, argv);
+        LocalFree(argv);
+        return iReturnValue;
+    }
+
+    if (argv && IsServeModeCommandLine(argc, argv))
+    {
+        iReturnValue = RunServeMode(argc, argv);
+        LocalFree(argv);
+        return iReturnValue;
+    }
+
+    LocalFree(argv);
+
     // Initialize GDI+.
     Gdiplus::GdiplusStartupInput gpStartupInput;
     ULONG_PTR gpToken;
@@ -29,12 +29,16 @@
 #include "win32_wrappers.h"
 
 #include <EnlyzeWinStringLib.h>
+#include <CS7PProjectWatcher.h>
+#include <CS7PQueryServer.h>
 #include <s7p_parser.h>
 
 #include "resource.h"
 #include "csv_exporter.h"
+#include "serve_mode.h"
 #include "utils.h"
 #include "version.h"
+#include "watch_mode.h"
 
 // Forward declarations
 class CFilePage;
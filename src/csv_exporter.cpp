@@ -29,12 +29,12 @@ ExportCSV(const std::wstring& wstrCSVFilePath, const std::vector<S7DeviceSymbolI
         {
             std::string strSanitizedBlockName = _SanitizeString(Block.strName);
 
-            for (const S7Symbol& Symbol : Block.Symbols)
+            for (const S7Symbol& Symbol : Block.GetSymbols())
             {
                 strCSV += strSanitizedDeviceName + ";";
                 strCSV += strSanitizedBlockName + ";";
                 strCSV += _SanitizeString(Symbol.strName) + ";";
-                strCSV += Symbol.strCode + ";";
+                strCSV += Block.GetCode(Symbol) + ";";
                 strCSV += Symbol.strDatatype + ";";
                 strCSV += _SanitizeString(Symbol.strComment) + "\n";
             }
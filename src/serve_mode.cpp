@@ -0,0 +1,94 @@
+//
+// S7-Project-Explorer - GUI for browsing variables in Siemens STEP 7 projects and exporting the list
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+// Usage: S7-Project-Explorer /serve PIPENAME S7PFILE [S7PFILE ...]
+//
+// Answers symbol queries for the given projects over the named pipe (see CS7PQueryServer for the protocol).
+// Each project is named after its .s7p file without the extension and kept up to date while STEP 7 saves changes to it.
+// Runs until Ctrl+C is pressed in the calling console or the process is terminated.
+//
+
+#include "S7-Project-Explorer.h"
+
+
+static std::string
+_GetProjectName(const std::wstring& wstrS7PFilePath)
+{
+    const size_t NameStart = wstrS7PFilePath.find_last_of(L"\\/") + 1;
+    const size_t NameEnd = wstrS7PFilePath.rfind(L'.');
+    const size_t NameLength = (NameEnd == std::wstring::npos || NameEnd < NameStart) ? std::wstring::npos : NameEnd - NameStart;
+
+    return WstrToStr(wstrS7PFilePath.substr(NameStart, NameLength));
+}
+
+
+bool
+IsServeModeCommandLine(int argc, PWSTR* argv)
+{
+    return argc >= 2 && _wcsicmp(argv[1], L"/serve") == 0;
+}
+
+int
+RunServeMode(int argc, PWSTR* argv)
+{
+    AttachParentConsole();
+
+    if (argc < 4)
+    {
+        ConsoleLog(L"Usage: S7-Project-Explorer /serve PIPENAME S7PFILE [S7PFILE ...]");
+        return 1;
+    }
+
+    const std::wstring wstrPipeName = argv[2];
+
+    auto StartServerResult = CS7PQueryServer::Start(wstrPipeName);
+    if (const auto pError = std::get_if<CS7PError>(&StartServerResult))
+    {
+        ConsoleLog(pError->Message());
+        return 1;
+    }
+
+    CS7PQueryServer& Server = *std::get<std::unique_ptr<CS7PQueryServer>>(StartServerResult);
+
+    // Declared after the server, so that all watchers are stopped before the server goes away.
+    std::vector<std::unique_ptr<CS7PProjectWatcher>> Watchers;
+
+    for (int i = 3; i < argc; i++)
+    {
+        const std::wstring wstrS7PFilePath = argv[i];
+        const std::string strProjectName = _GetProjectName(wstrS7PFilePath);
+
+        // Every update replaces the project in the server, while running queries finish on the previous version.
+        auto Callback = [&Server, wstrS7PFilePath, strProjectName](const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<size_t>& ChangedDeviceIndexes, const std::optional<CS7PError>& Error)
+        {
+            UNREFERENCED_PARAMETER(ChangedDeviceIndexes);
+
+            if (Error.has_value())
+            {
+                ConsoleLog(L"Could not update " + wstrS7PFilePath + L": " + Error->Message());
+                return;
+            }
+
+            Server.SetProject(strProjectName, DeviceSymbolInfos);
+            ConsoleLog(L"Loaded " + wstrS7PFilePath + L" as project " + StrToWstr(strProjectName));
+        };
+
+        auto StartWatcherResult = CS7PProjectWatcher::Start(wstrS7PFilePath, Callback);
+        if (const auto pError = std::get_if<CS7PError>(&StartWatcherResult))
+        {
+            ConsoleLog(pError->Message());
+            return 1;
+        }
+
+        Watchers.push_back(std::move(std::get<std::unique_ptr<CS7PProjectWatcher>>(StartWatcherResult)));
+    }
+
+    ConsoleLog(L"Serving queries on " + wstrPipeName + L", press Ctrl+C to stop");
+    WaitForCtrlC();
+
+    Watchers.clear();
+    Server.Stop();
+    return 0;
+}
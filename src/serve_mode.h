@@ -0,0 +1,10 @@
+//
+// S7-Project-Explorer - GUI for browsing variables in Siemens STEP 7 projects and exporting the list
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+
+#pragma once
+
+bool IsServeModeCommandLine(int argc, PWSTR* argv);
+int RunServeMode(int argc, PWSTR* argv);
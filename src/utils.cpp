@@ -12,6 +12,42 @@ typedef HRESULT (WINAPI *PGetDpiForMonitor)(HMONITOR hmonitor, int dpiType, UINT
 #define LOAD_LIBRARY_SEARCH_SYSTEM32            0x00000800
 #endif
 
+static HANDLE _hConsoleOutput = INVALID_HANDLE_VALUE;
+static HANDLE _hCtrlCEvent;
+
+
+static BOOL WINAPI
+_ConsoleCtrlHandler(DWORD dwCtrlType)
+{
+    UNREFERENCED_PARAMETER(dwCtrlType);
+
+    SetEvent(_hCtrlCEvent);
+    return TRUE;
+}
+
+
+void
+AttachParentConsole()
+{
+    // We are a GUI application without a console of our own.
+    // Use the console of the calling command prompt if there is any, otherwise ConsoleLog does nothing.
+    AttachConsole(ATTACH_PARENT_PROCESS);
+    _hConsoleOutput = CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+}
+
+void
+ConsoleLog(const std::wstring& wstrMessage)
+{
+    if (_hConsoleOutput == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    const std::wstring wstrLine = wstrMessage + L"\r\n";
+    DWORD cchWritten;
+    WriteConsoleW(_hConsoleOutput, wstrLine.c_str(), static_cast<DWORD>(wstrLine.size()), &cchWritten, nullptr);
+}
+
 void
 ErrorBox(const std::wstring& wstrMessage)
 {
@@ -133,3 +169,19 @@ SafeLoadSystemLibrary(const std::wstring& wstrLibraryFile)
 
     return LoadLibraryExW(wstrLibraryFilePath.data(), NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
 }
+
+void
+WaitForCtrlC()
+{
+    _hCtrlCEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!_hCtrlCEvent)
+    {
+        return;
+    }
+
+    SetConsoleCtrlHandler(_ConsoleCtrlHandler, TRUE);
+    WaitForSingleObject(_hCtrlCEvent, INFINITE);
+    SetConsoleCtrlHandler(_ConsoleCtrlHandler, FALSE);
+
+    CloseHandle(_hCtrlCEvent);
+}
@@ -31,8 +31,11 @@ InstanceFromWndProc(HWND hWnd, UINT uMsg, LPARAM lParam)
 }
 
 // utils.cpp
+void AttachParentConsole();
+void ConsoleLog(const std::wstring& wstrMessage);
 void ErrorBox(const std::wstring& wstrMessage);
 WORD GetWindowDPI(HWND hWnd);
 std::wstring LoadStringAsWstr(HINSTANCE hInstance, UINT uID);
 std::unique_ptr<Gdiplus::Bitmap> LoadPNGAsGdiplusBitmap(HINSTANCE hInstance, UINT uID);
 HMODULE SafeLoadSystemLibrary(const std::wstring& LibraryName);
+void WaitForCtrlC();
@@ -0,0 +1,102 @@
+//
+// S7-Project-Explorer - GUI for browsing variables in Siemens STEP 7 projects and exporting the list
+// Copyright (c) 2022 Colin Finck, ENLYZE GmbH <c.finck@enlyze.com>
+// SPDX-License-Identifier: MIT
+//
+// Usage: S7-Project-Explorer /watch S7PFILE CSVFILE
+//
+// Exports the project to the CSV file and keeps the export up to date while STEP 7 saves changes to the project.
+// Only the changed devices are reparsed, and the CSV file is replaced atomically, so readers never see a partial export.
+// Runs until Ctrl+C is pressed in the calling console or the process is terminated.
+//
+
+#include "S7-Project-Explorer.h"
+
+
+static std::variant<std::monostate, CS7PError>
+_ExportCSVAtomically(const std::wstring& wstrCSVFilePath, const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos)
+{
+    const std::wstring wstrTempFilePath = wstrCSVFilePath + L".tmp";
+
+    auto ExportResult = ExportCSV(wstrTempFilePath, DeviceSymbolInfos);
+    if (const auto pError = std::get_if<CS7PError>(&ExportResult))
+    {
+        DeleteFileW(wstrTempFilePath.c_str());
+        return *pError;
+    }
+
+    if (!MoveFileExW(wstrTempFilePath.c_str(), wstrCSVFilePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        const DWORD dwMoveError = GetLastError();
+        DeleteFileW(wstrTempFilePath.c_str());
+        return CS7PError(L"MoveFileExW failed with error " + std::to_wstring(dwMoveError));
+    }
+
+    return std::monostate();
+}
+
+
+bool
+IsWatchModeCommandLine(int argc, PWSTR* argv)
+{
+    return argc >= 2 && _wcsicmp(argv[1], L"/watch") == 0;
+}
+
+int
+RunWatchMode(int argc, PWSTR* argv)
+{
+    AttachParentConsole();
+
+    if (argc != 4)
+    {
+        ConsoleLog(L"Usage: S7-Project-Explorer /watch S7PFILE CSVFILE");
+        return 1;
+    }
+
+    const std::wstring wstrS7PFilePath = argv[2];
+    const std::wstring wstrCSVFilePath = argv[3];
+
+    // The callback runs on the thread calling CS7PProjectWatcher::Start for the initial export and on the watcher thread afterwards,
+    // but never on both at the same time.
+    auto Callback = [&](const std::vector<S7DeviceSymbolInfo>& DeviceSymbolInfos, const std::vector<size_t>& ChangedDeviceIndexes, const std::optional<CS7PError>& Error)
+    {
+        if (Error.has_value())
+        {
+            ConsoleLog(L"Could not update " + wstrS7PFilePath + L": " + Error->Message());
+            return;
+        }
+
+        auto ExportResult = _ExportCSVAtomically(wstrCSVFilePath, DeviceSymbolInfos);
+        if (const auto pError = std::get_if<CS7PError>(&ExportResult))
+        {
+            ConsoleLog(L"Could not export " + wstrCSVFilePath + L": " + pError->Message());
+            return;
+        }
+
+        std::wstring wstrDeviceNames;
+        for (size_t DeviceIndex : ChangedDeviceIndexes)
+        {
+            if (!wstrDeviceNames.empty())
+            {
+                wstrDeviceNames += L", ";
+            }
+
+            wstrDeviceNames += StrToWstr(DeviceSymbolInfos[DeviceIndex].strName);
+        }
+
+        ConsoleLog(L"Exported " + wstrCSVFilePath + L" after parsing " + wstrDeviceNames);
+    };
+
+    auto StartResult = CS7PProjectWatcher::Start(wstrS7PFilePath, Callback);
+    if (const auto pError = std::get_if<CS7PError>(&StartResult))
+    {
+        ConsoleLog(pError->Message());
+        return 1;
+    }
+
+    ConsoleLog(L"Watching " + wstrS7PFilePath + L", press Ctrl+C to stop");
+    WaitForCtrlC();
+
+    std::get<std::unique_ptr<CS7PProjectWatcher>>(StartResult)->Stop();
+    return 0;
+}